@@ -6,11 +6,19 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <filesystem>
 #include <functional>
 #include <map>
 #include <memory>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
 // TODO: use std::expected instead in C++23
 #include "expected.h"
@@ -22,6 +30,11 @@ enum class Error {
   DEVICE_NOT_AVAILABLE,
   OPERATION_UNSUPPORTED,
   OUT_OF_RANGE,
+  // See `SetNativeCallTimeout()`
+  TIMEOUT,
+  // See `StartAudioDeviceStateBroker()` and
+  // `ConnectToAudioDeviceStateBroker()`
+  BROKER_NOT_AVAILABLE,
 };
 
 template <>
@@ -41,6 +54,10 @@ class bad_expected_access<Error> : public bad_expected_access<void> {
         return "Bad expected access - unknown OS error";
       case Error::OUT_OF_RANGE:
         return "Bad expected access - out of range";
+      case Error::TIMEOUT:
+        return "Bad expected access - timed out";
+      case Error::BROKER_NOT_AVAILABLE:
+        return "Bad expected access - broker not available";
     }
     return "Bad expected access - INVALID ERROR VALUE";
   };
@@ -81,15 +98,111 @@ struct AudioDeviceInfo {
   auto operator<=>(const AudioDeviceInfo&) const = default;
 };
 
+/* Device properties are fetched concurrently, on library-owned threads.
+ *
+ * If an enumeration timeout has been set, devices that haven't reported
+ * their properties by then are left out, so that one unresponsive device
+ * doesn't delay the others. They are also left out of later lists, without
+ * being queried again, until the call that timed out returns.
+ */
 std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(AudioDeviceDirection);
+// Defaults to zero, which waits for every device
+void SetDeviceEnumerationTimeout(std::chrono::milliseconds);
+
 AudioDeviceState GetAudioDeviceState(const std::string& id);
 
+/* Blocks until the device is in `state`, or `timeout` has passed, in which
+ * case it fails with `Error::TIMEOUT`.
+ *
+ * Waiters are woken by native plug and state notifications rather than by
+ * polling; the device's state is queried once per notification, however
+ * many callers are waiting for it.
+ */
+result<void> WaitForDeviceState(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout);
+// Returns immediately; `onComplete` is invoked on a library-owned thread
+void WaitForDeviceState(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout,
+  std::function<void(result<void>)> onComplete);
+
+/* `co_await AwaitDeviceState(...)` is equivalent to `WaitForDeviceState()`.
+ *
+ * The coroutine is resumed on a library-owned thread; this works with any
+ * coroutine type, and doesn't need an executor.
+ */
+class AudioDeviceStateAwaitable final {
+ public:
+  AudioDeviceStateAwaitable(
+    std::string id,
+    AudioDeviceState state,
+    std::chrono::milliseconds timeout);
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<>);
+  result<void> await_resume() const;
+
+ private:
+  std::string mID;
+  AudioDeviceState mState;
+  std::chrono::milliseconds mTimeout;
+  std::optional<Error> mError;
+};
+
+AudioDeviceStateAwaitable AwaitDeviceState(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout);
+
 std::string GetDefaultAudioDeviceID(AudioDeviceDirection, AudioDeviceRole);
 void SetDefaultAudioDeviceID(
   AudioDeviceDirection,
   AudioDeviceRole,
   const std::string& deviceID);
 
+/* Bounds how long mute, volume and stream property calls wait for the
+ * platform; zero (the default) waits indefinitely.
+ *
+ * Calls that miss the deadline fail with `Error::TIMEOUT`, and so does every
+ * later call for the same device, without waiting, until the platform
+ * returns from the calls that timed out.
+ */
+void SetNativeCallTimeout(std::chrono::milliseconds);
+
+enum class NativeCallThreading {
+  // Calls are made on the calling thread, unless there is a timeout; this is
+  // the default
+  CALLING_THREAD,
+  /* `GetAudioDeviceList()`, prewarming, and the mute, volume, channel
+   * volume and stream property functions are all made on a single
+   * library-owned thread, and callers don't need to initialize COM on
+   * Windows for them.
+   *
+   * Other calls, such as `GetAudioDeviceState()`, the default device
+   * functions, callback registration, capture streams, identification tones
+   * and the session functions, are still made on the calling thread. To keep
+   * every native call on the backend thread, make those from a task passed
+   * to `PostToAudioBackendThread()`.
+   *
+   * A call that hangs delays every other call.
+   */
+  BACKEND_THREAD,
+};
+void SetNativeCallThreading(NativeCallThreading);
+
+/* Runs `task` on the library-owned backend thread, in the order posted.
+ *
+ * Library calls made from `task` run directly on that thread, so this can be
+ * used to make any sequence of calls asynchronously. `task` must not block
+ * for long, as it delays every other task.
+ */
+void PostToAudioBackendThread(std::function<void()> task);
+
 result<bool> IsAudioDeviceMuted(const std::string& deviceID);
 result<void> MuteAudioDevice(const std::string& deviceID);
 result<void> UnmuteAudioDevice(const std::string& deviceID);
@@ -115,6 +228,142 @@ result<void> SetDeviceVolumeDecibels(const std::string& deviceID, float);
 result<void> IncreaseDeviceVolume(const std::string& deviceID);
 result<void> DecreaseDeviceVolume(const std::string& deviceID);
 
+// Scalars for every channel, in [0, 1]; channel 0 is left, and 1 is right
+result<std::vector<float>> GetDeviceChannelVolumes(const std::string& deviceID);
+// Must have one value per channel; only channels that differ are written
+result<void> SetDeviceChannelVolumes(
+  const std::string& deviceID,
+  std::span<const float>);
+
+// From -1 (left only) to 1 (right only); 0 is centered
+result<float> GetDeviceVolumeBalance(const std::string& deviceID);
+/* Pans between the first two channels, preserving their combined power so
+ * that the perceived loudness doesn't change.
+ *
+ * If that would need a channel above full scale, both are scaled down.
+ */
+result<void> SetDeviceVolumeBalance(const std::string& deviceID, float);
+
+enum class VolumeAcceleration {
+  // Every adjustment changes the volume by exactly `delta`
+  NONE,
+  // Adjustments in quick succession are scaled up, by up to 4x
+  LINEAR,
+  // As `LINEAR`, but scaled up by up to 16x
+  QUADRATIC,
+};
+
+/* Adjusts the volume scalar by `delta`, for high-rate relative input such as
+ * dials or rotary encoders.
+ *
+ * Adjustments are accumulated and written as a single absolute value, at most
+ * once per device every 16ms, from a library-owned thread. The volume the
+ * device ends up with is the sum of every (accelerated) delta, applied to the
+ * volume at the start of the burst and clamped to [0, 1] after each one.
+ *
+ * Failed writes are retried with the latest target. If they keep failing, or
+ * the device is no longer available, the pending adjustments are dropped,
+ * and `onWriteFailed` from the latest call for the device (if provided) is
+ * invoked with the error on the library-owned thread. The next call starts
+ * over from the device's current volume.
+ *
+ * Only reading the volume at the start of a burst can make this fail.
+ */
+result<void> AdjustDeviceVolumeBy(
+  const std::string& deviceID,
+  float delta,
+  VolumeAcceleration = VolumeAcceleration::NONE,
+  std::function<void(Error)> onWriteFailed = {});
+
+enum class VolumeRampCurve {
+  LINEAR,
+  // Starts slowly, then speeds up
+  EASE_IN,
+  // Starts quickly, then slows down
+  EASE_OUT,
+  EASE_IN_OUT,
+};
+
+enum class VolumeRampResult {
+  // The target volume was reached
+  COMPLETED,
+  // Replaced by another ramp for the same device, or by
+  // `CancelDeviceVolumeRamp()`
+  CANCELLED,
+  // Something else changed the volume while the ramp was running
+  INTERRUPTED,
+  // Reading or writing the volume failed
+  FAILED,
+};
+
+/* Changes the volume scalar to `target` over `duration`, then invokes
+ * `onComplete` (if provided).
+ *
+ * All ramps are serviced by a single library-owned timer thread, writing at
+ * most once per device per frame; see `SetVolumeRampFrameRate()`.
+ *
+ * `onComplete` is invoked on the timer thread, except for `CANCELLED`, which
+ * is invoked on the thread that cancelled the ramp.
+ */
+result<void> RampDeviceVolume(
+  const std::string& deviceID,
+  float target,
+  std::chrono::milliseconds duration,
+  VolumeRampCurve = VolumeRampCurve::LINEAR,
+  std::function<void(VolumeRampResult)> onComplete = {});
+void CancelDeviceVolumeRamp(const std::string& deviceID);
+// Defaults to 60
+void SetVolumeRampFrameRate(uint32_t framesPerSecond);
+
+enum class CallbackDelivery {
+  // Invoke the callback for every native notification
+  ALL_NOTIFICATIONS,
+  // Only invoke the callback if a value it reports has changed since the
+  // previous invocation (or since it was registered)
+  CHANGES_ONLY,
+};
+
+// Bitmask of the `Volume` fields that changed
+enum class VolumeChangedFields : uint8_t {
+  NONE = 0,
+  MUTE = 1 << 0,
+  SCALAR = 1 << 1,
+  DECIBELS = 1 << 2,
+  STEP = 1 << 3,
+  CHANNELS = 1 << 4,
+};
+
+constexpr VolumeChangedFields operator|(
+  VolumeChangedFields a,
+  VolumeChangedFields b) {
+  return static_cast<VolumeChangedFields>(
+    static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
+
+constexpr VolumeChangedFields operator&(
+  VolumeChangedFields a,
+  VolumeChangedFields b) {
+  return static_cast<VolumeChangedFields>(
+    static_cast<uint8_t>(a) & static_cast<uint8_t>(b));
+}
+
+constexpr VolumeChangedFields& operator|=(
+  VolumeChangedFields& a,
+  VolumeChangedFields b) {
+  return a = a | b;
+}
+
+struct VolumeChangeEvent {
+  Volume volume;
+  // Per-channel scalars, if the platform includes them in notifications.
+  // Only valid for the duration of the callback.
+  std::span<const float> channelVolumes {};
+  VolumeChangedFields changedFields {VolumeChangedFields::NONE};
+  // Incremented for every native notification, including suppressed ones, so
+  // gaps show how many notifications were coalesced
+  uint64_t sequenceNumber {};
+};
+
 class MuteCallbackHandle final {
  public:
   class Impl;
@@ -128,7 +377,8 @@ class MuteCallbackHandle final {
 
 result<MuteCallbackHandle> AddAudioDeviceMuteUnmuteCallback(
   const std::string& deviceID,
-  std::function<void(bool isMuted)>);
+  std::function<void(bool isMuted)>,
+  CallbackDelivery = CallbackDelivery::ALL_NOTIFICATIONS);
 
 class VolumeCallbackHandle final {
  public:
@@ -143,7 +393,13 @@ class VolumeCallbackHandle final {
 
 result<VolumeCallbackHandle> AddAudioDeviceVolumeCallback(
   const std::string& deviceID,
-  std::function<void(const Volume&)>);
+  std::function<void(const Volume&)>,
+  CallbackDelivery = CallbackDelivery::ALL_NOTIFICATIONS);
+
+result<VolumeCallbackHandle> AddAudioDeviceVolumeChangeCallback(
+  const std::string& deviceID,
+  std::function<void(const VolumeChangeEvent&)>,
+  CallbackDelivery = CallbackDelivery::CHANGES_ONLY);
 
 class DefaultChangeCallbackHandle final {
  public:
@@ -176,4 +432,683 @@ enum class AudioDevicePlugEvent { ADDED, REMOVED };
 AudioDevicePlugEventCallbackHandle AddAudioDevicePlugEventCallback(
   std::function<void(AudioDevicePlugEvent, const std::string&)>);
 
+enum class AudioDeviceEventKind {
+  ADDED,
+  REMOVED,
+  DEFAULT_CHANGED,
+  // The device was enabled, disabled, plugged or unplugged; on Windows, this
+  // is also reported as `ADDED` or `REMOVED`. Not reported on macOS.
+  STATE_CHANGED,
+  // One of the device's names, or its shared-mode format, changed. Not
+  // reported on macOS.
+  PROPERTY_CHANGED,
+};
+
+struct AudioDeviceEvent {
+  AudioDeviceEventKind kind;
+  AudioDeviceDirection direction;
+  // Only set for `DEFAULT_CHANGED`
+  std::optional<AudioDeviceRole> role {};
+  // Empty for `DEFAULT_CHANGED` if there is no longer a default device
+  std::string deviceID {};
+  // The new state; only set for `STATE_CHANGED`
+  std::optional<AudioDeviceState> state {};
+};
+
+/* Events are only delivered if they match every non-empty field.
+ *
+ * This is evaluated inside the library, before any callback is invoked.
+ */
+struct AudioDeviceEventFilter {
+  std::vector<AudioDeviceEventKind> kinds {};
+  std::vector<AudioDeviceDirection> directions {};
+  // Only checked for `DEFAULT_CHANGED` events
+  std::vector<AudioDeviceRole> roles {};
+  std::vector<std::string> deviceIDs {};
+  std::string deviceIDPrefix {};
+};
+
+class AudioDeviceEventCallbackHandle final {
+ public:
+  class Impl;
+  AudioDeviceEventCallbackHandle() = default;
+  AudioDeviceEventCallbackHandle(const std::shared_ptr<Impl>& p);
+  ~AudioDeviceEventCallbackHandle();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+AudioDeviceEventCallbackHandle AddAudioDeviceEventCallback(
+  const AudioDeviceEventFilter&,
+  std::function<void(const AudioDeviceEvent&)>);
+
+/* A non-owning `AudioDeviceEvent`, only valid for the duration of the
+ * callback.
+ *
+ * These are built in a preallocated pool, so no heap allocations are made by
+ * the library between the native notification and the callback; copy
+ * `deviceID` if you need it later.
+ */
+struct AudioDeviceEventView {
+  AudioDeviceEventKind kind;
+  AudioDeviceDirection direction;
+  std::optional<AudioDeviceRole> role {};
+  std::string_view deviceID {};
+  std::optional<AudioDeviceState> state {};
+};
+
+AudioDeviceEventCallbackHandle AddAudioDeviceEventViewCallback(
+  const AudioDeviceEventFilter&,
+  std::function<void(const AudioDeviceEventView&)>);
+
+enum class AudioDeviceJournalEntryKind {
+  ADDED,
+  REMOVED,
+  DEFAULT_CHANGED,
+  // Includes mute changes
+  VOLUME_CHANGED,
+  // For devices that can be muted, but have no volume control
+  MUTE_CHANGED,
+  // Not recorded on macOS, which doesn't report state changes
+  STATE_CHANGED,
+};
+
+struct AudioDeviceJournalEntry {
+  // Starts at 1, and increases by 1 for each entry
+  uint64_t sequenceNumber {};
+  AudioDeviceJournalEntryKind kind;
+  AudioDeviceDirection direction;
+  // Only set for `DEFAULT_CHANGED`
+  std::optional<AudioDeviceRole> role {};
+  // Empty for `DEFAULT_CHANGED` if there is no longer a default device
+  std::string deviceID {};
+  // Only set for `VOLUME_CHANGED`
+  std::optional<Volume> volume {};
+  // Only set for `MUTE_CHANGED`
+  std::optional<bool> isMuted {};
+  // Only set for `STATE_CHANGED`
+  std::optional<AudioDeviceState> state {};
+};
+
+/* Starts recording device events in memory, keeping the most recent
+ * `capacity` entries; if already recording, this only changes the capacity.
+ *
+ * Volume and mute changes are recorded for every connected device; devices
+ * that can be muted but have no volume control get `MUTE_CHANGED` entries
+ * instead of `VOLUME_CHANGED`.
+ */
+void StartAudioDeviceJournal(size_t capacity = 4096);
+// The most recent entry, or 0 if there are none
+uint64_t GetAudioDeviceJournalSequenceNumber();
+
+class AudioDeviceJournalCallbackHandle final {
+ public:
+  class Impl;
+  AudioDeviceJournalCallbackHandle() = default;
+  AudioDeviceJournalCallbackHandle(const std::shared_ptr<Impl>& p);
+  ~AudioDeviceJournalCallbackHandle();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+/* Invokes the callback for each recorded entry after `afterSequenceNumber`,
+ * then for each new entry, in order and without gaps. Starts the journal if
+ * it isn't already recording.
+ *
+ * Fails with `Error::OUT_OF_RANGE` if any of the entries have already been
+ * evicted. To resync, get the current sequence number, then query the state
+ * you need, then add a callback after that sequence number; entries that
+ * were recorded while querying are replayed.
+ *
+ * Replayed entries are delivered on the calling thread before this returns,
+ * and new entries on native notification threads. Callbacks are invoked
+ * one at a time and without any library lock held, so they can add or
+ * remove journal callbacks; a slow callback delays later entries.
+ */
+result<AudioDeviceJournalCallbackHandle> AddAudioDeviceJournalCallback(
+  uint64_t afterSequenceNumber,
+  std::function<void(const AudioDeviceJournalEntry&)>);
+
+// Bitmask of the `AudioDeviceInfo` fields that changed
+enum class AudioDeviceInfoFields : uint8_t {
+  NONE = 0,
+  INTERFACE_NAME = 1 << 0,
+  ENDPOINT_NAME = 1 << 1,
+  DISPLAY_NAME = 1 << 2,
+  STATE = 1 << 3,
+  ALL = INTERFACE_NAME | ENDPOINT_NAME | DISPLAY_NAME | STATE,
+};
+
+constexpr AudioDeviceInfoFields operator|(
+  AudioDeviceInfoFields a,
+  AudioDeviceInfoFields b) {
+  return static_cast<AudioDeviceInfoFields>(
+    static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
+
+constexpr AudioDeviceInfoFields operator&(
+  AudioDeviceInfoFields a,
+  AudioDeviceInfoFields b) {
+  return static_cast<AudioDeviceInfoFields>(
+    static_cast<uint8_t>(a) & static_cast<uint8_t>(b));
+}
+
+constexpr AudioDeviceInfoFields& operator|=(
+  AudioDeviceInfoFields& a,
+  AudioDeviceInfoFields b) {
+  return a = a | b;
+}
+
+enum class AudioDeviceChangeKind {
+  ADDED,
+  // The device no longer exists; devices that are disabled or unplugged are
+  // `CHANGED`, with their new `state`
+  REMOVED,
+  CHANGED,
+};
+
+struct AudioDeviceChangeEvent {
+  AudioDeviceChangeKind kind;
+  // `ALL` for `ADDED`, and `NONE` for `REMOVED`
+  AudioDeviceInfoFields changedFields {AudioDeviceInfoFields::NONE};
+  // The new values; for `REMOVED`, the last known values
+  AudioDeviceInfo info;
+};
+
+class AudioDeviceChangeCallbackHandle final {
+ public:
+  class Impl;
+  AudioDeviceChangeCallbackHandle() = default;
+  AudioDeviceChangeCallbackHandle(const std::shared_ptr<Impl>& p);
+  ~AudioDeviceChangeCallbackHandle();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+/* Keeps a cache of `AudioDeviceInfo` up to date without re-enumerating:
+ * the callback is first invoked with `ADDED` for every device that is
+ * already known, then for each change, in order.
+ *
+ * Only the device that a native notification is for is queried, and
+ * notifications that don't change anything are not delivered. Callbacks are
+ * invoked on a library-owned thread.
+ */
+AudioDeviceChangeCallbackHandle AddAudioDeviceChangeCallback(
+  std::function<void(const AudioDeviceChangeEvent&)>);
+
+struct AudioDeviceListSnapshot {
+  // Both directions, keyed by ID
+  std::map<std::string, AudioDeviceInfo> devices {};
+  // Empty if there is no default device
+  std::string defaultOutputID {};
+  std::string defaultCommunicationOutputID {};
+  std::string defaultInputID {};
+  std::string defaultCommunicationInputID {};
+  // True if this was loaded from the cache, and hasn't been refreshed yet
+  bool isPossiblyStale {};
+};
+
+/* Returns the devices and defaults stored in `cachePath` without querying
+ * the platform, for fast startup.
+ *
+ * The cache is then refreshed on a library-owned thread, and `onRefresh` is
+ * invoked there for each difference found, as if it had been reported by
+ * `AddAudioDeviceEventCallback()`: devices that are now connected are
+ * `ADDED`, and devices that are no longer connected are `REMOVED`.
+ *
+ * If the cache is missing or invalid, the platform is queried immediately,
+ * and the cache is written.
+ */
+AudioDeviceListSnapshot GetCachedAudioDeviceList(
+  const std::filesystem::path& cachePath,
+  std::function<void(const AudioDeviceEvent&)> onRefresh = {});
+
+struct AudioDevicePrewarmOptions {
+  // Empty for every connected device
+  std::vector<std::string> deviceIDs {};
+};
+
+/* Resolves the native objects for each device in parallel, on library-owned
+ * threads, so that the first mute or volume call for a device doesn't stall.
+ *
+ * Returns immediately. `onComplete` is invoked on a library-owned thread once
+ * every device has been prewarmed; devices that fail are skipped.
+ */
+void PrewarmAudioDevices(
+  const AudioDevicePrewarmOptions& = {},
+  std::function<void()> onComplete = {});
+
+struct AudioDeviceStreamProperties;
+class StreamPropertiesCallbackHandle;
+
+/* An independent set of library-owned threads and settings for enumeration,
+ * prewarming, and mute and volume calls.
+ *
+ * The free functions above use `GetDefaultAudioContext()`. Each context has
+ * its own worker threads, backend thread, native call timeout, threading
+ * mode, enumeration timeout and quarantined devices, so components that
+ * need different timeouts or threading can be isolated from each other.
+ *
+ * Each context also owns its timer thread, and its default device and
+ * stream property caches; `ResetCaches()` empties the caches, e.g. between
+ * tests. Everything else is shared by the whole process, including between
+ * contexts, and lives until the process exits: the platform's native objects
+ * and the locks that guard them, notifications, and the components that are
+ * only available through the free functions, such as volume ramps.
+ *
+ * `Shutdown()` stops the timer thread, drops the caches, and releases their
+ * notification registrations; it waits for their running callbacks, so it
+ * must not be called from one. Afterwards, calls still work but are not
+ * cached, stream property callbacks can't be added, and timer-driven work -
+ * including, for the default context, volume ramps and fades - stops
+ * without invoking its completion callbacks.
+ *
+ * Destroying the last copy of a context shuts it down. It doesn't wait for
+ * native calls that are still running; its threads exit once they have
+ * finished.
+ */
+class AudioContext final {
+ public:
+  class Impl;
+  AudioContext() = default;
+  AudioContext(const std::shared_ptr<Impl>& p);
+  ~AudioContext();
+
+  std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(
+    AudioDeviceDirection) const;
+  void SetDeviceEnumerationTimeout(std::chrono::milliseconds);
+
+  void SetNativeCallTimeout(std::chrono::milliseconds);
+  void SetNativeCallThreading(NativeCallThreading);
+  void PostToAudioBackendThread(std::function<void()> task);
+
+  result<bool> IsAudioDeviceMuted(const std::string& deviceID) const;
+  result<void> MuteAudioDevice(const std::string& deviceID);
+  result<void> UnmuteAudioDevice(const std::string& deviceID);
+
+  result<VolumeRange> GetDeviceVolumeRange(const std::string& deviceID) const;
+  result<Volume> GetDeviceVolume(const std::string& deviceID) const;
+  result<void> SetDeviceVolumeScalar(const std::string& deviceID, float);
+  result<void> SetDeviceVolumeDecibels(const std::string& deviceID, float);
+  result<void> IncreaseDeviceVolume(const std::string& deviceID);
+  result<void> DecreaseDeviceVolume(const std::string& deviceID);
+
+  result<std::vector<float>> GetDeviceChannelVolumes(
+    const std::string& deviceID) const;
+  result<void> SetDeviceChannelVolumes(
+    const std::string& deviceID,
+    std::span<const float>);
+
+  void PrewarmAudioDevices(
+    const AudioDevicePrewarmOptions& = {},
+    std::function<void()> onComplete = {});
+
+  std::string GetDefaultAudioDeviceID(AudioDeviceDirection, AudioDeviceRole)
+    const;
+  void SetDefaultAudioDeviceID(
+    AudioDeviceDirection,
+    AudioDeviceRole,
+    const std::string& deviceID);
+
+  result<AudioDeviceStreamProperties> GetDeviceStreamProperties(
+    const std::string& deviceID) const;
+  result<StreamPropertiesCallbackHandle> AddDeviceStreamPropertiesCallback(
+    const std::string& deviceID,
+    std::function<void(const AudioDeviceStreamProperties&)>);
+
+  void ResetCaches();
+  void Shutdown();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+AudioContext CreateAudioContext();
+// Used by the free functions; lives for the life of the process
+AudioContext GetDefaultAudioContext();
+
+/* Broker mode, for when several processes need the same device state.
+ *
+ * The broker process owns the native notifications, and publishes the
+ * device list, the default devices, and the mute state and volume of each
+ * connected device in shared memory, so that other processes don't need
+ * notifications of their own, and can read the state without any system
+ * calls.
+ *
+ * Only one broker can use a given name at a time; starting another fails
+ * with `Error::BROKER_NOT_AVAILABLE`. The shared state holds up to 32
+ * devices, preferring connected devices, and long names are truncated.
+ *
+ * The broker stops when the last copy of the handle is destroyed.
+ */
+class AudioDeviceStateBroker final {
+ public:
+  class Impl;
+  AudioDeviceStateBroker() = default;
+  AudioDeviceStateBroker(const std::shared_ptr<Impl>& p);
+  ~AudioDeviceStateBroker();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+result<AudioDeviceStateBroker> StartAudioDeviceStateBroker(
+  const std::string& name);
+
+struct BrokeredAudioDeviceState {
+  // `isPossiblyStale` is always false
+  AudioDeviceListSnapshot list;
+  // Connected devices, if their volume could be read
+  std::map<std::string, Volume> volumes;
+  // Incremented by the broker for every change
+  uint64_t generation {};
+};
+
+class AudioDeviceStateClient final {
+ public:
+  class Impl;
+  AudioDeviceStateClient() = default;
+  AudioDeviceStateClient(const std::shared_ptr<Impl>& p);
+  ~AudioDeviceStateClient();
+
+  /* Copied from shared memory, without any system calls.
+   *
+   * Fails with `Error::BROKER_NOT_AVAILABLE` if the broker has stopped, or
+   * if it doesn't finish publishing a change within 100ms, e.g. because it
+   * crashed while publishing.
+   */
+  result<BrokeredAudioDeviceState> GetState() const;
+  // Cheaper than `GetState()`, for checking if anything has changed
+  uint64_t GetGeneration() const;
+
+  /* False once the broker has stopped, or its process has exited.
+   *
+   * If the broker crashes, `GetState()` keeps returning the last state it
+   * published; unlike `GetState()`, this makes a system call to find out.
+   * Reconnect with `ConnectToAudioDeviceStateBroker()` once a new broker has
+   * started.
+   */
+  bool IsBrokerRunning() const;
+
+  /* Returns true once the generation differs from `generation`, or false
+   * after the timeout.
+   *
+   * If the broker stops, this always waits for the full timeout; check
+   * `IsBrokerRunning()` when it returns false.
+   */
+  bool WaitForChange(uint64_t generation, std::chrono::milliseconds timeout)
+    const;
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+// Fails with `Error::BROKER_NOT_AVAILABLE` if the broker isn't running
+result<AudioDeviceStateClient> ConnectToAudioDeviceStateBroker(
+  const std::string& name);
+
+struct AudioChannelLevel {
+  // Linear, in [0, 1]
+  float peak {};
+  float rms {};
+  // dBFS of the peak, rising immediately but falling according to
+  // `LevelMeterOptions::decayTime`
+  float smoothedDecibels {};
+};
+
+struct AudioLevels {
+  static constexpr size_t MaxChannels = 8;
+
+  // Channels beyond `MaxChannels` are not metered
+  uint16_t channelCount {};
+  std::array<AudioChannelLevel, MaxChannels> channels {};
+  // Incremented each time levels are published
+  uint64_t sequenceNumber {};
+};
+
+struct LevelMeterOptions {
+  // How often `LevelMeterHandle::GetLevels()` is updated
+  std::chrono::milliseconds publishInterval {50};
+  // Time for `smoothedDecibels` to fall by 60dB
+  std::chrono::milliseconds decayTime {1500};
+};
+
+class LevelMeterHandle final {
+ public:
+  class Impl;
+  LevelMeterHandle() = default;
+  LevelMeterHandle(const std::shared_ptr<Impl>& p);
+  ~LevelMeterHandle();
+
+  // The most recently published levels; does not block or allocate
+  AudioLevels GetLevels() const;
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+/* Meters audio captured from the device; for output devices, this meters
+ * what is being played, if the platform supports loopback capture.
+ *
+ * Metering stops when the handle is destroyed.
+ */
+result<LevelMeterHandle> StartLevelMeter(
+  const std::string& deviceID,
+  const LevelMeterOptions& = {});
+
+struct SpeechWhileMutedOptions {
+  // Speech must be at least this far above the tracked noise floor...
+  float thresholdDecibels {12.0f};
+  // ... and at least this loud, in dBFS
+  float minimumDecibels {-50.0f};
+  // Shorter sounds are ignored
+  std::chrono::milliseconds minimumSpeech {150};
+  // After speech is reported, it isn't reported again until there has been
+  // no speech for this long
+  std::chrono::milliseconds hangover {2000};
+  // Audio is decimated to at most this rate before analysis, to bound CPU
+  // usage
+  uint32_t maxAnalysisSampleRate {16000};
+};
+
+class SpeechWhileMutedCallbackHandle final {
+ public:
+  class Impl;
+  SpeechWhileMutedCallbackHandle() = default;
+  SpeechWhileMutedCallbackHandle(const std::shared_ptr<Impl>& p);
+  ~SpeechWhileMutedCallbackHandle();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+/* Invokes the callback when someone appears to be talking into the input
+ * device while it is muted.
+ *
+ * Audio is only captured while the device is muted, so this only works for
+ * devices that apply mute after audio is delivered to capture streams. Fails
+ * with `Error::OPERATION_UNSUPPORTED` for other devices, which currently
+ * includes every device on Windows and macOS: their mute is applied by the
+ * driver or the audio engine, so captured audio would always be silent.
+ *
+ * The callback is invoked on a library-owned thread.
+ */
+result<SpeechWhileMutedCallbackHandle> AddSpeechWhileMutedCallback(
+  const std::string& deviceID,
+  std::function<void()>,
+  const SpeechWhileMutedOptions& = {});
+
+enum class AudioSampleFormat {
+  FLOAT32,
+  INT16,
+};
+
+struct AudioStreamFormat {
+  AudioSampleFormat sampleFormat {AudioSampleFormat::FLOAT32};
+  uint32_t sampleRate {};
+  uint16_t channels {};
+
+  bool operator==(const AudioStreamFormat&) const = default;
+};
+
+/* Audio captured from a device into a lock-free ring buffer, for reading on
+ * any single consumer thread.
+ *
+ * The sample rate and channel count are the device's own; samples are
+ * converted to the requested sample format, and interleaved.
+ *
+ * Capture stops when the last copy of the stream is destroyed.
+ */
+class CaptureStream final {
+ public:
+  class Impl;
+  CaptureStream() = default;
+  CaptureStream(const std::shared_ptr<Impl>& p);
+  ~CaptureStream();
+
+  // Available frames, without copying; only valid until `EndRead()`.
+  struct ReadSpans {
+    // If the data wraps around the end of the ring buffer, the remainder is
+    // in `second`
+    std::span<const std::byte> first;
+    std::span<const std::byte> second;
+    uint32_t frames {};
+  };
+
+  AudioStreamFormat GetFormat() const;
+
+  ReadSpans BeginRead() const;
+  // Releases the first `frames` frames returned by `BeginRead()`
+  void EndRead(uint32_t frames);
+  // Copies up to `frames` frames into `buffer`, and releases them
+  uint32_t Read(void* buffer, uint32_t frames);
+
+  // Returns false if `frames` frames aren't available within the timeout
+  bool WaitForFrames(uint32_t frames, std::chrono::milliseconds timeout) const;
+
+  // Frames dropped because the ring buffer was full
+  uint64_t GetOverrunFrames() const;
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+// `bufferFrames` is the capacity of the ring buffer
+result<CaptureStream> OpenCaptureStream(
+  const std::string& deviceID,
+  AudioSampleFormat,
+  uint32_t bufferFrames);
+
+struct IdentificationTonePattern {
+  float frequencyHz {880};
+  uint8_t beepCount {2};
+  std::chrono::milliseconds beepDuration {120};
+  std::chrono::milliseconds gap {80};
+  // Linear, from 0 to 1
+  float gain {0.25f};
+};
+
+/* Plays a short tone on an output device, so users can tell which physical
+ * device it is.
+ *
+ * Returns once playback has started; replaces any tone that is already
+ * playing on the device. Streams are kept open for a while afterwards, so
+ * repeated calls for the same device start quickly.
+ */
+result<void> PlayIdentificationTone(
+  const std::string& deviceID,
+  const IdentificationTonePattern& = {});
+
+struct AudioDeviceStreamProperties {
+  // The device's shared-mode format
+  AudioStreamFormat format {};
+  // How often the device processes a buffer
+  std::chrono::microseconds period {};
+  uint32_t bufferFrames {};
+  // As reported by the platform; does not include application buffering
+  std::chrono::microseconds latency {};
+
+  bool operator==(const AudioDeviceStreamProperties&) const = default;
+};
+
+/* Results are cached, and only refreshed when the platform reports a change
+ * to the device.
+ */
+result<AudioDeviceStreamProperties> GetDeviceStreamProperties(
+  const std::string& deviceID);
+
+class StreamPropertiesCallbackHandle final {
+ public:
+  class Impl;
+  StreamPropertiesCallbackHandle() = default;
+  StreamPropertiesCallbackHandle(const std::shared_ptr<Impl>& p);
+  ~StreamPropertiesCallbackHandle();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+/* Invoked with the new properties when the format, buffer size or latency of
+ * the device changes.
+ *
+ * Callbacks are invoked on a library-owned thread, and must not block.
+ */
+result<StreamPropertiesCallbackHandle> AddDeviceStreamPropertiesCallback(
+  const std::string& deviceID,
+  std::function<void(const AudioDeviceStreamProperties&)>);
+
+// An application's audio stream on an endpoint
+struct AudioSessionInfo {
+  // Unique to each instance of a session
+  std::string id;
+  // 0 if the session isn't owned by a single process
+  uint32_t processID {};
+  // The session's display name if it has one, otherwise the executable name
+  std::string displayName;
+  float volumeScalar {};
+  bool isMuted {};
+  // Whether the session currently has any open streams
+  bool isActive {};
+
+  bool operator==(const AudioSessionInfo&) const = default;
+};
+
+// Sessions are tracked from notifications, so this is cheap after the first
+// call for each device
+result<std::vector<AudioSessionInfo>> GetAudioSessions(
+  const std::string& deviceID);
+result<void> SetAudioSessionVolume(
+  const std::string& deviceID,
+  const std::string& sessionID,
+  float scalar);
+result<void> SetAudioSessionMute(
+  const std::string& deviceID,
+  const std::string& sessionID,
+  bool isMuted);
+
+enum class AudioSessionEventKind {
+  ADDED,
+  CHANGED,
+  REMOVED,
+};
+
+class AudioSessionCallbackHandle final {
+ public:
+  class Impl;
+  AudioSessionCallbackHandle() = default;
+  AudioSessionCallbackHandle(const std::shared_ptr<Impl>& p);
+  ~AudioSessionCallbackHandle();
+
+ private:
+  std::shared_ptr<Impl> p;
+};
+
+// Invoked on a native notification thread; must not block
+result<AudioSessionCallbackHandle> AddAudioSessionCallback(
+  const std::string& deviceID,
+  std::function<void(AudioSessionEventKind, const AudioSessionInfo&)>);
+
 }// namespace FredEmmott::Audio
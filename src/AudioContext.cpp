@@ -0,0 +1,133 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioContext.h"
+
+#include <utility>
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+const std::shared_ptr<AudioContext::Impl>& GetDefaultAudioContextImpl() {
+  // Intentionally leaked, so that it can be used during static destruction
+  static auto instance = new std::shared_ptr<AudioContext::Impl>(
+    std::make_shared<AudioContext::Impl>());
+  return *instance;
+}
+
+}// namespace
+
+AudioContext::Impl::~Impl() {
+  Shutdown();
+}
+
+DefaultDeviceCache* AudioContext::Impl::GetDefaultDeviceCache() {
+  std::unique_lock lock(mMutex);
+  if (mIsShutDown) {
+    return nullptr;
+  }
+  if (mDefaultDeviceSubscription) {
+    return &mDefaultDeviceCache;
+  }
+  const auto hub = GetAudioDeviceEventHub();
+  if (!hub) {
+    return nullptr;
+  }
+  mDefaultDeviceSubscription = hub->Subscribe(
+    {.kinds = {AudioDeviceEventKind::DEFAULT_CHANGED}},
+    AudioDeviceEventHub::ViewCallback(
+      [cache = &mDefaultDeviceCache](const AudioDeviceEventView& event) {
+        cache->Set(event.direction, *event.role, event.deviceID);
+      }));
+  return &mDefaultDeviceCache;
+}
+
+void AudioContext::Impl::ResetCaches() {
+  mDefaultDeviceCache.Reset();
+  mStreamPropertiesCache.Reset();
+}
+
+void AudioContext::Impl::Shutdown() {
+  std::optional<AudioDeviceEventHub::SubscriptionID> subscription;
+  {
+    std::unique_lock lock(mMutex);
+    if (mIsShutDown) {
+      return;
+    }
+    mIsShutDown = true;
+    subscription = std::exchange(mDefaultDeviceSubscription, std::nullopt);
+  }
+
+  // Without the lock, as these wait for running callbacks
+  if (subscription) {
+    GetAudioDeviceEventHub()->Unsubscribe(*subscription);
+  }
+  // Before the timer wheel, as notifications schedule refreshes
+  mStreamPropertiesCache.Stop();
+  mTimerWheel.Stop();
+  mDefaultDeviceCache.Reset();
+}
+
+AudioContext::AudioContext(const std::shared_ptr<Impl>& p) : p(p) {
+}
+
+AudioContext::~AudioContext() = default;
+
+void AudioContext::ResetCaches() {
+  p->ResetCaches();
+}
+
+void AudioContext::Shutdown() {
+  p->Shutdown();
+}
+
+void AudioContext::SetNativeCallTimeout(std::chrono::milliseconds timeout) {
+  p->mNativeCallGuard.SetTimeout(timeout);
+}
+
+void AudioContext::SetNativeCallThreading(NativeCallThreading threading) {
+  p->mNativeCallGuard.SetUseBackendThread(
+    threading == NativeCallThreading::BACKEND_THREAD);
+}
+
+void AudioContext::PostToAudioBackendThread(std::function<void()> task) {
+  p->mNativeCallGuard.GetBackendThread()->Post(std::move(task));
+}
+
+AudioContext CreateAudioContext() {
+  return {std::make_shared<AudioContext::Impl>()};
+}
+
+AudioContext GetDefaultAudioContext() {
+  return {GetDefaultAudioContextImpl()};
+}
+
+NativeCallGuard* GetNativeCallGuard() {
+  return &GetDefaultAudioContextImpl()->mNativeCallGuard;
+}
+
+TimerWheel* GetTimerWheel() {
+  return &GetDefaultAudioContextImpl()->mTimerWheel;
+}
+
+WorkerPool* GetWorkerPool() {
+  return &GetDefaultAudioContextImpl()->mWorkerPool;
+}
+
+void SetNativeCallTimeout(std::chrono::milliseconds timeout) {
+  GetDefaultAudioContext().SetNativeCallTimeout(timeout);
+}
+
+void SetNativeCallThreading(NativeCallThreading threading) {
+  GetDefaultAudioContext().SetNativeCallThreading(threading);
+}
+
+void PostToAudioBackendThread(std::function<void()> task) {
+  GetDefaultAudioContext().PostToAudioBackendThread(std::move(task));
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,71 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "AudioDeviceEventHub.h"
+#include "DefaultDeviceCache.h"
+#include "NativeCallGuard.h"
+#include "StreamPropertiesCache.h"
+#include "TimerWheel.h"
+#include "WorkerPool.h"
+
+namespace FredEmmott::Audio {
+
+class AudioContext::Impl final
+  : public std::enable_shared_from_this<AudioContext::Impl> {
+ public:
+  // Waits indefinitely, so that slow devices aren't left out
+  static constexpr std::chrono::milliseconds DefaultEnumerationTimeout {0};
+
+  Impl() = default;
+  // Shuts down, if that hasn't already been done
+  ~Impl();
+  Impl(const Impl&) = delete;
+  Impl& operator=(const Impl&) = delete;
+
+  std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(
+    AudioDeviceDirection);
+  void PrewarmAudioDevices(
+    const AudioDevicePrewarmOptions&,
+    std::function<void()> onComplete);
+
+  /* Subscribes to default-change notifications on first use.
+   *
+   * Returns `nullptr` if notifications are unavailable, as the cache would go
+   * stale, or once shut down.
+   */
+  DefaultDeviceCache* GetDefaultDeviceCache();
+  void ResetCaches();
+  void Shutdown();
+
+  NativeCallGuard mNativeCallGuard;
+  std::atomic<std::chrono::milliseconds::rep> mEnumerationTimeout {
+    DefaultEnumerationTimeout.count()};
+
+  // Slow but independent native calls, such as prewarming and refreshes,
+  // so that they don't delay timers
+  WorkerPool mWorkerPool {WorkerPool::DefaultThreadCount};
+  TimerWheel mTimerWheel;
+  StreamPropertiesCache mStreamPropertiesCache {
+    &mNativeCallGuard, &mWorkerPool, &mTimerWheel};
+
+ private:
+  std::mutex mMutex;
+  bool mIsShutDown {false};
+  DefaultDeviceCache mDefaultDeviceCache;
+  std::optional<AudioDeviceEventHub::SubscriptionID> mDefaultDeviceSubscription;
+};
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,270 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioDeviceChangeTracker.h"
+
+#include "AudioDeviceEventHub.h"
+#include "NativeCallGuard.h"
+#include "NativeDevices.h"
+#include "TimerWheel.h"
+#include "WorkerPool.h"
+
+namespace FredEmmott::Audio {
+
+AudioDeviceChangeTracker::SubscriptionID AudioDeviceChangeTracker::Subscribe(
+  Callback callback) {
+  std::call_once(mStartOnce, [this]() { Start(); });
+  auto subscriber = std::make_shared<Subscriber>();
+  subscriber->mCallback = std::move(callback);
+  const auto id = mSubscribers.Add(std::move(subscriber));
+  GetTimerWheel()->Schedule(
+    TimerWheel::Clock::now(), [this]() { PrimeSubscribers(); });
+  return id;
+}
+
+void AudioDeviceChangeTracker::Unsubscribe(SubscriptionID id) {
+  mSubscribers.Remove(id);
+}
+
+void AudioDeviceChangeTracker::Start() {
+  // Subscribers are primed once this finishes
+  GetWorkerPool()->Enqueue([this]() { Enumerate(); });
+
+  const auto hub = GetAudioDeviceEventHub();
+  if (!hub) {
+    return;
+  }
+  hub->Subscribe(
+    AudioDeviceEventFilter {
+      .kinds = {AudioDeviceEventKind::ADDED, AudioDeviceEventKind::REMOVED},
+    },
+    AudioDeviceEventHub::ViewCallback(
+      [this](const AudioDeviceEventView& event) {
+        ScheduleRefresh(event.deviceID, event.direction);
+      }));
+}
+
+void AudioDeviceChangeTracker::ScheduleRefresh(
+  std::string_view deviceID,
+  AudioDeviceDirection direction) {
+  std::unique_lock lock(mMutex);
+  // Coalesces bursts, e.g. Windows reports each property separately
+  const auto [it, inserted] = mPending.try_emplace(std::string(deviceID));
+  auto& pending = it->second;
+  pending.mDirection = direction;
+  if (pending.mIsQuerying) {
+    pending.mIsRequeryNeeded = true;
+    return;
+  }
+  if (!inserted) {
+    return;
+  }
+  GetWorkerPool()->Enqueue(
+    [this, deviceID = it->first]() { Query(deviceID); });
+}
+
+void AudioDeviceChangeTracker::Enumerate() {
+  std::map<std::string, AudioDeviceInfo> devices;
+  for (const auto direction:
+       {AudioDeviceDirection::OUTPUT, AudioDeviceDirection::INPUT}) {
+    devices.merge(GetAudioDeviceList(direction));
+  }
+  GetTimerWheel()->Schedule(
+    TimerWheel::Clock::now(),
+    [this, devices = std::move(devices)]() mutable {
+      OnEnumerated(std::move(devices));
+    });
+}
+
+void AudioDeviceChangeTracker::Query(const std::string& deviceID) {
+  AudioDeviceDirection direction;
+  {
+    std::unique_lock lock(mMutex);
+    auto& pending = mPending.at(deviceID);
+    direction = pending.mDirection;
+    pending.mIsQuerying = true;
+  }
+
+  auto info = GetNativeCallGuard()->Call<AudioDeviceInfo>(
+    deviceID, [direction, deviceID]() {
+      return GetNativeDeviceInfo(direction, deviceID);
+    });
+
+  const auto isTimeout = !info && info.error() == Error::TIMEOUT;
+  auto queried = info ? std::optional {std::move(*info)} : std::nullopt;
+  // Posted before any requery, so results are applied in order
+  GetTimerWheel()->Schedule(
+    TimerWheel::Clock::now(),
+    [this, deviceID, direction, isTimeout, info = std::move(queried)]() {
+      Refresh(deviceID, direction, info, isTimeout);
+    });
+  std::unique_lock lock(mMutex);
+  const auto it = mPending.find(deviceID);
+  if (!it->second.mIsRequeryNeeded) {
+    mPending.erase(it);
+    return;
+  }
+  it->second = {.mDirection = it->second.mDirection};
+  GetWorkerPool()->Enqueue([this, deviceID]() { Query(deviceID); });
+}
+
+void AudioDeviceChangeTracker::OnEnumerated(
+  std::map<std::string, AudioDeviceInfo> devices) {
+  mIsEnumerated = true;
+  for (auto& [id, info]: devices) {
+    Watch(id, info.direction);
+    // A notification may already have added it
+    mDevices.try_emplace(id, std::move(info));
+  }
+  PrimeSubscribers();
+}
+
+void AudioDeviceChangeTracker::PrimeSubscribers() {
+  // Primed by `OnEnumerated()`
+  if (!mIsEnumerated) {
+    return;
+  }
+  mSubscribers.ForEach([this](const std::shared_ptr<Subscriber>& subscriber) {
+    if (subscriber->mIsPrimed) {
+      return;
+    }
+    subscriber->mIsPrimed = true;
+    for (const auto& [id, info]: mDevices) {
+      subscriber->mCallback({
+        .kind = AudioDeviceChangeKind::ADDED,
+        .changedFields = AudioDeviceInfoFields::ALL,
+        .info = info,
+      });
+    }
+  });
+}
+
+void AudioDeviceChangeTracker::Refresh(
+  const std::string& deviceID,
+  AudioDeviceDirection direction,
+  std::optional<AudioDeviceInfo> info,
+  bool isTimeout) {
+  const auto known = mDevices.find(deviceID);
+
+  if (!info) {
+    // A device that is slow to respond hasn't been removed
+    if (known == mDevices.end() || isTimeout) {
+      return;
+    }
+    const AudioDeviceChangeEvent event {
+      .kind = AudioDeviceChangeKind::REMOVED,
+      .info = std::move(known->second),
+    };
+    mDevices.erase(known);
+    // Doesn't wait on `mMutex`, which the watch callback takes
+    mWatches.erase(deviceID);
+    Deliver(event);
+    return;
+  }
+
+  Watch(deviceID, direction);
+  if (known == mDevices.end()) {
+    const auto added = mDevices.emplace(deviceID, std::move(*info)).first;
+    Deliver({
+      .kind = AudioDeviceChangeKind::ADDED,
+      .changedFields = AudioDeviceInfoFields::ALL,
+      .info = added->second,
+    });
+    return;
+  }
+
+  const auto changed = GetChangedFields(known->second, *info);
+  if (changed == AudioDeviceInfoFields::NONE) {
+    return;
+  }
+  known->second = std::move(*info);
+  Deliver({
+    .kind = AudioDeviceChangeKind::CHANGED,
+    .changedFields = changed,
+    .info = known->second,
+  });
+}
+
+void AudioDeviceChangeTracker::Watch(
+  const std::string& deviceID,
+  AudioDeviceDirection direction) {
+  if (mWatches.contains(deviceID)) {
+    return;
+  }
+  auto watch = WatchNativeDeviceInfo(
+    deviceID,
+    [this, deviceID, direction]() { ScheduleRefresh(deviceID, direction); });
+  // Otherwise, retried on the next refresh
+  if (watch) {
+    mWatches.emplace(deviceID, std::move(*watch));
+  }
+}
+
+void AudioDeviceChangeTracker::Deliver(const AudioDeviceChangeEvent& event) {
+  mSubscribers.ForEach([&event](const std::shared_ptr<Subscriber>& subscriber) {
+    // Unprimed subscribers get this device when they're primed
+    if (subscriber->mIsPrimed) {
+      subscriber->mCallback(event);
+    }
+  });
+}
+
+AudioDeviceInfoFields AudioDeviceChangeTracker::GetChangedFields(
+  const AudioDeviceInfo& before,
+  const AudioDeviceInfo& after) {
+  auto changed = AudioDeviceInfoFields::NONE;
+  if (before.interfaceName != after.interfaceName) {
+    changed |= AudioDeviceInfoFields::INTERFACE_NAME;
+  }
+  if (before.endpointName != after.endpointName) {
+    changed |= AudioDeviceInfoFields::ENDPOINT_NAME;
+  }
+  if (before.displayName != after.displayName) {
+    changed |= AudioDeviceInfoFields::DISPLAY_NAME;
+  }
+  if (before.state != after.state) {
+    changed |= AudioDeviceInfoFields::STATE;
+  }
+  return changed;
+}
+
+AudioDeviceChangeTracker* GetAudioDeviceChangeTracker() {
+  // Intentionally leaked: notifications may be delivered during static
+  // destruction
+  static auto instance = new AudioDeviceChangeTracker();
+  return instance;
+}
+
+class AudioDeviceChangeCallbackHandle::Impl final {
+ public:
+  explicit Impl(AudioDeviceChangeTracker::SubscriptionID id) : mID(id) {
+  }
+
+  ~Impl() {
+    GetAudioDeviceChangeTracker()->Unsubscribe(mID);
+  }
+
+  Impl(const Impl&) = delete;
+  Impl& operator=(const Impl&) = delete;
+
+ private:
+  AudioDeviceChangeTracker::SubscriptionID mID;
+};
+
+AudioDeviceChangeCallbackHandle::AudioDeviceChangeCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+AudioDeviceChangeCallbackHandle::~AudioDeviceChangeCallbackHandle() = default;
+
+AudioDeviceChangeCallbackHandle AddAudioDeviceChangeCallback(
+  std::function<void(const AudioDeviceChangeEvent&)> callback) {
+  const auto id = GetAudioDeviceChangeTracker()->Subscribe(std::move(callback));
+  return {std::make_shared<AudioDeviceChangeCallbackHandle::Impl>(id)};
+}
+
+}// namespace FredEmmott::Audio
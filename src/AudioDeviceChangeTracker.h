@@ -0,0 +1,102 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "EpochSubscriberList.h"
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+/* Keeps the last known `AudioDeviceInfo` of every device, and reports the
+ * differences when a device is re-queried.
+ *
+ * Devices are only re-queried individually, when the hub or the backend
+ * reports that they may have changed. Queries run on the worker pool, so a
+ * slow device doesn't delay timers; at most one runs per device at a time,
+ * and each posts its result to the timer thread. Everything else is done on
+ * the timer thread, so delivery is in order, and a new subscriber's initial
+ * `ADDED` events can't interleave with changes.
+ */
+class AudioDeviceChangeTracker final {
+ public:
+  using Callback = std::function<void(const AudioDeviceChangeEvent&)>;
+
+  AudioDeviceChangeTracker() = default;
+  AudioDeviceChangeTracker(const AudioDeviceChangeTracker&) = delete;
+  AudioDeviceChangeTracker& operator=(const AudioDeviceChangeTracker&)
+    = delete;
+
+  struct Subscriber {
+    Callback mCallback;
+    // Set on the timer thread once every known device has been delivered
+    bool mIsPrimed {false};
+  };
+  using SubscriptionID
+    = EpochSubscriberList<std::shared_ptr<Subscriber>>::SubscriptionID;
+
+  SubscriptionID Subscribe(Callback);
+  void Unsubscribe(SubscriptionID);
+
+ private:
+  std::once_flag mStartOnce;
+  EpochSubscriberList<std::shared_ptr<Subscriber>> mSubscribers;
+
+  struct PendingRefresh {
+    AudioDeviceDirection mDirection {};
+    bool mIsQuerying {false};
+    // Requested while querying, so the result may already be stale
+    bool mIsRequeryNeeded {false};
+  };
+
+  // Devices with a query queued or running
+  std::mutex mMutex;
+  std::map<std::string, PendingRefresh, std::less<>> mPending;
+
+  // Only used on the timer thread
+  bool mIsEnumerated {false};
+  std::map<std::string, AudioDeviceInfo> mDevices;
+  // Removed once the device no longer exists
+  std::map<std::string, NativeWatchHandle> mWatches;
+
+  void Start();
+  void ScheduleRefresh(std::string_view deviceID, AudioDeviceDirection);
+
+  // On the worker pool
+  void Enumerate();
+  void Query(const std::string& deviceID);
+
+  // On the timer thread
+  void OnEnumerated(std::map<std::string, AudioDeviceInfo>);
+  void PrimeSubscribers();
+  // `info` is empty if the query failed
+  void Refresh(
+    const std::string& deviceID,
+    AudioDeviceDirection,
+    std::optional<AudioDeviceInfo> info,
+    bool isTimeout);
+  void Watch(const std::string& deviceID, AudioDeviceDirection);
+  void Deliver(const AudioDeviceChangeEvent&);
+
+  static AudioDeviceInfoFields GetChangedFields(
+    const AudioDeviceInfo& before,
+    const AudioDeviceInfo& after);
+};
+
+// Process-wide instance
+AudioDeviceChangeTracker* GetAudioDeviceChangeTracker();
+
+}// namespace FredEmmott::Audio
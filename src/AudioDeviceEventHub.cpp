@@ -0,0 +1,118 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioDeviceEventHub.h"
+
+#include <algorithm>
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+template <class T>
+uint8_t ToMask(const std::vector<T>& values) {
+  if (values.empty()) {
+    return 0xff;
+  }
+  uint8_t mask = 0;
+  for (const auto value: values) {
+    mask |= (1 << static_cast<uint8_t>(value));
+  }
+  return mask;
+}
+
+template <class T>
+bool MaskContains(uint8_t mask, T value) {
+  return mask & (1 << static_cast<uint8_t>(value));
+}
+
+}// namespace
+
+AudioDeviceEventMatcher::AudioDeviceEventMatcher(
+  const AudioDeviceEventFilter& filter)
+  : mKinds(ToMask(filter.kinds)),
+    mDirections(ToMask(filter.directions)),
+    mRoles(ToMask(filter.roles)),
+    mDeviceIDPrefix(filter.deviceIDPrefix),
+    mDeviceIDs(filter.deviceIDs) {
+  std::sort(mDeviceIDs.begin(), mDeviceIDs.end());
+  mDeviceIDs.erase(
+    std::unique(mDeviceIDs.begin(), mDeviceIDs.end()), mDeviceIDs.end());
+}
+
+bool AudioDeviceEventMatcher::Matches(const AudioDeviceEventView& event) const {
+  // Cheapest checks first
+  if (!MaskContains(mKinds, event.kind)) {
+    return false;
+  }
+  if (!MaskContains(mDirections, event.direction)) {
+    return false;
+  }
+  if (event.role && !MaskContains(mRoles, *event.role)) {
+    return false;
+  }
+  if (!event.deviceID.starts_with(mDeviceIDPrefix)) {
+    return false;
+  }
+  if (mDeviceIDs.empty()) {
+    return true;
+  }
+  return std::binary_search(
+    mDeviceIDs.begin(), mDeviceIDs.end(), event.deviceID, std::less<> {});
+}
+
+AudioDeviceEventHub::SubscriptionID AudioDeviceEventHub::Subscribe(
+  const AudioDeviceEventFilter& filter,
+  Callback callback) {
+  return Subscribe(
+    filter, std::variant<Callback, ViewCallback> {std::move(callback)});
+}
+
+AudioDeviceEventHub::SubscriptionID AudioDeviceEventHub::Subscribe(
+  const AudioDeviceEventFilter& filter,
+  ViewCallback callback) {
+  return Subscribe(
+    filter, std::variant<Callback, ViewCallback> {std::move(callback)});
+}
+
+AudioDeviceEventHub::SubscriptionID AudioDeviceEventHub::Subscribe(
+  const AudioDeviceEventFilter& filter,
+  std::variant<Callback, ViewCallback> callback) {
+  return mSubscribers.Add(
+    Subscriber {AudioDeviceEventMatcher(filter), std::move(callback)});
+}
+
+void AudioDeviceEventHub::Unsubscribe(SubscriptionID id) {
+  mSubscribers.Remove(id);
+}
+
+void AudioDeviceEventHub::Dispatch(const AudioDeviceEventView& view) {
+  std::optional<AudioDeviceEvent> event;
+  mSubscribers.ForEach([&](const Subscriber& subscriber) {
+    if (!subscriber.mMatcher.Matches(view)) {
+      return;
+    }
+
+    const auto viewCallback = std::get_if<ViewCallback>(&subscriber.mCallback);
+    if (viewCallback) {
+      (*viewCallback)(view);
+      return;
+    }
+
+    if (!event) {
+      event = AudioDeviceEvent {
+        .kind = view.kind,
+        .direction = view.direction,
+        .role = view.role,
+        .deviceID = std::string(view.deviceID),
+        .state = view.state,
+      };
+    }
+    std::get<Callback>(subscriber.mCallback)(*event);
+  });
+}
+
+}// namespace FredEmmott::Audio
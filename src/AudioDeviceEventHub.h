@@ -0,0 +1,89 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "AudioDeviceEventPool.h"
+#include "EpochSubscriberList.h"
+
+namespace FredEmmott::Audio {
+
+// An `AudioDeviceEventFilter`, compiled to bitmasks and a sorted ID list
+class AudioDeviceEventMatcher final {
+ public:
+  explicit AudioDeviceEventMatcher(const AudioDeviceEventFilter&);
+
+  bool Matches(const AudioDeviceEventView&) const;
+
+ private:
+  uint8_t mKinds {};
+  uint8_t mDirections {};
+  uint8_t mRoles {};
+  std::string mDeviceIDPrefix;
+  // Sorted; empty matches any device
+  std::vector<std::string> mDeviceIDs;
+};
+
+/* Fans out device events from a single native registration to every
+ * subscriber whose filter matches.
+ *
+ * The platform backends own the native registration; they build events in
+ * `GetEventPool()` and feed them in via `Dispatch()`.
+ *
+ * Dispatching never takes a lock, and does not allocate unless a matching
+ * subscriber wants an owning `AudioDeviceEvent`, in which case one is built
+ * for all of them.
+ */
+class AudioDeviceEventHub final {
+ public:
+  using Callback = std::function<void(const AudioDeviceEvent&)>;
+  using ViewCallback = std::function<void(const AudioDeviceEventView&)>;
+  using SubscriptionID = uint64_t;
+
+  AudioDeviceEventHub() = default;
+  AudioDeviceEventHub(const AudioDeviceEventHub&) = delete;
+  AudioDeviceEventHub& operator=(const AudioDeviceEventHub&) = delete;
+
+  SubscriptionID Subscribe(const AudioDeviceEventFilter&, Callback);
+  SubscriptionID Subscribe(const AudioDeviceEventFilter&, ViewCallback);
+  void Unsubscribe(SubscriptionID);
+
+  void Dispatch(const AudioDeviceEventView&);
+
+  AudioDeviceEventPool& GetEventPool() {
+    return mEventPool;
+  }
+
+ private:
+  struct Subscriber {
+    AudioDeviceEventMatcher mMatcher;
+    std::variant<Callback, ViewCallback> mCallback;
+  };
+
+  SubscriptionID Subscribe(
+    const AudioDeviceEventFilter&,
+    std::variant<Callback, ViewCallback>);
+
+  AudioDeviceEventPool mEventPool;
+  EpochSubscriberList<Subscriber> mSubscribers;
+};
+
+/* Implemented by each platform backend.
+ *
+ * Returns the process-wide hub, registering for native notifications on
+ * first use, or `nullptr` if native notifications are unavailable.
+ */
+AudioDeviceEventHub* GetAudioDeviceEventHub();
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,47 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioDeviceEventPool.h"
+
+#include <bit>
+#include <thread>
+
+namespace FredEmmott::Audio {
+
+AudioDeviceEventPool::Lease::Lease(AudioDeviceEventPool* pool, size_t index)
+  : mPool(pool), mIndex(index), mSlot(&pool->mSlots[index]) {
+}
+
+AudioDeviceEventPool::Lease::~Lease() {
+  mPool->Release(mIndex);
+}
+
+AudioDeviceEventPool::Lease AudioDeviceEventPool::Acquire() {
+  auto free = mFreeSlots.load(std::memory_order_relaxed);
+  while (true) {
+    if (free == 0) {
+      std::this_thread::yield();
+      free = mFreeSlots.load(std::memory_order_relaxed);
+      continue;
+    }
+
+    const auto index = static_cast<size_t>(std::countr_zero(free));
+    const auto claimed = free & ~(uint64_t {1} << index);
+    if (mFreeSlots.compare_exchange_weak(
+          free,
+          claimed,
+          std::memory_order_acquire,
+          std::memory_order_relaxed)) {
+      return Lease(this, index);
+    }
+  }
+}
+
+void AudioDeviceEventPool::Release(size_t index) {
+  mFreeSlots.fetch_or(uint64_t {1} << index, std::memory_order_release);
+}
+
+}// namespace FredEmmott::Audio
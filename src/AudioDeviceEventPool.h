@@ -0,0 +1,74 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+
+namespace FredEmmott::Audio {
+
+/* Fixed-size storage for events that are being built or dispatched.
+ *
+ * The platform backends write event data (e.g. a device ID converted from a
+ * native string) into a slot, then dispatch an `AudioDeviceEventView`
+ * referring to it; acquiring and releasing slots never allocates.
+ */
+class AudioDeviceEventPool final {
+ public:
+  static constexpr size_t SlotCount = 16;
+  static constexpr size_t MaxDeviceIDLength = 1024;
+
+  struct Slot {
+    std::array<char, MaxDeviceIDLength> mDeviceID;
+  };
+
+  class Lease final {
+   public:
+    Lease() = delete;
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    ~Lease();
+
+    std::span<char> GetDeviceIDBuffer() const {
+      return mSlot->mDeviceID;
+    }
+
+   private:
+    friend class AudioDeviceEventPool;
+    Lease(AudioDeviceEventPool*, size_t index);
+
+    AudioDeviceEventPool* mPool;
+    size_t mIndex;
+    Slot* mSlot;
+  };
+
+  AudioDeviceEventPool() = default;
+  AudioDeviceEventPool(const AudioDeviceEventPool&) = delete;
+  AudioDeviceEventPool& operator=(const AudioDeviceEventPool&) = delete;
+
+  /* Always succeeds.
+   *
+   * If every slot is in use, this yields until one is released; that
+   * requires more concurrent notification threads than there are slots.
+   */
+  Lease Acquire();
+
+ private:
+  static_assert(SlotCount <= 64);
+
+  std::array<Slot, SlotCount> mSlots {};
+  // Bit N is set if slot N is free
+  std::atomic<uint64_t> mFreeSlots {(SlotCount == 64)
+                                      ? ~uint64_t {0}
+                                      : ((uint64_t {1} << SlotCount) - 1)};
+
+  void Release(size_t index);
+};
+
+}// namespace FredEmmott::Audio
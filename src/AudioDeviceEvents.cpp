@@ -0,0 +1,132 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include "AudioDeviceEventHub.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+class HubSubscription {
+ public:
+  template <class TCallback>
+  HubSubscription(
+    AudioDeviceEventHub* hub,
+    const AudioDeviceEventFilter& filter,
+    TCallback callback)
+    : mHub(hub), mID(hub->Subscribe(filter, std::move(callback))) {
+  }
+
+  ~HubSubscription() {
+    mHub->Unsubscribe(mID);
+  }
+
+  HubSubscription(const HubSubscription&) = delete;
+  HubSubscription& operator=(const HubSubscription&) = delete;
+
+ private:
+  AudioDeviceEventHub* mHub;
+  AudioDeviceEventHub::SubscriptionID mID;
+};
+
+}// namespace
+
+class AudioDeviceEventCallbackHandle::Impl final : public HubSubscription {
+ public:
+  using HubSubscription::HubSubscription;
+};
+
+AudioDeviceEventCallbackHandle::AudioDeviceEventCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+AudioDeviceEventCallbackHandle::~AudioDeviceEventCallbackHandle() = default;
+
+AudioDeviceEventCallbackHandle AddAudioDeviceEventCallback(
+  const AudioDeviceEventFilter& filter,
+  std::function<void(const AudioDeviceEvent&)> cb) {
+  const auto hub = GetAudioDeviceEventHub();
+  if (!hub) {
+    return {};
+  }
+  return std::make_shared<AudioDeviceEventCallbackHandle::Impl>(
+    hub, filter, std::move(cb));
+}
+
+AudioDeviceEventCallbackHandle AddAudioDeviceEventViewCallback(
+  const AudioDeviceEventFilter& filter,
+  std::function<void(const AudioDeviceEventView&)> cb) {
+  const auto hub = GetAudioDeviceEventHub();
+  if (!hub) {
+    return {};
+  }
+  return std::make_shared<AudioDeviceEventCallbackHandle::Impl>(
+    hub, filter, std::move(cb));
+}
+
+class DefaultChangeCallbackHandle::Impl final : public HubSubscription {
+ public:
+  using HubSubscription::HubSubscription;
+};
+
+DefaultChangeCallbackHandle::DefaultChangeCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+DefaultChangeCallbackHandle::~DefaultChangeCallbackHandle() = default;
+
+DefaultChangeCallbackHandle AddDefaultAudioDeviceChangeCallback(
+  std::function<void(AudioDeviceDirection, AudioDeviceRole, const std::string&)>
+    cb) {
+  const auto hub = GetAudioDeviceEventHub();
+  if (!hub) {
+    return {};
+  }
+  return std::make_shared<DefaultChangeCallbackHandle::Impl>(
+    hub,
+    AudioDeviceEventFilter {.kinds = {AudioDeviceEventKind::DEFAULT_CHANGED}},
+    AudioDeviceEventHub::Callback([cb](const AudioDeviceEvent& event) {
+      cb(event.direction, *event.role, event.deviceID);
+    }));
+}
+
+class AudioDevicePlugEventCallbackHandle::Impl final : public HubSubscription {
+ public:
+  using HubSubscription::HubSubscription;
+};
+
+AudioDevicePlugEventCallbackHandle::AudioDevicePlugEventCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+AudioDevicePlugEventCallbackHandle::~AudioDevicePlugEventCallbackHandle()
+  = default;
+
+AudioDevicePlugEventCallbackHandle AddAudioDevicePlugEventCallback(
+  std::function<void(AudioDevicePlugEvent, const std::string&)> cb) {
+  const auto hub = GetAudioDeviceEventHub();
+  if (!hub) {
+    return {};
+  }
+  return std::make_shared<AudioDevicePlugEventCallbackHandle::Impl>(
+    hub,
+    AudioDeviceEventFilter {
+      .kinds = {AudioDeviceEventKind::ADDED, AudioDeviceEventKind::REMOVED}},
+    AudioDeviceEventHub::Callback([cb](const AudioDeviceEvent& event) {
+      cb(
+        event.kind == AudioDeviceEventKind::ADDED
+          ? AudioDevicePlugEvent::ADDED
+          : AudioDevicePlugEvent::REMOVED,
+        event.deviceID);
+    }));
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,322 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioDeviceJournal.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "AudioDeviceEventHub.h"
+#include "TimerWheel.h"
+#include "WorkerPool.h"
+
+namespace FredEmmott::Audio {
+
+void AudioDeviceJournal::Start(std::optional<size_t> capacity) {
+  {
+    std::unique_lock lock(mMutex);
+    if (capacity) {
+      mCapacity = std::max<size_t>(*capacity, 1);
+      Evict();
+    }
+    if (std::exchange(mIsStarted, true)) {
+      return;
+    }
+  }
+
+  const auto hub = GetAudioDeviceEventHub();
+  if (hub) {
+    hub->Subscribe(
+      AudioDeviceEventFilter {},
+      AudioDeviceEventHub::ViewCallback(
+        [this](const AudioDeviceEventView& event) { OnDeviceEvent(event); }));
+  }
+
+  // Devices that are added later are picked up by `OnDeviceEvent()`.
+  // Enumerated on a worker, as it can be slow; the watches are only used on
+  // the timer thread.
+  GetWorkerPool()->Enqueue([this]() {
+    std::vector<std::pair<std::string, AudioDeviceDirection>> connected;
+    for (const auto direction:
+         {AudioDeviceDirection::OUTPUT, AudioDeviceDirection::INPUT}) {
+      for (const auto& [id, info]: GetAudioDeviceList(direction)) {
+        if (info.state == AudioDeviceState::CONNECTED) {
+          connected.emplace_back(id, direction);
+        }
+      }
+    }
+    GetTimerWheel()->Schedule(
+      TimerWheel::Clock::now(), [this, connected = std::move(connected)]() {
+        for (const auto& [id, direction]: connected) {
+          WatchVolume(id, direction);
+        }
+      });
+  });
+}
+
+uint64_t AudioDeviceJournal::GetSequenceNumber() const {
+  return mSequenceNumber.load(std::memory_order_acquire);
+}
+
+std::optional<AudioDeviceJournal::SubscriptionID> AudioDeviceJournal::Subscribe(
+  uint64_t afterSequenceNumber,
+  Callback callback) {
+  std::unique_lock lock(mMutex);
+  // From inside a callback, this thread is already delivering
+  const auto isNested
+    = mIsDelivering && mDeliveringThread == std::this_thread::get_id();
+  if (!isNested) {
+    mDeliveryFinished.wait(lock, [this]() { return !mIsDelivering; });
+    mIsDelivering = true;
+    mDeliveringThread = std::this_thread::get_id();
+  }
+
+  const auto latest = mSequenceNumber.load(std::memory_order_relaxed);
+  const auto oldest
+    = mRecords.empty() ? latest + 1 : mRecords.front().mSequenceNumber;
+  if (afterSequenceNumber > latest || afterSequenceNumber + 1 < oldest) {
+    if (!isNested) {
+      Deliver(lock);
+    }
+    return std::nullopt;
+  }
+
+  // Subscribed along with copying the replay, so that nothing appended
+  // after the copy can be missed
+  const std::vector<Record> replay(
+    mRecords.begin() + (afterSequenceNumber + 1 - oldest), mRecords.end());
+  const auto id = mSubscribers.Add({latest, callback});
+
+  lock.unlock();
+  for (const auto& record: replay) {
+    callback(ToEntry(record));
+  }
+  lock.lock();
+
+  if (!isNested) {
+    Deliver(lock);
+  }
+  return id;
+}
+
+void AudioDeviceJournal::Unsubscribe(SubscriptionID id) {
+  mSubscribers.Remove(id);
+}
+
+void AudioDeviceJournal::Append(Record record, std::string_view deviceID) {
+  std::unique_lock lock(mMutex);
+  auto it = mDeviceIDs.find(deviceID);
+  if (it == mDeviceIDs.end()) {
+    auto interned = std::make_shared<const std::string>(deviceID);
+    it = mDeviceIDs.emplace(*interned, std::move(interned)).first;
+  }
+
+  record.mSequenceNumber = mSequenceNumber.load(std::memory_order_relaxed) + 1;
+  record.mDeviceID = it->second;
+  mRecords.push_back(std::move(record));
+  mSequenceNumber.store(
+    mRecords.back().mSequenceNumber, std::memory_order_release);
+
+  if (!mSubscribers.IsEmpty()) {
+    mUndelivered.push_back(mRecords.back());
+  }
+  Evict();
+
+  if (mIsDelivering || mUndelivered.empty()) {
+    // Delivered by the thread that's already delivering
+    return;
+  }
+  mIsDelivering = true;
+  mDeliveringThread = std::this_thread::get_id();
+  Deliver(lock);
+}
+
+void AudioDeviceJournal::Deliver(std::unique_lock<std::mutex>& lock) {
+  while (!mUndelivered.empty()) {
+    const auto record = std::move(mUndelivered.front());
+    mUndelivered.pop_front();
+
+    lock.unlock();
+    const auto entry = ToEntry(record);
+    mSubscribers.ForEach([&entry](const Subscriber& subscriber) {
+      if (entry.sequenceNumber > subscriber.mAfterSequenceNumber) {
+        subscriber.mCallback(entry);
+      }
+    });
+    lock.lock();
+  }
+  mIsDelivering = false;
+  mDeliveringThread = {};
+  mDeliveryFinished.notify_all();
+}
+
+void AudioDeviceJournal::Evict() {
+  while (mRecords.size() > mCapacity) {
+    const auto deviceID = std::move(mRecords.front().mDeviceID);
+    mRecords.pop_front();
+    // The other reference is `mDeviceIDs`'s own
+    if (deviceID.use_count() == 2) {
+      mDeviceIDs.erase(*deviceID);
+    }
+  }
+}
+
+void AudioDeviceJournal::OnDeviceEvent(const AudioDeviceEventView& event) {
+  switch (event.kind) {
+    case AudioDeviceEventKind::ADDED:
+      Append(
+        {.mKind = AudioDeviceJournalEntryKind::ADDED,
+         .mDirection = event.direction},
+        event.deviceID);
+      GetTimerWheel()->Schedule(
+        TimerWheel::Clock::now(),
+        [this,
+         deviceID = std::string(event.deviceID),
+         direction = event.direction]() { WatchVolume(deviceID, direction); });
+      return;
+    case AudioDeviceEventKind::REMOVED:
+      Append(
+        {.mKind = AudioDeviceJournalEntryKind::REMOVED,
+         .mDirection = event.direction},
+        event.deviceID);
+      // Native registrations aren't removed from their own notifications
+      GetTimerWheel()->Schedule(
+        TimerWheel::Clock::now(),
+        [this, deviceID = std::string(event.deviceID)]() {
+          mVolumeCallbacks.erase(deviceID);
+        });
+      return;
+    case AudioDeviceEventKind::DEFAULT_CHANGED:
+      Append(
+        {.mKind = AudioDeviceJournalEntryKind::DEFAULT_CHANGED,
+         .mDirection = event.direction,
+         .mRole = event.role},
+        event.deviceID);
+      return;
+    case AudioDeviceEventKind::STATE_CHANGED:
+      // Volume watches follow the `ADDED` and `REMOVED` events that are
+      // also reported for state changes
+      if (event.state) {
+        Append(
+          {.mKind = AudioDeviceJournalEntryKind::STATE_CHANGED,
+           .mDirection = event.direction,
+           .mState = event.state},
+          event.deviceID);
+      }
+      return;
+    case AudioDeviceEventKind::PROPERTY_CHANGED:
+      // Not recorded
+      return;
+  }
+}
+
+void AudioDeviceJournal::WatchVolume(
+  const std::string& deviceID,
+  AudioDeviceDirection direction) {
+  if (mVolumeCallbacks.contains(deviceID)) {
+    return;
+  }
+  auto callback = AddAudioDeviceVolumeCallback(
+    deviceID,
+    [this, deviceID, direction](const Volume& volume) {
+      Append(
+        {.mKind = AudioDeviceJournalEntryKind::VOLUME_CHANGED,
+         .mDirection = direction,
+         .mVolume = volume},
+        deviceID);
+    },
+    CallbackDelivery::CHANGES_ONLY);
+  if (callback) {
+    mVolumeCallbacks.emplace(deviceID, std::move(*callback));
+    return;
+  }
+  if (callback.error() != Error::OPERATION_UNSUPPORTED) {
+    return;
+  }
+
+  // e.g. macOS devices that only have a mute control
+  auto muteCallback = AddAudioDeviceMuteUnmuteCallback(
+    deviceID,
+    [this, deviceID, direction](bool isMuted) {
+      Append(
+        {.mKind = AudioDeviceJournalEntryKind::MUTE_CHANGED,
+         .mDirection = direction,
+         .mIsMuted = isMuted},
+        deviceID);
+    },
+    CallbackDelivery::CHANGES_ONLY);
+  if (muteCallback) {
+    mVolumeCallbacks.emplace(deviceID, std::move(*muteCallback));
+  }
+}
+
+AudioDeviceJournalEntry AudioDeviceJournal::ToEntry(const Record& record) {
+  return {
+    .sequenceNumber = record.mSequenceNumber,
+    .kind = record.mKind,
+    .direction = record.mDirection,
+    .role = record.mRole,
+    .deviceID = *record.mDeviceID,
+    .volume = record.mVolume,
+    .isMuted = record.mIsMuted,
+    .state = record.mState,
+  };
+}
+
+AudioDeviceJournal* GetAudioDeviceJournal() {
+  // Intentionally leaked: notifications may be delivered during static
+  // destruction
+  static auto instance = new AudioDeviceJournal();
+  return instance;
+}
+
+class AudioDeviceJournalCallbackHandle::Impl final {
+ public:
+  explicit Impl(AudioDeviceJournal::SubscriptionID id) : mID(id) {
+  }
+
+  ~Impl() {
+    GetAudioDeviceJournal()->Unsubscribe(mID);
+  }
+
+  Impl(const Impl&) = delete;
+  Impl& operator=(const Impl&) = delete;
+
+ private:
+  AudioDeviceJournal::SubscriptionID mID;
+};
+
+AudioDeviceJournalCallbackHandle::AudioDeviceJournalCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+AudioDeviceJournalCallbackHandle::~AudioDeviceJournalCallbackHandle()
+  = default;
+
+void StartAudioDeviceJournal(size_t capacity) {
+  GetAudioDeviceJournal()->Start(capacity);
+}
+
+uint64_t GetAudioDeviceJournalSequenceNumber() {
+  return GetAudioDeviceJournal()->GetSequenceNumber();
+}
+
+result<AudioDeviceJournalCallbackHandle> AddAudioDeviceJournalCallback(
+  uint64_t afterSequenceNumber,
+  std::function<void(const AudioDeviceJournalEntry&)> callback) {
+  const auto journal = GetAudioDeviceJournal();
+  journal->Start();
+  const auto id = journal->Subscribe(afterSequenceNumber, std::move(callback));
+  if (!id) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  return {AudioDeviceJournalCallbackHandle {
+    std::make_shared<AudioDeviceJournalCallbackHandle::Impl>(*id)}};
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,122 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+
+#include "EpochSubscriberList.h"
+
+namespace FredEmmott::Audio {
+
+/* A bounded, in-order record of device events, which subscribers can replay
+ * from any sequence number that hasn't been evicted yet.
+ *
+ * Subscribers are invoked without `mMutex` held, by one thread at a time:
+ * whichever thread finds nothing else delivering takes over, and delivers
+ * entries in sequence order until none are left; entries appended meanwhile
+ * are queued for it. `Subscribe()` waits its turn to deliver replayed
+ * entries, so there are no gaps between replayed and new entries.
+ *
+ * Callbacks can subscribe and unsubscribe; a nested subscription is
+ * delivered its replay immediately, and then skips queued entries that
+ * were already replayed.
+ */
+class AudioDeviceJournal final {
+ public:
+  using Callback = std::function<void(const AudioDeviceJournalEntry&)>;
+  using SubscriptionID = uint64_t;
+
+  AudioDeviceJournal() = default;
+  AudioDeviceJournal(const AudioDeviceJournal&) = delete;
+  AudioDeviceJournal& operator=(const AudioDeviceJournal&) = delete;
+
+  static constexpr size_t DefaultCapacity = 4096;
+
+  // Registers for native notifications on first call; the capacity is only
+  // changed if one is given
+  void Start(std::optional<size_t> capacity = std::nullopt);
+  uint64_t GetSequenceNumber() const;
+
+  // Returns `std::nullopt` if entries after `afterSequenceNumber` have been
+  // evicted, or haven't been recorded yet
+  std::optional<SubscriptionID> Subscribe(
+    uint64_t afterSequenceNumber,
+    Callback);
+  void Unsubscribe(SubscriptionID);
+
+ private:
+  // Smaller than an `AudioDeviceJournalEntry`, as device IDs are shared
+  struct Record {
+    uint64_t mSequenceNumber {};
+    AudioDeviceJournalEntryKind mKind {};
+    AudioDeviceDirection mDirection {};
+    std::optional<AudioDeviceRole> mRole;
+    std::shared_ptr<const std::string> mDeviceID;
+    std::optional<Volume> mVolume;
+    std::optional<bool> mIsMuted;
+    std::optional<AudioDeviceState> mState;
+  };
+
+  struct Subscriber {
+    // Later entries only; earlier ones are replayed by `Subscribe()`
+    uint64_t mAfterSequenceNumber {};
+    Callback mCallback;
+  };
+
+  std::mutex mMutex;
+  bool mIsStarted {false};
+  size_t mCapacity {DefaultCapacity};
+  std::deque<Record> mRecords;
+  // Appended, but not yet delivered to subscribers
+  std::deque<Record> mUndelivered;
+  bool mIsDelivering {false};
+  std::thread::id mDeliveringThread;
+  std::condition_variable mDeliveryFinished;
+  std::atomic<uint64_t> mSequenceNumber {0};
+  // Interned, as each device usually has many records; an ID is removed
+  // once its last record is evicted
+  std::map<std::string, std::shared_ptr<const std::string>, std::less<>>
+    mDeviceIDs;
+  EpochSubscriberList<Subscriber> mSubscribers;
+
+  // Only used on the timer thread; a mute callback if the device has no
+  // volume control
+  std::map<std::string, std::variant<VolumeCallbackHandle, MuteCallbackHandle>>
+    mVolumeCallbacks;
+
+  // `record`'s sequence number and device ID are filled in
+  void Append(Record record, std::string_view deviceID);
+  // `mMutex` must be held
+  void Evict();
+  // Delivers `mUndelivered`, then stops delivering; the lock must be held,
+  // and this thread must be delivering
+  void Deliver(std::unique_lock<std::mutex>&);
+
+  void OnDeviceEvent(const AudioDeviceEventView&);
+  void WatchVolume(const std::string& deviceID, AudioDeviceDirection);
+
+  static AudioDeviceJournalEntry ToEntry(const Record&);
+};
+
+// Process-wide instance
+AudioDeviceJournal* GetAudioDeviceJournal();
+
+}// namespace FredEmmott::Audio
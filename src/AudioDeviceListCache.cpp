@@ -0,0 +1,302 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioDeviceListCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string_view>
+
+#include "MappedFile.h"
+#include "TimerWheel.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+using Header = AudioDeviceListCache::Header;
+using DeviceRecord = AudioDeviceListCache::DeviceRecord;
+using StringRef = AudioDeviceListCache::StringRef;
+
+struct DefaultIDField {
+  std::string AudioDeviceListSnapshot::*mID;
+  AudioDeviceDirection mDirection;
+  AudioDeviceRole mRole;
+};
+
+// Also the order of `Header::mDefaultIDs`
+constexpr DefaultIDField DefaultIDFields[] {
+  {
+    &AudioDeviceListSnapshot::defaultOutputID,
+    AudioDeviceDirection::OUTPUT,
+    AudioDeviceRole::DEFAULT,
+  },
+  {
+    &AudioDeviceListSnapshot::defaultCommunicationOutputID,
+    AudioDeviceDirection::OUTPUT,
+    AudioDeviceRole::COMMUNICATION,
+  },
+  {
+    &AudioDeviceListSnapshot::defaultInputID,
+    AudioDeviceDirection::INPUT,
+    AudioDeviceRole::DEFAULT,
+  },
+  {
+    &AudioDeviceListSnapshot::defaultCommunicationInputID,
+    AudioDeviceDirection::INPUT,
+    AudioDeviceRole::COMMUNICATION,
+  },
+};
+static_assert(
+  std::size(DefaultIDFields)
+  == std::tuple_size_v<decltype(Header::mDefaultIDs)>);
+
+// Of the header, with `mChecksum` as 0, followed by the body
+uint32_t GetChecksum(Header header, std::span<const std::byte> body) {
+  header.mChecksum = 0;
+  uint32_t hash = 2166136261u;
+  for (const auto data: {std::as_bytes(std::span(&header, 1)), body}) {
+    for (const auto byte: data) {
+      hash ^= std::to_integer<uint32_t>(byte);
+      hash *= 16777619u;
+    }
+  }
+  return hash;
+}
+
+// The cache is only an optimization, so failures are ignored
+void WriteCache(
+  const std::filesystem::path& path,
+  const AudioDeviceListSnapshot& snapshot) {
+  // Writers share the temporary file
+  static std::mutex sMutex;
+
+  const auto data = AudioDeviceListCache::Encode(snapshot);
+  auto temporary = path;
+  temporary += ".tmp";
+
+  std::unique_lock lock(sMutex);
+  std::error_code ec;
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), ec);
+  }
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.close();
+    if (!file) {
+      std::filesystem::remove(temporary, ec);
+      return;
+    }
+  }
+  // Replaced rather than rewritten, so readers never see a partial file
+  std::filesystem::rename(temporary, path, ec);
+  if (ec) {
+    std::filesystem::remove(temporary, ec);
+  }
+}
+
+bool IsConnected(
+  const std::map<std::string, AudioDeviceInfo>& devices,
+  const std::string& id) {
+  const auto it = devices.find(id);
+  return it != devices.end() && it->second.state == AudioDeviceState::CONNECTED;
+}
+
+void DispatchDifferences(
+  const AudioDeviceListSnapshot& before,
+  const AudioDeviceListSnapshot& after,
+  const std::function<void(const AudioDeviceEvent&)>& callback) {
+  for (const auto& [id, info]: before.devices) {
+    if (IsConnected(before.devices, id) && !IsConnected(after.devices, id)) {
+      callback({
+        .kind = AudioDeviceEventKind::REMOVED,
+        .direction = info.direction,
+        .deviceID = id,
+      });
+    }
+  }
+  for (const auto& [id, info]: after.devices) {
+    if (IsConnected(after.devices, id) && !IsConnected(before.devices, id)) {
+      callback({
+        .kind = AudioDeviceEventKind::ADDED,
+        .direction = info.direction,
+        .deviceID = id,
+      });
+    }
+  }
+  for (const auto& field: DefaultIDFields) {
+    if (before.*field.mID != after.*field.mID) {
+      callback({
+        .kind = AudioDeviceEventKind::DEFAULT_CHANGED,
+        .direction = field.mDirection,
+        .role = field.mRole,
+        .deviceID = after.*field.mID,
+      });
+    }
+  }
+}
+
+}// namespace
+
+AudioDeviceListSnapshot QueryAudioDeviceListSnapshot() {
+  AudioDeviceListSnapshot ret;
+  for (const auto direction:
+       {AudioDeviceDirection::OUTPUT, AudioDeviceDirection::INPUT}) {
+    ret.devices.merge(GetAudioDeviceList(direction));
+  }
+  for (const auto& field: DefaultIDFields) {
+    ret.*field.mID = GetDefaultAudioDeviceID(field.mDirection, field.mRole);
+  }
+  return ret;
+}
+
+std::vector<std::byte> AudioDeviceListCache::Encode(
+  const AudioDeviceListSnapshot& snapshot) {
+  std::string strings;
+  const auto addString = [&strings](std::string_view value) {
+    const StringRef ref {
+      .mOffset = static_cast<uint32_t>(strings.size()),
+      .mSize = static_cast<uint32_t>(value.size()),
+    };
+    strings.append(value);
+    return ref;
+  };
+
+  std::vector<DeviceRecord> records;
+  records.reserve(snapshot.devices.size());
+  for (const auto& [id, info]: snapshot.devices) {
+    records.push_back({
+      .mID = addString(id),
+      .mInterfaceName = addString(info.interfaceName),
+      .mEndpointName = addString(info.endpointName),
+      .mDisplayName = addString(info.displayName),
+      .mDirection = static_cast<uint8_t>(info.direction),
+      .mState = static_cast<uint8_t>(info.state),
+    });
+  }
+
+  Header header {
+    .mDeviceCount = static_cast<uint32_t>(records.size()),
+  };
+  for (size_t i = 0; i < std::size(DefaultIDFields); ++i) {
+    header.mDefaultIDs[i] = addString(snapshot.*DefaultIDFields[i].mID);
+  }
+  header.mStringTableSize = static_cast<uint32_t>(strings.size());
+
+  const auto recordsSize = records.size() * sizeof(DeviceRecord);
+  std::vector<std::byte> ret(sizeof(Header) + recordsSize + strings.size());
+  std::memcpy(ret.data() + sizeof(Header), records.data(), recordsSize);
+  std::memcpy(
+    ret.data() + sizeof(Header) + recordsSize, strings.data(), strings.size());
+  header.mChecksum
+    = GetChecksum(header, std::span(ret).subspan(sizeof(Header)));
+  std::memcpy(ret.data(), &header, sizeof(Header));
+  return ret;
+}
+
+std::optional<AudioDeviceListSnapshot> AudioDeviceListCache::Decode(
+  std::span<const std::byte> data) {
+  // Copied out, as the data may not be suitably aligned
+  Header header;
+  if (data.size() < sizeof(Header)) {
+    return std::nullopt;
+  }
+  std::memcpy(&header, data.data(), sizeof(Header));
+  if (
+    header.mMagic != Magic || header.mVersion != Version
+    || header.mHeaderSize != sizeof(Header)) {
+    return std::nullopt;
+  }
+
+  const auto recordsSize
+    = static_cast<uint64_t>(header.mDeviceCount) * sizeof(DeviceRecord);
+  if (data.size() != sizeof(Header) + recordsSize + header.mStringTableSize) {
+    return std::nullopt;
+  }
+  const auto body = data.subspan(sizeof(Header));
+  if (GetChecksum(header, body) != header.mChecksum) {
+    return std::nullopt;
+  }
+
+  const auto strings = body.subspan(recordsSize);
+  bool isValid = true;
+  const auto getString = [&strings, &isValid](const StringRef& ref) {
+    if (static_cast<uint64_t>(ref.mOffset) + ref.mSize > strings.size()) {
+      isValid = false;
+      return std::string {};
+    }
+    return std::string {
+      reinterpret_cast<const char*>(strings.data()) + ref.mOffset, ref.mSize};
+  };
+
+  AudioDeviceListSnapshot ret;
+  ret.isPossiblyStale = true;
+  for (uint32_t i = 0; i < header.mDeviceCount; ++i) {
+    DeviceRecord record;
+    std::memcpy(
+      &record, body.data() + (i * sizeof(DeviceRecord)), sizeof(DeviceRecord));
+    if (
+      record.mDirection > static_cast<uint8_t>(AudioDeviceDirection::INPUT)
+      || record.mState > static_cast<uint8_t>(
+           AudioDeviceState::DEVICE_PRESENT_NO_CONNECTION)) {
+      return std::nullopt;
+    }
+    auto id = getString(record.mID);
+    ret.devices.emplace(
+      id,
+      AudioDeviceInfo {
+        .id = id,
+        .interfaceName = getString(record.mInterfaceName),
+        .endpointName = getString(record.mEndpointName),
+        .displayName = getString(record.mDisplayName),
+        .direction = static_cast<AudioDeviceDirection>(record.mDirection),
+        .state = static_cast<AudioDeviceState>(record.mState),
+      });
+  }
+  for (size_t i = 0; i < std::size(DefaultIDFields); ++i) {
+    ret.*DefaultIDFields[i].mID = getString(header.mDefaultIDs[i]);
+  }
+
+  if (!isValid) {
+    return std::nullopt;
+  }
+  return ret;
+}
+
+AudioDeviceListSnapshot GetCachedAudioDeviceList(
+  const std::filesystem::path& cachePath,
+  std::function<void(const AudioDeviceEvent&)> onRefresh) {
+  std::optional<AudioDeviceListSnapshot> cached;
+  {
+    // Unmapped before returning, as a mapped file can't be replaced on
+    // Windows
+    const auto file = MappedFile::Open(cachePath);
+    if (file) {
+      cached = AudioDeviceListCache::Decode(file->GetData());
+    }
+  }
+
+  if (!cached) {
+    auto live = QueryAudioDeviceListSnapshot();
+    WriteCache(cachePath, live);
+    return live;
+  }
+
+  GetTimerWheel()->Schedule(
+    TimerWheel::Clock::now(),
+    [cachePath, onRefresh = std::move(onRefresh), before = *cached]() {
+      const auto after = QueryAudioDeviceListSnapshot();
+      WriteCache(cachePath, after);
+      if (onRefresh) {
+        DispatchDifferences(before, after, onRefresh);
+      }
+    });
+  return std::move(*cached);
+}
+
+}// namespace FredEmmott::Audio
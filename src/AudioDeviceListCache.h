@@ -0,0 +1,76 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace FredEmmott::Audio {
+
+/* The on-disk format used by `GetCachedAudioDeviceList()`:
+ *
+ * - a `Header`
+ * - `Header::mDeviceCount` `DeviceRecord`s
+ * - a table of UTF-8 strings, referenced by `StringRef`s; these are not
+ *   null-terminated
+ *
+ * Everything is in native byte order, which is checked by `Magic`. The
+ * checksum covers everything except itself, so a truncated, partially written
+ * or corrupted file is rejected rather than decoded.
+ *
+ * Increment `Version` for any change to the layout.
+ */
+class AudioDeviceListCache final {
+ public:
+  static constexpr uint32_t Magic = 0x43444c41;// "ALDC" if little-endian
+  static constexpr uint16_t Version = 2;
+
+  struct StringRef {
+    // From the start of the string table
+    uint32_t mOffset {};
+    uint32_t mSize {};
+  };
+
+  struct Header {
+    uint32_t mMagic {Magic};
+    uint16_t mVersion {Version};
+    uint16_t mHeaderSize {sizeof(Header)};
+    uint32_t mDeviceCount {};
+    uint32_t mStringTableSize {};
+    // In the same order as the fields of `AudioDeviceListSnapshot`
+    std::array<StringRef, 4> mDefaultIDs {};
+    // FNV-1a
+    uint32_t mChecksum {};
+  };
+
+  struct DeviceRecord {
+    StringRef mID;
+    StringRef mInterfaceName;
+    StringRef mEndpointName;
+    StringRef mDisplayName;
+    uint8_t mDirection {};
+    uint8_t mState {};
+    uint8_t mPadding[2] {};
+  };
+
+  static std::vector<std::byte> Encode(const AudioDeviceListSnapshot&);
+  // Returns `std::nullopt` if the data is invalid. Strings are copied out,
+  // so the data doesn't need to outlive the snapshot.
+  static std::optional<AudioDeviceListSnapshot> Decode(
+    std::span<const std::byte>);
+};
+
+// Queries the platform for every field, without using the cache
+AudioDeviceListSnapshot QueryAudioDeviceListSnapshot();
+
+}// namespace FredEmmott::Audio
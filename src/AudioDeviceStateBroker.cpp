@@ -0,0 +1,367 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include "AudioDeviceListCache.h"
+#include "BrokerIPC.h"
+#include "SharedDeviceState.h"
+#include "WorkerPool.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+using Segment = SharedDeviceStateSegment;
+
+// Also the order of `Segment::State::mDefaultIDs`
+constexpr std::string AudioDeviceListSnapshot::*DefaultIDs[] {
+  &AudioDeviceListSnapshot::defaultOutputID,
+  &AudioDeviceListSnapshot::defaultCommunicationOutputID,
+  &AudioDeviceListSnapshot::defaultInputID,
+  &AudioDeviceListSnapshot::defaultCommunicationInputID,
+};
+static_assert(
+  std::size(DefaultIDs)
+  == std::tuple_size_v<decltype(Segment::State::mDefaultIDs)>);
+
+void CopyString(Segment::String& out, const std::string& value) {
+  auto size = std::min(value.size(), out.size() - 1);
+  // Don't split a UTF-8 sequence
+  if (size < value.size()) {
+    while (size > 0 && (static_cast<uint8_t>(value[size]) & 0xc0) == 0x80) {
+      --size;
+    }
+  }
+  std::memcpy(out.data(), value.data(), size);
+  out[size] = '\0';
+}
+
+std::string GetString(const Segment::String& value) {
+  return {value.data(), strnlen(value.data(), value.size())};
+}
+
+}// namespace
+
+/* Device list changes are handled on the worker pool, as re-enumerating
+ * can be slow; volume and mute changes are published directly from the
+ * device's volume callback. Devices whose volume callback can't be added
+ * only have their volume updated when the device list changes.
+ */
+class AudioDeviceStateBroker::Impl final
+  : public std::enable_shared_from_this<AudioDeviceStateBroker::Impl> {
+ public:
+  Impl(
+    std::unique_ptr<SharedMemorySegment> segment,
+    std::unique_ptr<BrokerNotifier> notifier)
+    : mSegment(std::move(segment)),
+      mNotifier(std::move(notifier)),
+      mShared(new (mSegment->GetData()) Segment()) {
+  }
+
+  ~Impl() {
+    // Clients are woken when `mNotifier` is destroyed
+    mShared->mIsStopped.store(1, std::memory_order_release);
+  }
+
+  void Start() {
+    std::weak_ptr<Impl> weak = shared_from_this();
+    mEventCallback = AddAudioDeviceEventCallback(
+      {}, [weak](const AudioDeviceEvent&) { ScheduleRefresh(weak); });
+    Refresh();
+    // Clients don't read anything else until this is set
+    mShared->mMagic.store(Segment::Magic, std::memory_order_release);
+  }
+
+ private:
+  const std::unique_ptr<SharedMemorySegment> mSegment;
+  const std::unique_ptr<BrokerNotifier> mNotifier;
+  Segment* const mShared;
+
+  AudioDeviceEventCallbackHandle mEventCallback;
+  std::atomic<bool> mIsRefreshPending {false};
+
+  // Held for the whole of `Refresh()`, which may run on several workers
+  // and in `Start()` at the same time
+  std::mutex mRefreshMutex;
+  std::map<std::string, VolumeCallbackHandle> mVolumeCallbacks;
+
+  // Held while publishing, as the segment only supports one writer
+  std::mutex mMutex;
+  AudioDeviceListSnapshot mSnapshot;
+  std::map<std::string, Volume> mVolumes;
+  uint64_t mGeneration {};
+
+  static void ScheduleRefresh(const std::weak_ptr<Impl>& weak) {
+    const auto self = weak.lock();
+    // Coalesces bursts, such as a device being removed and the default
+    // changing as a result
+    if (!self || self->mIsRefreshPending.exchange(true)) {
+      return;
+    }
+    GetWorkerPool()->Enqueue([weak]() {
+      const auto self = weak.lock();
+      if (self) {
+        self->Refresh();
+      }
+    });
+  }
+
+  void Refresh() {
+    std::unique_lock refreshLock(mRefreshMutex);
+    // Cleared first, so that changes while querying trigger another refresh
+    mIsRefreshPending.store(false);
+    auto snapshot = QueryAudioDeviceListSnapshot();
+
+    std::weak_ptr<Impl> weak = shared_from_this();
+    std::map<std::string, Volume> volumes;
+    std::map<std::string, VolumeCallbackHandle> callbacks;
+    for (const auto& [id, info]: snapshot.devices) {
+      if (info.state != AudioDeviceState::CONNECTED) {
+        continue;
+      }
+      if (const auto it = mVolumeCallbacks.find(id);
+          it != mVolumeCallbacks.end()) {
+        callbacks.emplace(id, std::move(it->second));
+      } else {
+        auto callback = AddAudioDeviceVolumeCallback(
+          id,
+          [weak, id](const Volume& volume) {
+            const auto self = weak.lock();
+            if (self) {
+              self->OnVolumeChanged(id, volume);
+            }
+          },
+          CallbackDelivery::CHANGES_ONLY);
+        if (callback) {
+          callbacks.emplace(id, std::move(*callback));
+        }
+      }
+      auto volume = GetDeviceVolume(id);
+      if (volume) {
+        volumes.emplace(id, std::move(*volume));
+      }
+    }
+    // Callbacks for devices that are gone are destroyed when this goes out
+    // of scope, without holding `mMutex`
+    std::swap(mVolumeCallbacks, callbacks);
+
+    std::unique_lock lock(mMutex);
+    mSnapshot = std::move(snapshot);
+    mVolumes = std::move(volumes);
+    Publish();
+  }
+
+  void OnVolumeChanged(const std::string& deviceID, const Volume& volume) {
+    std::unique_lock lock(mMutex);
+    if (!mSnapshot.devices.contains(deviceID)) {
+      return;
+    }
+    mVolumes.insert_or_assign(deviceID, volume);
+    Publish();
+  }
+
+  // `mMutex` must be held
+  void Publish() {
+    Segment::State state {};
+    const auto add = [&state, this](const AudioDeviceInfo& info) {
+      auto& device = state.mDevices.at(state.mDeviceCount++);
+      CopyString(device.mID, info.id);
+      CopyString(device.mInterfaceName, info.interfaceName);
+      CopyString(device.mEndpointName, info.endpointName);
+      CopyString(device.mDisplayName, info.displayName);
+      device.mDirection = static_cast<uint8_t>(info.direction);
+      device.mState = static_cast<uint8_t>(info.state);
+
+      const auto it = mVolumes.find(info.id);
+      if (it == mVolumes.end()) {
+        return;
+      }
+      const auto& volume = it->second;
+      device.mHasVolume = true;
+      device.mIsMuted = volume.isMuted;
+      device.mVolumeScalar = volume.volumeScalar;
+      device.mHasVolumeDecibels = volume.volumeDecibels.has_value();
+      device.mVolumeDecibels = volume.volumeDecibels.value_or(0);
+      device.mHasVolumeStep = volume.volumeStep.has_value();
+      device.mVolumeStep = volume.volumeStep.value_or(0);
+    };
+
+    // Connected devices take priority for the limited slots
+    for (const bool connected: {true, false}) {
+      for (const auto& [id, info]: mSnapshot.devices) {
+        if (state.mDeviceCount == Segment::MaxDevices) {
+          break;
+        }
+        if ((info.state == AudioDeviceState::CONNECTED) == connected) {
+          add(info);
+        }
+      }
+    }
+    for (size_t i = 0; i < std::size(DefaultIDs); ++i) {
+      CopyString(state.mDefaultIDs[i], mSnapshot.*DefaultIDs[i]);
+    }
+
+    mShared->mState.Store(state);
+    mShared->mGeneration.store(++mGeneration, std::memory_order_release);
+    mNotifier->Notify(mGeneration);
+  }
+};
+
+AudioDeviceStateBroker::AudioDeviceStateBroker(const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+AudioDeviceStateBroker::~AudioDeviceStateBroker() = default;
+
+result<AudioDeviceStateBroker> StartAudioDeviceStateBroker(
+  const std::string& name) {
+  auto segment = SharedMemorySegment::Create(name, sizeof(Segment));
+  if (!segment) {
+    return {unexpect, segment.error()};
+  }
+  // Only once the segment is ours, as this replaces any existing socket
+  auto notifier = BrokerNotifier::Create(name);
+  if (!notifier) {
+    return {unexpect, Error::UNKNOWN};
+  }
+  auto impl = std::make_shared<AudioDeviceStateBroker::Impl>(
+    std::move(*segment), std::move(notifier));
+  impl->Start();
+  return {AudioDeviceStateBroker {impl}};
+}
+
+class AudioDeviceStateClient::Impl {
+ public:
+  // Far longer than a `Store()` takes, unless the broker died during one
+  static constexpr auto MaxReadTime = std::chrono::milliseconds(100);
+
+  std::unique_ptr<SharedMemorySegment> mSegment;
+  std::unique_ptr<BrokerListener> mListener;
+  const Segment* mShared {nullptr};
+};
+
+AudioDeviceStateClient::AudioDeviceStateClient(const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+AudioDeviceStateClient::~AudioDeviceStateClient() = default;
+
+result<BrokeredAudioDeviceState> AudioDeviceStateClient::GetState() const {
+  if (p->mShared->mIsStopped.load(std::memory_order_acquire)) {
+    return {unexpect, Error::BROKER_NOT_AVAILABLE};
+  }
+  BrokeredAudioDeviceState ret;
+  // Read first, so that it's never newer than the state
+  ret.generation = GetGeneration();
+  const auto loaded = p->mShared->mState.TryLoad(Impl::MaxReadTime);
+  if (!loaded) {
+    return {unexpect, Error::BROKER_NOT_AVAILABLE};
+  }
+  const auto& state = *loaded;
+
+  const auto count
+    = std::min<size_t>(state.mDeviceCount, Segment::MaxDevices);
+  for (size_t i = 0; i < count; ++i) {
+    const auto& device = state.mDevices[i];
+    if (
+      device.mDirection > static_cast<uint8_t>(AudioDeviceDirection::INPUT)
+      || device.mState > static_cast<uint8_t>(
+           AudioDeviceState::DEVICE_PRESENT_NO_CONNECTION)) {
+      continue;
+    }
+    auto id = GetString(device.mID);
+    if (device.mHasVolume) {
+      Volume volume {
+        .isMuted = static_cast<bool>(device.mIsMuted),
+        .volumeScalar = device.mVolumeScalar,
+      };
+      if (device.mHasVolumeDecibels) {
+        volume.volumeDecibels = device.mVolumeDecibels;
+      }
+      if (device.mHasVolumeStep) {
+        volume.volumeStep = device.mVolumeStep;
+      }
+      ret.volumes.emplace(id, volume);
+    }
+    ret.list.devices.emplace(
+      id,
+      AudioDeviceInfo {
+        .id = id,
+        .interfaceName = GetString(device.mInterfaceName),
+        .endpointName = GetString(device.mEndpointName),
+        .displayName = GetString(device.mDisplayName),
+        .direction = static_cast<AudioDeviceDirection>(device.mDirection),
+        .state = static_cast<AudioDeviceState>(device.mState),
+      });
+  }
+  for (size_t i = 0; i < std::size(DefaultIDs); ++i) {
+    ret.list.*DefaultIDs[i] = GetString(state.mDefaultIDs[i]);
+  }
+  return ret;
+}
+
+bool AudioDeviceStateClient::IsBrokerRunning() const {
+  return !p->mShared->mIsStopped.load(std::memory_order_acquire)
+    && p->mSegment->IsOwnerRunning();
+}
+
+uint64_t AudioDeviceStateClient::GetGeneration() const {
+  return p->mShared->mGeneration.load(std::memory_order_acquire);
+}
+
+bool AudioDeviceStateClient::WaitForChange(
+  uint64_t generation,
+  std::chrono::milliseconds timeout) const {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    if (GetGeneration() != generation) {
+      return true;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      return false;
+    }
+    p->mListener->Wait(
+      generation,
+      std::chrono::ceil<std::chrono::milliseconds>(deadline - now));
+  }
+}
+
+result<AudioDeviceStateClient> ConnectToAudioDeviceStateBroker(
+  const std::string& name) {
+  auto impl = std::make_shared<AudioDeviceStateClient::Impl>();
+  // Connected before the generation can be read, so that a notification
+  // can't be missed between reading it and waiting
+  impl->mListener = BrokerListener::Open(name);
+  if (!impl->mListener) {
+    return {unexpect, Error::BROKER_NOT_AVAILABLE};
+  }
+  impl->mSegment = SharedMemorySegment::Open(name, sizeof(Segment));
+  if (!impl->mSegment) {
+    return {unexpect, Error::BROKER_NOT_AVAILABLE};
+  }
+
+  impl->mShared = static_cast<const Segment*>(impl->mSegment->GetData());
+  if (
+    impl->mShared->mMagic.load(std::memory_order_acquire) != Segment::Magic
+    || impl->mShared->mVersion != Segment::Version
+    || impl->mShared->mSize != sizeof(Segment)) {
+    // Still starting, or built from a different version of this library
+    return {unexpect, Error::BROKER_NOT_AVAILABLE};
+  }
+  return {AudioDeviceStateClient {impl}};
+}
+
+}// namespace FredEmmott::Audio
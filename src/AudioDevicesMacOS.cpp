@@ -8,9 +8,23 @@
 #include <CoreAudio/CoreAudio.h>
 
 #include <algorithm>
-#include <unordered_map>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
+#include "AudioDeviceEventHub.h"
+#include "AudioSessionTable.h"
+#include "EpochSubscriberList.h"
+#include "NativeAudioStreams.h"
+#include "NativeDevices.h"
+#include "VolumeChangeFilter.h"
+#include "VolumeCurve.h"
+
 namespace FredEmmott::Audio {
 
 namespace {
@@ -81,6 +95,10 @@ result<std::string> GetAudioObjectProperty<std::string>(
   return ret;
 }
 
+constexpr std::string_view GetDeviceIDPrefix(AudioDeviceDirection dir) {
+  return dir == AudioDeviceDirection::INPUT ? "input/" : "output/";
+}
+
 result<std::string> MakeDeviceID(UInt32 id, AudioDeviceDirection dir) {
   const auto uid = GetAudioObjectProperty<std::string>(
     id,
@@ -91,21 +109,126 @@ result<std::string> MakeDeviceID(UInt32 id, AudioDeviceDirection dir) {
     return {unexpect, Error::DEVICE_NOT_AVAILABLE};
   }
 
-  char buf[1024];
-  snprintf(
-    buf,
-    sizeof(buf),
-    "%s/%s",
-    dir == AudioDeviceDirection::INPUT ? "input" : "output",
-    uid->c_str());
-  return std::string(buf);
+  return std::string(GetDeviceIDPrefix(dir)) + *uid;
+}
+
+/* Non-allocating equivalent of `MakeDeviceID()`, for use in notifications.
+ *
+ * Writes the ID into `buffer`; returns an empty string if it doesn't fit.
+ */
+std::string_view FormatDeviceID(
+  AudioDeviceDirection dir,
+  std::string_view uid,
+  std::span<char> buffer) {
+  const auto prefix = GetDeviceIDPrefix(dir);
+  if (prefix.size() + uid.size() > buffer.size()) {
+    return {};
+  }
+  auto it = std::copy(prefix.begin(), prefix.end(), buffer.begin());
+  it = std::copy(uid.begin(), uid.end(), it);
+  return {buffer.data(), static_cast<size_t>(it - buffer.begin())};
+}
+
+// Non-allocating; returns an empty string if `buffer` is too small
+std::string_view GetDeviceUID(AudioObjectID id, std::span<char> buffer) {
+  const AudioObjectPropertyAddress prop {
+    kAudioDevicePropertyDeviceUID,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMain};
+  CFStringRef value = nullptr;
+  UInt32 size = sizeof(value);
+  const auto status
+    = AudioObjectGetPropertyData(id, &prop, 0, nullptr, &size, &value);
+  if (status != kAudioHardwareNoError || !value) {
+    return {};
+  }
+  const auto ok = CFStringGetCString(
+    value, buffer.data(), buffer.size(), kCFStringEncodingUTF8);
+  CFRelease(value);
+  if (!ok) {
+    return {};
+  }
+  return std::string_view(buffer.data());
 }
 
+/* Caches `kAudioHardwarePropertyDeviceForUID` translations.
+ *
+ * A device that is reconnected may be given a new `AudioObjectID`, so the
+ * cache is cleared whenever the device list changes; a translation is only
+ * stored if that didn't happen while it was in progress.
+ */
+class DeviceUIDCache final {
+ public:
+  static DeviceUIDCache* Get() {
+    // Intentionally leaked: the native listener references it
+    static auto instance = new DeviceUIDCache();
+    return instance;
+  }
+
+  std::optional<AudioObjectID> Find(const std::string& id) {
+    std::unique_lock lock(mMutex);
+    const auto it = mIDs.find(id);
+    if (it == mIDs.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  uint64_t GetGeneration() const {
+    std::unique_lock lock(mMutex);
+    return mGeneration;
+  }
+
+  void Store(const std::string& id, AudioObjectID native, uint64_t generation) {
+    std::unique_lock lock(mMutex);
+    if (mIsWatched && generation == mGeneration) {
+      mIDs.emplace(id, native);
+    }
+  }
+
+ private:
+  static constexpr AudioObjectPropertyAddress DevicesProp {
+    kAudioHardwarePropertyDevices,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMain,
+  };
+
+  mutable std::mutex mMutex;
+  bool mIsWatched {false};
+  uint64_t mGeneration {};
+  std::map<std::string, AudioObjectID> mIDs;
+
+  DeviceUIDCache() {
+    // If this fails, nothing is cached, as it could go stale
+    mIsWatched = AudioObjectAddPropertyListener(
+                   kAudioObjectSystemObject, &DevicesProp, &OSCallback, this)
+      == kAudioHardwareNoError;
+  }
+
+  static OSStatus OSCallback(
+    AudioObjectID,
+    UInt32,
+    const AudioObjectPropertyAddress*,
+    void* data) {
+    auto self = reinterpret_cast<DeviceUIDCache*>(data);
+    std::unique_lock lock(self->mMutex);
+    ++self->mGeneration;
+    self->mIDs.clear();
+    return kAudioHardwareNoError;
+  }
+};
+
 result<std::tuple<UInt32, AudioDeviceDirection>> ParseDeviceID(
   const std::string& id) {
   auto idx = id.find_first_of('/');
   auto direction = id.substr(0, idx) == "input" ? AudioDeviceDirection::INPUT
                                                 : AudioDeviceDirection::OUTPUT;
+  const auto cache = DeviceUIDCache::Get();
+  if (const auto cached = cache->Find(id)) {
+    return std::make_tuple(*cached, direction);
+  }
+  const auto generation = cache->GetGeneration();
+
   CFStringRef uid = CFStringCreateWithCString(
     kCFAllocatorDefault, id.substr(idx + 1).c_str(), kCFStringEncodingUTF8);
   UInt32 device_id;
@@ -129,6 +252,7 @@ result<std::tuple<UInt32, AudioDeviceDirection>> ParseDeviceID(
     return {unexpect, Error::DEVICE_NOT_AVAILABLE};
   }
 
+  cache->Store(id, device_id, generation);
   return std::make_tuple(device_id, direction);
 }
 
@@ -155,12 +279,13 @@ result<void> SetAudioDeviceIsMuted(const std::string& id, bool muted) {
 
 }// namespace
 
-std::string GetDefaultAudioDeviceID(
+std::string GetNativeDefaultAudioDeviceID(
   AudioDeviceDirection direction,
   AudioDeviceRole role) {
   if (role != AudioDeviceRole::DEFAULT) {
     return std::string();
   }
+
   AudioDeviceID native_id = 0;
   UInt32 native_id_size = sizeof(native_id);
   AudioObjectPropertyAddress prop = {
@@ -175,22 +300,22 @@ std::string GetDefaultAudioDeviceID(
   return MakeDeviceID(native_id, direction).value();
 }
 
-void SetDefaultAudioDeviceID(
+bool SetNativeDefaultAudioDeviceID(
   AudioDeviceDirection direction,
   AudioDeviceRole role,
   const std::string& deviceID) {
   if (role != AudioDeviceRole::DEFAULT) {
-    return;
+    return false;
   }
 
   const auto parsed = ParseDeviceID(deviceID);
   if (!parsed) {
-    return;
+    return false;
   }
 
   const auto [native_id, id_dir] = *parsed;
   if (id_dir != direction) {
-    return;
+    return false;
   }
 
   AudioObjectPropertyAddress prop = {
@@ -199,11 +324,23 @@ void SetDefaultAudioDeviceID(
       : kAudioHardwarePropertyDefaultOutputDevice,
     kAudioObjectPropertyScopeGlobal,
     kAudioObjectPropertyElementMain};
-  AudioObjectSetPropertyData(
+  const auto status = AudioObjectSetPropertyData(
     kAudioObjectSystemObject, &prop, 0, NULL, sizeof(native_id), &native_id);
+  return status == kAudioHardwareNoError;
+}
+
+void InitializeNativeThread() {
 }
 
-result<bool> IsAudioDeviceMuted(const std::string& id) {
+result<void> PrewarmNativeDevice(const std::string& deviceID) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  return {};
+}
+
+result<bool> IsNativeDeviceMuted(const std::string& id) {
   const auto parsed = ParseDeviceID(id);
   if (!parsed) {
     return {unexpect, parsed.error()};
@@ -217,11 +354,11 @@ result<bool> IsAudioDeviceMuted(const std::string& id) {
      kAudioObjectPropertyElementMain});
 };
 
-result<void> MuteAudioDevice(const std::string& id) {
+result<void> MuteNativeDevice(const std::string& id) {
   return SetAudioDeviceIsMuted(id, true);
 }
 
-result<void> UnmuteAudioDevice(const std::string& id) {
+result<void> UnmuteNativeDevice(const std::string& id) {
   return SetAudioDeviceIsMuted(id, false);
 }
 
@@ -269,14 +406,20 @@ constexpr AudioObjectPropertyAddress gDeviceListProp {
   kAudioObjectPropertyElementMain,
 };
 
-std::vector<AudioDeviceID> GetAudioDeviceIDs() {
+// Re-uses the capacity of `ids`, so doesn't allocate unless it grows
+void GetAudioDeviceIDs(std::vector<AudioDeviceID>& ids) {
   UInt32 size = 0;
   AudioObjectGetPropertyDataSize(
     kAudioObjectSystemObject, &gDeviceListProp, 0, nullptr, &size);
-  const auto count = size / sizeof(AudioDeviceID);
-  std::vector<AudioDeviceID> ids(count, {});
+  ids.resize(size / sizeof(AudioDeviceID));
   AudioObjectGetPropertyData(
     kAudioObjectSystemObject, &gDeviceListProp, 0, nullptr, &size, ids.data());
+  ids.resize(size / sizeof(AudioDeviceID));
+}
+
+std::vector<AudioDeviceID> GetAudioDeviceIDs() {
+  std::vector<AudioDeviceID> ids;
+  GetAudioDeviceIDs(ids);
   return ids;
 }
 
@@ -297,10 +440,9 @@ bool AudioDeviceSupportsScope(
 
 }// namespace
 
-std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(
-  AudioDeviceDirection direction) {
+std::vector<std::string> GetNativeDeviceIDs(AudioDeviceDirection direction) {
   const auto ids = GetAudioDeviceIDs();
-  std::map<std::string, AudioDeviceInfo> out;
+  std::vector<std::string> out;
 
   // The array of devices will always contain both input and output, even if
   // we set the scope above; instead filter inside the loop
@@ -313,58 +455,61 @@ std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(
       continue;
     }
 
-    const auto deviceID = MakeDeviceID(id, direction);
+    auto deviceID = MakeDeviceID(id, direction);
     if (!deviceID) {
       continue;
     }
+    out.push_back(std::move(*deviceID));
+  }
+  return out;
+}
 
-    const auto manufacturer = GetAudioObjectProperty<std::string>(
-      id,
-      {
-        kAudioObjectPropertyManufacturer,
-        kAudioObjectPropertyScopeGlobal,
-        kAudioObjectPropertyElementMain,
-      });
-    const auto name = GetAudioObjectProperty<std::string>(
-      id,
-      {
-        kAudioObjectPropertyName,
-        kAudioObjectPropertyScopeGlobal,
-        kAudioObjectPropertyElementMain,
-      });
+result<AudioDeviceInfo> GetNativeDeviceInfo(
+  AudioDeviceDirection direction,
+  const std::string& deviceID) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto id = std::get<0>(*parsed);
+  const auto scope = direction == AudioDeviceDirection::INPUT
+    ? kAudioObjectPropertyScopeInput
+    : kAudioObjectPropertyScopeOutput;
 
-    if (!(manufacturer && name)) {
-      continue;
-    }
+  const auto manufacturer = GetAudioObjectProperty<std::string>(
+    id,
+    {
+      kAudioObjectPropertyManufacturer,
+      kAudioObjectPropertyScopeGlobal,
+      kAudioObjectPropertyElementMain,
+    });
+  const auto name = GetAudioObjectProperty<std::string>(
+    id,
+    {
+      kAudioObjectPropertyName,
+      kAudioObjectPropertyScopeGlobal,
+      kAudioObjectPropertyElementMain,
+    });
 
-    AudioDeviceInfo info {
-      .id = *deviceID,
-      .interfaceName = *manufacturer + "/" + *name,
-      .direction = direction,
-    };
-    info.state = GetAudioDeviceState(info.id);
-
-    const auto data_source_name = GetDataSourceName(id, scope);
-    if (data_source_name && !data_source_name->empty()) {
-      info.displayName = *data_source_name;
-      info.endpointName = *data_source_name;
-    } else {
-      const auto name = GetAudioObjectProperty<std::string>(
-        id,
-        {
-          kAudioObjectPropertyName,
-          kAudioObjectPropertyScopeGlobal,
-          kAudioObjectPropertyElementMain,
-        });
-      if (!name) {
-        continue;
-      }
-      info.displayName = *name;
-    }
+  if (!(manufacturer && name)) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
 
-    out.emplace(info.id, info);
+  AudioDeviceInfo info {
+    .id = deviceID,
+    .interfaceName = *manufacturer + "/" + *name,
+    .direction = direction,
+  };
+  info.state = GetAudioDeviceState(info.id);
+
+  const auto data_source_name = GetDataSourceName(id, scope);
+  if (data_source_name && !data_source_name->empty()) {
+    info.displayName = *data_source_name;
+    info.endpointName = *data_source_name;
+  } else {
+    info.displayName = *name;
   }
-  return out;
+  return info;
 }
 
 AudioDeviceState GetAudioDeviceState(const std::string& id) {
@@ -416,52 +561,88 @@ AudioDeviceState GetAudioDeviceState(const std::string& id) {
 
 namespace {
 
-template <class TProp>
-struct BaseCallbackHandleImpl {
-  typedef std::function<void(TProp value)> UserCallback;
-  BaseCallbackHandleImpl(
-    UserCallback callback,
-    AudioDeviceID device,
-    AudioObjectPropertyAddress prop)
-    : mProp(prop), mDevice(device), mCallback(callback) {
-    AudioObjectAddPropertyListener(mDevice, &mProp, &OSCallback, this);
+using PropertySubscriberList = EpochSubscriberList<std::function<void()>>;
+
+/* One native listener per (object, property address), shared by every handle
+ * for it.
+ *
+ * These are never removed or freed: the listener's context pointer must stay
+ * valid for as long as CoreAudio may invoke it, which includes calls that
+ * are already in flight on another thread when a handle is destroyed.
+ * Handles only remove themselves from `mSubscribers`.
+ */
+class PropertyNotifier final {
+ public:
+  PropertySubscriberList mSubscribers;
+
+  static result<PropertyNotifier*> Get(
+    AudioObjectID id,
+    const AudioObjectPropertyAddress& prop) {
+    static std::mutex mutex;
+    static std::map<std::tuple<AudioObjectID, UInt32, UInt32, UInt32>,
+      PropertyNotifier*>
+      cache;
+
+    const auto key
+      = std::make_tuple(id, prop.mSelector, prop.mScope, prop.mElement);
+    std::unique_lock lock(mutex);
+    const auto cached = cache.find(key);
+    if (cached != cache.end()) {
+      return cached->second;
+    }
+
+    auto notifier = std::make_unique<PropertyNotifier>(prop);
+    const auto status = AudioObjectAddPropertyListener(
+      id, &notifier->mProp, &OSCallback, notifier.get());
+    if (status != kAudioHardwareNoError) {
+      return {unexpect, ErrorFromOSStatus(status)};
+    }
+    // Intentionally leaked; see above
+    return cache.emplace(key, notifier.release()).first->second;
   }
 
-  virtual ~BaseCallbackHandleImpl() {
-    AudioObjectRemovePropertyListener(mDevice, &mProp, &OSCallback, this);
+  explicit PropertyNotifier(const AudioObjectPropertyAddress& prop)
+    : mProp(prop) {
   }
 
  private:
   const AudioObjectPropertyAddress mProp;
-  AudioDeviceID mDevice;
-  UserCallback mCallback;
 
   static OSStatus OSCallback(
-    AudioDeviceID id,
-    UInt32 _prop_count,
-    const AudioObjectPropertyAddress* _props,
+    AudioObjectID,
+    UInt32,
+    const AudioObjectPropertyAddress*,
     void* data) {
-    auto self = reinterpret_cast<BaseCallbackHandleImpl<TProp>*>(data);
-    const auto result = GetAudioObjectProperty<TProp>(id, self->mProp);
-    if (result.has_value()) {
-      self->mCallback(result.value());
-    }
-    return 0;
+    auto self = reinterpret_cast<PropertyNotifier*>(data);
+    self->mSubscribers.ForEach([](const auto& cb) { cb(); });
+    return kAudioHardwareNoError;
   }
 };
 
+// Subscribes to all of them, until the handle is destroyed
+NativeWatchHandle Subscribe(
+  const std::vector<PropertyNotifier*>& notifiers,
+  std::function<void()> callback) {
+  using Subscription
+    = std::pair<PropertyNotifier*, PropertySubscriberList::SubscriptionID>;
+  std::vector<Subscription> subscriptions;
+  for (const auto notifier: notifiers) {
+    subscriptions.emplace_back(notifier, notifier->mSubscribers.Add(callback));
+  }
+  return NativeWatchHandle([subscriptions = std::move(subscriptions)]() {
+    for (const auto& [notifier, id]: subscriptions) {
+      notifier->mSubscribers.Remove(id);
+    }
+  });
+}
+
 }// namespace
 
-struct MuteCallbackHandle::Impl : BaseCallbackHandleImpl<bool> {
-  Impl(UserCallback cb, AudioDeviceID device, AudioDeviceDirection direction)
-    : BaseCallbackHandleImpl(
-      cb,
-      device,
-      {kAudioDevicePropertyMute,
-       direction == AudioDeviceDirection::INPUT
-         ? kAudioObjectPropertyScopeInput
-         : kAudioObjectPropertyScopeOutput,
-       kAudioObjectPropertyElementMain}) {
+struct MuteCallbackHandle::Impl {
+  PropertyNotifier* notifier;
+  PropertySubscriberList::SubscriptionID id;
+  ~Impl() {
+    notifier->mSubscribers.Remove(id);
   }
 };
 
@@ -472,202 +653,1083 @@ MuteCallbackHandle::~MuteCallbackHandle() = default;
 
 result<MuteCallbackHandle> AddAudioDeviceMuteUnmuteCallback(
   const std::string& deviceID,
-  std::function<void(bool isMuted)> cb) {
+  std::function<void(bool isMuted)> cb,
+  CallbackDelivery delivery) {
   const auto parsed = ParseDeviceID(deviceID);
   if (!parsed) {
     return {unexpect, Error::DEVICE_NOT_AVAILABLE};
   }
   const auto [id, direction] = *parsed;
-  return {{std::make_shared<MuteCallbackHandle::Impl>(cb, id, direction)}};
-}
+  const AudioObjectPropertyAddress prop {
+    kAudioDevicePropertyMute,
+    direction == AudioDeviceDirection::INPUT ? kAudioObjectPropertyScopeInput
+                                             : kAudioObjectPropertyScopeOutput,
+    kAudioObjectPropertyElementMain,
+  };
+  const auto notifier = PropertyNotifier::Get(id, prop);
+  if (!notifier) {
+    return {unexpect, notifier.error()};
+  }
 
-struct DefaultChangeCallbackHandle::Impl {
-  Impl(std::function<
-       void(AudioDeviceDirection, AudioDeviceRole, const std::string&)> cb)
-    : mInputImpl(
-      [=](AudioDeviceID native_id) {
-        const auto device
-          = MakeDeviceID(native_id, AudioDeviceDirection::INPUT);
-        if (!device) {
-          return;
-        }
-        cb(AudioDeviceDirection::INPUT, AudioDeviceRole::DEFAULT, *device);
-      },
-      kAudioObjectSystemObject,
-      {kAudioHardwarePropertyDefaultInputDevice,
-       kAudioObjectPropertyScopeGlobal,
-       kAudioObjectPropertyElementMain}),
-
-      mOutputImpl(
-        [=](AudioDeviceID native_id) {
-          const auto device
-            = MakeDeviceID(native_id, AudioDeviceDirection::OUTPUT);
-          if (!device) {
-            return;
-          }
-          cb(AudioDeviceDirection::OUTPUT, AudioDeviceRole::DEFAULT, *device);
-        },
-        kAudioObjectSystemObject,
-        {kAudioHardwarePropertyDefaultOutputDevice,
-         kAudioObjectPropertyScopeGlobal,
-         kAudioObjectPropertyElementMain}) {
+  std::optional<Volume> initial;
+  {
+    const auto muted = IsAudioDeviceMuted(deviceID);
+    if (muted.has_value()) {
+      initial = Volume {.isMuted = muted.value()};
+    }
   }
+  auto filter = std::make_shared<VolumeChangeFilter>(
+    delivery, VolumeChangedFields::MUTE, initial);
 
- private:
-  BaseCallbackHandleImpl<AudioDeviceID> mInputImpl;
-  BaseCallbackHandleImpl<AudioDeviceID> mOutputImpl;
-};
+  const auto subscription
+    = (*notifier)->mSubscribers.Add([cb, filter, id, prop]() {
+        const auto isMuted = GetAudioObjectProperty<bool>(id, prop);
+        if (!isMuted.has_value()) {
+          return;
+        }
+        const auto event = filter->Update({.isMuted = isMuted.value()});
+        if (event) {
+          cb(event->volume.isMuted);
+        }
+      });
 
-DefaultChangeCallbackHandle::DefaultChangeCallbackHandle(
-  const std::shared_ptr<Impl>& p)
-  : p(p) {
+  return {{std::make_shared<MuteCallbackHandle::Impl>(
+    *notifier, subscription)}};
 }
 
-DefaultChangeCallbackHandle::~DefaultChangeCallbackHandle() = default;
+namespace {
 
-DefaultChangeCallbackHandle AddDefaultAudioDeviceChangeCallback(
-  std::function<void(AudioDeviceDirection, AudioDeviceRole, const std::string&)>
-    cb) {
-  return std::make_shared<DefaultChangeCallbackHandle::Impl>(cb);
-}
+constexpr AudioObjectPropertyAddress gDefaultInputDeviceProp {
+  kAudioHardwarePropertyDefaultInputDevice,
+  kAudioObjectPropertyScopeGlobal,
+  kAudioObjectPropertyElementMain,
+};
+
+constexpr AudioObjectPropertyAddress gDefaultOutputDeviceProp {
+  kAudioHardwarePropertyDefaultOutputDevice,
+  kAudioObjectPropertyScopeGlobal,
+  kAudioObjectPropertyElementMain,
+};
 
-struct AudioDevicePlugEventCallbackHandle::Impl final {
-  using UserCallback
-    = std::function<void(AudioDevicePlugEvent, const std::string&)>;
+/* Owns the system object listeners, and feeds an `AudioDeviceEventHub`.
+ *
+ * Only one of these exists, and it is never destroyed, so the listener
+ * context can not dangle.
+ *
+ * State is preallocated so that handling a notification doesn't allocate
+ * unless there are more devices than ever before.
+ */
+class AudioDeviceEventNotifier final {
+ public:
+  AudioDeviceEventHub mHub;
+
+  AudioDeviceEventNotifier() {
+    mDeviceIDs.reserve(ExpectedMaxDevices);
+    mKnownDevices.resize(ExpectedMaxDevices);
+    for (auto& device: mKnownDevices) {
+      device.mUID.reserve(ExpectedMaxUIDLength);
+    }
 
-  Impl(const UserCallback& cb) : mCallback(cb) {
-    UpdateDevices();
-    AudioObjectAddPropertyListener(
-      kAudioObjectSystemObject, &gDeviceListProp, &OSCallback, this);
+    GetAudioDeviceIDs(mDeviceIDs);
+    for (const auto id: mDeviceIDs) {
+      AddKnownDevice(id);
+    }
   }
 
-  ~Impl() {
-    AudioObjectRemovePropertyListener(
-      kAudioObjectSystemObject, &gDeviceListProp, &OSCallback, this);
+  bool Register() {
+    for (const auto prop: {
+           &gDeviceListProp,
+           &gDefaultInputDeviceProp,
+           &gDefaultOutputDeviceProp,
+         }) {
+      const auto status = AudioObjectAddPropertyListener(
+        kAudioObjectSystemObject, prop, &OSCallback, this);
+      if (status != kAudioHardwareNoError) {
+        return false;
+      }
+    }
+    return true;
   }
 
  private:
-  UserCallback mCallback;
-  std::vector<AudioDeviceID> mDevices;
-  std::unordered_map<AudioDeviceID, std::vector<std::string>> mDeviceIDStrings;
-
-  void UpdateDevices() {
-    mDevices = GetAudioDeviceIDs();
-    std::sort(mDevices.begin(), mDevices.end());
-
-    for (const auto id: mDevices) {
-      auto& id_strings = mDeviceIDStrings[id];
-      id_strings.clear();
-      if (AudioDeviceSupportsScope(id, kAudioDevicePropertyScopeInput)) {
-        auto devID = MakeDeviceID(id, AudioDeviceDirection::INPUT);
-        if (devID) {
-          id_strings.push_back(*devID);
-        }
+  static constexpr size_t ExpectedMaxDevices = 64;
+  static constexpr size_t ExpectedMaxUIDLength = 256;
+
+  // Kept so that we can report the IDs of removed devices
+  struct KnownDevice {
+    bool mInUse {false};
+    AudioDeviceID mID {};
+    bool mHasInput {false};
+    bool mHasOutput {false};
+    std::string mUID;
+  };
+
+  std::mutex mMutex;
+  std::vector<AudioDeviceID> mDeviceIDs;
+  std::vector<KnownDevice> mKnownDevices;
+
+  KnownDevice* FindKnownDevice(AudioDeviceID id) {
+    for (auto& device: mKnownDevices) {
+      if (device.mInUse && device.mID == id) {
+        return &device;
+      }
+    }
+    return nullptr;
+  }
+
+  KnownDevice* AddKnownDevice(AudioDeviceID id) {
+    auto slot = mHub.GetEventPool().Acquire();
+    const auto uid = GetDeviceUID(id, slot.GetDeviceIDBuffer());
+    if (uid.empty()) {
+      return nullptr;
+    }
+
+    auto it = std::find_if(
+      mKnownDevices.begin(), mKnownDevices.end(), [](const auto& device) {
+        return !device.mInUse;
+      });
+    auto& device
+      = (it == mKnownDevices.end()) ? mKnownDevices.emplace_back() : *it;
+
+    device.mInUse = true;
+    device.mID = id;
+    device.mHasInput
+      = AudioDeviceSupportsScope(id, kAudioDevicePropertyScopeInput);
+    device.mHasOutput
+      = AudioDeviceSupportsScope(id, kAudioDevicePropertyScopeOutput);
+    // Doesn't allocate, as long as it fits in the reserved capacity
+    device.mUID.assign(uid);
+    return &device;
+  }
+
+  void DispatchPlugEvents(
+    AudioDeviceEventKind kind,
+    const KnownDevice& device) {
+    for (const auto direction: {
+           AudioDeviceDirection::INPUT,
+           AudioDeviceDirection::OUTPUT,
+         }) {
+      if (!(direction == AudioDeviceDirection::INPUT ? device.mHasInput
+                                                      : device.mHasOutput)) {
+        continue;
       }
-      if (AudioDeviceSupportsScope(id, kAudioDevicePropertyScopeOutput)) {
-        auto devID = MakeDeviceID(id, AudioDeviceDirection::OUTPUT);
-        id_strings.push_back(*devID);
+      auto slot = mHub.GetEventPool().Acquire();
+      const auto id
+        = FormatDeviceID(direction, device.mUID, slot.GetDeviceIDBuffer());
+      if (id.empty()) {
+        continue;
       }
+      mHub.Dispatch({
+        .kind = kind,
+        .direction = direction,
+        .deviceID = id,
+      });
     }
   }
 
+  // Events are dispatched with the lock held; the HAL delivers these
+  // notifications on a single thread anyway.
   void OnDevicesChanged() {
-    const auto oldDevices = std::move(mDevices);
-    UpdateDevices();
-    const auto& newDevices = mDevices;
-
-    std::vector<AudioDeviceID> added, removed;
-    std::set_difference(
-      oldDevices.begin(),
-      oldDevices.end(),
-      newDevices.begin(),
-      newDevices.end(),
-      std::back_inserter(removed));
-    std::set_difference(
-      newDevices.begin(),
-      newDevices.end(),
-      oldDevices.begin(),
-      oldDevices.end(),
-      std::back_inserter(added));
-
-    for (const auto id: added) {
-      if (AudioDeviceSupportsScope(id, kAudioDevicePropertyScopeInput)) {
-        auto devID = MakeDeviceID(id, AudioDeviceDirection::INPUT);
-        if (devID) {
-          mCallback(AudioDevicePlugEvent::ADDED, *devID);
-        }
+    std::unique_lock lock(mMutex);
+    GetAudioDeviceIDs(mDeviceIDs);
+    std::sort(mDeviceIDs.begin(), mDeviceIDs.end());
+
+    for (auto& device: mKnownDevices) {
+      if (!device.mInUse) {
+        continue;
       }
-      if (AudioDeviceSupportsScope(id, kAudioDevicePropertyScopeOutput)) {
-        auto devID = MakeDeviceID(id, AudioDeviceDirection::OUTPUT);
-        if (devID) {
-          mCallback(AudioDevicePlugEvent::ADDED, *devID);
-        }
+      if (std::binary_search(
+            mDeviceIDs.begin(), mDeviceIDs.end(), device.mID)) {
+        continue;
       }
+      device.mInUse = false;
+      DispatchPlugEvents(AudioDeviceEventKind::REMOVED, device);
     }
-    for (const auto id: removed) {
-      auto it = mDeviceIDStrings.find(id);
-      if (it == mDeviceIDStrings.end()) {
+
+    for (const auto id: mDeviceIDs) {
+      if (FindKnownDevice(id)) {
         continue;
       }
-      for (const auto& id_string: it->second) {
-        mCallback(AudioDevicePlugEvent::REMOVED, id_string);
+      const auto device = AddKnownDevice(id);
+      if (device) {
+        DispatchPlugEvents(AudioDeviceEventKind::ADDED, *device);
       }
-      mDeviceIDStrings.erase(it);
     }
   }
 
-  void InvokeCallback(
-    AudioDevicePlugEvent event,
-    const std::vector<AudioDeviceID>& ids) {
-    for (const auto id: ids) {
+  void OnDefaultDeviceChanged(AudioDeviceDirection direction) {
+    const auto native_id = GetAudioObjectProperty<AudioDeviceID>(
+      kAudioObjectSystemObject,
+      direction == AudioDeviceDirection::INPUT ? gDefaultInputDeviceProp
+                                               : gDefaultOutputDeviceProp);
+    if (!native_id.has_value()) {
+      return;
+    }
+
+    // Two slots: one for the UID, and one for the formatted ID
+    auto uidSlot = mHub.GetEventPool().Acquire();
+    const auto uid
+      = GetDeviceUID(native_id.value(), uidSlot.GetDeviceIDBuffer());
+    if (uid.empty()) {
+      return;
+    }
+    auto slot = mHub.GetEventPool().Acquire();
+    const auto id = FormatDeviceID(direction, uid, slot.GetDeviceIDBuffer());
+    if (id.empty()) {
+      return;
     }
+
+    mHub.Dispatch({
+      .kind = AudioDeviceEventKind::DEFAULT_CHANGED,
+      .direction = direction,
+      .role = AudioDeviceRole::DEFAULT,
+      .deviceID = id,
+    });
   }
 
   static OSStatus OSCallback(
-    AudioDeviceID _id,
-    UInt32 _prop_count,
-    const AudioObjectPropertyAddress* _props,
+    AudioObjectID _id,
+    UInt32 prop_count,
+    const AudioObjectPropertyAddress* props,
     void* data) {
-    reinterpret_cast<Impl*>(data)->OnDevicesChanged();
+    auto self = reinterpret_cast<AudioDeviceEventNotifier*>(data);
+    for (UInt32 i = 0; i < prop_count; ++i) {
+      switch (props[i].mSelector) {
+        case kAudioHardwarePropertyDevices:
+          self->OnDevicesChanged();
+          break;
+        case kAudioHardwarePropertyDefaultInputDevice:
+          self->OnDefaultDeviceChanged(AudioDeviceDirection::INPUT);
+          break;
+        case kAudioHardwarePropertyDefaultOutputDevice:
+          self->OnDefaultDeviceChanged(AudioDeviceDirection::OUTPUT);
+          break;
+      }
+    }
     return 0;
   }
 };
 
-AudioDevicePlugEventCallbackHandle::AudioDevicePlugEventCallbackHandle(
-  const std::shared_ptr<Impl>& p)
+}// namespace
+
+AudioDeviceEventHub* GetAudioDeviceEventHub() {
+  static AudioDeviceEventNotifier* sNotifier
+    = []() -> AudioDeviceEventNotifier* {
+    // Intentionally leaked: notifications are delivered on other threads,
+    // and may arrive during static destruction
+    auto notifier = new AudioDeviceEventNotifier();
+    if (!notifier->Register()) {
+      return nullptr;
+    }
+    return notifier;
+  }();
+
+  if (!sNotifier) {
+    return nullptr;
+  }
+  return &sNotifier->mHub;
+}
+
+namespace {
+
+// CoreAudio has no volume steps; this matches the hardware volume keys
+constexpr uint32_t VolumeStepCount = 16;
+
+AudioObjectPropertyAddress GetVolumeProperty(
+  AudioObjectPropertySelector selector,
+  AudioDeviceDirection direction) {
+  return {
+    selector,
+    direction == AudioDeviceDirection::INPUT ? kAudioObjectPropertyScopeInput
+                                             : kAudioObjectPropertyScopeOutput,
+    kAudioObjectPropertyElementMain,
+  };
+}
+
+// The HAL's mapping between scalars and decibels is device-specific, so it's
+// preferred; the curve provides the range, and steps, which the HAL doesn't
+// have at all
+result<VolumeCurve> GetVolumeCurve(
+  AudioDeviceID id,
+  AudioDeviceDirection direction) {
+  const auto range = GetAudioObjectProperty<AudioValueRange>(
+    id, GetVolumeProperty(kAudioDevicePropertyVolumeRangeDecibels, direction));
+  if (!range) {
+    return {unexpect, range.error()};
+  }
+  const auto minDecibels = static_cast<float>(range->mMinimum);
+  const auto maxDecibels = static_cast<float>(range->mMaximum);
+  return VolumeCurve {{
+    .minDecibels = minDecibels,
+    .maxDecibels = maxDecibels,
+    .incrementDecibels = (maxDecibels - minDecibels) / (VolumeStepCount - 1),
+    .volumeSteps = VolumeStepCount,
+  }};
+}
+
+// Converts with `kAudioDevicePropertyVolumeScalarToDecibels` or
+// `kAudioDevicePropertyVolumeDecibelsToScalar`; the value is both the input
+// and the output of the property
+result<float> TranslateVolume(
+  AudioDeviceID id,
+  AudioDeviceDirection direction,
+  AudioObjectPropertySelector selector,
+  float value) {
+  Float32 translated = value;
+  UInt32 size = sizeof(translated);
+  const auto prop = GetVolumeProperty(selector, direction);
+  const auto status
+    = AudioObjectGetPropertyData(id, &prop, 0, nullptr, &size, &translated);
+  if (status != kAudioHardwareNoError) {
+    return {unexpect, ErrorFromOSStatus(status)};
+  }
+  return translated;
+}
+
+// Not every device can translate; those use the curve's audio taper instead
+result<float> ScalarToDecibels(
+  AudioDeviceID id,
+  AudioDeviceDirection direction,
+  const VolumeCurve& curve,
+  float scalar) {
+  auto translated = TranslateVolume(
+    id, direction, kAudioDevicePropertyVolumeScalarToDecibels, scalar);
+  if (translated || translated.error() != Error::OPERATION_UNSUPPORTED) {
+    return translated;
+  }
+  return curve.ScalarToDecibels(scalar);
+}
+
+result<float> DecibelsToScalar(
+  AudioDeviceID id,
+  AudioDeviceDirection direction,
+  const VolumeCurve& curve,
+  float decibels) {
+  auto translated = TranslateVolume(
+    id, direction, kAudioDevicePropertyVolumeDecibelsToScalar, decibels);
+  if (translated || translated.error() != Error::OPERATION_UNSUPPORTED) {
+    return translated;
+  }
+  return curve.DecibelsToScalar(decibels);
+}
+
+// By native ID, so that notifications don't need to parse the device ID
+result<Volume> GetVolume(AudioDeviceID id, AudioDeviceDirection direction) {
+  const auto curve = GetVolumeCurve(id, direction);
+  if (!curve) {
+    return {unexpect, curve.error()};
+  }
+  const auto scalar = GetAudioObjectProperty<Float32>(
+    id, GetVolumeProperty(kAudioDevicePropertyVolumeScalar, direction));
+  if (!scalar.has_value()) {
+    return {unexpect, scalar.error()};
+  }
+  // Translated rather than read, so that it matches the scalar even if the
+  // volume changes in between
+  const auto decibels = ScalarToDecibels(id, direction, *curve, *scalar);
+  if (!decibels.has_value()) {
+    return {unexpect, decibels.error()};
+  }
+  const auto muted = GetAudioObjectProperty<bool>(
+    id, GetVolumeProperty(kAudioDevicePropertyMute, direction));
+  return Volume {
+    .isMuted = muted.value_or(false),
+    .volumeScalar = *scalar,
+    .volumeDecibels = *decibels,
+    .volumeStep = curve->ScalarToStep(*scalar),
+  };
+}
+
+result<void> SetVolumeScalar(
+  AudioDeviceID id,
+  AudioDeviceDirection direction,
+  float value) {
+  if (value < 0 || value > 1) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  const Float32 scalar = value;
+  const auto prop
+    = GetVolumeProperty(kAudioDevicePropertyVolumeScalar, direction);
+  const auto status = AudioObjectSetPropertyData(
+    id, &prop, 0, nullptr, sizeof(scalar), &scalar);
+  if (status != kAudioHardwareNoError) {
+    return {unexpect, ErrorFromOSStatus(status)};
+  }
+  return {};
+}
+
+result<void> StepVolume(const std::string& deviceID, int32_t delta) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto curve = GetVolumeCurve(id, direction);
+  if (!curve) {
+    return {unexpect, curve.error()};
+  }
+  const auto scalar = GetAudioObjectProperty<Float32>(
+    id, GetVolumeProperty(kAudioDevicePropertyVolumeScalar, direction));
+  if (!scalar.has_value()) {
+    return {unexpect, scalar.error()};
+  }
+
+  const auto step = static_cast<int32_t>(curve->ScalarToStep(*scalar));
+  const auto next = std::clamp<int32_t>(
+    step + delta, 0, static_cast<int32_t>(VolumeStepCount - 1));
+  return SetVolumeScalar(
+    id, direction, curve->StepToScalar(static_cast<uint32_t>(next)));
+}
+
+}// namespace
+
+result<VolumeRange> GetNativeDeviceVolumeRange(const std::string& deviceID) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto curve = GetVolumeCurve(id, direction);
+  if (!curve) {
+    return {unexpect, curve.error()};
+  }
+  return curve->GetRange();
+}
+
+result<Volume> GetNativeDeviceVolume(const std::string& deviceID) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  return GetVolume(id, direction);
+}
+
+result<void> SetNativeDeviceVolumeScalar(
+  const std::string& deviceID,
+  float value) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  return SetVolumeScalar(id, direction, value);
+}
+
+result<void> SetNativeDeviceVolumeDecibels(
+  const std::string& deviceID,
+  float value) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto curve = GetVolumeCurve(id, direction);
+  if (!curve) {
+    return {unexpect, curve.error()};
+  }
+  const auto& range = curve->GetRange();
+  if (value < range.minDecibels || value > range.maxDecibels) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  const auto scalar = DecibelsToScalar(id, direction, *curve, value);
+  if (!scalar) {
+    return {unexpect, scalar.error()};
+  }
+  return SetVolumeScalar(id, direction, std::clamp(*scalar, 0.0f, 1.0f));
+}
+
+result<void> IncreaseNativeDeviceVolume(const std::string& deviceID) {
+  return StepVolume(deviceID, 1);
+}
+
+result<void> DecreaseNativeDeviceVolume(const std::string& deviceID) {
+  return StepVolume(deviceID, -1);
+}
+
+struct VolumeCallbackHandle::Impl {
+  NativeWatchHandle watch;
+};
+
+VolumeCallbackHandle::VolumeCallbackHandle(const std::shared_ptr<Impl>& p)
   : p(p) {
 }
 
-AudioDevicePlugEventCallbackHandle::~AudioDevicePlugEventCallbackHandle()
-  = default;
+VolumeCallbackHandle::~VolumeCallbackHandle() = default;
+
+result<VolumeCallbackHandle> AddAudioDeviceVolumeChangeCallback(
+  const std::string& deviceID,
+  std::function<void(const VolumeChangeEvent&)> cb,
+  CallbackDelivery delivery) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
+  const auto [id, direction] = *parsed;
 
-AudioDevicePlugEventCallbackHandle AddAudioDevicePlugEventCallback(
-  std::function<void(AudioDevicePlugEvent, const std::string&)> userCallback) {
-  return std::make_shared<AudioDevicePlugEventCallbackHandle::Impl>(
-    userCallback);
+  // The HAL notifies the scalar and mute separately; there are no
+  // notifications for the decibels or step, which are derived from the
+  // scalar. Channel volumes are notified per channel element, so they aren't
+  // included.
+  const auto scalarProp
+    = GetVolumeProperty(kAudioDevicePropertyVolumeScalar, direction);
+  // Listeners can be added for properties that the device doesn't have;
+  // callers fall back to mute callbacks for devices without volume control
+  if (!AudioObjectHasProperty(id, &scalarProp)) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  std::vector<PropertyNotifier*> notifiers;
+  const auto scalarNotifier = PropertyNotifier::Get(id, scalarProp);
+  if (!scalarNotifier) {
+    return {unexpect, scalarNotifier.error()};
+  }
+  notifiers.push_back(*scalarNotifier);
+  // Not every device can be muted
+  const auto muteNotifier = PropertyNotifier::Get(
+    id, GetVolumeProperty(kAudioDevicePropertyMute, direction));
+  if (muteNotifier) {
+    notifiers.push_back(*muteNotifier);
+  }
+
+  const auto initial = GetVolume(id, direction);
+  auto filter = std::make_shared<VolumeChangeFilter>(
+    delivery,
+    VolumeChangedFields::MUTE | VolumeChangedFields::SCALAR
+      | VolumeChangedFields::DECIBELS | VolumeChangedFields::STEP,
+    initial.has_value() ? std::optional {*initial} : std::nullopt);
+
+  auto watch = Subscribe(notifiers, [cb, filter, id, direction]() {
+    const auto volume = GetVolume(id, direction);
+    if (!volume.has_value()) {
+      return;
+    }
+    const auto event = filter->Update(*volume);
+    if (event) {
+      cb(*event);
+    }
+  });
+  return {{std::make_shared<VolumeCallbackHandle::Impl>(std::move(watch))}};
 }
 
-result<VolumeRange> GetDeviceVolumeRange(const std::string&) {
-  return {unexpect, Error::OPERATION_UNSUPPORTED};
+result<VolumeCallbackHandle> AddAudioDeviceVolumeCallback(
+  const std::string& deviceID,
+  std::function<void(const Volume&)> cb,
+  CallbackDelivery delivery) {
+  return AddAudioDeviceVolumeChangeCallback(
+    deviceID,
+    [cb](const VolumeChangeEvent& event) { cb(event.volume); },
+    delivery);
 }
 
-result<Volume> GetDeviceVolume(const std::string& deviceID) {
-  return {unexpect, Error::OPERATION_UNSUPPORTED};
+namespace {
+
+// IOProcs always use interleaved 32-bit float, and we only use the first
+// buffer in each direction
+result<AudioStreamFormat> GetIOProcFormat(
+  AudioDeviceID device,
+  AudioObjectPropertyScope scope) {
+  const auto sampleRate = GetAudioObjectProperty<Float64>(
+    device,
+    {kAudioDevicePropertyNominalSampleRate,
+     kAudioObjectPropertyScopeGlobal,
+     kAudioObjectPropertyElementMain});
+  if (!sampleRate.has_value()) {
+    return {unexpect, sampleRate.error()};
+  }
+
+  // Variable-length, so not supported by `GetAudioObjectProperty()`
+  const AudioObjectPropertyAddress configProp {
+    kAudioDevicePropertyStreamConfiguration,
+    scope,
+    kAudioObjectPropertyElementMain,
+  };
+  UInt32 size = 0;
+  AudioObjectGetPropertyDataSize(device, &configProp, 0, nullptr, &size);
+  if (size < sizeof(AudioBufferList)) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  std::vector<std::byte> config(size);
+  const auto status = AudioObjectGetPropertyData(
+    device, &configProp, 0, nullptr, &size, config.data());
+  if (status != kAudioHardwareNoError) {
+    return {unexpect, ErrorFromOSStatus(status)};
+  }
+  const auto buffers = reinterpret_cast<const AudioBufferList*>(config.data());
+  if (buffers->mNumberBuffers == 0) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+
+  return AudioStreamFormat {
+    .sampleFormat = AudioSampleFormat::FLOAT32,
+    .sampleRate = static_cast<uint32_t>(*sampleRate),
+    .channels = static_cast<uint16_t>(buffers->mBuffers[0].mNumberChannels),
+  };
 }
 
-result<void> SetDeviceVolumeScalar(const std::string& deviceID, float) {
-  return {unexpect, Error::OPERATION_UNSUPPORTED};
+/* Captures the device's first input stream via an IOProc.
+ *
+ * Buffers are delivered directly from the HAL, without copying.
+ */
+class HALCaptureStream final : public NativeCaptureStream {
+ public:
+  HALCaptureStream(AudioDeviceID device, Callback callback)
+    : mDevice(device), mCallback(std::move(callback)) {
+  }
+
+  ~HALCaptureStream() {
+    if (mProcID) {
+      AudioDeviceStop(mDevice, mProcID);
+      AudioDeviceDestroyIOProcID(mDevice, mProcID);
+    }
+  }
+
+  result<void> Start() {
+    auto format = GetIOProcFormat(mDevice, kAudioObjectPropertyScopeInput);
+    if (!format) {
+      return {unexpect, format.error()};
+    }
+    mFormat = *format;
+
+    auto status = AudioDeviceCreateIOProcID(mDevice, &IOProc, this, &mProcID);
+    if (status != kAudioHardwareNoError) {
+      mProcID = nullptr;
+      return {unexpect, ErrorFromOSStatus(status)};
+    }
+    status = AudioDeviceStart(mDevice, mProcID);
+    if (status != kAudioHardwareNoError) {
+      return {unexpect, ErrorFromOSStatus(status)};
+    }
+    return {};
+  }
+
+  AudioStreamFormat GetFormat() const override {
+    return mFormat;
+  }
+
+ private:
+  AudioDeviceID mDevice;
+  Callback mCallback;
+  AudioStreamFormat mFormat {};
+  AudioDeviceIOProcID mProcID {nullptr};
+
+  static OSStatus IOProc(
+    AudioObjectID,
+    const AudioTimeStamp*,
+    const AudioBufferList* inputData,
+    const AudioTimeStamp*,
+    AudioBufferList*,
+    const AudioTimeStamp*,
+    void* context) {
+    auto self = reinterpret_cast<HALCaptureStream*>(context);
+    if (!(inputData && inputData->mNumberBuffers > 0)) {
+      return kAudioHardwareNoError;
+    }
+    const auto& buffer = inputData->mBuffers[0];
+    if (buffer.mNumberChannels == 0) {
+      return kAudioHardwareNoError;
+    }
+    self->mCallback({
+      .mData = buffer.mData,
+      .mFrames = static_cast<uint32_t>(
+        buffer.mDataByteSize / (sizeof(float) * buffer.mNumberChannels)),
+      .mChannels = static_cast<uint16_t>(buffer.mNumberChannels),
+      .mSampleRate = self->mFormat.sampleRate,
+      .mFormat = AudioSampleFormat::FLOAT32,
+      .mIsSilent = (buffer.mData == nullptr),
+    });
+    return kAudioHardwareNoError;
+  }
+};
+
+/* Renders to the device's first output stream via an IOProc.
+ *
+ * The IOProc is created when the stream is opened, but the device is only
+ * started by `Start()`; this is most of the cost of starting playback.
+ */
+class HALRenderStream final : public NativeRenderStream {
+ public:
+  HALRenderStream(AudioDeviceID device, Callback callback)
+    : mDevice(device), mCallback(std::move(callback)) {
+  }
+
+  ~HALRenderStream() {
+    if (mProcID) {
+      AudioDeviceStop(mDevice, mProcID);
+      AudioDeviceDestroyIOProcID(mDevice, mProcID);
+    }
+  }
+
+  result<void> Open() {
+    auto format = GetIOProcFormat(mDevice, kAudioObjectPropertyScopeOutput);
+    if (!format) {
+      return {unexpect, format.error()};
+    }
+    mFormat = *format;
+
+    const auto status
+      = AudioDeviceCreateIOProcID(mDevice, &IOProc, this, &mProcID);
+    if (status != kAudioHardwareNoError) {
+      mProcID = nullptr;
+      return {unexpect, ErrorFromOSStatus(status)};
+    }
+    return {};
+  }
+
+  AudioStreamFormat GetFormat() const override {
+    return mFormat;
+  }
+
+  result<void> Start() override {
+    const auto status = AudioDeviceStart(mDevice, mProcID);
+    if (status != kAudioHardwareNoError) {
+      return {unexpect, ErrorFromOSStatus(status)};
+    }
+    return {};
+  }
+
+  void Stop() override {
+    AudioDeviceStop(mDevice, mProcID);
+  }
+
+ private:
+  AudioDeviceID mDevice;
+  Callback mCallback;
+  AudioStreamFormat mFormat {};
+  AudioDeviceIOProcID mProcID {nullptr};
+
+  static OSStatus IOProc(
+    AudioObjectID,
+    const AudioTimeStamp*,
+    const AudioBufferList*,
+    const AudioTimeStamp*,
+    AudioBufferList* outputData,
+    const AudioTimeStamp*,
+    void* context) {
+    auto self = reinterpret_cast<HALRenderStream*>(context);
+    if (!(outputData && outputData->mNumberBuffers > 0)) {
+      return kAudioHardwareNoError;
+    }
+    // We don't render to other streams, but they still need to be silent
+    for (UInt32 i = 1; i < outputData->mNumberBuffers; ++i) {
+      auto& buffer = outputData->mBuffers[i];
+      if (buffer.mData) {
+        std::memset(buffer.mData, 0, buffer.mDataByteSize);
+      }
+    }
+
+    auto& buffer = outputData->mBuffers[0];
+    if (buffer.mNumberChannels == 0 || !buffer.mData) {
+      return kAudioHardwareNoError;
+    }
+    self->mCallback({
+      .mData = buffer.mData,
+      .mFrames = static_cast<uint32_t>(
+        buffer.mDataByteSize / (sizeof(float) * buffer.mNumberChannels)),
+      .mChannels = static_cast<uint16_t>(buffer.mNumberChannels),
+      .mSampleRate = self->mFormat.sampleRate,
+      .mFormat = AudioSampleFormat::FLOAT32,
+    });
+    return kAudioHardwareNoError;
+  }
+};
+
+}// namespace
+
+result<bool> IsNativeMuteAfterCapture(const std::string& deviceID) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  // Input mute is applied by the driver or the HAL, before any client's IO
+  // proc is invoked
+  return false;
+}
+
+result<std::unique_ptr<NativeCaptureStream>> OpenNativeCaptureStream(
+  const std::string& deviceID,
+  NativeCaptureStream::Callback callback) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  // Loopback needs process taps, which aren't available on all supported
+  // versions of macOS
+  if (direction != AudioDeviceDirection::INPUT) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+
+  auto stream = std::make_unique<HALCaptureStream>(id, std::move(callback));
+  auto started = stream->Start();
+  if (!started) {
+    return {unexpect, started.error()};
+  }
+  return std::unique_ptr<NativeCaptureStream>(std::move(stream));
+}
+
+result<std::unique_ptr<NativeRenderStream>> OpenNativeRenderStream(
+  const std::string& deviceID,
+  NativeRenderStream::Callback callback) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  if (direction != AudioDeviceDirection::OUTPUT) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+
+  auto stream = std::make_unique<HALRenderStream>(id, std::move(callback));
+  auto opened = stream->Open();
+  if (!opened) {
+    return {unexpect, opened.error()};
+  }
+  return std::unique_ptr<NativeRenderStream>(std::move(stream));
+}
+
+result<AudioDeviceStreamProperties> QueryNativeStreamProperties(
+  const std::string& deviceID) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto scope = direction == AudioDeviceDirection::INPUT
+    ? kAudioObjectPropertyScopeInput
+    : kAudioObjectPropertyScopeOutput;
+
+  const auto format = GetIOProcFormat(id, scope);
+  if (!format) {
+    return {unexpect, format.error()};
+  }
+  const auto bufferFrames = GetAudioObjectProperty<UInt32>(
+    id,
+    {kAudioDevicePropertyBufferFrameSize,
+     kAudioObjectPropertyScopeGlobal,
+     kAudioObjectPropertyElementMain});
+  if (!bufferFrames.has_value()) {
+    return {unexpect, bufferFrames.error()};
+  }
+  // Both in frames; the safety offset is how far ahead of the hardware the
+  // HAL reads or writes
+  const auto latency = GetAudioObjectProperty<UInt32>(
+    id, {kAudioDevicePropertyLatency, scope, kAudioObjectPropertyElementMain});
+  const auto safetyOffset = GetAudioObjectProperty<UInt32>(
+    id,
+    {kAudioDevicePropertySafetyOffset, scope, kAudioObjectPropertyElementMain});
+
+  const auto toDuration = [rate = format->sampleRate](uint64_t frames) {
+    return std::chrono::microseconds(rate ? (frames * 1000000) / rate : 0);
+  };
+  return AudioDeviceStreamProperties {
+    .format = *format,
+    .period = toDuration(*bufferFrames),
+    .bufferFrames = *bufferFrames,
+    .latency = toDuration(latency.value_or(0) + safetyOffset.value_or(0)),
+  };
+}
+
+result<NativeWatchHandle> WatchNativeStreamProperties(
+  const std::string& deviceID,
+  std::function<void()> callback) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto scope = direction == AudioDeviceDirection::INPUT
+    ? kAudioObjectPropertyScopeInput
+    : kAudioObjectPropertyScopeOutput;
+
+  const AudioObjectPropertyAddress props[] {
+    {kAudioDevicePropertyNominalSampleRate,
+     kAudioObjectPropertyScopeGlobal,
+     kAudioObjectPropertyElementMain},
+    {kAudioDevicePropertyBufferFrameSize,
+     kAudioObjectPropertyScopeGlobal,
+     kAudioObjectPropertyElementMain},
+    {kAudioDevicePropertyStreamConfiguration,
+     scope,
+     kAudioObjectPropertyElementMain},
+    {kAudioDevicePropertyLatency, scope, kAudioObjectPropertyElementMain},
+    {kAudioDevicePropertySafetyOffset, scope, kAudioObjectPropertyElementMain},
+  };
+  // Get all the notifiers before subscribing to any, so that a failure
+  // doesn't leave a partial registration behind
+  std::vector<PropertyNotifier*> notifiers;
+  for (const auto& prop: props) {
+    const auto notifier = PropertyNotifier::Get(id, prop);
+    if (!notifier) {
+      return {unexpect, notifier.error()};
+    }
+    notifiers.push_back(*notifier);
+  }
+  return Subscribe(notifiers, std::move(callback));
+}
+
+result<NativeWatchHandle> WatchNativeDeviceInfo(
+  const std::string& deviceID,
+  std::function<void()> callback) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto scope = direction == AudioDeviceDirection::INPUT
+    ? kAudioObjectPropertyScopeInput
+    : kAudioObjectPropertyScopeOutput;
+
+  // The inputs to `GetNativeDeviceInfo()`
+  const AudioObjectPropertyAddress props[] {
+    {kAudioObjectPropertyName,
+     kAudioObjectPropertyScopeGlobal,
+     kAudioObjectPropertyElementMain},
+    {kAudioObjectPropertyManufacturer,
+     kAudioObjectPropertyScopeGlobal,
+     kAudioObjectPropertyElementMain},
+    {kAudioDevicePropertyDataSource, scope, kAudioObjectPropertyElementMain},
+    {kAudioDevicePropertyJackIsConnected,
+     scope,
+     kAudioObjectPropertyElementMain},
+  };
+  std::vector<PropertyNotifier*> notifiers;
+  for (const auto& prop: props) {
+    // Most devices have no data source or jack
+    if (!AudioObjectHasProperty(id, &prop)) {
+      continue;
+    }
+    const auto notifier = PropertyNotifier::Get(id, prop);
+    if (!notifier) {
+      return {unexpect, notifier.error()};
+    }
+    notifiers.push_back(*notifier);
+  }
+  return Subscribe(notifiers, std::move(callback));
+}
+
+namespace {
+
+// Element 0 is the main control; channel controls are 1-based
+AudioObjectPropertyAddress GetChannelVolumeProperty(
+  AudioDeviceDirection direction,
+  uint32_t channel) {
+  auto prop = GetVolumeProperty(kAudioDevicePropertyVolumeScalar, direction);
+  prop.mElement = channel + 1;
+  return prop;
+}
+
+// Channels of the first stream, as used for IOProcs
+result<uint32_t> GetChannelCount(
+  AudioDeviceID id,
+  AudioDeviceDirection direction) {
+  const auto format = GetIOProcFormat(
+    id,
+    direction == AudioDeviceDirection::INPUT ? kAudioObjectPropertyScopeInput
+                                             : kAudioObjectPropertyScopeOutput);
+  if (!format) {
+    return {unexpect, format.error()};
+  }
+  return format->channels;
+}
+
+}// namespace
+
+result<std::vector<float>> GetNativeDeviceChannelVolumes(
+  const std::string& deviceID) {
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto count = GetChannelCount(id, direction);
+  if (!count.has_value()) {
+    return {unexpect, count.error()};
+  }
+
+  // Channels without their own control follow the main control
+  const auto main = GetAudioObjectProperty<Float32>(
+    id, GetVolumeProperty(kAudioDevicePropertyVolumeScalar, direction));
+  std::vector<float> volumes(*count, main.value_or(1.0f));
+  bool hasChannelControls = false;
+  for (uint32_t i = 0; i < *count; ++i) {
+    const auto prop = GetChannelVolumeProperty(direction, i);
+    if (!AudioObjectHasProperty(id, &prop)) {
+      continue;
+    }
+    const auto volume = GetAudioObjectProperty<Float32>(id, prop);
+    if (!volume.has_value()) {
+      return {unexpect, volume.error()};
+    }
+    volumes[i] = *volume;
+    hasChannelControls = true;
+  }
+  if (!hasChannelControls) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  return volumes;
+}
+
+result<void> SetNativeDeviceChannelVolumes(
+  const std::string& deviceID,
+  std::span<const float> volumes) {
+  if (std::ranges::any_of(volumes, [](float v) { return v < 0 || v > 1; })) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  const auto parsed = ParseDeviceID(deviceID);
+  if (!parsed) {
+    return {unexpect, parsed.error()};
+  }
+  const auto [id, direction] = *parsed;
+  const auto count = GetChannelCount(id, direction);
+  if (!count.has_value()) {
+    return {unexpect, count.error()};
+  }
+  if (volumes.size() != *count) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+
+  // Every write is a separate native call and notification, so skip
+  // channels that are already at the requested level
+  bool hasChannelControls = false;
+  for (uint32_t i = 0; i < *count; ++i) {
+    const auto prop = GetChannelVolumeProperty(direction, i);
+    if (!AudioObjectHasProperty(id, &prop)) {
+      continue;
+    }
+    hasChannelControls = true;
+    const auto current = GetAudioObjectProperty<Float32>(id, prop);
+    if (current.has_value() && *current == volumes[i]) {
+      continue;
+    }
+    const Float32 scalar = volumes[i];
+    const auto status = AudioObjectSetPropertyData(
+      id, &prop, 0, nullptr, sizeof(scalar), &scalar);
+    if (status != kAudioHardwareNoError) {
+      return {unexpect, ErrorFromOSStatus(status)};
+    }
+  }
+  if (!hasChannelControls) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  return {};
 }
 
-result<void> SetDeviceVolumeDecibels(const std::string& deviceID, float) {
+// CoreAudio has no per-application volume or mute controls
+result<AudioSessionTable*> GetAudioSessionTable(const std::string&) {
   return {unexpect, Error::OPERATION_UNSUPPORTED};
 }
 
-result<void> IncreaseDeviceVolume(const std::string& deviceID) {
+result<void> SetAudioSessionVolume(
+  const std::string&,
+  const std::string&,
+  float) {
   return {unexpect, Error::OPERATION_UNSUPPORTED};
 }
 
-result<void> DecreaseDeviceVolume(const std::string& deviceID) {
+result<void> SetAudioSessionMute(
+  const std::string&,
+  const std::string&,
+  bool) {
   return {unexpect, Error::OPERATION_UNSUPPORTED};
 }
 
@@ -9,17 +9,37 @@
 // Include order matters for these; don't let the autoformatter break things
 // clang-format off
 #include <Windows.h>
+#include <Audioclient.h>
+#include <audiopolicy.h>
+#include <avrt.h>
 #include <endpointvolume.h>
+#include <ksmedia.h>
 #include <mmdeviceapi.h>
+#include <mmreg.h>
 #include <Unknwn.h>
 // clang-format on
 
 #include <winrt/base.h>
 
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "AudioDeviceEventHub.h"
+#include "AudioSessionTable.h"
+#include "EpochSubscriberList.h"
 #include "Functiondiscoverykeys_devpkey.h"
+#include "NativeAudioStreams.h"
+#include "NativeDevices.h"
 #include "PolicyConfig.h"
+#include "VolumeChangeFilter.h"
 
 #pragma comment(lib, "WindowsApp.lib")
+#pragma comment(lib, "avrt.lib")
 
 namespace FredEmmott::Audio {
 
@@ -32,6 +52,28 @@ std::string Utf16ToUtf8(const std::wstring& utf16) {
   return winrt::to_string(utf16);
 }
 
+// Converts into `buffer` without allocating; returns an empty string if the
+// buffer is too small
+std::string_view Utf16ToUtf8(LPCWSTR utf16, std::span<char> buffer) {
+  if (!(utf16 && *utf16)) {
+    return {};
+  }
+  const auto length = WideCharToMultiByte(
+    CP_UTF8,
+    0,
+    utf16,
+    -1,
+    buffer.data(),
+    static_cast<int>(buffer.size()),
+    nullptr,
+    nullptr);
+  if (length <= 0) {
+    return {};
+  }
+  // `length` includes the null terminator
+  return {buffer.data(), static_cast<size_t>(length - 1)};
+}
+
 std::wstring Utf8ToUtf16(const std::string& utf8) {
   if (utf8.empty()) {
     return std::wstring();
@@ -59,12 +101,22 @@ ERole AudioDeviceRoleToERole(const AudioDeviceRole role) {
   __assume(0);
 }
 
+/* These caches are populated concurrently by `PrewarmAudioDevices()`.
+ *
+ * The locks aren't held while resolving, as that can be slow; if two threads
+ * resolve the same device, the first result to be stored is kept.
+ */
+
 result<winrt::com_ptr<IMMDevice>> DeviceIDToDevice(
   const std::string& device_id) {
+  static std::mutex mutex;
   static std::map<std::string, winrt::com_ptr<IMMDevice>> cache;
-  const auto cached = cache.find(device_id);
-  if (cached != cache.end()) {
-    return cached->second;
+  {
+    std::unique_lock lock(mutex);
+    const auto cached = cache.find(device_id);
+    if (cached != cache.end()) {
+      return cached->second;
+    }
   }
 
   auto de
@@ -75,16 +127,20 @@ result<winrt::com_ptr<IMMDevice>> DeviceIDToDevice(
   if (!device) {
     return {unexpect, Error::DEVICE_NOT_AVAILABLE};
   }
-  cache.emplace(device_id, device);
-  return device;
+  std::unique_lock lock(mutex);
+  return cache.try_emplace(device_id, device).first->second;
 }
 
 result<winrt::com_ptr<IAudioEndpointVolume>> DeviceIDToAudioEndpointVolume(
   const std::string& device_id) {
+  static std::mutex mutex;
   static std::map<std::string, winrt::com_ptr<IAudioEndpointVolume>> cache;
-  const auto cached = cache.find(device_id);
-  if (cached != cache.end()) {
-    return cached->second;
+  {
+    std::unique_lock lock(mutex);
+    const auto cached = cache.find(device_id);
+    if (cached != cache.end()) {
+      return cached->second;
+    }
   }
   auto device = DeviceIDToDevice(device_id);
   if (!device) {
@@ -96,20 +152,11 @@ result<winrt::com_ptr<IAudioEndpointVolume>> DeviceIDToAudioEndpointVolume(
   if (!volume) {
     return {unexpect, Error::OPERATION_UNSUPPORTED};
   }
-  cache[device_id] = volume;
-  return volume;
+  std::unique_lock lock(mutex);
+  return cache.try_emplace(device_id, volume).first->second;
 }
 
-AudioDeviceState GetAudioDeviceState(const winrt::com_ptr<IMMDevice>& device) {
-  if (!device) {
-    return AudioDeviceState::DEVICE_NOT_PRESENT;
-  }
-
-  DWORD nativeState;
-  if (device->GetState(&nativeState) != S_OK) {
-    return AudioDeviceState::DEVICE_NOT_PRESENT;
-  }
-
+AudioDeviceState AudioDeviceStateFromNative(DWORD nativeState) {
   switch (nativeState) {
     case DEVICE_STATE_ACTIVE:
       return AudioDeviceState::CONNECTED;
@@ -124,8 +171,32 @@ AudioDeviceState GetAudioDeviceState(const winrt::com_ptr<IMMDevice>& device) {
   __assume(0);
 }
 
+AudioDeviceState GetAudioDeviceState(const winrt::com_ptr<IMMDevice>& device) {
+  if (!device) {
+    return AudioDeviceState::DEVICE_NOT_PRESENT;
+  }
+
+  DWORD nativeState;
+  if (device->GetState(&nativeState) != S_OK) {
+    return AudioDeviceState::DEVICE_NOT_PRESENT;
+  }
+  return AudioDeviceStateFromNative(nativeState);
+}
+
 }// namespace
 
+void InitializeNativeThread() {
+  winrt::init_apartment(winrt::apartment_type::multi_threaded);
+}
+
+result<void> PrewarmNativeDevice(const std::string& deviceID) {
+  const auto volume = DeviceIDToAudioEndpointVolume(deviceID);
+  if (!volume) {
+    return {unexpect, volume.error()};
+  }
+  return {};
+}
+
 AudioDeviceState GetAudioDeviceState(const std::string& id) {
   auto device = DeviceIDToDevice(id);
   if (!device.has_value()) {
@@ -134,8 +205,7 @@ AudioDeviceState GetAudioDeviceState(const std::string& id) {
   return GetAudioDeviceState(*device);
 }
 
-std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(
-  AudioDeviceDirection direction) {
+std::vector<std::string> GetNativeDeviceIDs(AudioDeviceDirection direction) {
   auto de
     = winrt::create_instance<IMMDeviceEnumerator>(__uuidof(MMDeviceEnumerator));
 
@@ -147,44 +217,65 @@ std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(
 
   UINT deviceCount;
   devices->GetCount(&deviceCount);
-  std::map<std::string, AudioDeviceInfo> out;
+  std::vector<std::string> out;
+  out.reserve(deviceCount);
 
   for (UINT i = 0; i < deviceCount; ++i) {
     winrt::com_ptr<IMMDevice> device;
     devices->Item(i, device.put());
-    LPWSTR nativeID;
+    LPWSTR nativeID {nullptr};
     device->GetId(&nativeID);
-    const auto id = Utf16ToUtf8(nativeID);
-    winrt::com_ptr<IPropertyStore> properties;
-    const auto propStoreResult
-      = device->OpenPropertyStore(STGM_READ, properties.put());
-    if (!properties) {
+    if (!nativeID) {
       continue;
     }
-    PROPVARIANT nativeCombinedName;
-    properties->GetValue(PKEY_Device_FriendlyName, &nativeCombinedName);
-    PROPVARIANT nativeInterfaceName;
-    properties->GetValue(
-      PKEY_DeviceInterface_FriendlyName, &nativeInterfaceName);
-    PROPVARIANT nativeEndpointName;
-    properties->GetValue(PKEY_Device_DeviceDesc, &nativeEndpointName);
+    out.push_back(Utf16ToUtf8(nativeID));
+    CoTaskMemFree(nativeID);
+  }
+  return out;
+}
 
-    if (!nativeCombinedName.pwszVal) {
-      continue;
-    }
+result<AudioDeviceInfo> GetNativeDeviceInfo(
+  AudioDeviceDirection direction,
+  const std::string& deviceID) {
+  const auto device = DeviceIDToDevice(deviceID);
+  if (!device) {
+    return {unexpect, device.error()};
+  }
 
-    out[id] = AudioDeviceInfo {
-      .id = id,
+  winrt::com_ptr<IPropertyStore> properties;
+  (*device)->OpenPropertyStore(STGM_READ, properties.put());
+  if (!properties) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
+  PROPVARIANT nativeCombinedName;
+  properties->GetValue(PKEY_Device_FriendlyName, &nativeCombinedName);
+  PROPVARIANT nativeInterfaceName;
+  properties->GetValue(
+    PKEY_DeviceInterface_FriendlyName, &nativeInterfaceName);
+  PROPVARIANT nativeEndpointName;
+  properties->GetValue(PKEY_Device_DeviceDesc, &nativeEndpointName);
+
+  std::optional<AudioDeviceInfo> info;
+  if (nativeCombinedName.pwszVal) {
+    info = AudioDeviceInfo {
+      .id = deviceID,
       .interfaceName = Utf16ToUtf8(nativeInterfaceName.pwszVal),
       .endpointName = Utf16ToUtf8(nativeEndpointName.pwszVal),
       .displayName = Utf16ToUtf8(nativeCombinedName.pwszVal),
       .direction = direction,
-      .state = GetAudioDeviceState(device)};
+      .state = GetAudioDeviceState(*device)};
   }
-  return out;
+  PropVariantClear(&nativeCombinedName);
+  PropVariantClear(&nativeInterfaceName);
+  PropVariantClear(&nativeEndpointName);
+
+  if (!info) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
+  return std::move(*info);
 }
 
-std::string GetDefaultAudioDeviceID(
+std::string GetNativeDefaultAudioDeviceID(
   AudioDeviceDirection direction,
   AudioDeviceRole role) {
   auto de
@@ -208,21 +299,19 @@ std::string GetDefaultAudioDeviceID(
   return Utf16ToUtf8(deviceID);
 }
 
-void SetDefaultAudioDeviceID(
-  AudioDeviceDirection direction,
+bool SetNativeDefaultAudioDeviceID(
+  AudioDeviceDirection,
   AudioDeviceRole role,
   const std::string& desiredID) {
-  if (desiredID == GetDefaultAudioDeviceID(direction, role)) {
-    return;
-  }
-
   auto policyConfig = winrt::create_instance<IPolicyConfigVista>(
     __uuidof(CPolicyConfigVistaClient));
   const auto utf16 = Utf8ToUtf16(desiredID);
-  policyConfig->SetDefaultEndpoint(utf16.c_str(), AudioDeviceRoleToERole(role));
+  const auto hr = policyConfig->SetDefaultEndpoint(
+    utf16.c_str(), AudioDeviceRoleToERole(role));
+  return hr == S_OK;
 }
 
-result<bool> IsAudioDeviceMuted(const std::string& deviceID) {
+result<bool> IsNativeDeviceMuted(const std::string& deviceID) {
   auto volume = DeviceIDToAudioEndpointVolume(deviceID);
   if (!volume) {
     return {unexpect, volume.error()};
@@ -233,7 +322,7 @@ result<bool> IsAudioDeviceMuted(const std::string& deviceID) {
   return ret;
 }
 
-result<void> MuteAudioDevice(const std::string& deviceID) {
+result<void> MuteNativeDevice(const std::string& deviceID) {
   auto volume = DeviceIDToAudioEndpointVolume(deviceID);
   if (!volume) {
     return {unexpect, volume.error()};
@@ -242,7 +331,7 @@ result<void> MuteAudioDevice(const std::string& deviceID) {
   return {};
 }
 
-result<void> UnmuteAudioDevice(const std::string& deviceID) {
+result<void> UnmuteNativeDevice(const std::string& deviceID) {
   auto volume = DeviceIDToAudioEndpointVolume(deviceID);
   if (!volume) {
     return {unexpect, volume.error()};
@@ -251,7 +340,7 @@ result<void> UnmuteAudioDevice(const std::string& deviceID) {
   return {};
 }
 
-result<VolumeRange> GetDeviceVolumeRange(const std::string& deviceID) {
+result<VolumeRange> GetNativeDeviceVolumeRange(const std::string& deviceID) {
   auto volume = DeviceIDToAudioEndpointVolume(deviceID);
   if (!volume) {
     return {unexpect, volume.error()};
@@ -268,33 +357,41 @@ result<VolumeRange> GetDeviceVolumeRange(const std::string& deviceID) {
   return ret;
 }
 
-result<Volume> GetDeviceVolume(const std::string& deviceID) {
-  auto volume = DeviceIDToAudioEndpointVolume(deviceID);
-  if (!volume) {
-    return {unexpect, volume.error()};
-  }
+namespace {
 
+Volume GetVolume(IAudioEndpointVolume* volume) {
   BOOL muted;
   UINT currentStep;
   UINT stepCount;
   FLOAT volumeDecibels;
   FLOAT volumeScalar;
-  (*volume)->GetMute(&muted);
-  (*volume)->GetVolumeStepInfo(&currentStep, &stepCount);
-  (*volume)->GetMasterVolumeLevel(&volumeDecibels);
-  (*volume)->GetMasterVolumeLevelScalar(&volumeScalar);
+  volume->GetMute(&muted);
+  volume->GetVolumeStepInfo(&currentStep, &stepCount);
+  volume->GetMasterVolumeLevel(&volumeDecibels);
+  volume->GetMasterVolumeLevelScalar(&volumeScalar);
 
-  Volume ret {
+  return {
     .isMuted = static_cast<bool>(muted),
     .volumeScalar = volumeScalar,
     .volumeDecibels = volumeDecibels,
     .volumeStep = currentStep,
   };
+}
 
-  return ret;
+}// namespace
+
+result<Volume> GetNativeDeviceVolume(const std::string& deviceID) {
+  auto volume = DeviceIDToAudioEndpointVolume(deviceID);
+  if (!volume) {
+    return {unexpect, volume.error()};
+  }
+
+  return GetVolume(volume->get());
 }
 
-result<void> SetDeviceVolumeScalar(const std::string& deviceID, float value) {
+result<void> SetNativeDeviceVolumeScalar(
+  const std::string& deviceID,
+  float value) {
   const auto aev = DeviceIDToAudioEndpointVolume(deviceID);
   if (!aev) {
     return {unexpect, aev.error()};
@@ -307,7 +404,9 @@ result<void> SetDeviceVolumeScalar(const std::string& deviceID, float value) {
   return {};
 }
 
-result<void> SetDeviceVolumeDecibels(const std::string& deviceID, float value) {
+result<void> SetNativeDeviceVolumeDecibels(
+  const std::string& deviceID,
+  float value) {
   const auto aev = DeviceIDToAudioEndpointVolume(deviceID);
   if (!aev) {
     return {unexpect, aev.error()};
@@ -320,7 +419,7 @@ result<void> SetDeviceVolumeDecibels(const std::string& deviceID, float value) {
   return {};
 }
 
-result<void> IncreaseDeviceVolume(const std::string& deviceID) {
+result<void> IncreaseNativeDeviceVolume(const std::string& deviceID) {
   const auto aev = DeviceIDToAudioEndpointVolume(deviceID);
   if (!aev) {
     return {unexpect, aev.error()};
@@ -331,7 +430,7 @@ result<void> IncreaseDeviceVolume(const std::string& deviceID) {
   return {};
 }
 
-result<void> DecreaseDeviceVolume(const std::string& deviceID) {
+result<void> DecreaseNativeDeviceVolume(const std::string& deviceID) {
   const auto aev = DeviceIDToAudioEndpointVolume(deviceID);
   if (!aev) {
     return {unexpect, aev.error()};
@@ -343,33 +442,134 @@ result<void> DecreaseDeviceVolume(const std::string& deviceID) {
 }
 
 namespace {
+
+result<void> GetChannelVolumes(
+  IAudioEndpointVolume* aev,
+  std::vector<float>& volumes) {
+  UINT count {};
+  if (aev->GetChannelCount(&count) != S_OK) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  volumes.resize(count);
+  for (UINT i = 0; i < count; ++i) {
+    if (aev->GetChannelVolumeLevelScalar(i, &volumes[i]) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+  }
+  return {};
+}
+
+}// namespace
+
+result<std::vector<float>> GetNativeDeviceChannelVolumes(
+  const std::string& deviceID) {
+  const auto aev = DeviceIDToAudioEndpointVolume(deviceID);
+  if (!aev) {
+    return {unexpect, aev.error()};
+  }
+  std::vector<float> volumes;
+  auto got = GetChannelVolumes(aev->get(), volumes);
+  if (!got) {
+    return {unexpect, got.error()};
+  }
+  return volumes;
+}
+
+result<void> SetNativeDeviceChannelVolumes(
+  const std::string& deviceID,
+  std::span<const float> volumes) {
+  if (std::ranges::any_of(volumes, [](float v) { return v < 0 || v > 1; })) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  const auto aev = DeviceIDToAudioEndpointVolume(deviceID);
+  if (!aev) {
+    return {unexpect, aev.error()};
+  }
+
+  // Every write is a separate native call and notification, so skip
+  // channels that are already at the requested level
+  std::vector<float> current;
+  auto got = GetChannelVolumes(aev->get(), current);
+  if (!got) {
+    return {unexpect, got.error()};
+  }
+  if (current.size() != volumes.size()) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  for (UINT i = 0; i < current.size(); ++i) {
+    if (current[i] == volumes[i]) {
+      continue;
+    }
+    if ((*aev)->SetChannelVolumeLevelScalar(i, volumes[i], nullptr) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+  }
+  return {};
+}
+
+namespace {
+using VolumeNotificationCallback
+  = std::function<void(PAUDIO_VOLUME_NOTIFICATION_DATA)>;
+using VolumeSubscriberList = EpochSubscriberList<VolumeNotificationCallback>;
+
 class VolumeCOMCallback
   : public winrt::implements<VolumeCOMCallback, IAudioEndpointVolumeCallback> {
  public:
-  VolumeCOMCallback(std::function<void(PAUDIO_VOLUME_NOTIFICATION_DATA)> cb)
-    : mCB(cb) {
-  }
-
-  ~VolumeCOMCallback() {
+  VolumeCOMCallback(VolumeSubscriberList* subscribers)
+    : mSubscribers(subscribers) {
   }
 
   virtual HRESULT OnNotify(PAUDIO_VOLUME_NOTIFICATION_DATA pNotify) override {
-    mCB(pNotify);
+    mSubscribers->ForEach(
+      [pNotify](const VolumeNotificationCallback& cb) { cb(pNotify); });
     return S_OK;
   }
 
  private:
-  std::function<void(PAUDIO_VOLUME_NOTIFICATION_DATA)> mCB;
+  VolumeSubscriberList* mSubscribers;
 };
 
+/* One native registration per endpoint, shared by every handle for it.
+ *
+ * These are never unregistered or freed: handles only remove themselves from
+ * `mSubscribers`, so destroying a handle only waits for its own callback to
+ * return, rather than for every notification being delivered to the
+ * endpoint.
+ */
+struct EndpointVolumeNotifier {
+  VolumeSubscriberList mSubscribers;
+  winrt::com_ptr<IAudioEndpointVolumeCallback> mCallback;
+};
+
+result<EndpointVolumeNotifier*> GetEndpointVolumeNotifier(
+  const std::string& deviceID,
+  const winrt::com_ptr<IAudioEndpointVolume>& aev) {
+  static std::mutex mutex;
+  static std::map<std::string, EndpointVolumeNotifier*> cache;
+
+  std::unique_lock lock(mutex);
+  const auto cached = cache.find(deviceID);
+  if (cached != cache.end()) {
+    return cached->second;
+  }
+
+  auto notifier = std::make_unique<EndpointVolumeNotifier>();
+  notifier->mCallback = winrt::make<VolumeCOMCallback>(&notifier->mSubscribers);
+  if (aev->RegisterControlChangeNotify(notifier->mCallback.get()) != S_OK) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  // Intentionally leaked; see above
+  return cache.emplace(deviceID, notifier.release()).first->second;
+}
+
 }// namespace
 
 class MuteCallbackHandle::Impl {
  public:
-  winrt::com_ptr<IAudioEndpointVolumeCallback> impl;
-  winrt::com_ptr<IAudioEndpointVolume> dev;
+  EndpointVolumeNotifier* notifier;
+  VolumeSubscriberList::SubscriptionID id;
   ~Impl() {
-    dev->UnregisterControlChangeNotify(impl.get());
+    notifier->mSubscribers.Remove(id);
   }
 };
 
@@ -380,28 +580,43 @@ MuteCallbackHandle::~MuteCallbackHandle() = default;
 
 result<MuteCallbackHandle> AddAudioDeviceMuteUnmuteCallback(
   const std::string& deviceID,
-  std::function<void(bool isMuted)> cb) {
+  std::function<void(bool isMuted)> cb,
+  CallbackDelivery delivery) {
   auto dev = DeviceIDToAudioEndpointVolume(deviceID);
   if (!dev.has_value()) {
     return {unexpect, dev.error()};
   }
+  auto notifier = GetEndpointVolumeNotifier(deviceID, *dev);
+  if (!notifier) {
+    return {unexpect, notifier.error()};
+  }
 
-  auto impl = winrt::make<VolumeCOMCallback>(
-    [cb](PAUDIO_VOLUME_NOTIFICATION_DATA data) { cb(data->bMuted); });
-  auto ret = (*dev)->RegisterControlChangeNotify(impl.get());
-  if (ret != S_OK) {
-    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  std::optional<Volume> initial;
+  BOOL muted;
+  if ((*dev)->GetMute(&muted) == S_OK) {
+    initial = Volume {.isMuted = static_cast<bool>(muted)};
   }
+  auto filter = std::make_shared<VolumeChangeFilter>(
+    delivery, VolumeChangedFields::MUTE, initial);
+
+  const auto id = (*notifier)->mSubscribers.Add(
+    [cb, filter](PAUDIO_VOLUME_NOTIFICATION_DATA data) {
+      const auto event
+        = filter->Update({.isMuted = static_cast<bool>(data->bMuted)});
+      if (event) {
+        cb(event->volume.isMuted);
+      }
+    });
 
-  return {{std::make_shared<MuteCallbackHandle::Impl>(impl, *dev)}};
+  return {{std::make_shared<MuteCallbackHandle::Impl>(*notifier, id)}};
 }
 
 class VolumeCallbackHandle::Impl {
  public:
-  winrt::com_ptr<IAudioEndpointVolumeCallback> impl;
-  winrt::com_ptr<IAudioEndpointVolume> dev;
+  EndpointVolumeNotifier* notifier;
+  VolumeSubscriberList::SubscriptionID id;
   ~Impl() {
-    dev->UnregisterControlChangeNotify(impl.get());
+    notifier->mSubscribers.Remove(id);
   }
 };
 
@@ -411,37 +626,65 @@ VolumeCallbackHandle::VolumeCallbackHandle(const std::shared_ptr<Impl>& p)
 
 VolumeCallbackHandle::~VolumeCallbackHandle() = default;
 
-result<VolumeCallbackHandle> AddAudioDeviceVolumeCallback(
+result<VolumeCallbackHandle> AddAudioDeviceVolumeChangeCallback(
   const std::string& deviceID,
-  std::function<void(const Volume&)> cb) {
+  std::function<void(const VolumeChangeEvent&)> cb,
+  CallbackDelivery delivery) {
   auto dev = DeviceIDToAudioEndpointVolume(deviceID);
   if (!dev.has_value()) {
     return {unexpect, dev.error()};
   }
+  auto notifier = GetEndpointVolumeNotifier(deviceID, *dev);
+  if (!notifier) {
+    return {unexpect, notifier.error()};
+  }
 
-  auto impl = winrt::make<VolumeCOMCallback>(
-    [cb, deviceID](PAUDIO_VOLUME_NOTIFICATION_DATA data) {
-      auto volume = GetDeviceVolume(deviceID).value();
+  auto filter = std::make_shared<VolumeChangeFilter>(
+    delivery,
+    VolumeChangedFields::MUTE | VolumeChangedFields::SCALAR
+      | VolumeChangedFields::DECIBELS | VolumeChangedFields::STEP
+      | VolumeChangedFields::CHANNELS,
+    GetVolume(dev->get()));
+
+  // Query the endpoint directly rather than by ID, so that notifications
+  // don't need to allocate or look up the device
+  const auto id = (*notifier)->mSubscribers.Add(
+    [cb, filter, aev = *dev](PAUDIO_VOLUME_NOTIFICATION_DATA data) {
+      // The notification doesn't include the decibels or step
+      auto volume = GetVolume(aev.get());
       volume.isMuted = data->bMuted;
       volume.volumeScalar = data->fMasterVolume;
-      cb(volume);
+
+      const auto event = filter->Update(
+        volume, {data->afChannelVolumes, data->nChannels});
+      if (event) {
+        cb(*event);
+      }
     });
-  auto ret = (*dev)->RegisterControlChangeNotify(impl.get());
-  if (ret != S_OK) {
-    return {unexpect, Error::OPERATION_UNSUPPORTED};
-  }
 
-  return {{std::make_shared<VolumeCallbackHandle::Impl>(impl, *dev)}};
+  return {{std::make_shared<VolumeCallbackHandle::Impl>(*notifier, id)}};
+}
+
+result<VolumeCallbackHandle> AddAudioDeviceVolumeCallback(
+  const std::string& deviceID,
+  std::function<void(const Volume&)> cb,
+  CallbackDelivery delivery) {
+  return AddAudioDeviceVolumeChangeCallback(
+    deviceID,
+    [cb](const VolumeChangeEvent& event) { cb(event.volume); },
+    delivery);
 }
 
 namespace {
-typedef std::function<
-  void(AudioDeviceDirection, AudioDeviceRole, const std::string&)>
-  DefaultChangeCallbackFun;
-class DefaultChangeCOMCallback
-  : public winrt::implements<DefaultChangeCOMCallback, IMMNotificationClient> {
+
+class AudioDeviceEventCOMCallback
+  : public winrt::
+      implements<AudioDeviceEventCOMCallback, IMMNotificationClient> {
  public:
-  DefaultChangeCOMCallback(DefaultChangeCallbackFun cb) : mCB(cb) {
+  AudioDeviceEventCOMCallback(
+    AudioDeviceEventHub* hub,
+    const winrt::com_ptr<IMMDeviceEnumerator>& enumerator)
+    : mHub(hub), mEnumerator(enumerator) {
   }
 
   virtual HRESULT OnDefaultDeviceChanged(
@@ -462,139 +705,997 @@ class DefaultChangeCOMCallback
     const AudioDeviceDirection direction = (flow == EDataFlow::eCapture)
       ? AudioDeviceDirection::INPUT
       : AudioDeviceDirection::OUTPUT;
-    mCB(direction, role, Utf16ToUtf8(defaultDeviceID));
+    // `defaultDeviceID` is null if there is no longer a default device
+    auto slot = mHub->GetEventPool().Acquire();
+    mHub->Dispatch({
+      .kind = AudioDeviceEventKind::DEFAULT_CHANGED,
+      .direction = direction,
+      .role = role,
+      .deviceID = Utf16ToUtf8(defaultDeviceID, slot.GetDeviceIDBuffer()),
+    });
 
     return S_OK;
   };
 
   virtual HRESULT OnDeviceAdded(LPCWSTR pwstrDeviceId) override {
+    DispatchDeviceEvent(AudioDeviceEventKind::ADDED, pwstrDeviceId);
     return S_OK;
   };
 
   virtual HRESULT OnDeviceRemoved(LPCWSTR pwstrDeviceId) override {
+    DispatchDeviceEvent(AudioDeviceEventKind::REMOVED, pwstrDeviceId);
     return S_OK;
   };
 
   virtual HRESULT OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState)
     override {
+    // Still reported as plug events, which subscribers relied on before
+    // `STATE_CHANGED` existed
+    DispatchDeviceEvent(
+      (dwNewState == DEVICE_STATE_ACTIVE) ? AudioDeviceEventKind::ADDED
+                                          : AudioDeviceEventKind::REMOVED,
+      pwstrDeviceId);
+    DispatchDeviceEvent(
+      AudioDeviceEventKind::STATE_CHANGED,
+      pwstrDeviceId,
+      AudioDeviceStateFromNative(dwNewState));
     return S_OK;
   };
 
   virtual HRESULT OnPropertyValueChanged(
     LPCWSTR pwstrDeviceId,
     const PROPERTYKEY key) override {
+    // Windows reports many other properties, often; these are the ones that
+    // `AudioDeviceInfo` and `AudioDeviceStreamProperties` are built from
+    for (const auto& property: {
+           PKEY_Device_FriendlyName,
+           PKEY_DeviceInterface_FriendlyName,
+           PKEY_Device_DeviceDesc,
+           PKEY_AudioEngine_DeviceFormat,
+         }) {
+      if (key.fmtid == property.fmtid && key.pid == property.pid) {
+        DispatchDeviceEvent(
+          AudioDeviceEventKind::PROPERTY_CHANGED, pwstrDeviceId);
+        break;
+      }
+    }
     return S_OK;
   };
 
  private:
-  DefaultChangeCallbackFun mCB;
+  AudioDeviceEventHub* mHub;
+  winrt::com_ptr<IMMDeviceEnumerator> mEnumerator;
+
+  void DispatchDeviceEvent(
+    AudioDeviceEventKind kind,
+    LPCWSTR nativeID,
+    std::optional<AudioDeviceState> state = std::nullopt) {
+    if (!nativeID) {
+      return;
+    }
+    auto slot = mHub->GetEventPool().Acquire();
+    mHub->Dispatch({
+      .kind = kind,
+      .direction = GetDirection(nativeID),
+      .deviceID = Utf16ToUtf8(nativeID, slot.GetDeviceIDBuffer()),
+      .state = state,
+    });
+  }
+
+  // Resolved once per event, rather than by each subscriber
+  AudioDeviceDirection GetDirection(LPCWSTR nativeID) {
+    winrt::com_ptr<IMMDevice> device;
+    mEnumerator->GetDevice(nativeID, device.put());
+    const auto endpoint
+      = device ? device.try_as<IMMEndpoint>() : winrt::com_ptr<IMMEndpoint> {};
+    EDataFlow flow;
+    if (endpoint && endpoint->GetDataFlow(&flow) == S_OK) {
+      return (flow == eCapture) ? AudioDeviceDirection::INPUT
+                                : AudioDeviceDirection::OUTPUT;
+    }
+
+    // Removed devices may no longer be available; fall back to the ID
+    // format, which is `{0.0.0.00000000}.{GUID}` for render devices, and
+    // `{0.0.1.00000000}.{GUID}` for capture devices
+    return std::wstring_view(nativeID).starts_with(L"{0.0.1.")
+      ? AudioDeviceDirection::INPUT
+      : AudioDeviceDirection::OUTPUT;
+  }
 };
 
 }// namespace
 
-struct DefaultChangeCallbackHandle::Impl {
-  winrt::com_ptr<IMMNotificationClient> impl;
-  winrt::com_ptr<IMMDeviceEnumerator> enumerator;
-  ~Impl() {
-    enumerator->UnregisterEndpointNotificationCallback(impl.get());
+AudioDeviceEventHub* GetAudioDeviceEventHub() {
+  struct Notifier {
+    AudioDeviceEventHub mHub;
+    winrt::com_ptr<IMMDeviceEnumerator> mEnumerator;
+    winrt::com_ptr<IMMNotificationClient> mCallback;
+  };
+
+  static Notifier* sNotifier = []() -> Notifier* {
+    auto de = winrt::create_instance<IMMDeviceEnumerator>(
+      __uuidof(MMDeviceEnumerator));
+    if (!de) {
+      return nullptr;
+    }
+    // Intentionally leaked: notifications are delivered on other threads,
+    // and may arrive during static destruction
+    auto notifier = new Notifier {.mEnumerator = de};
+    notifier->mCallback
+      = winrt::make<AudioDeviceEventCOMCallback>(&notifier->mHub, de);
+    if (
+      de->RegisterEndpointNotificationCallback(notifier->mCallback.get())
+      != S_OK) {
+      delete notifier;
+      return nullptr;
+    }
+    return notifier;
+  }();
+
+  if (!sNotifier) {
+    return nullptr;
   }
-};
+  return &sNotifier->mHub;
+}
 
-DefaultChangeCallbackHandle::DefaultChangeCallbackHandle(
-  const std::shared_ptr<Impl>& p)
-  : p(p) {
+namespace {
+
+std::optional<AudioSampleFormat> GetSampleFormat(
+  const WAVEFORMATEX* format) {
+  switch (format->wFormatTag) {
+    case WAVE_FORMAT_IEEE_FLOAT:
+      if (format->wBitsPerSample == 32) {
+        return AudioSampleFormat::FLOAT32;
+      }
+      break;
+    case WAVE_FORMAT_PCM:
+      if (format->wBitsPerSample == 16) {
+        return AudioSampleFormat::INT16;
+      }
+      break;
+    case WAVE_FORMAT_EXTENSIBLE: {
+      const auto extensible
+        = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(format);
+      if (
+        extensible->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
+        && format->wBitsPerSample == 32) {
+        return AudioSampleFormat::FLOAT32;
+      }
+      if (
+        extensible->SubFormat == KSDATAFORMAT_SUBTYPE_PCM
+        && format->wBitsPerSample == 16) {
+        return AudioSampleFormat::INT16;
+      }
+      break;
+    }
+  }
+  return std::nullopt;
 }
 
-DefaultChangeCallbackHandle::~DefaultChangeCallbackHandle() = default;
+result<AudioDeviceDirection> GetDeviceDirection(
+  const winrt::com_ptr<IMMDevice>& device) {
+  const auto endpoint = device.try_as<IMMEndpoint>();
+  EDataFlow flow;
+  if (!(endpoint && endpoint->GetDataFlow(&flow) == S_OK)) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
+  return (flow == eCapture) ? AudioDeviceDirection::INPUT
+                            : AudioDeviceDirection::OUTPUT;
+}
 
-DefaultChangeCallbackHandle AddDefaultAudioDeviceChangeCallback(
-  DefaultChangeCallbackFun cb) {
-  auto de
-    = winrt::create_instance<IMMDeviceEnumerator>(__uuidof(MMDeviceEnumerator));
-  if (!de) {
+/* Event-driven shared-mode capture; for render endpoints, this is a loopback
+ * capture of what's being played.
+ *
+ * Packets are delivered directly from WASAPI's buffer on a dedicated MMCSS
+ * thread, without copying.
+ */
+class WASAPICaptureStream final : public NativeCaptureStream {
+ public:
+  // In 100ns units
+  static constexpr REFERENCE_TIME BufferDuration = 20 * 10000;
+
+  explicit WASAPICaptureStream(Callback callback)
+    : mCallback(std::move(callback)) {
+  }
+
+  ~WASAPICaptureStream() {
+    if (mThread.joinable()) {
+      SetEvent(mStopEvent.get());
+      mThread.join();
+    }
+    if (mClient) {
+      mClient->Stop();
+    }
+  }
+
+  result<void> Start(const winrt::com_ptr<IMMDevice>& device) {
+    const auto direction = GetDeviceDirection(device);
+    if (!direction.has_value()) {
+      return {unexpect, direction.error()};
+    }
+
+    device->Activate(
+      __uuidof(IAudioClient), CLSCTX_ALL, nullptr, mClient.put_void());
+    if (!mClient) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+
+    WAVEFORMATEX* mixFormat {nullptr};
+    if (mClient->GetMixFormat(&mixFormat) != S_OK) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+    const auto format = GetSampleFormat(mixFormat);
+    mBuffer.mChannels = mixFormat->nChannels;
+    mBuffer.mSampleRate = mixFormat->nSamplesPerSec;
+    DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+    if (direction.value() == AudioDeviceDirection::OUTPUT) {
+      flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
+    }
+    const auto initialized = format
+      && mClient->Initialize(
+           AUDCLNT_SHAREMODE_SHARED,
+           flags,
+           BufferDuration,
+           0,
+           mixFormat,
+           nullptr)
+        == S_OK;
+    CoTaskMemFree(mixFormat);
+    if (!initialized) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+    mBuffer.mFormat = *format;
+
+    mSampleEvent.attach(CreateEventW(nullptr, FALSE, FALSE, nullptr));
+    mStopEvent.attach(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+    if (mClient->SetEventHandle(mSampleEvent.get()) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+    mClient->GetService(__uuidof(IAudioCaptureClient), mCapture.put_void());
+    if (!mCapture) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+    if (mClient->Start() != S_OK) {
+      return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+    }
+
+    mThread = std::thread([this]() { Run(); });
     return {};
   }
-  auto impl = winrt::make<DefaultChangeCOMCallback>(cb);
-  if (de->RegisterEndpointNotificationCallback(impl.get()) != S_OK) {
+
+  AudioStreamFormat GetFormat() const override {
+    return {
+      .sampleFormat = mBuffer.mFormat,
+      .sampleRate = mBuffer.mSampleRate,
+      .channels = mBuffer.mChannels,
+    };
+  }
+
+ private:
+  Callback mCallback;
+  AudioBufferView mBuffer {};
+
+  winrt::com_ptr<IAudioClient> mClient;
+  winrt::com_ptr<IAudioCaptureClient> mCapture;
+  winrt::handle mSampleEvent;
+  winrt::handle mStopEvent;
+  std::thread mThread;
+
+  void Run() {
+    winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    DWORD taskIndex = 0;
+    const auto mmcss = AvSetMmThreadCharacteristicsW(L"Audio", &taskIndex);
+
+    const HANDLE events[] {mStopEvent.get(), mSampleEvent.get()};
+    while (WaitForMultipleObjects(
+             static_cast<DWORD>(std::size(events)), events, FALSE, INFINITE)
+           == WAIT_OBJECT_0 + 1) {
+      UINT32 packetFrames = 0;
+      while (mCapture->GetNextPacketSize(&packetFrames) == S_OK
+             && packetFrames > 0) {
+        BYTE* data {nullptr};
+        UINT32 frames {};
+        DWORD flags {};
+        if (
+          mCapture->GetBuffer(&data, &frames, &flags, nullptr, nullptr)
+          != S_OK) {
+          break;
+        }
+        auto buffer = mBuffer;
+        buffer.mData = data;
+        buffer.mFrames = frames;
+        buffer.mIsSilent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
+        mCallback(buffer);
+        mCapture->ReleaseBuffer(frames);
+      }
+    }
+
+    if (mmcss) {
+      AvRevertMmThreadCharacteristics(mmcss);
+    }
+    winrt::uninit_apartment();
+  }
+};
+
+/* Event-driven shared-mode playback.
+ *
+ * The client is initialized when the stream is opened, and the render thread
+ * lives as long as the stream; `Start()` only pre-fills the buffer and starts
+ * the client.
+ */
+class WASAPIRenderStream final : public NativeRenderStream {
+ public:
+  // In 100ns units
+  static constexpr REFERENCE_TIME BufferDuration = 20 * 10000;
+
+  explicit WASAPIRenderStream(Callback callback)
+    : mCallback(std::move(callback)) {
+  }
+
+  ~WASAPIRenderStream() {
+    if (mThread.joinable()) {
+      SetEvent(mStopEvent.get());
+      mThread.join();
+    }
+    if (mClient) {
+      mClient->Stop();
+    }
+  }
+
+  result<void> Open(const winrt::com_ptr<IMMDevice>& device) {
+    device->Activate(
+      __uuidof(IAudioClient), CLSCTX_ALL, nullptr, mClient.put_void());
+    if (!mClient) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+
+    WAVEFORMATEX* mixFormat {nullptr};
+    if (mClient->GetMixFormat(&mixFormat) != S_OK) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+    const auto format = GetSampleFormat(mixFormat);
+    mFormat.sampleRate = mixFormat->nSamplesPerSec;
+    mFormat.channels = mixFormat->nChannels;
+    const auto initialized = format
+      && mClient->Initialize(
+           AUDCLNT_SHAREMODE_SHARED,
+           AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+           BufferDuration,
+           0,
+           mixFormat,
+           nullptr)
+        == S_OK;
+    CoTaskMemFree(mixFormat);
+    if (!initialized) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+    mFormat.sampleFormat = *format;
+
+    if (mClient->GetBufferSize(&mBufferFrames) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+    mSampleEvent.attach(CreateEventW(nullptr, FALSE, FALSE, nullptr));
+    mStopEvent.attach(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+    if (mClient->SetEventHandle(mSampleEvent.get()) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+    mClient->GetService(__uuidof(IAudioRenderClient), mRender.put_void());
+    if (!mRender) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+
+    mThread = std::thread([this]() { Run(); });
+    return {};
+  }
+
+  AudioStreamFormat GetFormat() const override {
+    return mFormat;
+  }
+
+  result<void> Start() override {
+    std::unique_lock lock(mMutex);
+    // Pre-fill, so the first period isn't silent
+    Fill();
+    if (mClient->Start() != S_OK) {
+      return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+    }
     return {};
   }
 
-  return std::make_shared<DefaultChangeCallbackHandle::Impl>(impl, de);
+  void Stop() override {
+    std::unique_lock lock(mMutex);
+    mClient->Stop();
+    mClient->Reset();
+  }
+
+ private:
+  Callback mCallback;
+  AudioStreamFormat mFormat {};
+  UINT32 mBufferFrames {};
+
+  winrt::com_ptr<IAudioClient> mClient;
+  winrt::com_ptr<IAudioRenderClient> mRender;
+  winrt::handle mSampleEvent;
+  winrt::handle mStopEvent;
+  std::thread mThread;
+
+  // Only contended while starting or stopping
+  std::mutex mMutex;
+
+  void Fill() {
+    UINT32 padding {};
+    if (mClient->GetCurrentPadding(&padding) != S_OK) {
+      return;
+    }
+    const auto frames = mBufferFrames - padding;
+    BYTE* data {nullptr};
+    if (frames == 0 || mRender->GetBuffer(frames, &data) != S_OK) {
+      return;
+    }
+    mCallback({
+      .mData = data,
+      .mFrames = frames,
+      .mChannels = mFormat.channels,
+      .mSampleRate = mFormat.sampleRate,
+      .mFormat = mFormat.sampleFormat,
+    });
+    mRender->ReleaseBuffer(frames, 0);
+  }
+
+  void Run() {
+    winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    DWORD taskIndex = 0;
+    const auto mmcss = AvSetMmThreadCharacteristicsW(L"Audio", &taskIndex);
+
+    const HANDLE events[] {mStopEvent.get(), mSampleEvent.get()};
+    while (WaitForMultipleObjects(
+             static_cast<DWORD>(std::size(events)), events, FALSE, INFINITE)
+           == WAIT_OBJECT_0 + 1) {
+      std::unique_lock lock(mMutex);
+      Fill();
+    }
+
+    if (mmcss) {
+      AvRevertMmThreadCharacteristics(mmcss);
+    }
+    winrt::uninit_apartment();
+  }
+};
+
+}// namespace
+
+result<bool> IsNativeMuteAfterCapture(const std::string& deviceID) {
+  const auto device = DeviceIDToDevice(deviceID);
+  if (!device) {
+    return {unexpect, device.error()};
+  }
+  // The audio engine applies endpoint mute before audio reaches shared-mode
+  // clients, and hardware mute is further upstream
+  return false;
 }
 
-namespace {
-typedef std::function<void(AudioDevicePlugEvent, const std::string&)>
-  AudioDevicePlugEventCallback;
-class AudioDevicePlugEventCOMCallback
-  : public winrt::
-      implements<AudioDevicePlugEventCOMCallback, IMMNotificationClient> {
- public:
-  AudioDevicePlugEventCOMCallback(AudioDevicePlugEventCallback cb) : mCB(cb) {
+result<std::unique_ptr<NativeCaptureStream>> OpenNativeCaptureStream(
+  const std::string& deviceID,
+  NativeCaptureStream::Callback callback) {
+  const auto device = DeviceIDToDevice(deviceID);
+  if (!device) {
+    return {unexpect, device.error()};
   }
 
-  virtual HRESULT OnDefaultDeviceChanged(
-    EDataFlow flow,
-    ERole winAudioDeviceRole,
-    LPCWSTR defaultDeviceID) override {
-    return S_OK;
+  auto stream = std::make_unique<WASAPICaptureStream>(std::move(callback));
+  auto started = stream->Start(*device);
+  if (!started) {
+    return {unexpect, started.error()};
+  }
+  return std::unique_ptr<NativeCaptureStream>(std::move(stream));
+}
+
+result<std::unique_ptr<NativeRenderStream>> OpenNativeRenderStream(
+  const std::string& deviceID,
+  NativeRenderStream::Callback callback) {
+  const auto device = DeviceIDToDevice(deviceID);
+  if (!device) {
+    return {unexpect, device.error()};
+  }
+  const auto direction = GetDeviceDirection(*device);
+  if (!direction.has_value()) {
+    return {unexpect, direction.error()};
+  }
+  if (direction.value() != AudioDeviceDirection::OUTPUT) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+
+  auto stream = std::make_unique<WASAPIRenderStream>(std::move(callback));
+  auto opened = stream->Open(*device);
+  if (!opened) {
+    return {unexpect, opened.error()};
+  }
+  return std::unique_ptr<NativeRenderStream>(std::move(stream));
+}
+
+result<AudioDeviceStreamProperties> QueryNativeStreamProperties(
+  const std::string& deviceID) {
+  const auto device = DeviceIDToDevice(deviceID);
+  if (!device) {
+    return {unexpect, device.error()};
+  }
+
+  // Activating and initializing a client is the only way to get the buffer
+  // size and latency; it isn't started, so this doesn't affect other streams
+  winrt::com_ptr<IAudioClient> client;
+  (*device)->Activate(
+    __uuidof(IAudioClient), CLSCTX_ALL, nullptr, client.put_void());
+  if (!client) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  WAVEFORMATEX* mixFormat {nullptr};
+  if (client->GetMixFormat(&mixFormat) != S_OK) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  const auto sampleFormat = GetSampleFormat(mixFormat);
+  const AudioStreamFormat format {
+    .sampleFormat = sampleFormat.value_or(AudioSampleFormat::FLOAT32),
+    .sampleRate = mixFormat->nSamplesPerSec,
+    .channels = mixFormat->nChannels,
   };
+  const auto initialized = sampleFormat
+    && client->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, 0, 0, mixFormat, nullptr)
+      == S_OK;
+  CoTaskMemFree(mixFormat);
+  if (!initialized) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
 
-  virtual HRESULT OnDeviceAdded(LPCWSTR pwstrDeviceId) override {
-    mCB(AudioDevicePlugEvent::ADDED, Utf16ToUtf8(pwstrDeviceId));
-    return S_OK;
+  // All in 100ns units
+  REFERENCE_TIME period {};
+  REFERENCE_TIME latency {};
+  UINT32 bufferFrames {};
+  if (
+    client->GetDevicePeriod(&period, nullptr) != S_OK
+    || client->GetStreamLatency(&latency) != S_OK
+    || client->GetBufferSize(&bufferFrames) != S_OK) {
+    return {unexpect, Error::UNKNOWN};
+  }
+
+  return AudioDeviceStreamProperties {
+    .format = format,
+    .period = std::chrono::microseconds(period / 10),
+    .bufferFrames = bufferFrames,
+    .latency = std::chrono::microseconds(latency / 10),
   };
+}
 
-  virtual HRESULT OnDeviceRemoved(LPCWSTR pwstrDeviceId) override {
-    mCB(AudioDevicePlugEvent::REMOVED, Utf16ToUtf8(pwstrDeviceId));
+namespace {
+
+// Invokes the callback for the hub's `kinds` events for the device, without
+// any lock held
+result<NativeWatchHandle> WatchDeviceEvents(
+  const std::string& deviceID,
+  std::vector<AudioDeviceEventKind> kinds,
+  std::function<void()> callback) {
+  const auto hub = GetAudioDeviceEventHub();
+  if (!hub) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  const auto device = DeviceIDToDevice(deviceID);
+  if (!device) {
+    return {unexpect, device.error()};
+  }
+  const auto id = hub->Subscribe(
+    AudioDeviceEventFilter {
+      .kinds = std::move(kinds),
+      .deviceIDs = {deviceID},
+    },
+    AudioDeviceEventHub::ViewCallback(
+      [callback = std::move(callback)](const AudioDeviceEventView&) {
+        callback();
+      }));
+  return NativeWatchHandle([hub, id]() { hub->Unsubscribe(id); });
+}
+
+}// namespace
+
+/* Stream properties change when the shared-mode format is changed, or when
+ * the device is disabled or re-enabled.
+ */
+result<NativeWatchHandle> WatchNativeStreamProperties(
+  const std::string& deviceID,
+  std::function<void()> callback) {
+  return WatchDeviceEvents(
+    deviceID,
+    {AudioDeviceEventKind::STATE_CHANGED,
+     AudioDeviceEventKind::PROPERTY_CHANGED},
+    std::move(callback));
+}
+
+/* `AudioDeviceInfo` changes when the device's state changes, or when it or
+ * its interface is renamed.
+ */
+result<NativeWatchHandle> WatchNativeDeviceInfo(
+  const std::string& deviceID,
+  std::function<void()> callback) {
+  return WatchDeviceEvents(
+    deviceID,
+    {AudioDeviceEventKind::STATE_CHANGED,
+     AudioDeviceEventKind::PROPERTY_CHANGED},
+    std::move(callback));
+}
+
+namespace {
+
+class AudioSessionTracker;
+
+class AudioSessionEventsCOMCallback
+  : public winrt::
+      implements<AudioSessionEventsCOMCallback, IAudioSessionEvents> {
+ public:
+  AudioSessionEventsCOMCallback(
+    AudioSessionTracker* tracker,
+    const std::string& sessionID)
+    : mTracker(tracker), mSessionID(sessionID) {
+  }
+
+  virtual HRESULT OnDisplayNameChanged(LPCWSTR, LPCGUID) override;
+  virtual HRESULT OnSimpleVolumeChanged(float, BOOL, LPCGUID) override;
+  virtual HRESULT OnStateChanged(::AudioSessionState) override;
+  virtual HRESULT OnSessionDisconnected(AudioSessionDisconnectReason) override;
+
+  virtual HRESULT OnIconPathChanged(LPCWSTR, LPCGUID) override {
     return S_OK;
-  };
+  }
 
-  virtual HRESULT OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState)
+  virtual HRESULT OnChannelVolumeChanged(DWORD, float[], DWORD, LPCGUID)
     override {
-    if (dwNewState == DEVICE_STATE_ACTIVE) {
-      mCB(AudioDevicePlugEvent::ADDED, Utf16ToUtf8(pwstrDeviceId));
-    } else {
-      mCB(AudioDevicePlugEvent::REMOVED, Utf16ToUtf8(pwstrDeviceId));
-    }
     return S_OK;
-  };
+  }
 
-  virtual HRESULT OnPropertyValueChanged(
-    LPCWSTR pwstrDeviceId,
-    const PROPERTYKEY key) override {
+  virtual HRESULT OnGroupingParamChanged(LPCGUID, LPCGUID) override {
     return S_OK;
-  };
+  }
 
  private:
-  AudioDevicePlugEventCallback mCB;
+  AudioSessionTracker* mTracker;
+  const std::string mSessionID;
 };
-}// namespace
 
-class AudioDevicePlugEventCallbackHandle::Impl {
+class AudioSessionNotificationCOMCallback
+  : public winrt::implements<
+      AudioSessionNotificationCOMCallback,
+      IAudioSessionNotification> {
  public:
-  winrt::com_ptr<IMMDeviceEnumerator> de;
-  winrt::com_ptr<IMMNotificationClient> callback;
+  AudioSessionNotificationCOMCallback(AudioSessionTracker* tracker)
+    : mTracker(tracker) {
+  }
 
-  ~Impl() {
-    de->UnregisterEndpointNotificationCallback(callback.get());
+  virtual HRESULT OnSessionCreated(IAudioSessionControl*) override;
+
+ private:
+  AudioSessionTracker* mTracker;
+};
+
+std::string GetProcessName(DWORD processID) {
+  winrt::handle process {
+    OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID)};
+  if (!process) {
+    return {};
+  }
+  wchar_t buffer[MAX_PATH];
+  DWORD size = MAX_PATH;
+  if (!QueryFullProcessImageNameW(process.get(), 0, buffer, &size)) {
+    return {};
+  }
+  std::wstring_view name(buffer, size);
+  name = name.substr(name.find_last_of(L"\\/") + 1);
+  name = name.substr(0, name.rfind(L'.'));
+  return Utf16ToUtf8(std::wstring(name));
+}
+
+std::string GetSessionDisplayName(
+  IAudioSessionControl2* control,
+  DWORD processID) {
+  if (control->IsSystemSoundsSession() == S_OK) {
+    return "System Sounds";
+  }
+  LPWSTR nativeName {nullptr};
+  std::string name;
+  if (control->GetDisplayName(&nativeName) == S_OK && nativeName) {
+    // Names starting with '@' are indirect resource references
+    if (nativeName[0] != L'\0' && nativeName[0] != L'@') {
+      name = Utf16ToUtf8(nativeName);
+    }
+    CoTaskMemFree(nativeName);
+  }
+  if (name.empty() && processID) {
+    name = GetProcessName(processID);
+  }
+  return name;
+}
+
+/* Tracks the sessions on one endpoint in an `AudioSessionTable`.
+ *
+ * Sessions are enumerated once, then kept up to date from session-created
+ * and per-session notifications. These are never freed, as notifications
+ * may be delivered on other threads at any time.
+ *
+ * Unregistering a session's notifications from inside one of its own
+ * callbacks deadlocks, so expired sessions are retired, and unregistered
+ * later from another thread.
+ */
+class AudioSessionTracker final {
+ public:
+  AudioSessionTable mTable;
+
+  static result<AudioSessionTracker*> Get(const std::string& deviceID) {
+    static std::mutex mutex;
+    static std::map<std::string, AudioSessionTracker*> cache;
+
+    std::unique_lock lock(mutex);
+    const auto cached = cache.find(deviceID);
+    if (cached != cache.end()) {
+      cached->second->ReleaseRetired();
+      return cached->second;
+    }
+
+    const auto device = DeviceIDToDevice(deviceID);
+    if (!device) {
+      return {unexpect, device.error()};
+    }
+    auto tracker = std::make_unique<AudioSessionTracker>();
+    auto started = tracker->Start(*device);
+    if (!started) {
+      return {unexpect, started.error()};
+    }
+    // Intentionally leaked; see above
+    return cache.emplace(deviceID, tracker.release()).first->second;
+  }
+
+  void Add(IAudioSessionControl* session) {
+    ReleaseRetired();
+
+    winrt::com_ptr<IAudioSessionControl> base;
+    base.copy_from(session);
+    const auto control = base.try_as<IAudioSessionControl2>();
+    const auto volume = base.try_as<ISimpleAudioVolume>();
+    if (!(control && volume)) {
+      return;
+    }
+
+    LPWSTR nativeID {nullptr};
+    if (control->GetSessionInstanceIdentifier(&nativeID) != S_OK) {
+      return;
+    }
+    const auto id = Utf16ToUtf8(nativeID);
+    CoTaskMemFree(nativeID);
+
+    DWORD processID {};
+    // Fails with `AUDCLNT_S_NO_SINGLE_PROCESS` for multi-process sessions
+    if (control->GetProcessId(&processID) != S_OK) {
+      processID = 0;
+    }
+
+    // Register first, so that changes while we read the initial state
+    // aren't missed
+    auto events = winrt::make<AudioSessionEventsCOMCallback>(this, id);
+    {
+      std::unique_lock lock(mMutex);
+      // Sessions created during the initial enumeration are reported twice
+      if (mSessions.contains(id)) {
+        return;
+      }
+      if (control->RegisterAudioSessionNotification(events.get()) != S_OK) {
+        return;
+      }
+      mSessions.emplace(id, Session {control, volume, events, processID});
+    }
+
+    ::AudioSessionState state {};
+    control->GetState(&state);
+    if (state == AudioSessionStateExpired) {
+      Retire(id);
+      return;
+    }
+
+    float scalar {};
+    BOOL muted {};
+    volume->GetMasterVolume(&scalar);
+    volume->GetMute(&muted);
+
+    mTable.Set({
+      .id = id,
+      .processID = processID,
+      .displayName = GetSessionDisplayName(control.get(), processID),
+      .volumeScalar = scalar,
+      .isMuted = static_cast<bool>(muted),
+      .isActive = (state == AudioSessionStateActive),
+    });
+  }
+
+  void Retire(const std::string& sessionID) {
+    {
+      std::unique_lock lock(mMutex);
+      auto node = mSessions.extract(sessionID);
+      if (node) {
+        mRetired.push_back(std::move(node.mapped()));
+      }
+    }
+    mTable.Remove(sessionID);
+  }
+
+  void OnDisplayNameChanged(const std::string& sessionID) {
+    const auto session = GetSession(sessionID);
+    if (!session.mControl) {
+      return;
+    }
+    const auto name
+      = GetSessionDisplayName(session.mControl.get(), session.mProcessID);
+    mTable.Update(sessionID, [&name](auto& info) { info.displayName = name; });
+  }
+
+  result<void> SetVolume(const std::string& sessionID, float scalar) {
+    if (scalar < 0 || scalar > 1) {
+      return {unexpect, Error::OUT_OF_RANGE};
+    }
+    const auto volume = GetSession(sessionID).mVolume;
+    if (!volume) {
+      return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+    }
+    if (volume->SetMasterVolume(scalar, nullptr) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+    return {};
+  }
+
+  result<void> SetMute(const std::string& sessionID, bool isMuted) {
+    const auto volume = GetSession(sessionID).mVolume;
+    if (!volume) {
+      return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+    }
+    if (volume->SetMute(isMuted, nullptr) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+    return {};
+  }
+
+ private:
+  struct Session {
+    winrt::com_ptr<IAudioSessionControl2> mControl;
+    winrt::com_ptr<ISimpleAudioVolume> mVolume;
+    winrt::com_ptr<IAudioSessionEvents> mEvents;
+    DWORD mProcessID {};
+  };
+
+  winrt::com_ptr<IAudioSessionManager2> mManager;
+  winrt::com_ptr<IAudioSessionNotification> mNotification;
+
+  std::mutex mMutex;
+  std::map<std::string, Session> mSessions;
+  std::vector<Session> mRetired;
+
+  result<void> Start(const winrt::com_ptr<IMMDevice>& device) {
+    device->Activate(
+      __uuidof(IAudioSessionManager2),
+      CLSCTX_ALL,
+      nullptr,
+      mManager.put_void());
+    if (!mManager) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+    mNotification = winrt::make<AudioSessionNotificationCOMCallback>(this);
+    if (mManager->RegisterSessionNotification(mNotification.get()) != S_OK) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+
+    // Must be enumerated after registering: session-created notifications
+    // aren't delivered until the enumerator has been retrieved
+    winrt::com_ptr<IAudioSessionEnumerator> sessions;
+    if (mManager->GetSessionEnumerator(sessions.put()) != S_OK) {
+      return {unexpect, Error::UNKNOWN};
+    }
+    int count {};
+    sessions->GetCount(&count);
+    for (int i = 0; i < count; ++i) {
+      winrt::com_ptr<IAudioSessionControl> session;
+      if (sessions->GetSession(i, session.put()) == S_OK) {
+        Add(session.get());
+      }
+    }
+    return {};
+  }
+
+  Session GetSession(const std::string& sessionID) {
+    std::unique_lock lock(mMutex);
+    const auto it = mSessions.find(sessionID);
+    if (it == mSessions.end()) {
+      return {};
+    }
+    return it->second;
+  }
+
+  void ReleaseRetired() {
+    std::vector<Session> retired;
+    {
+      std::unique_lock lock(mMutex);
+      retired.swap(mRetired);
+    }
+    for (const auto& session: retired) {
+      session.mControl->UnregisterAudioSessionNotification(
+        session.mEvents.get());
+    }
   }
 };
 
-AudioDevicePlugEventCallbackHandle::AudioDevicePlugEventCallbackHandle(
-  const std::shared_ptr<Impl>& p)
-  : p(p) {
+HRESULT AudioSessionEventsCOMCallback::OnDisplayNameChanged(
+  LPCWSTR,
+  LPCGUID) {
+  mTracker->OnDisplayNameChanged(mSessionID);
+  return S_OK;
 }
 
-AudioDevicePlugEventCallbackHandle::~AudioDevicePlugEventCallbackHandle()
-  = default;
+HRESULT AudioSessionEventsCOMCallback::OnSimpleVolumeChanged(
+  float scalar,
+  BOOL muted,
+  LPCGUID) {
+  mTracker->mTable.Update(mSessionID, [scalar, muted](auto& info) {
+    info.volumeScalar = scalar;
+    info.isMuted = static_cast<bool>(muted);
+  });
+  return S_OK;
+}
 
-AudioDevicePlugEventCallbackHandle AddAudioDevicePlugEventCallback(
-  std::function<void(AudioDevicePlugEvent, const std::string&)> cb) {
-  auto de
-    = winrt::create_instance<IMMDeviceEnumerator>(__uuidof(MMDeviceEnumerator));
-  auto comcb = winrt::make<AudioDevicePlugEventCOMCallback>(cb);
-  de->RegisterEndpointNotificationCallback(comcb.get());
-  return std::make_shared<AudioDevicePlugEventCallbackHandle::Impl>(de, comcb);
+HRESULT AudioSessionEventsCOMCallback::OnStateChanged(
+  ::AudioSessionState state) {
+  if (state == AudioSessionStateExpired) {
+    mTracker->Retire(mSessionID);
+    return S_OK;
+  }
+  mTracker->mTable.Update(mSessionID, [state](auto& info) {
+    info.isActive = (state == AudioSessionStateActive);
+  });
+  return S_OK;
+}
+
+HRESULT AudioSessionEventsCOMCallback::OnSessionDisconnected(
+  AudioSessionDisconnectReason) {
+  mTracker->Retire(mSessionID);
+  return S_OK;
+}
+
+HRESULT AudioSessionNotificationCOMCallback::OnSessionCreated(
+  IAudioSessionControl* session) {
+  mTracker->Add(session);
+  return S_OK;
+}
+
+}// namespace
+
+result<AudioSessionTable*> GetAudioSessionTable(const std::string& deviceID) {
+  const auto tracker = AudioSessionTracker::Get(deviceID);
+  if (!tracker) {
+    return {unexpect, tracker.error()};
+  }
+  return &(*tracker)->mTable;
+}
+
+result<void> SetAudioSessionVolume(
+  const std::string& deviceID,
+  const std::string& sessionID,
+  float scalar) {
+  const auto tracker = AudioSessionTracker::Get(deviceID);
+  if (!tracker) {
+    return {unexpect, tracker.error()};
+  }
+  return (*tracker)->SetVolume(sessionID, scalar);
+}
+
+result<void> SetAudioSessionMute(
+  const std::string& deviceID,
+  const std::string& sessionID,
+  bool isMuted) {
+  const auto tracker = AudioSessionTracker::Get(deviceID);
+  if (!tracker) {
+    return {unexpect, tracker.error()};
+  }
+  return (*tracker)->SetMute(sessionID, isMuted);
 }
 
 }// namespace FredEmmott::Audio
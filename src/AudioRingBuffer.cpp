@@ -0,0 +1,196 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioRingBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+size_t GetSampleBytes(AudioSampleFormat format) {
+  switch (format) {
+    case AudioSampleFormat::FLOAT32:
+      return sizeof(float);
+    case AudioSampleFormat::INT16:
+      return sizeof(int16_t);
+  }
+  return sizeof(float);
+}
+
+void ConvertSample(float in, float* out) {
+  *out = in;
+}
+
+void ConvertSample(int16_t in, int16_t* out) {
+  *out = in;
+}
+
+void ConvertSample(int16_t in, float* out) {
+  *out = in / 32768.0f;
+}
+
+void ConvertSample(float in, int16_t* out) {
+  *out
+    = static_cast<int16_t>(std::lrint(std::clamp(in, -1.0f, 1.0f) * 32767));
+}
+
+}// namespace
+
+AudioRingBuffer::AudioRingBuffer(
+  const AudioStreamFormat& format,
+  uint32_t capacityFrames)
+  : mFormat(format),
+    mCapacityFrames(std::max<uint32_t>(1, capacityFrames)),
+    mFrameBytes(GetSampleBytes(format.sampleFormat) * format.channels),
+    mStorage(mCapacityFrames * mFrameBytes) {
+}
+
+void AudioRingBuffer::Write(const AudioBufferView& buffer) {
+  // Only the producer modifies the write position
+  const auto position = mWritePosition.load(std::memory_order_relaxed);
+  const auto used = position - mReadPosition.load(std::memory_order_acquire);
+  const auto frames = static_cast<uint32_t>(
+    std::min<uint64_t>(buffer.mFrames, mCapacityFrames - used));
+  if (frames < buffer.mFrames) {
+    mOverrunFrames.fetch_add(
+      buffer.mFrames - frames, std::memory_order_relaxed);
+  }
+  if (frames == 0) {
+    return;
+  }
+
+  if (buffer.mIsSilent || buffer.mData == nullptr) {
+    WriteSamples<float>(nullptr, buffer.mChannels, position, frames);
+  } else if (buffer.mFormat == AudioSampleFormat::INT16) {
+    WriteSamples(
+      static_cast<const int16_t*>(buffer.mData),
+      buffer.mChannels,
+      position,
+      frames);
+  } else {
+    WriteSamples(
+      static_cast<const float*>(buffer.mData),
+      buffer.mChannels,
+      position,
+      frames);
+  }
+
+  // Sequentially consistent, pairing with `WaitForFrames()`: either the
+  // consumer sees the new position, or we see that it's waiting
+  mWritePosition.store(position + frames, std::memory_order_seq_cst);
+  if (mConsumerWaiting.exchange(false, std::memory_order_seq_cst)) {
+    mDataAvailable.release();
+  }
+}
+
+template <class T>
+void AudioRingBuffer::WriteSamples(
+  const T* samples,
+  uint16_t channels,
+  uint64_t position,
+  uint32_t frames) {
+  const auto start = static_cast<uint32_t>(position % mCapacityFrames);
+  const auto firstFrames = std::min(frames, mCapacityFrames - start);
+  const std::array<std::pair<uint32_t, uint32_t>, 2> regions {{
+    {start, firstFrames},
+    {0, frames - firstFrames},
+  }};
+
+  for (const auto& [offset, count]: regions) {
+    if (count == 0) {
+      continue;
+    }
+    auto out = mStorage.data() + (offset * mFrameBytes);
+    if (!samples) {
+      std::memset(out, 0, count * mFrameBytes);
+      continue;
+    }
+
+    const auto outFormat = mFormat.sampleFormat;
+    const auto sameFormat = GetSampleBytes(outFormat) == sizeof(T);
+    if (channels == mFormat.channels && sameFormat) {
+      std::memcpy(out, samples, count * mFrameBytes);
+      samples += count * channels;
+      continue;
+    }
+
+    // Extra channels are dropped, and missing channels are silent
+    const auto copyChannels = std::min(channels, mFormat.channels);
+    std::memset(out, 0, count * mFrameBytes);
+    for (uint32_t frame = 0; frame < count; ++frame) {
+      for (uint16_t channel = 0; channel < copyChannels; ++channel) {
+        const auto index = (frame * mFormat.channels) + channel;
+        if (outFormat == AudioSampleFormat::INT16) {
+          ConvertSample(
+            samples[channel], reinterpret_cast<int16_t*>(out) + index);
+        } else {
+          ConvertSample(
+            samples[channel], reinterpret_cast<float*>(out) + index);
+        }
+      }
+      samples += channels;
+    }
+  }
+}
+
+CaptureStream::ReadSpans AudioRingBuffer::BeginRead() const {
+  // Only the consumer modifies the read position
+  const auto position = mReadPosition.load(std::memory_order_relaxed);
+  const auto frames = static_cast<uint32_t>(
+    mWritePosition.load(std::memory_order_acquire) - position);
+  const auto start = static_cast<uint32_t>(position % mCapacityFrames);
+  const auto firstFrames = std::min(frames, mCapacityFrames - start);
+
+  return {
+    .first = {
+      mStorage.data() + (start * mFrameBytes),
+      firstFrames * mFrameBytes,
+    },
+    .second = {mStorage.data(), (frames - firstFrames) * mFrameBytes},
+    .frames = frames,
+  };
+}
+
+void AudioRingBuffer::EndRead(uint32_t frames) {
+  const auto position = mReadPosition.load(std::memory_order_relaxed);
+  const auto available
+    = mWritePosition.load(std::memory_order_acquire) - position;
+  mReadPosition.store(
+    position + std::min<uint64_t>(frames, available),
+    std::memory_order_release);
+}
+
+bool AudioRingBuffer::WaitForFrames(
+  uint32_t frames,
+  std::chrono::milliseconds timeout) {
+  frames = std::min(frames, mCapacityFrames);
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    // Set before checking, so a write after the check always signals us
+    mConsumerWaiting.store(true, std::memory_order_seq_cst);
+    const auto available = mWritePosition.load(std::memory_order_seq_cst)
+      - mReadPosition.load(std::memory_order_relaxed);
+    if (available >= frames) {
+      mConsumerWaiting.store(false, std::memory_order_relaxed);
+      return true;
+    }
+    // Wakeups may be stale, from a previous wait; re-check either way
+    if (!mDataAvailable.try_acquire_until(deadline)) {
+      mConsumerWaiting.store(false, std::memory_order_relaxed);
+      const auto final = mWritePosition.load(std::memory_order_acquire)
+        - mReadPosition.load(std::memory_order_relaxed);
+      return final >= frames;
+    }
+  }
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,84 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <semaphore>
+#include <vector>
+
+#include "NativeAudioStreams.h"
+
+namespace FredEmmott::Audio {
+
+/* A single-producer, single-consumer ring buffer of interleaved frames.
+ *
+ * The producer is a capture callback: it converts to the buffer's sample
+ * format, and never blocks or allocates. Frames that don't fit are dropped,
+ * and counted as overruns, rather than overwriting unread data.
+ *
+ * Positions are frame counts since creation, so they never wrap in practice,
+ * and `write - read` is always the number of readable frames.
+ */
+class AudioRingBuffer final {
+ public:
+  AudioRingBuffer(const AudioStreamFormat&, uint32_t capacityFrames);
+
+  AudioRingBuffer(const AudioRingBuffer&) = delete;
+  AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+  const AudioStreamFormat& GetFormat() const {
+    return mFormat;
+  }
+
+  size_t GetFrameBytes() const {
+    return mFrameBytes;
+  }
+
+  // Producer
+  void Write(const AudioBufferView&);
+
+  // Consumer
+  CaptureStream::ReadSpans BeginRead() const;
+  void EndRead(uint32_t frames);
+  bool WaitForFrames(uint32_t frames, std::chrono::milliseconds timeout);
+
+  // Any thread
+  uint64_t GetOverrunFrames() const {
+    return mOverrunFrames.load(std::memory_order_relaxed);
+  }
+
+ private:
+  const AudioStreamFormat mFormat;
+  const uint32_t mCapacityFrames;
+  const size_t mFrameBytes;
+  std::vector<std::byte> mStorage;
+
+  // Each is only written by one side; kept on separate cache lines so the
+  // producer and consumer don't contend
+  alignas(64) std::atomic<uint64_t> mWritePosition {0};
+  alignas(64) std::atomic<uint64_t> mReadPosition {0};
+  std::atomic<uint64_t> mOverrunFrames {0};
+
+  // Set by a consumer in `WaitForFrames()`; the producer only signals the
+  // semaphore if it's set, so it doesn't accumulate a count per buffer.
+  std::atomic<bool> mConsumerWaiting {false};
+  std::counting_semaphore<> mDataAvailable {0};
+
+  template <class T>
+  void WriteSamples(
+    const T* samples,
+    uint16_t channels,
+    uint64_t position,
+    uint32_t frames);
+};
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,117 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "AudioSessionTable.h"
+
+#include <memory>
+
+namespace FredEmmott::Audio {
+
+std::vector<AudioSessionInfo> AudioSessionTable::GetSessions() const {
+  std::unique_lock lock(mMutex);
+  std::vector<AudioSessionInfo> ret;
+  ret.reserve(mSessions.size());
+  for (const auto& [id, info]: mSessions) {
+    ret.push_back(info);
+  }
+  return ret;
+}
+
+void AudioSessionTable::Set(const AudioSessionInfo& info) {
+  std::unique_lock lock(mMutex);
+  auto [it, inserted] = mSessions.try_emplace(info.id, info);
+  if (!inserted) {
+    if (it->second == info) {
+      return;
+    }
+    it->second = info;
+  }
+  Notify(
+    lock,
+    inserted ? AudioSessionEventKind::ADDED : AudioSessionEventKind::CHANGED,
+    info);
+}
+
+void AudioSessionTable::Remove(const std::string& sessionID) {
+  std::unique_lock lock(mMutex);
+  auto node = mSessions.extract(sessionID);
+  if (node) {
+    Notify(lock, AudioSessionEventKind::REMOVED, node.mapped());
+  }
+}
+
+AudioSessionTable::SubscriptionID AudioSessionTable::Subscribe(
+  Callback callback) {
+  return mSubscribers.Add(std::move(callback));
+}
+
+void AudioSessionTable::Unsubscribe(SubscriptionID id) {
+  mSubscribers.Remove(id);
+}
+
+void AudioSessionTable::Notify(
+  std::unique_lock<std::mutex>& lock,
+  AudioSessionEventKind kind,
+  const AudioSessionInfo& info) {
+  if (mSubscribers.IsEmpty()) {
+    return;
+  }
+  mUndelivered.emplace_back(kind, info);
+  if (mIsDelivering) {
+    // Delivered by the thread that's already delivering
+    return;
+  }
+
+  mIsDelivering = true;
+  while (!mUndelivered.empty()) {
+    const auto event = std::move(mUndelivered.front());
+    mUndelivered.pop_front();
+
+    lock.unlock();
+    mSubscribers.ForEach(
+      [&event](const auto& cb) { cb(event.first, event.second); });
+    lock.lock();
+  }
+  mIsDelivering = false;
+}
+
+result<std::vector<AudioSessionInfo>> GetAudioSessions(
+  const std::string& deviceID) {
+  const auto table = GetAudioSessionTable(deviceID);
+  if (!table) {
+    return {unexpect, table.error()};
+  }
+  return (*table)->GetSessions();
+}
+
+class AudioSessionCallbackHandle::Impl {
+ public:
+  AudioSessionTable* table;
+  AudioSessionTable::SubscriptionID id;
+  ~Impl() {
+    table->Unsubscribe(id);
+  }
+};
+
+AudioSessionCallbackHandle::AudioSessionCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+AudioSessionCallbackHandle::~AudioSessionCallbackHandle() = default;
+
+result<AudioSessionCallbackHandle> AddAudioSessionCallback(
+  const std::string& deviceID,
+  std::function<void(AudioSessionEventKind, const AudioSessionInfo&)> cb) {
+  const auto table = GetAudioSessionTable(deviceID);
+  if (!table) {
+    return {unexpect, table.error()};
+  }
+  const auto id = (*table)->Subscribe(std::move(cb));
+  return {{std::make_shared<AudioSessionCallbackHandle::Impl>(*table, id)}};
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,88 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EpochSubscriberList.h"
+
+namespace FredEmmott::Audio {
+
+/* The sessions on one endpoint, kept up to date by the platform backend from
+ * session notifications rather than re-enumeration.
+ *
+ * Subscribers are only notified of actual changes, outside of the lock, and
+ * in the order that the changes were made: a change made while another thread
+ * is notifying subscribers is queued, and delivered by that thread.
+ */
+class AudioSessionTable final {
+ public:
+  using Callback
+    = std::function<void(AudioSessionEventKind, const AudioSessionInfo&)>;
+  using SubscriptionID = uint64_t;
+
+  AudioSessionTable() = default;
+  AudioSessionTable(const AudioSessionTable&) = delete;
+  AudioSessionTable& operator=(const AudioSessionTable&) = delete;
+
+  std::vector<AudioSessionInfo> GetSessions() const;
+
+  // Adds or replaces a session
+  void Set(const AudioSessionInfo&);
+  // Has no effect if the session isn't in the table
+  template <class F>
+  void Update(const std::string& sessionID, F&& update) {
+    std::unique_lock lock(mMutex);
+    const auto it = mSessions.find(sessionID);
+    if (it == mSessions.end()) {
+      return;
+    }
+    auto info = it->second;
+    update(info);
+    if (info == it->second) {
+      return;
+    }
+    it->second = info;
+    Notify(lock, AudioSessionEventKind::CHANGED, info);
+  }
+  void Remove(const std::string& sessionID);
+
+  SubscriptionID Subscribe(Callback);
+  void Unsubscribe(SubscriptionID);
+
+ private:
+  mutable std::mutex mMutex;
+  std::map<std::string, AudioSessionInfo> mSessions;
+  // Changed, but not yet delivered to subscribers
+  std::deque<std::pair<AudioSessionEventKind, AudioSessionInfo>> mUndelivered;
+  bool mIsDelivering {false};
+  EpochSubscriberList<Callback> mSubscribers;
+
+  // Queues the event, then delivers the queue unless another thread already
+  // is; the lock must be held, and is held again on return
+  void Notify(
+    std::unique_lock<std::mutex>&,
+    AudioSessionEventKind,
+    const AudioSessionInfo&);
+};
+
+/* Implemented by each platform backend.
+ *
+ * Returns the table for the device, enumerating its sessions and
+ * registering for notifications on first use. Tables are never freed.
+ */
+result<AudioSessionTable*> GetAudioSessionTable(const std::string& deviceID);
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,65 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "BackendThread.h"
+
+#include <thread>
+
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+thread_local const void* tCurrentBackendThread {nullptr};
+}// namespace
+
+BackendThread::~BackendThread() {
+  if (mIsRunning) {
+    // Queued behind everything that's already been posted
+    Post([state = mState.get()]() { state->mIsStopping = true; });
+  }
+}
+
+bool BackendThread::IsCurrentThread() const {
+  return tCurrentBackendThread == mState.get();
+}
+
+void BackendThread::Post(std::function<void()> task) {
+  std::call_once(mStarted, [this]() {
+    std::thread([state = mState]() { Run(state); }).detach();
+    mIsRunning = true;
+  });
+
+  const auto previous
+    = mState->mPending.fetch_add(1, std::memory_order_acq_rel);
+  mState->mQueue.Push(std::move(task));
+  if (previous == 0) {
+    mState->mPending.notify_one();
+  }
+}
+
+void BackendThread::Run(const std::shared_ptr<State>& state) {
+  tCurrentBackendThread = state.get();
+  InitializeNativeThread();
+
+  while (!state->mIsStopping) {
+    auto task = state->mQueue.Pop();
+    if (!task) {
+      if (state->mPending.load(std::memory_order_acquire) == 0) {
+        state->mPending.wait(0, std::memory_order_acquire);
+      } else {
+        // Counted, but the producer hasn't finished linking it yet
+        std::this_thread::yield();
+      }
+      continue;
+    }
+    state->mPending.fetch_sub(1, std::memory_order_acq_rel);
+    (*task)();
+  }
+  tCurrentBackendThread = nullptr;
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,61 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "MPSCQueue.h"
+
+namespace FredEmmott::Audio {
+
+/* A single library-owned thread that runs tasks in the order they were
+ * posted, so that anything only ever touched from tasks is owned by one
+ * thread.
+ *
+ * Posting is lock-free. The thread sleeps on `mPending` (a futex on most
+ * platforms) when there is nothing to do, and producers only wake it when
+ * it may be sleeping.
+ *
+ * The thread is started by the first `Post()`. Destroying the
+ * `BackendThread` doesn't wait for it: it runs the tasks that were already
+ * posted, then exits.
+ */
+class BackendThread final {
+ public:
+  BackendThread() = default;
+  ~BackendThread();
+  BackendThread(const BackendThread&) = delete;
+  BackendThread& operator=(const BackendThread&) = delete;
+
+  // Any thread
+  void Post(std::function<void()>);
+
+  // True on this backend thread, without starting it
+  bool IsCurrentThread() const;
+
+ private:
+  // Shared with the thread, as it can outlive the `BackendThread`
+  struct State {
+    MPSCQueue<std::function<void()>> mQueue;
+    // Incremented before each push, so it's never less than the queue length
+    std::atomic<uint64_t> mPending {0};
+    // Only used by the thread
+    bool mIsStopping {false};
+  };
+
+  const std::shared_ptr<State> mState {std::make_shared<State>()};
+  std::once_flag mStarted;
+  bool mIsRunning {false};
+
+  static void Run(const std::shared_ptr<State>&);
+};
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,111 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace FredEmmott::Audio {
+
+/* A named region of memory shared by the broker and its clients.
+ *
+ * Only the broker can write to it. It's removed when the broker's segment
+ * is destroyed, though clients that already have it open can keep reading;
+ * they can use `IsOwnerRunning()` to find out if the broker process has
+ * exited.
+ */
+class SharedMemorySegment final {
+ public:
+  class Impl;
+
+  /* Replaces any segment left behind by a broker that didn't exit cleanly.
+   *
+   * Fails with `Error::BROKER_NOT_AVAILABLE` if another broker is using
+   * the name.
+   */
+  static result<std::unique_ptr<SharedMemorySegment>> Create(
+    const std::string& name,
+    size_t size);
+  // Read-only; returns `nullptr` if it doesn't exist, or is too small
+  static std::unique_ptr<SharedMemorySegment> Open(
+    const std::string& name,
+    size_t size);
+
+  SharedMemorySegment(const SharedMemorySegment&) = delete;
+  SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+  ~SharedMemorySegment();
+
+  void* GetData() const {
+    return mData;
+  }
+
+  // False once the process that created the segment has exited, even if
+  // it didn't exit cleanly
+  bool IsOwnerRunning() const;
+
+ private:
+  SharedMemorySegment(std::unique_ptr<Impl>, void* data);
+
+  std::unique_ptr<Impl> p;
+  void* mData {nullptr};
+};
+
+/* Wakes clients that are waiting in `BrokerListener::Wait()`.
+ *
+ * This is only used to wake clients; they read the new state from the
+ * `SharedMemorySegment`.
+ */
+class BrokerNotifier final {
+ public:
+  class Impl;
+
+  // Returns `nullptr` on failure
+  static std::unique_ptr<BrokerNotifier> Create(const std::string& name);
+
+  BrokerNotifier(const BrokerNotifier&) = delete;
+  BrokerNotifier& operator=(const BrokerNotifier&) = delete;
+  ~BrokerNotifier();
+
+  // `generation` is the one that's just been published
+  void Notify(uint64_t generation);
+
+ private:
+  explicit BrokerNotifier(std::unique_ptr<Impl>);
+
+  std::unique_ptr<Impl> p;
+};
+
+class BrokerListener final {
+ public:
+  class Impl;
+
+  // Returns `nullptr` if the broker isn't running
+  static std::unique_ptr<BrokerListener> Open(const std::string& name);
+
+  BrokerListener(const BrokerListener&) = delete;
+  BrokerListener& operator=(const BrokerListener&) = delete;
+  ~BrokerListener();
+
+  /* Returns once any generation after `generation` may have been published,
+   * or after the timeout.
+   *
+   * Wake-ups may be spurious, so callers must check the generation.
+   */
+  void Wait(uint64_t generation, std::chrono::milliseconds timeout);
+
+ private:
+  explicit BrokerListener(std::unique_ptr<Impl>);
+
+  std::unique_ptr<Impl> p;
+};
+
+}// namespace FredEmmott::Audio
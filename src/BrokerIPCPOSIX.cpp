@@ -0,0 +1,449 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "BrokerIPC.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+// macOS uses `SO_NOSIGPIPE` instead
+constexpr int SendFlags = 0;
+#endif
+
+// macOS limits these to 31 characters, including the leading slash
+constexpr size_t MaxSharedMemoryNameLength = 31;
+
+// Longer names are replaced with their hash
+std::string GetSharedMemoryName(const std::string& name) {
+  const std::string prefix {"/adl-"};
+  if (prefix.size() + name.size() <= MaxSharedMemoryNameLength) {
+    return prefix + name;
+  }
+
+  uint64_t hash = 14695981039346656037ull;
+  for (const auto c: name) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  char hex[17] {};
+  std::snprintf(hex, sizeof(hex), "%016" PRIx64, hash);
+  return prefix + hex;
+}
+
+/* Precedes the caller's data in the segment, so that a segment left behind
+ * by a broker that didn't exit cleanly can be told apart from one that is
+ * still in use.
+ *
+ * A whole cache line, so that the caller's data stays aligned.
+ */
+struct alignas(64) SegmentOwner {
+  // 0 until the creating process has set it
+  std::atomic<pid_t> mPID;
+};
+static_assert(std::atomic<pid_t>::is_always_lock_free);
+
+bool IsProcessRunning(pid_t pid) {
+  // `EPERM` means it's running as another user
+  return !(kill(pid, 0) == -1 && errno == ESRCH);
+}
+
+enum class SegmentStatus {
+  MISSING,
+  ABANDONED,
+  // Includes segments that are still being created
+  IN_USE,
+};
+
+SegmentStatus GetSegmentStatus(const std::string& sharedMemoryName) {
+  const auto fd = shm_open(sharedMemoryName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd == -1) {
+    return errno == ENOENT ? SegmentStatus::MISSING : SegmentStatus::IN_USE;
+  }
+
+  struct stat info {};
+  void* data = MAP_FAILED;
+  if (
+    fstat(fd, &info) == 0
+    && static_cast<size_t>(info.st_size) >= sizeof(SegmentOwner)) {
+    data = mmap(nullptr, sizeof(SegmentOwner), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    return SegmentStatus::IN_USE;
+  }
+
+  const auto pid = static_cast<const SegmentOwner*>(data)->mPID.load(
+    std::memory_order_acquire);
+  munmap(data, sizeof(SegmentOwner));
+  if (pid == 0) {
+    return SegmentStatus::IN_USE;
+  }
+  return IsProcessRunning(pid) ? SegmentStatus::IN_USE
+                               : SegmentStatus::ABANDONED;
+}
+
+std::filesystem::path GetSocketPath(const std::string& name) {
+  std::error_code ec;
+  return std::filesystem::temp_directory_path(ec)
+    / ("AudioDeviceLib-" + name + ".sock");
+}
+
+// Returns false if the path doesn't fit
+bool GetSocketAddress(const std::string& name, sockaddr_un* address) {
+  const auto path = GetSocketPath(name).string();
+  *address = {};
+  address->sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address->sun_path)) {
+    return false;
+  }
+  std::memcpy(address->sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+void ConfigureDescriptor(int fd) {
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+  const int enabled = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+}
+
+}// namespace
+
+class SharedMemorySegment::Impl {
+ public:
+  std::string mName;
+  size_t mSize {};
+  bool mIsOwner {};
+};
+
+SharedMemorySegment::SharedMemorySegment(std::unique_ptr<Impl> p, void* data)
+  : p(std::move(p)),
+    mData(data) {
+}
+
+SharedMemorySegment::~SharedMemorySegment() {
+  munmap(static_cast<std::byte*>(mData) - sizeof(SegmentOwner), p->mSize);
+  if (p->mIsOwner) {
+    shm_unlink(p->mName.c_str());
+  }
+}
+
+bool SharedMemorySegment::IsOwnerRunning() const {
+  if (p->mIsOwner) {
+    return true;
+  }
+  const auto owner = reinterpret_cast<const SegmentOwner*>(
+    static_cast<const std::byte*>(mData) - sizeof(SegmentOwner));
+  const auto pid = owner->mPID.load(std::memory_order_acquire);
+  // Still being created
+  if (pid == 0) {
+    return true;
+  }
+  return IsProcessRunning(pid);
+}
+
+result<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Create(
+  const std::string& name,
+  size_t size) {
+  auto impl = std::make_unique<Impl>(
+    GetSharedMemoryName(name), sizeof(SegmentOwner) + size, true);
+
+  int fd = -1;
+  // At most once for a segment that was abandoned, then for real
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    fd = shm_open(
+      impl->mName.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd != -1) {
+      break;
+    }
+    if (errno != EEXIST) {
+      return {unexpect, Error::UNKNOWN};
+    }
+    switch (GetSegmentStatus(impl->mName)) {
+      case SegmentStatus::MISSING:
+        // Removed since we tried; try again
+        break;
+      case SegmentStatus::ABANDONED:
+        // If two brokers find the same abandoned segment, the second one
+        // can remove the first one's new segment; the owner can't be
+        // checked and the segment removed in one step
+        shm_unlink(impl->mName.c_str());
+        break;
+      case SegmentStatus::IN_USE:
+        return {unexpect, Error::BROKER_NOT_AVAILABLE};
+    }
+  }
+  if (fd == -1) {
+    // Another broker is starting with the same name
+    return {unexpect, Error::BROKER_NOT_AVAILABLE};
+  }
+
+  void* data = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(impl->mSize)) == 0) {
+    data = mmap(
+      nullptr, impl->mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  // The mapping keeps its own reference
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    shm_unlink(impl->mName.c_str());
+    return {unexpect, Error::UNKNOWN};
+  }
+  new (data) SegmentOwner {};
+  static_cast<SegmentOwner*>(data)->mPID.store(
+    getpid(), std::memory_order_release);
+  return std::unique_ptr<SharedMemorySegment>(new SharedMemorySegment(
+    std::move(impl), static_cast<std::byte*>(data) + sizeof(SegmentOwner)));
+}
+
+std::unique_ptr<SharedMemorySegment> SharedMemorySegment::Open(
+  const std::string& name,
+  size_t size) {
+  auto impl = std::make_unique<Impl>(
+    GetSharedMemoryName(name), sizeof(SegmentOwner) + size, false);
+  const auto fd = shm_open(impl->mName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  struct stat info {};
+  void* data = MAP_FAILED;
+  if (
+    fstat(fd, &info) == 0
+    && static_cast<size_t>(info.st_size) >= impl->mSize) {
+    data = mmap(nullptr, impl->mSize, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  return std::unique_ptr<SharedMemorySegment>(new SharedMemorySegment(
+    std::move(impl), static_cast<std::byte*>(data) + sizeof(SegmentOwner)));
+}
+
+/* Each client connects to a Unix domain socket; the broker writes a byte to
+ * every client for each notification.
+ *
+ * Client sockets are non-blocking, so a client that isn't reading can't
+ * stall the broker; it already has unread bytes, so it will still wake.
+ */
+class BrokerNotifier::Impl {
+ public:
+  Impl(std::filesystem::path path, int listener, int wakeRead, int wakeWrite)
+    : mPath(std::move(path)),
+      mListener(listener),
+      mWakeRead(wakeRead),
+      mWakeWrite(wakeWrite) {
+    mThread = std::thread([this]() { AcceptClients(); });
+  }
+
+  ~Impl() {
+    const char byte {};
+    write(mWakeWrite, &byte, 1);
+    mThread.join();
+
+    for (const auto fd: mClients) {
+      close(fd);
+    }
+    close(mListener);
+    close(mWakeRead);
+    close(mWakeWrite);
+    std::error_code ec;
+    std::filesystem::remove(mPath, ec);
+  }
+
+  void Notify() {
+    const char byte {};
+    std::unique_lock lock(mMutex);
+    std::erase_if(mClients, [&byte](int fd) {
+      if (send(fd, &byte, 1, SendFlags) == 1) {
+        return false;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return false;
+      }
+      // Disconnected
+      close(fd);
+      return true;
+    });
+  }
+
+ private:
+  const std::filesystem::path mPath;
+  const int mListener;
+  // Written to by the destructor, to stop the thread
+  const int mWakeRead;
+  const int mWakeWrite;
+
+  std::mutex mMutex;
+  std::vector<int> mClients;
+  std::thread mThread;
+
+  void AcceptClients() {
+    pollfd fds[] {
+      {.fd = mListener, .events = POLLIN, .revents = 0},
+      {.fd = mWakeRead, .events = POLLIN, .revents = 0},
+    };
+    while (true) {
+      if (poll(fds, std::size(fds), -1) == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+      if (fds[1].revents) {
+        return;
+      }
+      if (!(fds[0].revents & POLLIN)) {
+        continue;
+      }
+      const auto client = accept(mListener, nullptr, nullptr);
+      if (client == -1) {
+        continue;
+      }
+      ConfigureDescriptor(client);
+      std::unique_lock lock(mMutex);
+      mClients.push_back(client);
+    }
+  }
+};
+
+BrokerNotifier::BrokerNotifier(std::unique_ptr<Impl> p) : p(std::move(p)) {
+}
+
+BrokerNotifier::~BrokerNotifier() = default;
+
+std::unique_ptr<BrokerNotifier> BrokerNotifier::Create(
+  const std::string& name) {
+  sockaddr_un address {};
+  if (!GetSocketAddress(name, &address)) {
+    return nullptr;
+  }
+  // Left behind by a broker that didn't exit cleanly
+  unlink(address.sun_path);
+
+  const auto listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener == -1) {
+    return nullptr;
+  }
+  fcntl(listener, F_SETFD, FD_CLOEXEC);
+  int wake[2] {-1, -1};
+  if (
+    bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+      == -1
+    || listen(listener, SOMAXCONN) == -1 || pipe(wake) == -1) {
+    close(listener);
+    unlink(address.sun_path);
+    return nullptr;
+  }
+  fcntl(wake[0], F_SETFD, FD_CLOEXEC);
+  fcntl(wake[1], F_SETFD, FD_CLOEXEC);
+
+  return std::unique_ptr<BrokerNotifier>(new BrokerNotifier(
+    std::make_unique<Impl>(address.sun_path, listener, wake[0], wake[1])));
+}
+
+void BrokerNotifier::Notify(uint64_t) {
+  p->Notify();
+}
+
+class BrokerListener::Impl {
+ public:
+  explicit Impl(int fd) : mSocket(fd) {
+  }
+
+  ~Impl() {
+    close(mSocket);
+  }
+
+  void Wait(std::chrono::milliseconds timeout) {
+    if (!mIsConnected.load(std::memory_order_relaxed)) {
+      // The broker has stopped, so nothing is coming
+      std::this_thread::sleep_for(timeout);
+      return;
+    }
+
+    pollfd fd {.fd = mSocket, .events = POLLIN, .revents = 0};
+    if (poll(&fd, 1, static_cast<int>(timeout.count())) <= 0) {
+      return;
+    }
+    // Notifications carry no data, so any number of them is one wake-up
+    char buffer[64];
+    while (true) {
+      const auto received = recv(mSocket, buffer, sizeof(buffer), 0);
+      if (received == 0) {
+        mIsConnected.store(false, std::memory_order_relaxed);
+        return;
+      }
+      if (received < 0) {
+        return;
+      }
+    }
+  }
+
+ private:
+  const int mSocket;
+  std::atomic<bool> mIsConnected {true};
+};
+
+BrokerListener::BrokerListener(std::unique_ptr<Impl> p) : p(std::move(p)) {
+}
+
+BrokerListener::~BrokerListener() = default;
+
+std::unique_ptr<BrokerListener> BrokerListener::Open(const std::string& name) {
+  sockaddr_un address {};
+  if (!GetSocketAddress(name, &address)) {
+    return nullptr;
+  }
+  const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return nullptr;
+  }
+  if (
+    connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+    == -1) {
+    close(fd);
+    return nullptr;
+  }
+  ConfigureDescriptor(fd);
+  return std::unique_ptr<BrokerListener>(
+    new BrokerListener(std::make_unique<Impl>(fd)));
+}
+
+void BrokerListener::Wait(uint64_t, std::chrono::milliseconds timeout) {
+  p->Wait(timeout);
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,224 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <Windows.h>
+#include <winrt/base.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+#include "BrokerIPC.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+std::wstring GetObjectName(const std::string& name) {
+  return L"Local\\AudioDeviceLib-" + std::wstring(winrt::to_hstring(name));
+}
+
+std::wstring GetEventName(const std::wstring& prefix, uint64_t generation) {
+  return prefix + L"-" + std::to_wstring(generation);
+}
+
+/* Precedes the caller's data in the segment, so that clients can find out
+ * if the broker process has exited; the mapping itself lives on until the
+ * clients close it.
+ *
+ * A whole cache line, so that the caller's data stays aligned.
+ */
+struct alignas(64) SegmentOwner {
+  // 0 until the creating process has set it
+  std::atomic<DWORD> mProcessID;
+};
+static_assert(std::atomic<DWORD>::is_always_lock_free);
+
+}// namespace
+
+class SharedMemorySegment::Impl {
+ public:
+  winrt::handle mMapping;
+  // Null for the owner; held so that the process ID can't be reused
+  winrt::handle mOwnerProcess;
+};
+
+SharedMemorySegment::SharedMemorySegment(std::unique_ptr<Impl> p, void* data)
+  : p(std::move(p)),
+    mData(data) {
+}
+
+SharedMemorySegment::~SharedMemorySegment() {
+  UnmapViewOfFile(static_cast<std::byte*>(mData) - sizeof(SegmentOwner));
+}
+
+bool SharedMemorySegment::IsOwnerRunning() const {
+  if (!p->mOwnerProcess) {
+    return true;
+  }
+  return WaitForSingleObject(p->mOwnerProcess.get(), 0) == WAIT_TIMEOUT;
+}
+
+result<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Create(
+  const std::string& name,
+  size_t size) {
+  size += sizeof(SegmentOwner);
+  // Named mappings are removed by Windows once every handle is closed, so
+  // there can't be one left behind by a broker that crashed
+  winrt::handle mapping {CreateFileMappingW(
+    INVALID_HANDLE_VALUE,
+    nullptr,
+    PAGE_READWRITE,
+    static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+    static_cast<DWORD>(size),
+    GetObjectName(name).c_str())};
+  if (!mapping) {
+    return {unexpect, Error::UNKNOWN};
+  }
+  if (GetLastError() == ERROR_ALREADY_EXISTS) {
+    // Another broker is running
+    return {unexpect, Error::BROKER_NOT_AVAILABLE};
+  }
+  auto impl = std::make_unique<Impl>(std::move(mapping));
+  const auto data
+    = MapViewOfFile(impl->mMapping.get(), FILE_MAP_WRITE, 0, 0, size);
+  if (!data) {
+    return {unexpect, Error::UNKNOWN};
+  }
+  new (data) SegmentOwner {};
+  static_cast<SegmentOwner*>(data)->mProcessID.store(
+    GetCurrentProcessId(), std::memory_order_release);
+  return std::unique_ptr<SharedMemorySegment>(new SharedMemorySegment(
+    std::move(impl), static_cast<std::byte*>(data) + sizeof(SegmentOwner)));
+}
+
+std::unique_ptr<SharedMemorySegment> SharedMemorySegment::Open(
+  const std::string& name,
+  size_t size) {
+  auto impl = std::make_unique<Impl>(winrt::handle {OpenFileMappingW(
+    FILE_MAP_READ, /* inherit = */ FALSE, GetObjectName(name).c_str())});
+  if (!impl->mMapping) {
+    return nullptr;
+  }
+  const auto data
+    = MapViewOfFile(impl->mMapping.get(), FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    return nullptr;
+  }
+  MEMORY_BASIC_INFORMATION info {};
+  if (
+    VirtualQuery(data, &info, sizeof(info)) != sizeof(info)
+    || info.RegionSize < sizeof(SegmentOwner) + size) {
+    UnmapViewOfFile(data);
+    return nullptr;
+  }
+  // Fails if the broker is still starting, or has already exited
+  const auto processID = static_cast<const SegmentOwner*>(data)
+                           ->mProcessID.load(std::memory_order_acquire);
+  impl->mOwnerProcess.attach(
+    OpenProcess(SYNCHRONIZE, /* inherit = */ FALSE, processID));
+  if (processID == 0 || !impl->mOwnerProcess) {
+    UnmapViewOfFile(data);
+    return nullptr;
+  }
+  return std::unique_ptr<SharedMemorySegment>(new SharedMemorySegment(
+    std::move(impl), static_cast<std::byte*>(data) + sizeof(SegmentOwner)));
+}
+
+/* There is a named manual-reset event for each generation, which is
+ * signalled and closed once the next generation is published.
+ *
+ * Clients keep the event open while they wait, so it isn't destroyed under
+ * them; once every handle is closed, Windows removes the name.
+ */
+class BrokerNotifier::Impl {
+ public:
+  std::wstring mPrefix;
+
+  std::mutex mMutex;
+  winrt::handle mCurrent;
+};
+
+BrokerNotifier::BrokerNotifier(std::unique_ptr<Impl> p) : p(std::move(p)) {
+}
+
+BrokerNotifier::~BrokerNotifier() {
+  // Wakes any remaining clients
+  SetEvent(p->mCurrent.get());
+}
+
+std::unique_ptr<BrokerNotifier> BrokerNotifier::Create(
+  const std::string& name) {
+  auto impl = std::make_unique<Impl>();
+  impl->mPrefix = GetObjectName(name);
+  impl->mCurrent.attach(CreateEventW(
+    nullptr,
+    /* manual reset = */ TRUE,
+    /* initial state = */ FALSE,
+    GetEventName(impl->mPrefix, 0).c_str()));
+  if (!impl->mCurrent) {
+    return nullptr;
+  }
+  return std::unique_ptr<BrokerNotifier>(new BrokerNotifier(std::move(impl)));
+}
+
+void BrokerNotifier::Notify(uint64_t generation) {
+  winrt::handle next {CreateEventW(
+    nullptr,
+    /* manual reset = */ TRUE,
+    /* initial state = */ FALSE,
+    GetEventName(p->mPrefix, generation).c_str())};
+
+  std::unique_lock lock(p->mMutex);
+  SetEvent(p->mCurrent.get());
+  p->mCurrent = std::move(next);
+}
+
+class BrokerListener::Impl {
+ public:
+  std::wstring mPrefix;
+};
+
+BrokerListener::BrokerListener(std::unique_ptr<Impl> p) : p(std::move(p)) {
+}
+
+BrokerListener::~BrokerListener() = default;
+
+std::unique_ptr<BrokerListener> BrokerListener::Open(const std::string& name) {
+  auto prefix = GetObjectName(name);
+  // Checks that the broker is running; the segment is opened separately
+  const winrt::handle mapping {
+    OpenFileMappingW(FILE_MAP_READ, /* inherit = */ FALSE, prefix.c_str())};
+  if (!mapping) {
+    return nullptr;
+  }
+  return std::unique_ptr<BrokerListener>(
+    new BrokerListener(std::make_unique<Impl>(std::move(prefix))));
+}
+
+void BrokerListener::Wait(
+  uint64_t generation,
+  std::chrono::milliseconds timeout) {
+  const winrt::handle event {OpenEventW(
+    SYNCHRONIZE,
+    /* inherit = */ FALSE,
+    GetEventName(p->mPrefix, generation).c_str())};
+  if (!event) {
+    // Either a later generation has already been published, or this one
+    // has been published but the broker hasn't created its event yet, or
+    // the broker has stopped; briefly back off, as the caller will retry
+    std::this_thread::sleep_for(
+      std::min(timeout, std::chrono::milliseconds(1)));
+    return;
+  }
+  WaitForSingleObject(event.get(), static_cast<DWORD>(timeout.count()));
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,127 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "AudioRingBuffer.h"
+#include "NativeAudioStreams.h"
+
+namespace FredEmmott::Audio {
+
+class CaptureStream::Impl {
+ public:
+  // The native stream's format isn't known until it's open, and it may
+  // deliver buffers before then; they're dropped until this is set.
+  std::atomic<AudioRingBuffer*> producerRing {nullptr};
+  std::unique_ptr<AudioRingBuffer> ring;
+  // Declared last so that it's destroyed first, as it references `ring`
+  std::unique_ptr<NativeCaptureStream> stream;
+};
+
+CaptureStream::CaptureStream(const std::shared_ptr<Impl>& p) : p(p) {
+}
+
+CaptureStream::~CaptureStream() = default;
+
+AudioStreamFormat CaptureStream::GetFormat() const {
+  if (!p) {
+    return {};
+  }
+  return p->ring->GetFormat();
+}
+
+CaptureStream::ReadSpans CaptureStream::BeginRead() const {
+  if (!p) {
+    return {};
+  }
+  return p->ring->BeginRead();
+}
+
+void CaptureStream::EndRead(uint32_t frames) {
+  if (p) {
+    p->ring->EndRead(frames);
+  }
+}
+
+uint32_t CaptureStream::Read(void* buffer, uint32_t frames) {
+  if (!p) {
+    return 0;
+  }
+  const auto spans = p->ring->BeginRead();
+  frames = std::min(frames, spans.frames);
+  if (frames == 0) {
+    return 0;
+  }
+
+  const auto bytes = frames * p->ring->GetFrameBytes();
+  const auto firstBytes = std::min(bytes, spans.first.size());
+  auto out = static_cast<std::byte*>(buffer);
+  std::memcpy(out, spans.first.data(), firstBytes);
+  std::memcpy(out + firstBytes, spans.second.data(), bytes - firstBytes);
+
+  p->ring->EndRead(frames);
+  return frames;
+}
+
+bool CaptureStream::WaitForFrames(
+  uint32_t frames,
+  std::chrono::milliseconds timeout) const {
+  if (!p) {
+    return false;
+  }
+  return p->ring->WaitForFrames(frames, timeout);
+}
+
+uint64_t CaptureStream::GetOverrunFrames() const {
+  if (!p) {
+    return 0;
+  }
+  return p->ring->GetOverrunFrames();
+}
+
+result<CaptureStream> OpenCaptureStream(
+  const std::string& deviceID,
+  AudioSampleFormat sampleFormat,
+  uint32_t bufferFrames) {
+  if (bufferFrames == 0) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+
+  auto impl = std::make_shared<CaptureStream::Impl>();
+  auto stream = OpenNativeCaptureStream(
+    deviceID, [impl = impl.get()](const AudioBufferView& buffer) {
+      const auto ring = impl->producerRing.load(std::memory_order_acquire);
+      if (ring) {
+        ring->Write(buffer);
+      }
+    });
+  if (!stream) {
+    return {unexpect, stream.error()};
+  }
+
+  const auto native = (*stream)->GetFormat();
+  if (native.channels == 0) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  impl->ring = std::make_unique<AudioRingBuffer>(
+    AudioStreamFormat {
+      .sampleFormat = sampleFormat,
+      .sampleRate = native.sampleRate,
+      .channels = native.channels,
+    },
+    bufferFrames);
+  impl->producerRing.store(impl->ring.get(), std::memory_order_release);
+  impl->stream = std::move(*stream);
+
+  return {{impl}};
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,116 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "DefaultDeviceCache.h"
+
+#include "AudioContext.h"
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+size_t DefaultDeviceCache::GetSlotIndex(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role) {
+  const size_t directionIndex
+    = (direction == AudioDeviceDirection::INPUT) ? 1 : 0;
+  const size_t roleIndex = (role == AudioDeviceRole::COMMUNICATION) ? 1 : 0;
+  return (directionIndex * RoleCount) + roleIndex;
+}
+
+const std::string* DefaultDeviceCache::Intern(std::string_view id) {
+  std::unique_lock lock(mInternMutex);
+  const auto it = mInterned.find(id);
+  if (it != mInterned.end()) {
+    return &*it;
+  }
+  return &*mInterned.emplace(id).first;
+}
+
+std::optional<std::string> DefaultDeviceCache::Get(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role) const {
+  const auto id
+    = mSlots[GetSlotIndex(direction, role)].load(std::memory_order_acquire);
+  if (!id) {
+    return std::nullopt;
+  }
+  return *id;
+}
+
+void DefaultDeviceCache::Set(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role,
+  std::string_view id) {
+  mSlots[GetSlotIndex(direction, role)].store(
+    Intern(id), std::memory_order_release);
+}
+
+void DefaultDeviceCache::SetIfEmpty(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role,
+  std::string_view id) {
+  const std::string* expected = nullptr;
+  mSlots[GetSlotIndex(direction, role)].compare_exchange_strong(
+    expected, Intern(id), std::memory_order_acq_rel);
+}
+
+void DefaultDeviceCache::Reset() {
+  for (auto& slot: mSlots) {
+    slot.store(nullptr, std::memory_order_release);
+  }
+}
+
+std::string AudioContext::GetDefaultAudioDeviceID(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role) const {
+  const auto cache = p->GetDefaultDeviceCache();
+  if (!cache) {
+    return GetNativeDefaultAudioDeviceID(direction, role);
+  }
+
+  auto cached = cache->Get(direction, role);
+  if (cached) {
+    return *cached;
+  }
+
+  const auto id = GetNativeDefaultAudioDeviceID(direction, role);
+  cache->SetIfEmpty(direction, role, id);
+  return id;
+}
+
+void AudioContext::SetDefaultAudioDeviceID(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role,
+  const std::string& deviceID) {
+  const auto cache = p->GetDefaultDeviceCache();
+  if (cache && cache->Get(direction, role) == deviceID) {
+    return;
+  }
+  if (!SetNativeDefaultAudioDeviceID(direction, role, deviceID)) {
+    return;
+  }
+
+  // Don't wait for the notification, otherwise an immediate
+  // `GetDefaultAudioDeviceID()` would return the old device
+  if (cache) {
+    cache->Set(direction, role, deviceID);
+  }
+}
+
+std::string GetDefaultAudioDeviceID(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role) {
+  return GetDefaultAudioContext().GetDefaultAudioDeviceID(direction, role);
+}
+
+void SetDefaultAudioDeviceID(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role,
+  const std::string& deviceID) {
+  GetDefaultAudioContext().SetDefaultAudioDeviceID(direction, role, deviceID);
+}
+
+}// namespace FredEmmott::Audio
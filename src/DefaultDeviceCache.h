@@ -0,0 +1,71 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace FredEmmott::Audio {
+
+/* Last-known default device for each (direction, role) pair.
+ *
+ * This is kept up to date by the platform backends from default-change
+ * notifications, so reads are an atomic load rather than a native query.
+ *
+ * IDs are interned in a set that is never pruned, so a published pointer
+ * stays valid for the lifetime of the cache; there are only ever a handful
+ * of distinct devices.
+ *
+ * Each `AudioContext` has its own cache.
+ */
+class DefaultDeviceCache final {
+ public:
+  DefaultDeviceCache() = default;
+  DefaultDeviceCache(const DefaultDeviceCache&) = delete;
+  DefaultDeviceCache& operator=(const DefaultDeviceCache&) = delete;
+
+  // Returns `std::nullopt` if nothing has been stored for this pair yet
+  std::optional<std::string> Get(AudioDeviceDirection, AudioDeviceRole) const;
+
+  // Store a value from a notification, or from a successful change
+  void Set(AudioDeviceDirection, AudioDeviceRole, std::string_view id);
+
+  /* Store the result of a native query, unless a notification has already
+   * populated this pair.
+   *
+   * The notification may have been delivered while the native query was in
+   * progress, in which case it is at least as new as the query result.
+   */
+  void SetIfEmpty(AudioDeviceDirection, AudioDeviceRole, std::string_view id);
+
+  // Forgets every stored value, so that the next `Get()` for each pair
+  // returns `std::nullopt`; interned IDs are kept
+  void Reset();
+
+ private:
+  static constexpr size_t DirectionCount = 2;
+  static constexpr size_t RoleCount = 2;
+
+  std::array<std::atomic<const std::string*>, DirectionCount * RoleCount>
+    mSlots {};
+
+  std::mutex mInternMutex;
+  std::set<std::string, std::less<>> mInterned;
+
+  static size_t GetSlotIndex(AudioDeviceDirection, AudioDeviceRole);
+  // Only allocates the first time an ID is seen
+  const std::string* Intern(std::string_view id);
+};
+
+}// namespace FredEmmott::Audio
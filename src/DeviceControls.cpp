@@ -0,0 +1,132 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include "AudioContext.h"
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+result<bool> AudioContext::IsAudioDeviceMuted(
+  const std::string& deviceID) const {
+  return p->mNativeCallGuard.Call<bool>(
+    deviceID, [deviceID]() { return IsNativeDeviceMuted(deviceID); });
+}
+
+result<void> AudioContext::MuteAudioDevice(const std::string& deviceID) {
+  return p->mNativeCallGuard.Call<void>(
+    deviceID, [deviceID]() { return MuteNativeDevice(deviceID); });
+}
+
+result<void> AudioContext::UnmuteAudioDevice(const std::string& deviceID) {
+  return p->mNativeCallGuard.Call<void>(
+    deviceID, [deviceID]() { return UnmuteNativeDevice(deviceID); });
+}
+
+result<VolumeRange> AudioContext::GetDeviceVolumeRange(
+  const std::string& deviceID) const {
+  return p->mNativeCallGuard.Call<VolumeRange>(
+    deviceID, [deviceID]() { return GetNativeDeviceVolumeRange(deviceID); });
+}
+
+result<Volume> AudioContext::GetDeviceVolume(
+  const std::string& deviceID) const {
+  return p->mNativeCallGuard.Call<Volume>(
+    deviceID, [deviceID]() { return GetNativeDeviceVolume(deviceID); });
+}
+
+result<void> AudioContext::SetDeviceVolumeScalar(
+  const std::string& deviceID,
+  float value) {
+  return p->mNativeCallGuard.Call<void>(deviceID, [deviceID, value]() {
+    return SetNativeDeviceVolumeScalar(deviceID, value);
+  });
+}
+
+result<void> AudioContext::SetDeviceVolumeDecibels(
+  const std::string& deviceID,
+  float value) {
+  return p->mNativeCallGuard.Call<void>(deviceID, [deviceID, value]() {
+    return SetNativeDeviceVolumeDecibels(deviceID, value);
+  });
+}
+
+result<void> AudioContext::IncreaseDeviceVolume(const std::string& deviceID) {
+  return p->mNativeCallGuard.Call<void>(
+    deviceID, [deviceID]() { return IncreaseNativeDeviceVolume(deviceID); });
+}
+
+result<void> AudioContext::DecreaseDeviceVolume(const std::string& deviceID) {
+  return p->mNativeCallGuard.Call<void>(
+    deviceID, [deviceID]() { return DecreaseNativeDeviceVolume(deviceID); });
+}
+
+result<std::vector<float>> AudioContext::GetDeviceChannelVolumes(
+  const std::string& deviceID) const {
+  return p->mNativeCallGuard.Call<std::vector<float>>(
+    deviceID, [deviceID]() { return GetNativeDeviceChannelVolumes(deviceID); });
+}
+
+result<void> AudioContext::SetDeviceChannelVolumes(
+  const std::string& deviceID,
+  std::span<const float> volumes) {
+  // Copied, as the call may outlive the caller's buffer
+  return p->mNativeCallGuard.Call<void>(
+    deviceID,
+    [deviceID, volumes = std::vector<float>(volumes.begin(), volumes.end())]() {
+      return SetNativeDeviceChannelVolumes(deviceID, volumes);
+    });
+}
+
+result<bool> IsAudioDeviceMuted(const std::string& deviceID) {
+  return GetDefaultAudioContext().IsAudioDeviceMuted(deviceID);
+}
+
+result<void> MuteAudioDevice(const std::string& deviceID) {
+  return GetDefaultAudioContext().MuteAudioDevice(deviceID);
+}
+
+result<void> UnmuteAudioDevice(const std::string& deviceID) {
+  return GetDefaultAudioContext().UnmuteAudioDevice(deviceID);
+}
+
+result<VolumeRange> GetDeviceVolumeRange(const std::string& deviceID) {
+  return GetDefaultAudioContext().GetDeviceVolumeRange(deviceID);
+}
+
+result<Volume> GetDeviceVolume(const std::string& deviceID) {
+  return GetDefaultAudioContext().GetDeviceVolume(deviceID);
+}
+
+result<void> SetDeviceVolumeScalar(const std::string& deviceID, float value) {
+  return GetDefaultAudioContext().SetDeviceVolumeScalar(deviceID, value);
+}
+
+result<void> SetDeviceVolumeDecibels(const std::string& deviceID, float value) {
+  return GetDefaultAudioContext().SetDeviceVolumeDecibels(deviceID, value);
+}
+
+result<void> IncreaseDeviceVolume(const std::string& deviceID) {
+  return GetDefaultAudioContext().IncreaseDeviceVolume(deviceID);
+}
+
+result<void> DecreaseDeviceVolume(const std::string& deviceID) {
+  return GetDefaultAudioContext().DecreaseDeviceVolume(deviceID);
+}
+
+result<std::vector<float>> GetDeviceChannelVolumes(
+  const std::string& deviceID) {
+  return GetDefaultAudioContext().GetDeviceChannelVolumes(deviceID);
+}
+
+result<void> SetDeviceChannelVolumes(
+  const std::string& deviceID,
+  std::span<const float> volumes) {
+  return GetDefaultAudioContext().SetDeviceChannelVolumes(deviceID, volumes);
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,95 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "AudioContext.h"
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+result<std::map<std::string, AudioDeviceInfo>> GetAudioDeviceListSerially(
+  AudioDeviceDirection direction) {
+  std::map<std::string, AudioDeviceInfo> out;
+  for (const auto& id: GetNativeDeviceIDs(direction)) {
+    auto info = GetNativeDeviceInfo(direction, id);
+    if (info) {
+      out.emplace(id, std::move(*info));
+    }
+  }
+  return out;
+}
+
+}// namespace
+
+std::map<std::string, AudioDeviceInfo> AudioContext::Impl::GetAudioDeviceList(
+  AudioDeviceDirection direction) {
+  if (mNativeCallGuard.IsUsingBackendThread()) {
+    // The workers can't be used, as native objects must not be shared; this
+    // is quarantined as a whole, rather than per device
+    auto list = mNativeCallGuard.Call<std::map<std::string, AudioDeviceInfo>>(
+      {}, [direction]() { return GetAudioDeviceListSerially(direction); });
+    if (!list) {
+      return {};
+    }
+    return std::move(*list);
+  }
+
+  const auto ids = GetNativeDeviceIDs(direction);
+  const std::chrono::milliseconds timeout {
+    mEnumerationTimeout.load(std::memory_order_relaxed)};
+  // Every call starts immediately, as the guard starts threads on demand, so
+  // a shared deadline is a per-device timeout
+  const auto deadline = timeout == timeout.zero()
+    ? std::chrono::steady_clock::time_point::max()
+    : std::chrono::steady_clock::now() + timeout;
+
+  // Devices that are still hung from an earlier enumeration fail here
+  // without another call
+  std::vector<std::shared_ptr<NativeCallGuard::PendingCall<AudioDeviceInfo>>>
+    calls;
+  calls.reserve(ids.size());
+  for (const auto& id: ids) {
+    calls.push_back(mNativeCallGuard.Start<AudioDeviceInfo>(
+      id, [direction, id]() { return GetNativeDeviceInfo(direction, id); }));
+  }
+
+  std::map<std::string, AudioDeviceInfo> out;
+  for (const auto& call: calls) {
+    auto info = mNativeCallGuard.Wait(call, deadline);
+    if (info) {
+      out.emplace(info->id, std::move(*info));
+    }
+  }
+  return out;
+}
+
+std::map<std::string, AudioDeviceInfo> AudioContext::GetAudioDeviceList(
+  AudioDeviceDirection direction) const {
+  return p->GetAudioDeviceList(direction);
+}
+
+void AudioContext::SetDeviceEnumerationTimeout(
+  std::chrono::milliseconds timeout) {
+  p->mEnumerationTimeout.store(timeout.count(), std::memory_order_relaxed);
+}
+
+std::map<std::string, AudioDeviceInfo> GetAudioDeviceList(
+  AudioDeviceDirection direction) {
+  return GetDefaultAudioContext().GetAudioDeviceList(direction);
+}
+
+void SetDeviceEnumerationTimeout(std::chrono::milliseconds timeout) {
+  GetDefaultAudioContext().SetDeviceEnumerationTimeout(timeout);
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,257 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "DeviceStateWaiters.h"
+
+#include <vector>
+
+#include "AudioDeviceEventHub.h"
+
+namespace FredEmmott::Audio {
+
+result<void> DeviceStateWaiters::Wait(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout) {
+  Subscribe();
+  std::unique_lock lock(mMutex);
+  auto& device = Acquire(id);
+  const auto matched = device.mChanged.wait_for(
+    lock, timeout, [&device, state]() { return device.mState == state; });
+  const auto released = Release(id);
+  lock.unlock();
+  if (!matched) {
+    return {unexpect, Error::TIMEOUT};
+  }
+  return {};
+}
+
+void DeviceStateWaiters::Wait(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout,
+  Callback callback) {
+  Subscribe();
+  std::unique_lock lock(mMutex);
+  // Completed by the refresh that `Acquire()` schedules, or a later one,
+  // even if the state is already known
+  auto& device = Acquire(id);
+  const auto waiterID = mNextAsyncWaiterID++;
+  device.mAsyncWaiters.emplace(
+    waiterID,
+    AsyncWaiter {
+      .mState = state,
+      .mCallback = std::move(callback),
+      .mTimeout = GetTimerWheel()->Schedule(
+        TimerWheel::Clock::now() + timeout,
+        [this, id, waiterID]() { OnTimeout(id, waiterID); }),
+    });
+}
+
+void DeviceStateWaiters::Subscribe() {
+  std::call_once(mSubscribeOnce, [this]() {
+    const auto hub = GetAudioDeviceEventHub();
+    if (!hub) {
+      return;
+    }
+    mHaveNotifications = true;
+    hub->Subscribe(
+      AudioDeviceEventFilter {
+        .kinds = {AudioDeviceEventKind::ADDED, AudioDeviceEventKind::REMOVED},
+      },
+      AudioDeviceEventHub::ViewCallback(
+        [this](const AudioDeviceEventView& event) { OnDeviceEvent(event); }));
+  });
+}
+
+DeviceStateWaiters::Device& DeviceStateWaiters::Acquire(const std::string& id) {
+  auto& device = mDevices.try_emplace(id).first->second;
+  ++device.mWaiterCount;
+  ScheduleRefresh(id, TimerWheel::Clock::now());
+  return device;
+}
+
+std::optional<NativeWatchHandle> DeviceStateWaiters::Release(
+  const std::string& id) {
+  const auto it = mDevices.find(id);
+  if (it == mDevices.end() || --it->second.mWaiterCount > 0) {
+    return std::nullopt;
+  }
+  auto watch = std::move(it->second.mWatch);
+  mDevices.erase(it);
+  return watch;
+}
+
+void DeviceStateWaiters::ScheduleRefresh(
+  std::string_view id,
+  TimerWheel::Clock::time_point due) {
+  const auto it = mDevices.find(id);
+  // Coalesces notifications, and waiters for the same device
+  if (it == mDevices.end() || it->second.mIsRefreshPending) {
+    return;
+  }
+  it->second.mIsRefreshPending = true;
+  GetTimerWheel()->Schedule(
+    due, [this, id = std::string(id)]() { Refresh(id); });
+}
+
+void DeviceStateWaiters::OnDeviceEvent(const AudioDeviceEventView& event) {
+  std::unique_lock lock(mMutex);
+  ScheduleRefresh(event.deviceID, TimerWheel::Clock::now());
+}
+
+void DeviceStateWaiters::Refresh(const std::string& id) {
+  bool needsWatch {};
+  {
+    std::unique_lock lock(mMutex);
+    const auto it = mDevices.find(id);
+    if (it == mDevices.end()) {
+      return;
+    }
+    // Cleared first, so that changes while querying trigger another refresh
+    it->second.mIsRefreshPending = false;
+    needsWatch = !(it->second.mWatch || it->second.mIsPolled);
+  }
+
+  // Added without `mMutex`, as the callback takes it. Before the query, so
+  // that a change during the query isn't missed.
+  std::optional<NativeWatchHandle> watch;
+  bool isPolled {false};
+  if (needsWatch) {
+    auto watched = WatchNativeDeviceInfo(id, [this, id]() {
+      std::unique_lock lock(mMutex);
+      ScheduleRefresh(id, TimerWheel::Clock::now());
+    });
+    if (watched) {
+      watch = std::move(*watched);
+    } else {
+      isPolled = true;
+    }
+  }
+
+  const auto state = GetAudioDeviceState(id);
+
+  std::vector<Callback> completed;
+  {
+    std::unique_lock lock(mMutex);
+    const auto it = mDevices.find(id);
+    if (it == mDevices.end()) {
+      return;
+    }
+    auto& device = it->second;
+    if (watch) {
+      device.mWatch = std::move(watch);
+    }
+    device.mIsPolled |= isPolled;
+    device.mState = state;
+    device.mChanged.notify_all();
+
+    std::erase_if(device.mAsyncWaiters, [&completed, state](auto& entry) {
+      auto& waiter = entry.second;
+      if (waiter.mState != state) {
+        return false;
+      }
+      // This is the timer thread, so the timeout can't already be running
+      GetTimerWheel()->Cancel(waiter.mTimeout);
+      completed.push_back(std::move(waiter.mCallback));
+      return true;
+    });
+    device.mWaiterCount -= completed.size();
+
+    if (device.mWaiterCount == 0) {
+      watch = std::move(device.mWatch);
+      mDevices.erase(it);
+    } else if (!mHaveNotifications || device.mIsPolled) {
+      ScheduleRefresh(id, TimerWheel::Clock::now() + PollInterval);
+    }
+  }
+  // Without `mMutex`, and before the callbacks run
+  watch.reset();
+
+  for (const auto& callback: completed) {
+    callback({});
+  }
+}
+
+void DeviceStateWaiters::OnTimeout(const std::string& id, uint64_t waiterID) {
+  Callback callback;
+  std::optional<NativeWatchHandle> released;
+  {
+    std::unique_lock lock(mMutex);
+    const auto device = mDevices.find(id);
+    if (device == mDevices.end()) {
+      return;
+    }
+    const auto waiter = device->second.mAsyncWaiters.find(waiterID);
+    if (waiter == device->second.mAsyncWaiters.end()) {
+      return;
+    }
+    callback = std::move(waiter->second.mCallback);
+    device->second.mAsyncWaiters.erase(waiter);
+    released = Release(id);
+  }
+  released.reset();
+  callback({unexpect, Error::TIMEOUT});
+}
+
+DeviceStateWaiters* GetDeviceStateWaiters() {
+  // Intentionally leaked: timers may still be pending during static
+  // destruction
+  static auto instance = new DeviceStateWaiters();
+  return instance;
+}
+
+result<void> WaitForDeviceState(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout) {
+  return GetDeviceStateWaiters()->Wait(id, state, timeout);
+}
+
+void WaitForDeviceState(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout,
+  std::function<void(result<void>)> onComplete) {
+  GetDeviceStateWaiters()->Wait(id, state, timeout, std::move(onComplete));
+}
+
+AudioDeviceStateAwaitable::AudioDeviceStateAwaitable(
+  std::string id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout)
+  : mID(std::move(id)),
+    mState(state),
+    mTimeout(timeout) {
+}
+
+void AudioDeviceStateAwaitable::await_suspend(std::coroutine_handle<> handle) {
+  // Nothing may be touched after this call, as the coroutine may already
+  // have been resumed and destroyed this awaitable
+  GetDeviceStateWaiters()->Wait(
+    mID, mState, mTimeout, [this, handle](result<void> waited) {
+      if (!waited) {
+        mError = waited.error();
+      }
+      handle.resume();
+    });
+}
+
+result<void> AudioDeviceStateAwaitable::await_resume() const {
+  if (mError) {
+    return {unexpect, *mError};
+  }
+  return {};
+}
+
+AudioDeviceStateAwaitable AwaitDeviceState(
+  const std::string& id,
+  AudioDeviceState state,
+  std::chrono::milliseconds timeout) {
+  return {id, state, timeout};
+}
+
+}// namespace FredEmmott::Audio
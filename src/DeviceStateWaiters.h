@@ -0,0 +1,107 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "NativeDevices.h"
+#include "TimerWheel.h"
+
+namespace FredEmmott::Audio {
+
+/* Tracks the state of every device that something is waiting for.
+ *
+ * A device's state is only queried on the timer thread, once for each plug
+ * or state notification and once when it starts being waited for; as those
+ * queries are serialized, the last one to finish is always the most recent.
+ * Synchronous waiters share a condition variable per device, and
+ * asynchronous waiters are invoked from the timer thread.
+ *
+ * Plug notifications from the hub don't cover every state change, e.g.
+ * jacks on macOS, so each device is also watched with
+ * `WatchNativeDeviceInfo()` while it has waiters; devices that can't be
+ * watched are polled instead.
+ */
+class DeviceStateWaiters final {
+ public:
+  using Callback = std::function<void(result<void>)>;
+
+  DeviceStateWaiters() = default;
+  DeviceStateWaiters(const DeviceStateWaiters&) = delete;
+  DeviceStateWaiters& operator=(const DeviceStateWaiters&) = delete;
+
+  result<void> Wait(
+    const std::string& id,
+    AudioDeviceState,
+    std::chrono::milliseconds timeout);
+  void Wait(
+    const std::string& id,
+    AudioDeviceState,
+    std::chrono::milliseconds timeout,
+    Callback);
+
+ private:
+  // Used if native notifications are unavailable, or the device can't be
+  // watched
+  static constexpr auto PollInterval = std::chrono::milliseconds(250);
+
+  struct AsyncWaiter {
+    AudioDeviceState mState {};
+    Callback mCallback;
+    TimerWheel::TimerID mTimeout {};
+  };
+
+  struct Device {
+    // Synchronous and asynchronous; the entry is removed when this is 0
+    size_t mWaiterCount {};
+    std::optional<AudioDeviceState> mState;
+    bool mIsRefreshPending {false};
+    std::condition_variable mChanged;
+    std::map<uint64_t, AsyncWaiter> mAsyncWaiters;
+    // Added by the first refresh; must be destroyed without `mMutex`, as
+    // its callback takes it
+    std::optional<NativeWatchHandle> mWatch;
+    bool mIsPolled {false};
+  };
+
+  std::once_flag mSubscribeOnce;
+  // Only written in `mSubscribeOnce`
+  bool mHaveNotifications {false};
+
+  std::mutex mMutex;
+  uint64_t mNextAsyncWaiterID {1};
+  std::map<std::string, Device, std::less<>> mDevices;
+
+  void Subscribe();
+
+  // `mMutex` must be held for all of these
+  Device& Acquire(const std::string& id);
+  // Returns the device's watch if this was the last waiter, to be
+  // destroyed once `mMutex` is released
+  [[nodiscard]] std::optional<NativeWatchHandle> Release(
+    const std::string& id);
+  void ScheduleRefresh(std::string_view id, TimerWheel::Clock::time_point);
+
+  void OnDeviceEvent(const AudioDeviceEventView&);
+  void Refresh(const std::string& id);
+  void OnTimeout(const std::string& id, uint64_t waiterID);
+};
+
+// Process-wide instance
+DeviceStateWaiters* GetDeviceStateWaiters();
+
+}// namespace FredEmmott::Audio
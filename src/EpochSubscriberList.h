@@ -0,0 +1,227 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FredEmmott::Audio {
+
+/* A list of subscribers that can be iterated without locks, using
+ * epoch-based reclamation.
+ *
+ * - `ForEach()` never blocks or allocates; it is safe to call from native
+ *   notification threads
+ * - `Add()` and `Remove()` are serialized with each other, but never wait
+ *   for readers to finish with a snapshot; they publish a new snapshot, and
+ *   the previous snapshot is freed by a later writer once no reader can
+ *   still be using it
+ * - once `Remove()` returns, the subscriber is not being invoked on any
+ *   other thread, and will not be invoked again. It waits for invocations
+ *   that have already started, so it must not be called while holding a
+ *   lock that the subscriber may take.
+ *
+ * Subscribers may call `Add()` or `Remove()` from inside `ForEach()`; a
+ * subscriber may remove itself, in which case `Remove()` doesn't wait for
+ * the invocation that it was called from.
+ */
+template <class T>
+class EpochSubscriberList final {
+ public:
+  using SubscriptionID = uint64_t;
+
+  EpochSubscriberList() = default;
+  EpochSubscriberList(const EpochSubscriberList&) = delete;
+  EpochSubscriberList& operator=(const EpochSubscriberList&) = delete;
+
+  ~EpochSubscriberList() {
+    delete mCurrent.load();
+  }
+
+  SubscriptionID Add(T value) {
+    std::unique_lock lock(mWriterMutex);
+    const auto id = mNextID++;
+    auto next = std::make_unique<Snapshot>(*mCurrent.load());
+    next->push_back(std::make_shared<Entry>(id, std::move(value)));
+    Publish(std::move(next));
+    return id;
+  }
+
+  void Remove(SubscriptionID id) {
+    std::shared_ptr<Entry> removed;
+    {
+      std::unique_lock lock(mWriterMutex);
+      auto next = std::make_unique<Snapshot>(*mCurrent.load());
+      const auto it = std::ranges::find_if(
+        *next, [id](const auto& entry) { return entry->mID == id; });
+      if (it == next->end()) {
+        return;
+      }
+      removed = *it;
+      next->erase(it);
+      removed->mActive.store(false);
+      Publish(std::move(next));
+    }
+
+    // Not holding `mWriterMutex`, so the invocations we're waiting for can
+    // call `Add()` or `Remove()`
+    size_t onThisThread = 0;
+    for (auto frame = tInvocations; frame; frame = frame->mParent) {
+      if (frame->mEntry == removed.get()) {
+        ++onThisThread;
+      }
+    }
+    while (removed->mInFlight.load() > onThisThread) {
+      std::this_thread::yield();
+    }
+  }
+
+  bool IsEmpty() const {
+    ReadGuard guard(this);
+    return guard.mSnapshot->empty();
+  }
+
+  // Invokes `f(const T&)` for each active subscriber
+  template <class F>
+  void ForEach(F&& f) const {
+    ReadGuard guard(this);
+    for (const auto& entry: *guard.mSnapshot) {
+      Invocation invocation(entry.get());
+      // Sequentially consistent with `Remove()`: either this sees that the
+      // entry is inactive, or `Remove()` sees the invocation, and waits
+      if (entry->mActive.load()) {
+        f(entry->mValue);
+      }
+    }
+  }
+
+ private:
+  // More than the number of threads that will concurrently deliver native
+  // notifications; if exceeded, readers yield until a slot is free
+  static constexpr size_t ReaderSlotCount = 64;
+  static constexpr uint64_t InactiveReader = 0;
+
+  struct Entry {
+    Entry(SubscriptionID id, T&& value) : mID(id), mValue(std::move(value)) {
+    }
+
+    const SubscriptionID mID;
+    std::atomic<bool> mActive {true};
+    // Invocations in progress, including ones that haven't yet checked
+    // `mActive`
+    mutable std::atomic<size_t> mInFlight {0};
+    const T mValue;
+  };
+  using Snapshot = std::vector<std::shared_ptr<Entry>>;
+
+  // The entries this thread is invoking, innermost first
+  struct InvocationFrame {
+    const Entry* mEntry;
+    const InvocationFrame* mParent;
+  };
+  static inline thread_local const InvocationFrame* tInvocations {nullptr};
+
+  class Invocation final {
+   public:
+    explicit Invocation(const Entry* entry) : mFrame {entry, tInvocations} {
+      entry->mInFlight.fetch_add(1);
+      tInvocations = &mFrame;
+    }
+
+    ~Invocation() {
+      tInvocations = mFrame.mParent;
+      mFrame.mEntry->mInFlight.fetch_sub(1);
+    }
+
+    Invocation(const Invocation&) = delete;
+    Invocation& operator=(const Invocation&) = delete;
+
+   private:
+    const InvocationFrame mFrame;
+  };
+
+  struct RetiredSnapshot {
+    // Safe to free once no reader has an epoch <= this
+    uint64_t mEpoch;
+    std::unique_ptr<const Snapshot> mSnapshot;
+  };
+
+  // Epochs start at 1, as 0 marks an unused reader slot
+  std::atomic<uint64_t> mEpoch {1};
+  std::atomic<const Snapshot*> mCurrent {new Snapshot()};
+  mutable std::array<std::atomic<uint64_t>, ReaderSlotCount> mReaders {};
+
+  std::mutex mWriterMutex;
+  SubscriptionID mNextID {1};
+  std::vector<RetiredSnapshot> mRetired;
+
+  class ReadGuard final {
+   public:
+    ReadGuard(const EpochSubscriberList* list) {
+      // Any slot will do; start with one that is likely to be unique to
+      // this thread to reduce contention
+      const auto start
+        = std::hash<std::thread::id> {}(std::this_thread::get_id());
+      for (size_t i = 0;; ++i) {
+        auto& reader = list->mReaders[(start + i) % ReaderSlotCount];
+        auto expected = InactiveReader;
+        if (reader.compare_exchange_strong(expected, list->mEpoch.load())) {
+          mReader = &reader;
+          break;
+        }
+        if (i > 0 && (i % ReaderSlotCount) == 0) {
+          std::this_thread::yield();
+        }
+      }
+      mSnapshot = list->mCurrent.load();
+    }
+
+    ~ReadGuard() {
+      mReader->store(InactiveReader, std::memory_order_release);
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    const Snapshot* mSnapshot {nullptr};
+
+   private:
+    std::atomic<uint64_t>* mReader {nullptr};
+  };
+
+  // Requires `mWriterMutex`
+  void Publish(std::unique_ptr<const Snapshot> next) {
+    const auto previous = mCurrent.exchange(next.release());
+    // Readers that see the new epoch are guaranteed to see the new snapshot
+    const auto retiredAt = mEpoch.fetch_add(1);
+    mRetired.push_back({retiredAt, std::unique_ptr<const Snapshot>(previous)});
+    Reclaim();
+  }
+
+  // Requires `mWriterMutex`
+  void Reclaim() {
+    auto oldestReader = UINT64_MAX;
+    for (const auto& reader: mReaders) {
+      const auto epoch = reader.load();
+      if (epoch != InactiveReader && epoch < oldestReader) {
+        oldestReader = epoch;
+      }
+    }
+    std::erase_if(mRetired, [oldestReader](const auto& retired) {
+      return retired.mEpoch < oldestReader;
+    });
+  }
+};
+
+}// namespace FredEmmott::Audio
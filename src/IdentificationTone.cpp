@@ -0,0 +1,133 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "NativeAudioStreams.h"
+#include "TimerWheel.h"
+#include "ToneGenerator.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+/* Plays tones on one device, keeping its render stream open between tones.
+ *
+ * The stream is stopped shortly after each tone, and closed once it has been
+ * idle for `IdleTimeout`. Both are done from the timer thread, and ignored if
+ * another tone has been started since they were scheduled.
+ */
+class IdentificationTonePlayer final {
+ public:
+  // Allow for audio still buffered when the generator finishes
+  static constexpr auto StopDelay = std::chrono::milliseconds(250);
+  static constexpr auto IdleTimeout = std::chrono::seconds(30);
+
+  explicit IdentificationTonePlayer(const std::string& deviceID)
+    : mDeviceID(deviceID) {
+  }
+
+  result<void> Play(const IdentificationTonePattern& pattern) {
+    std::unique_lock lock(mMutex);
+    const auto generation = ++mGeneration;
+
+    // A pooled stream may have been invalidated, e.g. by a format change, so
+    // if it fails to start, try again with a new stream
+    if (mStream) {
+      mStream->Stop();
+      auto started = Start(pattern);
+      if (!started) {
+        mStream.reset();
+      }
+    }
+    if (!mStream) {
+      auto stream = OpenNativeRenderStream(
+        mDeviceID, [this](const AudioRenderBufferView& buffer) {
+          mGenerator.Render(buffer);
+        });
+      if (!stream) {
+        return {unexpect, stream.error()};
+      }
+      mStream = std::move(*stream);
+      auto started = Start(pattern);
+      if (!started) {
+        mStream.reset();
+        return {unexpect, started.error()};
+      }
+    }
+
+    const auto period = pattern.beepDuration + pattern.gap;
+    const auto duration = (period * pattern.beepCount) - pattern.gap;
+    GetTimerWheel()->Schedule(
+      TimerWheel::Clock::now() + duration + StopDelay,
+      [this, generation]() { Stop(generation); });
+    return {};
+  }
+
+ private:
+  const std::string mDeviceID;
+
+  std::mutex mMutex;
+  uint64_t mGeneration {};
+  // Only used by the render thread while `mStream` is started
+  ToneGenerator mGenerator;
+  // Declared last so that it's destroyed first, as it references
+  // `mGenerator`
+  std::unique_ptr<NativeRenderStream> mStream;
+
+  // Called with `mMutex` held, and `mStream` stopped
+  result<void> Start(const IdentificationTonePattern& pattern) {
+    mGenerator.Reset(pattern, mStream->GetFormat().sampleRate);
+    return mStream->Start();
+  }
+
+  void Stop(uint64_t generation) {
+    std::unique_lock lock(mMutex);
+    if (generation != mGeneration || !mStream) {
+      return;
+    }
+    mStream->Stop();
+    GetTimerWheel()->Schedule(
+      TimerWheel::Clock::now() + IdleTimeout,
+      [this, generation]() { Close(generation); });
+  }
+
+  void Close(uint64_t generation) {
+    std::unique_lock lock(mMutex);
+    if (generation == mGeneration) {
+      mStream.reset();
+    }
+  }
+};
+
+IdentificationTonePlayer* GetIdentificationTonePlayer(
+  const std::string& deviceID) {
+  static std::mutex sMutex;
+  // Intentionally leaked, so that timer callbacks can always use the players
+  static auto sPlayers
+    = new std::map<std::string, std::unique_ptr<IdentificationTonePlayer>>();
+
+  std::unique_lock lock(sMutex);
+  auto& player = (*sPlayers)[deviceID];
+  if (!player) {
+    player = std::make_unique<IdentificationTonePlayer>(deviceID);
+  }
+  return player.get();
+}
+
+}// namespace
+
+result<void> PlayIdentificationTone(
+  const std::string& deviceID,
+  const IdentificationTonePattern& pattern) {
+  return GetIdentificationTonePlayer(deviceID)->Play(pattern);
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,193 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "LevelKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+  || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIODEVICELIB_LEVELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define AUDIODEVICELIB_LEVELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+constexpr float Int16Scale = 1.0f / 32768;
+
+float ToFloat(float sample) {
+  return sample;
+}
+
+float ToFloat(int16_t sample) {
+  return sample * Int16Scale;
+}
+
+template <class T>
+void AccumulateScalar(
+  std::span<const T> samples,
+  size_t offset,
+  uint16_t channels,
+  std::span<float> peaks,
+  std::span<float> sumSquares) {
+  for (size_t i = offset; i < samples.size(); ++i) {
+    const auto channel = i % channels;
+    const auto value = ToFloat(samples[i]);
+    peaks[channel] = std::max(peaks[channel], std::abs(value));
+    sumSquares[channel] += value * value;
+  }
+}
+
+#if defined(AUDIODEVICELIB_LEVELS_SSE2)
+#define AUDIODEVICELIB_LEVELS_SIMD
+using Vector = __m128;
+
+Vector LoadFloats(const float* samples) {
+  return _mm_loadu_ps(samples);
+}
+
+// Loads 8 samples
+void LoadInt16s(const int16_t* samples, Vector& low, Vector& high) {
+  const auto packed
+    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples));
+  // Sign-extend by unpacking into the high half, then shifting down
+  const auto low32 = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+  const auto high32 = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+  const auto scale = _mm_set1_ps(Int16Scale);
+  low = _mm_mul_ps(_mm_cvtepi32_ps(low32), scale);
+  high = _mm_mul_ps(_mm_cvtepi32_ps(high32), scale);
+}
+
+class Lanes final {
+ public:
+  void Add(Vector value) {
+    const auto abs = _mm_and_ps(
+      value, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+    mPeaks = _mm_max_ps(mPeaks, abs);
+    mSumSquares = _mm_add_ps(mSumSquares, _mm_mul_ps(value, value));
+  }
+
+  void Store(float* peaks, float* sumSquares) const {
+    _mm_storeu_ps(peaks, mPeaks);
+    _mm_storeu_ps(sumSquares, mSumSquares);
+  }
+
+ private:
+  Vector mPeaks {_mm_setzero_ps()};
+  Vector mSumSquares {_mm_setzero_ps()};
+};
+#elif defined(AUDIODEVICELIB_LEVELS_NEON)
+#define AUDIODEVICELIB_LEVELS_SIMD
+using Vector = float32x4_t;
+
+Vector LoadFloats(const float* samples) {
+  return vld1q_f32(samples);
+}
+
+// Loads 8 samples
+void LoadInt16s(const int16_t* samples, Vector& low, Vector& high) {
+  const auto packed = vld1q_s16(samples);
+  const auto low32 = vmovl_s16(vget_low_s16(packed));
+  const auto high32 = vmovl_s16(vget_high_s16(packed));
+  low = vmulq_n_f32(vcvtq_f32_s32(low32), Int16Scale);
+  high = vmulq_n_f32(vcvtq_f32_s32(high32), Int16Scale);
+}
+
+class Lanes final {
+ public:
+  void Add(Vector value) {
+    mPeaks = vmaxq_f32(mPeaks, vabsq_f32(value));
+    mSumSquares = vmlaq_f32(mSumSquares, value, value);
+  }
+
+  void Store(float* peaks, float* sumSquares) const {
+    vst1q_f32(peaks, mPeaks);
+    vst1q_f32(sumSquares, mSumSquares);
+  }
+
+ private:
+  Vector mPeaks {vdupq_n_f32(0)};
+  Vector mSumSquares {vdupq_n_f32(0)};
+};
+#endif
+
+#ifdef AUDIODEVICELIB_LEVELS_SIMD
+constexpr size_t LaneCount = 4;
+
+// Lane `i` always holds samples for channel `i % channels`, as the channel
+// count divides the lane count
+void Fold(
+  const Lanes& lanes,
+  uint16_t channels,
+  std::span<float> peaks,
+  std::span<float> sumSquares) {
+  std::array<float, LaneCount> lanePeaks;
+  std::array<float, LaneCount> laneSumSquares;
+  lanes.Store(lanePeaks.data(), laneSumSquares.data());
+  for (size_t i = 0; i < LaneCount; ++i) {
+    const auto channel = i % channels;
+    peaks[channel] = std::max(peaks[channel], lanePeaks[i]);
+    sumSquares[channel] += laneSumSquares[i];
+  }
+}
+#endif
+
+}// namespace
+
+void AccumulateLevels(
+  std::span<const float> interleaved,
+  uint16_t channels,
+  std::span<float> peaks,
+  std::span<float> sumSquares) {
+  if (channels == 0) {
+    return;
+  }
+  size_t i = 0;
+#ifdef AUDIODEVICELIB_LEVELS_SIMD
+  if (LaneCount % channels == 0) {
+    Lanes lanes;
+    for (; i + LaneCount <= interleaved.size(); i += LaneCount) {
+      lanes.Add(LoadFloats(&interleaved[i]));
+    }
+    Fold(lanes, channels, peaks, sumSquares);
+  }
+#endif
+  AccumulateScalar(interleaved, i, channels, peaks, sumSquares);
+}
+
+void AccumulateLevels(
+  std::span<const int16_t> interleaved,
+  uint16_t channels,
+  std::span<float> peaks,
+  std::span<float> sumSquares) {
+  if (channels == 0) {
+    return;
+  }
+  size_t i = 0;
+#ifdef AUDIODEVICELIB_LEVELS_SIMD
+  if (LaneCount % channels == 0) {
+    Lanes lanes;
+    for (; i + (2 * LaneCount) <= interleaved.size(); i += 2 * LaneCount) {
+      Vector low;
+      Vector high;
+      LoadInt16s(&interleaved[i], low, high);
+      lanes.Add(low);
+      lanes.Add(high);
+    }
+    Fold(lanes, channels, peaks, sumSquares);
+  }
+#endif
+  AccumulateScalar(interleaved, i, channels, peaks, sumSquares);
+}
+
+}// namespace FredEmmott::Audio
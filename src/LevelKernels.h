@@ -0,0 +1,34 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace FredEmmott::Audio {
+
+/* Accumulates the per-channel peak absolute value and sum of squares of
+ * interleaved samples into `peaks` and `sumSquares`, which must have at least
+ * `channels` elements.
+ *
+ * `int16_t` samples are scaled to [-1, 1).
+ *
+ * Uses SSE2 or NEON when available and the channel count evenly divides the
+ * vector width (1, 2, or 4 channels); otherwise, this is scalar.
+ */
+void AccumulateLevels(
+  std::span<const float> interleaved,
+  uint16_t channels,
+  std::span<float> peaks,
+  std::span<float> sumSquares);
+void AccumulateLevels(
+  std::span<const int16_t> interleaved,
+  uint16_t channels,
+  std::span<float> peaks,
+  std::span<float> sumSquares);
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,125 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "LevelMeter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <span>
+
+#include "LevelKernels.h"
+
+namespace FredEmmott::Audio {
+
+LevelMeter::LevelMeter(const LevelMeterOptions& options) : mOptions(options) {
+  mSmoothedDecibels.fill(MinDecibels);
+}
+
+void LevelMeter::Process(const AudioBufferView& buffer) {
+  const auto channels = buffer.mChannels;
+  if (channels == 0 || channels > MaxInputChannels || buffer.mSampleRate == 0) {
+    return;
+  }
+
+  if (!(buffer.mIsSilent || buffer.mData == nullptr)) {
+    const auto samples = static_cast<size_t>(buffer.mFrames) * channels;
+    switch (buffer.mFormat) {
+      case AudioSampleFormat::FLOAT32:
+        AccumulateLevels(
+          {static_cast<const float*>(buffer.mData), samples},
+          channels,
+          mPeaks,
+          mSumSquares);
+        break;
+      case AudioSampleFormat::INT16:
+        AccumulateLevels(
+          {static_cast<const int16_t*>(buffer.mData), samples},
+          channels,
+          mPeaks,
+          mSumSquares);
+        break;
+    }
+  }
+  mFrames += buffer.mFrames;
+
+  const auto publishFrames = std::max<uint64_t>(
+    1,
+    (static_cast<uint64_t>(buffer.mSampleRate)
+     * mOptions.publishInterval.count())
+      / 1000);
+  if (mFrames >= publishFrames) {
+    Publish(channels, buffer.mSampleRate);
+  }
+}
+
+void LevelMeter::Publish(uint16_t channels, uint32_t sampleRate) {
+  const auto elapsed = static_cast<float>(mFrames) / sampleRate;
+  const auto decayTime
+    = std::chrono::duration<float>(mOptions.decayTime).count();
+  const auto decay = decayTime > 0 ? (60.0f * elapsed) / decayTime : 0.0f;
+
+  AudioLevels levels {
+    .channelCount = std::min<uint16_t>(channels, AudioLevels::MaxChannels),
+    .sequenceNumber = ++mSequenceNumber,
+  };
+  for (size_t i = 0; i < levels.channelCount; ++i) {
+    const auto peak = mPeaks[i];
+    const auto decibels
+      = peak > 0 ? std::max(MinDecibels, 20 * std::log10(peak)) : MinDecibels;
+    auto& smoothed = mSmoothedDecibels[i];
+    smoothed = std::max({decibels, smoothed - decay, MinDecibels});
+
+    levels.channels[i] = {
+      .peak = peak,
+      .rms = std::sqrt(mSumSquares[i] / static_cast<float>(mFrames)),
+      .smoothedDecibels = smoothed,
+    };
+  }
+  mLevels.Store(levels);
+
+  std::fill_n(mPeaks.begin(), channels, 0.0f);
+  std::fill_n(mSumSquares.begin(), channels, 0.0f);
+  mFrames = 0;
+}
+
+class LevelMeterHandle::Impl {
+ public:
+  std::unique_ptr<LevelMeter> meter;
+  // Declared last so that it's destroyed first, as it references `meter`
+  std::unique_ptr<NativeCaptureStream> stream;
+};
+
+LevelMeterHandle::LevelMeterHandle(const std::shared_ptr<Impl>& p) : p(p) {
+}
+
+LevelMeterHandle::~LevelMeterHandle() = default;
+
+AudioLevels LevelMeterHandle::GetLevels() const {
+  if (!p) {
+    return {};
+  }
+  return p->meter->GetLevels();
+}
+
+result<LevelMeterHandle> StartLevelMeter(
+  const std::string& deviceID,
+  const LevelMeterOptions& options) {
+  auto meter = std::make_unique<LevelMeter>(options);
+  auto stream = OpenNativeCaptureStream(
+    deviceID,
+    [meter = meter.get()](const AudioBufferView& buffer) {
+      meter->Process(buffer);
+    });
+  if (!stream) {
+    return {unexpect, stream.error()};
+  }
+
+  return {{std::make_shared<LevelMeterHandle::Impl>(
+    std::move(meter), std::move(*stream))}};
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,57 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <array>
+#include <cstdint>
+
+#include "NativeAudioStreams.h"
+#include "SeqLockSnapshot.h"
+
+namespace FredEmmott::Audio {
+
+/* Accumulates levels from captured buffers, and publishes them every
+ * `publishInterval` worth of frames.
+ *
+ * `Process()` must only be called from one thread at a time, and neither
+ * blocks nor allocates; `GetLevels()` may be called from any thread.
+ */
+class LevelMeter final {
+ public:
+  // dBFS reported for silence
+  static constexpr float MinDecibels = -100.0f;
+  // Buffers with more channels than this are ignored
+  static constexpr uint16_t MaxInputChannels = 64;
+
+  explicit LevelMeter(const LevelMeterOptions&);
+  LevelMeter(const LevelMeter&) = delete;
+  LevelMeter& operator=(const LevelMeter&) = delete;
+
+  void Process(const AudioBufferView&);
+
+  AudioLevels GetLevels() const {
+    return mLevels.Load();
+  }
+
+ private:
+  const LevelMeterOptions mOptions;
+
+  // Only used by `Process()`
+  std::array<float, MaxInputChannels> mPeaks {};
+  std::array<float, MaxInputChannels> mSumSquares {};
+  std::array<float, AudioLevels::MaxChannels> mSmoothedDecibels {};
+  uint32_t mFrames {};
+  uint64_t mSequenceNumber {};
+
+  SeqLockSnapshot<AudioLevels> mLevels;
+
+  void Publish(uint16_t channels, uint32_t sampleRate);
+};
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,90 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+namespace FredEmmott::Audio {
+
+/* An unbounded multiple-producer, single-consumer queue.
+ *
+ * `Push()` is wait-free: a single atomic exchange, then a store. `Pop()` is
+ * lock-free, but may briefly report the queue as empty while a `Push()` is
+ * between those two steps; callers that need to know whether anything is
+ * pending must count pushes themselves.
+ *
+ * Nodes are linked intrusively, starting from a permanent stub node, so the
+ * consumer never contends with producers except on the last node.
+ */
+template <class T>
+class MPSCQueue final {
+ public:
+  MPSCQueue() : mHead(&mStub), mTail(&mStub) {
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  ~MPSCQueue() {
+    while (Pop()) {
+    }
+  }
+
+  // Any thread
+  void Push(T value) {
+    Link(new Node {.mValue = std::move(value)});
+  }
+
+  // Consumer thread only
+  std::optional<T> Pop() {
+    auto tail = mTail;
+    auto next = tail->mNext.load(std::memory_order_acquire);
+    if (tail == &mStub) {
+      if (!next) {
+        return std::nullopt;
+      }
+      mTail = next;
+      tail = next;
+      next = next->mNext.load(std::memory_order_acquire);
+    }
+    if (!next) {
+      if (tail != mHead.load(std::memory_order_acquire)) {
+        // A producer is part-way through `Push()`
+        return std::nullopt;
+      }
+      // `tail` is the last node, so put the stub behind it before taking it
+      Link(&mStub);
+      next = tail->mNext.load(std::memory_order_acquire);
+      if (!next) {
+        return std::nullopt;
+      }
+    }
+    mTail = next;
+    std::unique_ptr<Node> node {tail};
+    return std::move(node->mValue);
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node*> mNext {nullptr};
+    T mValue {};
+  };
+
+  std::atomic<Node*> mHead;
+  Node* mTail;
+  Node mStub;
+
+  void Link(Node* node) {
+    node->mNext.store(nullptr, std::memory_order_relaxed);
+    const auto previous = mHead.exchange(node, std::memory_order_acq_rel);
+    previous->mNext.store(node, std::memory_order_release);
+  }
+};
+
+}// namespace FredEmmott::Audio
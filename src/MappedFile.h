@@ -0,0 +1,42 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace FredEmmott::Audio {
+
+/* A read-only view of an entire file.
+ *
+ * On Windows, the file can not be replaced while it is mapped, so views
+ * should be short-lived.
+ */
+class MappedFile final {
+ public:
+  // Returns `nullptr` if the file is missing, empty, or can't be mapped
+  static std::unique_ptr<MappedFile> Open(const std::filesystem::path&);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  std::span<const std::byte> GetData() const {
+    return {mData, mSize};
+  }
+
+ private:
+  MappedFile(const std::byte* data, size_t size) : mData(data), mSize(size) {
+  }
+
+  const std::byte* mData {nullptr};
+  size_t mSize {};
+};
+
+}// namespace FredEmmott::Audio
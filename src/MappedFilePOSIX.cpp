@@ -0,0 +1,42 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace FredEmmott::Audio {
+
+std::unique_ptr<MappedFile> MappedFile::Open(
+  const std::filesystem::path& path) {
+  const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  struct stat info {};
+  void* data = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  // The mapping keeps its own reference to the file
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(
+    static_cast<const std::byte*>(data), static_cast<size_t>(info.st_size)));
+}
+
+MappedFile::~MappedFile() {
+  munmap(const_cast<std::byte*>(mData), mSize);
+}
+
+}// namespace FredEmmott::Audio
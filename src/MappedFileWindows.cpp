@@ -0,0 +1,51 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "MappedFile.h"
+
+#include <Windows.h>
+#include <winrt/base.h>
+
+namespace FredEmmott::Audio {
+
+std::unique_ptr<MappedFile> MappedFile::Open(
+  const std::filesystem::path& path) {
+  const winrt::file_handle file {CreateFileW(
+    path.c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    nullptr)};
+  if (!file) {
+    return nullptr;
+  }
+
+  LARGE_INTEGER size {};
+  if (!GetFileSizeEx(file.get(), &size) || size.QuadPart <= 0) {
+    return nullptr;
+  }
+
+  // The view keeps its own references to the mapping and the file
+  const winrt::handle mapping {CreateFileMappingW(
+    file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+  if (!mapping) {
+    return nullptr;
+  }
+  const auto data = MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(
+    static_cast<const std::byte*>(data), static_cast<size_t>(size.QuadPart)));
+}
+
+MappedFile::~MappedFile() {
+  UnmapViewOfFile(mData);
+}
+
+}// namespace FredEmmott::Audio
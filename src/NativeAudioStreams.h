@@ -0,0 +1,114 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+// Interleaved samples, only valid for the duration of the callback
+struct AudioBufferView {
+  const void* mData {nullptr};
+  uint32_t mFrames {};
+  uint16_t mChannels {};
+  uint32_t mSampleRate {};
+  AudioSampleFormat mFormat {AudioSampleFormat::FLOAT32};
+  // `mData` should be treated as all zeroes
+  bool mIsSilent {false};
+};
+
+// Interleaved samples to be filled in, only valid for the duration of the
+// callback
+struct AudioRenderBufferView {
+  void* mData {nullptr};
+  uint32_t mFrames {};
+  uint16_t mChannels {};
+  uint32_t mSampleRate {};
+  AudioSampleFormat mFormat {AudioSampleFormat::FLOAT32};
+};
+
+class NativeCaptureStream {
+ public:
+  // Invoked on a backend-owned thread; must not block
+  using Callback = std::function<void(const AudioBufferView&)>;
+
+  virtual ~NativeCaptureStream() = default;
+
+  // The format of buffers passed to the callback
+  virtual AudioStreamFormat GetFormat() const = 0;
+};
+
+/* Implemented by each platform backend.
+ *
+ * Captures in the device's shared-mode format. For output devices, this
+ * captures what is being played (loopback), if the platform supports it.
+ *
+ * Once the stream has been destroyed, the callback will not be invoked again.
+ */
+result<std::unique_ptr<NativeCaptureStream>> OpenNativeCaptureStream(
+  const std::string& deviceID,
+  NativeCaptureStream::Callback);
+
+/* Implemented by each platform backend.
+ *
+ * Whether capture streams still receive the device's audio while it is
+ * muted, i.e. whether the mute is applied after audio is delivered to
+ * clients, rather than before.
+ */
+result<bool> IsNativeMuteAfterCapture(const std::string& deviceID);
+
+/* A playback stream that is opened once, then started and stopped.
+ *
+ * Opening does the expensive setup; `Start()` is cheap enough that streams
+ * can be kept open while idle, and started on demand.
+ */
+class NativeRenderStream {
+ public:
+  // Invoked on a backend-owned thread while the stream is started; must fill
+  // the entire buffer, and must not block
+  using Callback = std::function<void(const AudioRenderBufferView&)>;
+
+  virtual ~NativeRenderStream() = default;
+
+  // The format of buffers passed to the callback
+  virtual AudioStreamFormat GetFormat() const = 0;
+
+  // The callback may be invoked before this returns
+  virtual result<void> Start() = 0;
+  // Once this returns, the callback will not be invoked until the next
+  // `Start()`; buffered audio is discarded
+  virtual void Stop() = 0;
+};
+
+// Implemented by each platform backend; only supported for output devices
+result<std::unique_ptr<NativeRenderStream>> OpenNativeRenderStream(
+  const std::string& deviceID,
+  NativeRenderStream::Callback);
+
+/* Implemented by each platform backend; always queries the platform, so may
+ * be slow.
+ */
+result<AudioDeviceStreamProperties> QueryNativeStreamProperties(
+  const std::string& deviceID);
+
+/* Implemented by each platform backend.
+ *
+ * Invokes the callback on a backend-owned thread whenever the stream
+ * properties of the device may have changed, until the handle is destroyed.
+ */
+result<NativeWatchHandle> WatchNativeStreamProperties(
+  const std::string& deviceID,
+  std::function<void()>);
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,105 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "NativeCallGuard.h"
+
+#include <thread>
+
+#include "BackendThread.h"
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+thread_local const void* tCurrentNativeCallGuard {nullptr};
+}// namespace
+
+NativeCallGuard::~NativeCallGuard() {
+  {
+    std::unique_lock lock(mState->mMutex);
+    mState->mIsStopping = true;
+  }
+  mState->mWake.notify_all();
+}
+
+bool NativeCallGuard::IsWorkerThread() const {
+  return tCurrentNativeCallGuard == mState.get()
+    || mBackendThread.IsCurrentThread();
+}
+
+void NativeCallGuard::SetUseBackendThread(bool value) {
+  mUseBackendThread.store(value, std::memory_order_relaxed);
+}
+
+bool NativeCallGuard::IsUsingBackendThread() const {
+  return mUseBackendThread.load(std::memory_order_relaxed);
+}
+
+BackendThread* NativeCallGuard::GetBackendThread() {
+  return &mBackendThread;
+}
+
+void NativeCallGuard::SetTimeout(std::chrono::milliseconds timeout) {
+  mTimeout.store(timeout.count(), std::memory_order_relaxed);
+}
+
+bool NativeCallGuard::State::IsQuarantined(const std::string& deviceID) {
+  std::unique_lock lock(mMutex);
+  return mHungCalls.contains(deviceID);
+}
+
+void NativeCallGuard::State::Quarantine(const std::string& deviceID) {
+  std::unique_lock lock(mMutex);
+  ++mHungCalls[deviceID];
+}
+
+void NativeCallGuard::State::Release(const std::string& deviceID) {
+  std::unique_lock lock(mMutex);
+  const auto it = mHungCalls.find(deviceID);
+  if (it != mHungCalls.end() && --it->second == 0) {
+    mHungCalls.erase(it);
+  }
+}
+
+void NativeCallGuard::Enqueue(std::function<void()> task) {
+  std::unique_lock lock(mState->mMutex);
+  mState->mTasks.push_back(std::move(task));
+  if (mState->mTasks.size() > mState->mIdleThreads) {
+    std::thread([state = mState]() { Run(state); }).detach();
+    return;
+  }
+  mState->mWake.notify_one();
+}
+
+void NativeCallGuard::Run(const std::shared_ptr<State>& state) {
+  tCurrentNativeCallGuard = state.get();
+  InitializeNativeThread();
+
+  std::unique_lock lock(state->mMutex);
+  while (true) {
+    ++state->mIdleThreads;
+    state->mWake.wait_for(lock, IdleTimeout, [&state]() {
+      return state->mIsStopping || !state->mTasks.empty();
+    });
+    --state->mIdleThreads;
+    // Idle for too long, or stopping
+    if (state->mTasks.empty()) {
+      tCurrentNativeCallGuard = nullptr;
+      return;
+    }
+
+    auto task = std::move(state->mTasks.front());
+    state->mTasks.pop_front();
+
+    lock.unlock();
+    task();
+    // Released before relocking, as it may own the guard
+    task = {};
+    lock.lock();
+  }
+}
+
+}// namespace FredEmmott::Audio
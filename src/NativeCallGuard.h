@@ -0,0 +1,220 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+#include "BackendThread.h"
+
+namespace FredEmmott::Audio {
+
+/* Runs native calls for a device with a deadline, if one has been set with
+ * `SetNativeCallTimeout()`.
+ *
+ * If a call misses the deadline, the caller gets `Error::TIMEOUT`, and the
+ * device is quarantined: later calls for it fail immediately with
+ * `Error::TIMEOUT`, until every call that timed out has returned.
+ *
+ * Calls run on library-owned threads. A thread is started whenever there
+ * isn't an idle one, so a hung call never delays calls for other devices;
+ * threads exit after `IdleTimeout`.
+ *
+ * Alternatively, every call can be made on the `BackendThread`, so that
+ * native objects are only ever used by one thread. A hung call then delays
+ * every other call.
+ *
+ * `Start()` and `Wait()` split a call in two, so that calls for several
+ * devices can run concurrently, each with its own deadline.
+ */
+class NativeCallGuard final {
+ public:
+  static constexpr auto IdleTimeout = std::chrono::seconds(30);
+
+  NativeCallGuard() = default;
+  // Doesn't wait for calls that are still running
+  ~NativeCallGuard();
+  NativeCallGuard(const NativeCallGuard&) = delete;
+  NativeCallGuard& operator=(const NativeCallGuard&) = delete;
+
+  // Zero disables the deadline, and calls are made on the calling thread
+  // unless the backend thread is in use
+  void SetTimeout(std::chrono::milliseconds);
+  void SetUseBackendThread(bool);
+  bool IsUsingBackendThread() const;
+  BackendThread* GetBackendThread();
+
+  // `fn` must return `result<T>`, and is copied to another thread
+  template <class T, class F>
+  result<T> Call(const std::string& deviceID, F fn);
+
+  // Shared with the worker, as it can outlive the caller if it times out
+  template <class T>
+  struct PendingCall {
+    std::string mDeviceID;
+    std::mutex mMutex;
+    std::condition_variable mDone;
+    bool mIsDone {false};
+    bool mTimedOut {false};
+    std::optional<std::conditional_t<std::is_void_v<T>, std::monostate, T>>
+      mValue;
+    std::optional<Error> mError;
+  };
+
+  /* Starts a call on one of this guard's threads without waiting for it,
+   * even if there's no timeout; finish it with `Wait()`.
+   *
+   * If the device is quarantined, the call isn't made, and fails with
+   * `Error::TIMEOUT`.
+   */
+  template <class T, class F>
+  std::shared_ptr<PendingCall<T>> Start(const std::string& deviceID, F fn);
+  // If the deadline passes first, fails with `Error::TIMEOUT` and
+  // quarantines the device; `time_point::max()` waits indefinitely
+  template <class T>
+  result<T> Wait(
+    const std::shared_ptr<PendingCall<T>>&,
+    std::chrono::steady_clock::time_point deadline);
+
+ private:
+  // Shared with the threads and calls, as they can outlive the guard
+  struct State {
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<std::function<void()>> mTasks;
+    size_t mIdleThreads {};
+    bool mIsStopping {false};
+    // Calls that timed out but haven't returned yet, by device ID
+    std::map<std::string, size_t> mHungCalls;
+
+    bool IsQuarantined(const std::string& deviceID);
+    void Quarantine(const std::string& deviceID);
+    void Release(const std::string& deviceID);
+  };
+
+  std::atomic<std::chrono::milliseconds::rep> mTimeout {0};
+  std::atomic<bool> mUseBackendThread {false};
+  const std::shared_ptr<State> mState {std::make_shared<State>()};
+  BackendThread mBackendThread;
+
+  // This guard's threads, or its backend thread
+  bool IsWorkerThread() const;
+
+  void Enqueue(std::function<void()>);
+  static void Run(const std::shared_ptr<State>&);
+
+  template <class T, class F>
+  std::shared_ptr<PendingCall<T>>
+  StartCall(const std::string& deviceID, F fn, bool useBackendThread);
+};
+
+// The default `AudioContext`'s instance
+NativeCallGuard* GetNativeCallGuard();
+
+template <class T, class F>
+result<T> NativeCallGuard::Call(const std::string& deviceID, F fn) {
+  const std::chrono::milliseconds timeout {
+    mTimeout.load(std::memory_order_relaxed)};
+  const auto useBackendThread = IsUsingBackendThread();
+  // Nested calls are already covered by the outer call
+  if (IsWorkerThread() || (timeout == timeout.zero() && !useBackendThread)) {
+    return fn();
+  }
+  const auto pending
+    = StartCall<T>(deviceID, std::move(fn), useBackendThread);
+  return Wait(
+    pending,
+    timeout == timeout.zero()
+      ? std::chrono::steady_clock::time_point::max()
+      : std::chrono::steady_clock::now() + timeout);
+}
+
+template <class T, class F>
+std::shared_ptr<NativeCallGuard::PendingCall<T>> NativeCallGuard::Start(
+  const std::string& deviceID,
+  F fn) {
+  return StartCall<T>(deviceID, std::move(fn), /* useBackendThread = */ false);
+}
+
+template <class T, class F>
+std::shared_ptr<NativeCallGuard::PendingCall<T>> NativeCallGuard::StartCall(
+  const std::string& deviceID,
+  F fn,
+  bool useBackendThread) {
+  const auto pending = std::make_shared<PendingCall<T>>();
+  pending->mDeviceID = deviceID;
+  if (mState->IsQuarantined(deviceID)) {
+    pending->mIsDone = true;
+    pending->mError = Error::TIMEOUT;
+    return pending;
+  }
+
+  auto task = [state = mState, pending, fn = std::move(fn)]() {
+    auto ret = fn();
+    bool timedOut = false;
+    {
+      std::unique_lock lock(pending->mMutex);
+      if (!ret.has_value()) {
+        pending->mError = ret.error();
+      } else if constexpr (std::is_void_v<T>) {
+        pending->mValue.emplace();
+      } else {
+        pending->mValue.emplace(std::move(*ret));
+      }
+      pending->mIsDone = true;
+      timedOut = pending->mTimedOut;
+    }
+    pending->mDone.notify_one();
+    if (timedOut) {
+      state->Release(pending->mDeviceID);
+    }
+  };
+  if (useBackendThread) {
+    mBackendThread.Post(std::move(task));
+  } else {
+    Enqueue(std::move(task));
+  }
+  return pending;
+}
+
+template <class T>
+result<T> NativeCallGuard::Wait(
+  const std::shared_ptr<PendingCall<T>>& pending,
+  std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock lock(pending->mMutex);
+  const auto isDone = [&pending]() { return pending->mIsDone; };
+  if (deadline == std::chrono::steady_clock::time_point::max()) {
+    pending->mDone.wait(lock, isDone);
+  } else if (!pending->mDone.wait_until(lock, deadline, isDone)) {
+    // Still holding the lock, so the worker sees this once it returns
+    pending->mTimedOut = true;
+    mState->Quarantine(pending->mDeviceID);
+    return {unexpect, Error::TIMEOUT};
+  }
+  if (pending->mError) {
+    return {unexpect, *pending->mError};
+  }
+  if constexpr (std::is_void_v<T>) {
+    return {};
+  } else {
+    return std::move(*pending->mValue);
+  }
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,117 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <functional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace FredEmmott::Audio {
+
+/* Implemented by each platform backend.
+ *
+ * These may be called concurrently from worker threads.
+ */
+
+/* Called at the start of every library-owned thread that makes native calls,
+ * e.g. to join the COM multi-threaded apartment: the `WorkerPool`,
+ * `NativeCallGuard`, `BackendThread` and `TimerWheel` threads.
+ *
+ * Platform stream threads set themselves up instead.
+ */
+void InitializeNativeThread();
+
+// Lists devices without fetching their properties, so that the properties
+// can be fetched concurrently
+std::vector<std::string> GetNativeDeviceIDs(AudioDeviceDirection);
+result<AudioDeviceInfo> GetNativeDeviceInfo(
+  AudioDeviceDirection,
+  const std::string& deviceID);
+
+// Resolves and caches the native objects that are needed to control the
+// device, so that the first call that uses them doesn't have to
+result<void> PrewarmNativeDevice(const std::string& deviceID);
+
+/* Unregisters a native watch when destroyed.
+ *
+ * Once destroyed, the callback is not running on any other thread, and won't
+ * be invoked again, so it must not be destroyed while holding a lock that
+ * the callback takes.
+ */
+class NativeWatchHandle final {
+ public:
+  NativeWatchHandle() = default;
+  explicit NativeWatchHandle(std::function<void()> unwatch)
+    : mUnwatch(std::move(unwatch)) {
+  }
+  NativeWatchHandle(NativeWatchHandle&& other) noexcept
+    : mUnwatch(std::exchange(other.mUnwatch, {})) {
+  }
+  NativeWatchHandle& operator=(NativeWatchHandle&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      mUnwatch = std::exchange(other.mUnwatch, {});
+    }
+    return *this;
+  }
+  NativeWatchHandle(const NativeWatchHandle&) = delete;
+  NativeWatchHandle& operator=(const NativeWatchHandle&) = delete;
+
+  ~NativeWatchHandle() {
+    Reset();
+  }
+
+ private:
+  std::function<void()> mUnwatch;
+
+  void Reset() {
+    if (mUnwatch) {
+      std::exchange(mUnwatch, {})();
+    }
+  }
+};
+
+// Invokes the callback on a backend-owned thread whenever the device's
+// `AudioDeviceInfo` may have changed, including its state, until the handle
+// is destroyed
+result<NativeWatchHandle> WatchNativeDeviceInfo(
+  const std::string& deviceID,
+  std::function<void()>);
+
+// The platform implementations of `GetDefaultAudioDeviceID()` and
+// `SetDefaultAudioDeviceID()`, without caching. An empty ID means there is
+// no default; setting returns `false` if the default wasn't changed.
+std::string GetNativeDefaultAudioDeviceID(
+  AudioDeviceDirection,
+  AudioDeviceRole);
+bool SetNativeDefaultAudioDeviceID(
+  AudioDeviceDirection,
+  AudioDeviceRole,
+  const std::string& deviceID);
+
+// The platform implementations of the public functions with similar names;
+// these are wrapped by `NativeCallGuard`
+result<bool> IsNativeDeviceMuted(const std::string& deviceID);
+result<void> MuteNativeDevice(const std::string& deviceID);
+result<void> UnmuteNativeDevice(const std::string& deviceID);
+result<VolumeRange> GetNativeDeviceVolumeRange(const std::string& deviceID);
+result<Volume> GetNativeDeviceVolume(const std::string& deviceID);
+result<void> SetNativeDeviceVolumeScalar(const std::string& deviceID, float);
+result<void> SetNativeDeviceVolumeDecibels(const std::string& deviceID, float);
+result<void> IncreaseNativeDeviceVolume(const std::string& deviceID);
+result<void> DecreaseNativeDeviceVolume(const std::string& deviceID);
+result<std::vector<float>> GetNativeDeviceChannelVolumes(
+  const std::string& deviceID);
+result<void> SetNativeDeviceChannelVolumes(
+  const std::string& deviceID,
+  std::span<const float>);
+
+}// namespace FredEmmott::Audio
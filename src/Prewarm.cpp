@@ -0,0 +1,88 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <atomic>
+#include <memory>
+
+#include "AudioContext.h"
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+// Shared by the per-device tasks; the last one to finish completes it
+struct PrewarmProgress {
+  std::atomic<size_t> mRemaining;
+  std::function<void()> mOnComplete;
+};
+
+std::vector<std::string> GetConnectedDeviceIDs(AudioContext::Impl* context) {
+  std::vector<std::string> ret;
+  for (const auto direction:
+       {AudioDeviceDirection::OUTPUT, AudioDeviceDirection::INPUT}) {
+    for (const auto& [id, info]: context->GetAudioDeviceList(direction)) {
+      if (info.state == AudioDeviceState::CONNECTED) {
+        ret.push_back(id);
+      }
+    }
+  }
+  return ret;
+}
+
+}// namespace
+
+void AudioContext::Impl::PrewarmAudioDevices(
+  const AudioDevicePrewarmOptions& options,
+  std::function<void()> onComplete) {
+  // Enumerating can be slow too, so that's done on a worker thread as well.
+  // The tasks keep the context alive until they're done.
+  mWorkerPool.Enqueue([self = shared_from_this(),
+                       deviceIDs = options.deviceIDs,
+                       onComplete = std::move(onComplete)]() mutable {
+    if (deviceIDs.empty()) {
+      deviceIDs = GetConnectedDeviceIDs(self.get());
+    }
+    if (deviceIDs.empty()) {
+      if (onComplete) {
+        onComplete();
+      }
+      return;
+    }
+
+    const auto progress = std::make_shared<PrewarmProgress>(
+      deviceIDs.size(), std::move(onComplete));
+    for (auto& deviceID: deviceIDs) {
+      self->mWorkerPool.Enqueue(
+        [self, progress, deviceID = std::move(deviceID)]() {
+          // Errors are left for the first real call to report
+          self->mNativeCallGuard.Call<void>(
+            deviceID, [deviceID]() { return PrewarmNativeDevice(deviceID); });
+          if (
+            progress->mRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1
+            && progress->mOnComplete) {
+            progress->mOnComplete();
+          }
+        });
+    }
+  });
+}
+
+void AudioContext::PrewarmAudioDevices(
+  const AudioDevicePrewarmOptions& options,
+  std::function<void()> onComplete) {
+  p->PrewarmAudioDevices(options, std::move(onComplete));
+}
+
+void PrewarmAudioDevices(
+  const AudioDevicePrewarmOptions& options,
+  std::function<void()> onComplete) {
+  GetDefaultAudioContext().PrewarmAudioDevices(options, std::move(onComplete));
+}
+
+}// namespace FredEmmott::Audio
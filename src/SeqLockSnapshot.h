@@ -0,0 +1,111 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+namespace FredEmmott::Audio {
+
+/* Publishes a small trivially-copyable value from a single writer to any
+ * number of readers, without locks on either side.
+ *
+ * Writers never wait; readers retry if they overlap a write.
+ */
+template <class T>
+  requires std::is_trivially_copyable_v<T>
+class SeqLockSnapshot final {
+ public:
+  SeqLockSnapshot() {
+    Store(T {});
+  }
+
+  SeqLockSnapshot(const SeqLockSnapshot&) = delete;
+  SeqLockSnapshot& operator=(const SeqLockSnapshot&) = delete;
+
+  // Must only be called from one thread at a time
+  void Store(const T& value) {
+    std::array<uint64_t, WordCount> words {};
+    std::memcpy(words.data(), &value, sizeof(T));
+
+    const auto sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    // Release, so that the odd sequence number is visible before any word
+    for (size_t i = 0; i < WordCount; ++i) {
+      mWords[i].store(words[i], std::memory_order_release);
+    }
+    mSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  T Load() const {
+    while (true) {
+      if (auto ret = TryLoadOnce()) {
+        return *ret;
+      }
+    }
+  }
+
+  /* As `Load()`, but gives up if a consistent value can't be read within
+   * the timeout.
+   *
+   * For readers in other processes, as the writer may have died during a
+   * `Store()`, leaving the sequence number odd forever.
+   */
+  std::optional<T> TryLoad(std::chrono::steady_clock::duration timeout) const {
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    while (true) {
+      if (auto ret = TryLoadOnce()) {
+        return ret;
+      }
+      // Only after a failed attempt, so the common case doesn't read the
+      // clock
+      const auto now = std::chrono::steady_clock::now();
+      if (!deadline) {
+        deadline = now + timeout;
+      } else if (now >= *deadline) {
+        return std::nullopt;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  static constexpr size_t WordCount
+    = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  // Odd while a write is in progress
+  std::atomic<uint64_t> mSequence {0};
+  std::array<std::atomic<uint64_t>, WordCount> mWords {};
+
+  // Returns `std::nullopt` if it overlapped a write
+  std::optional<T> TryLoadOnce() const {
+    const auto before = mSequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      return std::nullopt;
+    }
+    std::array<uint64_t, WordCount> words {};
+    // Acquire, so that the sequence number is re-read after every word
+    for (size_t i = 0; i < WordCount; ++i) {
+      words[i] = mWords[i].load(std::memory_order_acquire);
+    }
+    if (mSequence.load(std::memory_order_relaxed) != before) {
+      return std::nullopt;
+    }
+
+    std::optional<T> ret {std::in_place};
+    std::memcpy(static_cast<void*>(&*ret), words.data(), sizeof(T));
+    return ret;
+  }
+};
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,75 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "SeqLockSnapshot.h"
+
+namespace FredEmmott::Audio {
+
+/* The shared memory segment published by `StartAudioDeviceStateBroker()`.
+ *
+ * This has a fixed size, so that clients can map it without asking the
+ * broker; devices beyond `MaxDevices` are left out, and strings are
+ * truncated. Everything is in native byte order, so the broker and its
+ * clients must be built for the same architecture.
+ *
+ * The broker writes `mMagic` last, so clients must check it before reading
+ * anything else. Increment `Version` for any change to the layout.
+ */
+struct SharedDeviceStateSegment {
+  static constexpr uint32_t Magic = 0x42534441;// "ADSB" if little-endian
+  static constexpr uint32_t Version = 2;
+  static constexpr size_t MaxDevices = 32;
+
+  // Null-terminated UTF-8
+  using String = std::array<char, 128>;
+
+  struct Device {
+    String mID {};
+    String mInterfaceName {};
+    String mEndpointName {};
+    String mDisplayName {};
+    uint8_t mDirection {};
+    uint8_t mState {};
+    uint8_t mHasVolume {};
+    uint8_t mIsMuted {};
+    float mVolumeScalar {};
+    uint8_t mHasVolumeDecibels {};
+    uint8_t mHasVolumeStep {};
+    uint8_t mPadding[2] {};
+    float mVolumeDecibels {};
+    uint32_t mVolumeStep {};
+  };
+
+  struct State {
+    uint32_t mDeviceCount {};
+    std::array<Device, MaxDevices> mDevices {};
+    // In the same order as the fields of `AudioDeviceListSnapshot`
+    std::array<String, 4> mDefaultIDs {};
+  };
+
+  std::atomic<uint32_t> mMagic {0};
+  uint32_t mVersion {Version};
+  uint64_t mSize {sizeof(SharedDeviceStateSegment)};
+  // Incremented after each change to `mState`; clients compare this
+  // rather than copying `mState` to find out if anything changed
+  std::atomic<uint64_t> mGeneration {0};
+  // Set when the broker stops cleanly; if it crashes, clients find out
+  // from `SharedMemorySegment::IsOwnerRunning()`
+  std::atomic<uint32_t> mIsStopped {0};
+  SeqLockSnapshot<State> mState;
+};
+
+// Shared between processes, so they must not be implemented with a lock
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+}// namespace FredEmmott::Audio
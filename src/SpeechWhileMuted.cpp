@@ -0,0 +1,153 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <memory>
+#include <mutex>
+
+#include "NativeAudioStreams.h"
+#include "TimerWheel.h"
+#include "VoiceActivityDetector.h"
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+/* Captures only while the device is muted.
+ *
+ * Opening and closing streams, and invoking the user callback, happen on the
+ * timer thread: the former so that mute notifications aren't blocked on
+ * stream setup, and the latter to keep user code off the capture thread.
+ */
+class SpeechWhileMutedMonitor final
+  : public std::enable_shared_from_this<SpeechWhileMutedMonitor> {
+ public:
+  SpeechWhileMutedMonitor(
+    const std::string& deviceID,
+    std::function<void()> callback,
+    const SpeechWhileMutedOptions& options)
+    : mDeviceID(deviceID),
+      mCallback(std::move(callback)),
+      mDetector(options) {
+  }
+
+  result<void> Start() {
+    // Otherwise, the detector would only ever see silence
+    auto isMuteAfterCapture = IsNativeMuteAfterCapture(mDeviceID);
+    if (!isMuteAfterCapture.has_value()) {
+      return {unexpect, isMuteAfterCapture.error()};
+    }
+    if (!isMuteAfterCapture.value()) {
+      return {unexpect, Error::OPERATION_UNSUPPORTED};
+    }
+
+    std::weak_ptr<SpeechWhileMutedMonitor> weak = shared_from_this();
+    auto handle = AddAudioDeviceMuteUnmuteCallback(
+      mDeviceID,
+      [weak](bool isMuted) { OnMuteChanged(weak, isMuted); },
+      CallbackDelivery::CHANGES_ONLY);
+    if (!handle) {
+      return {unexpect, handle.error()};
+    }
+    mMuteCallback = std::move(*handle);
+
+    const auto isMuted = IsAudioDeviceMuted(mDeviceID);
+    if (!isMuted.has_value()) {
+      return {unexpect, isMuted.error()};
+    }
+    OnMuteChanged(weak, isMuted.value());
+    return {};
+  }
+
+ private:
+  const std::string mDeviceID;
+  const std::function<void()> mCallback;
+
+  // Only used by the capture thread while `mStream` is open
+  VoiceActivityDetector mDetector;
+
+  MuteCallbackHandle mMuteCallback;
+
+  std::mutex mMutex;
+  // Declared last so that it's destroyed first, as it references `mDetector`
+  std::unique_ptr<NativeCaptureStream> mStream;
+
+  static void OnMuteChanged(
+    const std::weak_ptr<SpeechWhileMutedMonitor>& weak,
+    bool isMuted) {
+    GetTimerWheel()->Schedule(
+      TimerWheel::Clock::now(), [weak, isMuted]() {
+        const auto self = weak.lock();
+        if (self) {
+          self->UpdateStream(isMuted);
+        }
+      });
+  }
+
+  void UpdateStream(bool isMuted) {
+    std::unique_lock lock(mMutex);
+    if (!isMuted) {
+      mStream.reset();
+      return;
+    }
+    if (mStream) {
+      return;
+    }
+
+    mDetector.Reset();
+    auto stream = OpenNativeCaptureStream(
+      mDeviceID, [this](const AudioBufferView& buffer) {
+        if (mDetector.Process(buffer)) {
+          OnSpeech();
+        }
+      });
+    if (stream) {
+      mStream = std::move(*stream);
+    }
+  }
+
+  // Called from the capture thread
+  void OnSpeech() {
+    std::weak_ptr<SpeechWhileMutedMonitor> weak = weak_from_this();
+    GetTimerWheel()->Schedule(TimerWheel::Clock::now(), [weak]() {
+      const auto self = weak.lock();
+      if (self) {
+        self->mCallback();
+      }
+    });
+  }
+};
+
+}// namespace
+
+class SpeechWhileMutedCallbackHandle::Impl {
+ public:
+  std::shared_ptr<SpeechWhileMutedMonitor> monitor;
+};
+
+SpeechWhileMutedCallbackHandle::SpeechWhileMutedCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+SpeechWhileMutedCallbackHandle::~SpeechWhileMutedCallbackHandle() = default;
+
+result<SpeechWhileMutedCallbackHandle> AddSpeechWhileMutedCallback(
+  const std::string& deviceID,
+  std::function<void()> callback,
+  const SpeechWhileMutedOptions& options) {
+  auto monitor = std::make_shared<SpeechWhileMutedMonitor>(
+    deviceID, std::move(callback), options);
+  auto started = monitor->Start();
+  if (!started) {
+    return {unexpect, started.error()};
+  }
+  return {{std::make_shared<SpeechWhileMutedCallbackHandle::Impl>(
+    std::move(monitor))}};
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,266 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "StreamPropertiesCache.h"
+
+#include <vector>
+
+#include "AudioContext.h"
+#include "NativeAudioStreams.h"
+
+namespace FredEmmott::Audio {
+
+StreamPropertiesCache::StreamPropertiesCache(
+  NativeCallGuard* nativeCallGuard,
+  WorkerPool* workers,
+  TimerWheel* timers)
+  : mNativeCallGuard(nativeCallGuard), mWorkers(workers), mTimers(timers) {
+}
+
+StreamPropertiesCache::Entry* StreamPropertiesCache::GetWatchedEntry(
+  const std::string& deviceID) {
+  if (mIsStopped) {
+    return nullptr;
+  }
+  auto& entry = mEntries[deviceID];
+  if (!entry) {
+    entry = std::make_unique<Entry>();
+  }
+  if (entry->mWatch) {
+    return entry.get();
+  }
+
+  // Retried on each use until it succeeds
+  auto watch = WatchNativeStreamProperties(
+    deviceID, [this, deviceID, entry = entry.get()]() {
+      OnChanged(deviceID, entry);
+    });
+  if (!watch) {
+    return nullptr;
+  }
+  entry->mWatch = std::move(*watch);
+  return entry.get();
+}
+
+result<AudioDeviceStreamProperties> StreamPropertiesCache::Get(
+  const std::string& deviceID) {
+  Entry* entry {nullptr};
+  uint64_t generation {};
+  {
+    std::unique_lock lock(mMutex);
+    entry = GetWatchedEntry(deviceID);
+    if (entry) {
+      generation = entry->mGeneration.load(std::memory_order_acquire);
+      if (
+        entry->mProperties && entry->mPropertiesGeneration == generation) {
+        return *entry->mProperties;
+      }
+    }
+  }
+
+  // Not holding the lock, so a slow device doesn't block the others
+  const auto properties = mNativeCallGuard->Call<AudioDeviceStreamProperties>(
+    deviceID, [deviceID]() { return QueryNativeStreamProperties(deviceID); });
+  if (!properties) {
+    return {unexpect, properties.error()};
+  }
+
+  if (entry) {
+    std::unique_lock lock(mMutex);
+    if (generation == entry->mGeneration.load(std::memory_order_acquire)) {
+      entry->mProperties = *properties;
+      entry->mPropertiesGeneration = generation;
+    }
+  }
+  return *properties;
+}
+
+result<StreamPropertiesCache::SubscriptionID> StreamPropertiesCache::Subscribe(
+  const std::string& deviceID,
+  Callback callback) {
+  std::unique_lock lock(mMutex);
+  if (mIsStopped) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  const auto entry = GetWatchedEntry(deviceID);
+  if (!entry) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
+  return entry->mSubscribers.Add(std::move(callback));
+}
+
+void StreamPropertiesCache::Reset() {
+  std::unique_lock lock(mMutex);
+  for (const auto& [id, entry]: mEntries) {
+    entry->mProperties.reset();
+  }
+}
+
+void StreamPropertiesCache::Stop() {
+  std::vector<NativeWatchHandle> watches;
+  {
+    std::unique_lock lock(mMutex);
+    mIsStopped = true;
+    for (const auto& [id, entry]: mEntries) {
+      entry->mProperties.reset();
+      if (entry->mWatch) {
+        watches.push_back(std::move(*entry->mWatch));
+        entry->mWatch.reset();
+      }
+    }
+    mQueriesFinished.wait(lock, [this]() { return mQueriesInFlight == 0; });
+  }
+  // Released without the lock, as this waits for running callbacks
+  watches.clear();
+}
+
+void StreamPropertiesCache::Unsubscribe(
+  const std::string& deviceID,
+  SubscriptionID id) {
+  Entry* entry {nullptr};
+  {
+    std::unique_lock lock(mMutex);
+    const auto it = mEntries.find(deviceID);
+    if (it == mEntries.end()) {
+      return;
+    }
+    entry = it->second.get();
+  }
+  // Not holding the lock, as this waits for running callbacks, which may
+  // call `Get()`; entries are never removed
+  entry->mSubscribers.Remove(id);
+}
+
+// Called on a backend thread
+void StreamPropertiesCache::OnChanged(
+  const std::string& deviceID,
+  Entry* entry) {
+  entry->mGeneration.fetch_add(1, std::memory_order_acq_rel);
+  if (entry->mRefreshPending.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  mTimers->Schedule(
+    TimerWheel::Clock::now() + RefreshDelay,
+    [this, deviceID, entry]() { Refresh(deviceID, entry); });
+}
+
+// Called on the timer thread
+void StreamPropertiesCache::Refresh(
+  const std::string& deviceID,
+  Entry* entry) {
+  // Cleared first, so that notifications during the query schedule another
+  // refresh
+  entry->mRefreshPending.store(false, std::memory_order_release);
+  if (entry->mSubscribers.IsEmpty()) {
+    return;
+  }
+  // Sampled before the query, so it's never newer than the result
+  const auto generation = entry->mGeneration.load(std::memory_order_acquire);
+
+  std::unique_lock lock(mMutex);
+  if (mIsStopped) {
+    return;
+  }
+  ++mQueriesInFlight;
+  mWorkers->Enqueue([this, deviceID, entry, generation]() {
+    Query(deviceID, entry, generation);
+  });
+}
+
+// Called on the worker pool
+void StreamPropertiesCache::Query(
+  const std::string& deviceID,
+  Entry* entry,
+  uint64_t generation) {
+  const auto properties = Get(deviceID);
+  if (properties) {
+    mTimers->Schedule(
+      TimerWheel::Clock::now(),
+      [this, entry, generation, properties = *properties]() {
+        Deliver(entry, generation, properties);
+      });
+  }
+
+  std::unique_lock lock(mMutex);
+  if (--mQueriesInFlight == 0) {
+    mQueriesFinished.notify_all();
+  }
+}
+
+// Called on the timer thread
+void StreamPropertiesCache::Deliver(
+  Entry* entry,
+  uint64_t generation,
+  const AudioDeviceStreamProperties& properties) {
+  {
+    std::unique_lock lock(mMutex);
+    if (mIsStopped) {
+      return;
+    }
+  }
+  if (generation < entry->mLastNotifiedGeneration) {
+    return;
+  }
+  entry->mLastNotifiedGeneration = generation;
+  if (entry->mLastNotified == properties) {
+    return;
+  }
+  entry->mLastNotified = properties;
+  entry->mSubscribers.ForEach([&](const auto& cb) { cb(properties); });
+}
+
+class StreamPropertiesCallbackHandle::Impl {
+ public:
+  // Doesn't keep the context alive; if it's gone, so is the subscription
+  std::weak_ptr<AudioContext::Impl> context;
+  std::string deviceID;
+  StreamPropertiesCache::SubscriptionID id;
+
+  ~Impl() {
+    if (const auto locked = context.lock()) {
+      locked->mStreamPropertiesCache.Unsubscribe(deviceID, id);
+    }
+  }
+};
+
+StreamPropertiesCallbackHandle::StreamPropertiesCallbackHandle(
+  const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+StreamPropertiesCallbackHandle::~StreamPropertiesCallbackHandle() = default;
+
+result<AudioDeviceStreamProperties> AudioContext::GetDeviceStreamProperties(
+  const std::string& deviceID) const {
+  return p->mStreamPropertiesCache.Get(deviceID);
+}
+
+result<StreamPropertiesCallbackHandle>
+AudioContext::AddDeviceStreamPropertiesCallback(
+  const std::string& deviceID,
+  std::function<void(const AudioDeviceStreamProperties&)> callback) {
+  const auto id
+    = p->mStreamPropertiesCache.Subscribe(deviceID, std::move(callback));
+  if (!id.has_value()) {
+    return {unexpect, id.error()};
+  }
+  return {{std::make_shared<StreamPropertiesCallbackHandle::Impl>(
+    p, deviceID, *id)}};
+}
+
+result<AudioDeviceStreamProperties> GetDeviceStreamProperties(
+  const std::string& deviceID) {
+  return GetDefaultAudioContext().GetDeviceStreamProperties(deviceID);
+}
+
+result<StreamPropertiesCallbackHandle> AddDeviceStreamPropertiesCallback(
+  const std::string& deviceID,
+  std::function<void(const AudioDeviceStreamProperties&)> callback) {
+  return GetDefaultAudioContext().AddDeviceStreamPropertiesCallback(
+    deviceID, std::move(callback));
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,117 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "EpochSubscriberList.h"
+#include "NativeCallGuard.h"
+#include "NativeDevices.h"
+#include "TimerWheel.h"
+#include "WorkerPool.h"
+
+namespace FredEmmott::Audio {
+
+/* Per-device `AudioDeviceStreamProperties`, invalidated by native change
+ * notifications.
+ *
+ * Notifications only bump a generation counter, without taking a lock, so
+ * they can never deadlock against a native registration in progress. A
+ * query result is only cached if no notification arrived while the query was
+ * running.
+ *
+ * Subscribers are refreshed shortly after the first of a burst of
+ * notifications, and only if the properties actually changed. The query
+ * runs on the worker pool, so a slow device doesn't delay timers, and the
+ * result is delivered on the timer thread.
+ *
+ * Each `AudioContext` has its own cache, using its native call guard,
+ * worker pool, and timer wheel.
+ */
+class StreamPropertiesCache final {
+ public:
+  using Callback = std::function<void(const AudioDeviceStreamProperties&)>;
+  using SubscriptionID = uint64_t;
+
+  static constexpr auto RefreshDelay = std::chrono::milliseconds(10);
+
+  StreamPropertiesCache(NativeCallGuard*, WorkerPool*, TimerWheel*);
+  StreamPropertiesCache(const StreamPropertiesCache&) = delete;
+  StreamPropertiesCache& operator=(const StreamPropertiesCache&) = delete;
+
+  result<AudioDeviceStreamProperties> Get(const std::string& deviceID);
+
+  // Fails with `Error::OPERATION_UNSUPPORTED` once stopped
+  result<SubscriptionID> Subscribe(const std::string& deviceID, Callback);
+  void Unsubscribe(const std::string& deviceID, SubscriptionID);
+
+  // Forgets every cached value, so that the next `Get()` for each device
+  // queries the platform
+  void Reset();
+  /* Releases every native registration, so that subscribers are no longer
+   * notified, and `Get()` always queries the platform.
+   *
+   * Waits for running refresh queries. Refreshes that are already
+   * scheduled still run, so the timer wheel must be stopped before the
+   * cache is destroyed.
+   */
+  void Stop();
+
+ private:
+  struct Entry {
+    // Incremented by each notification
+    std::atomic<uint64_t> mGeneration {0};
+    std::atomic<bool> mRefreshPending {false};
+    EpochSubscriberList<Callback> mSubscribers;
+
+    // Protected by `mMutex`
+    std::optional<NativeWatchHandle> mWatch;
+    std::optional<AudioDeviceStreamProperties> mProperties;
+    uint64_t mPropertiesGeneration {};
+
+    // Only used on the timer thread
+    std::optional<AudioDeviceStreamProperties> mLastNotified;
+    // Refreshes can finish out of order; older results are dropped
+    uint64_t mLastNotifiedGeneration {};
+  };
+
+  NativeCallGuard* const mNativeCallGuard {nullptr};
+  WorkerPool* const mWorkers {nullptr};
+  TimerWheel* const mTimers {nullptr};
+
+  std::mutex mMutex;
+  bool mIsStopped {false};
+  size_t mQueriesInFlight {};
+  std::condition_variable mQueriesFinished;
+  // Never removed, so callbacks can keep using them without a lock
+  std::map<std::string, std::unique_ptr<Entry>> mEntries;
+
+  // Called with `mMutex` held; returns `nullptr` if the device can't be
+  // watched, or the cache has been stopped
+  Entry* GetWatchedEntry(const std::string& deviceID);
+
+  void OnChanged(const std::string& deviceID, Entry*);
+  void Refresh(const std::string& deviceID, Entry*);
+  void Query(const std::string& deviceID, Entry*, uint64_t generation);
+  void Deliver(
+    Entry*,
+    uint64_t generation,
+    const AudioDeviceStreamProperties&);
+};
+
+}// namespace FredEmmott::Audio
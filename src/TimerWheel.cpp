@@ -0,0 +1,150 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+TimerWheel::~TimerWheel() {
+  Stop();
+}
+
+uint64_t TimerWheel::State::GetTick(Clock::time_point time) const {
+  if (time <= mStart) {
+    return 0;
+  }
+  // Round up, so that timers never fire early
+  return static_cast<uint64_t>(
+    std::chrono::ceil<std::chrono::milliseconds>(time - mStart) / Resolution);
+}
+
+TimerWheel::Clock::time_point TimerWheel::State::GetTime(
+  uint64_t tick) const {
+  return mStart + (tick * Resolution);
+}
+
+TimerWheel::TimerID TimerWheel::Schedule(
+  Clock::time_point due,
+  std::function<void()> callback) {
+  std::call_once(mStarted, [this]() {
+    std::thread([state = mState]() { Run(state); }).detach();
+  });
+
+  auto& state = *mState;
+  std::unique_lock lock(state.mMutex);
+  const auto id = state.mNextID++;
+  if (state.mIsStopping) {
+    return id;
+  }
+  if (state.mTimers.empty()) {
+    // Skip over the ticks we slept through while idle
+    state.mNextTick = std::max(state.mNextTick, state.GetTick(Clock::now()));
+  }
+
+  const auto tick = std::max(state.GetTick(due), state.mNextTick);
+  state.mTimers.emplace(
+    id, Timer {(tick - state.mNextTick) / SlotCount, std::move(callback)});
+  state.mSlots[tick % SlotCount].push_back(id);
+  state.mWake.notify_one();
+  return id;
+}
+
+void TimerWheel::Cancel(TimerID id) {
+  std::unique_lock lock(mState->mMutex);
+  mState->mTimers.erase(id);
+}
+
+void TimerWheel::Stop() {
+  auto& state = *mState;
+  // Destroyed without the lock, as their destructors may use the wheel
+  std::unordered_map<TimerID, Timer> discarded;
+  {
+    std::unique_lock lock(state.mMutex);
+    state.mIsStopping = true;
+    discarded = std::move(state.mTimers);
+    state.mTimers.clear();
+    for (auto& slot: state.mSlots) {
+      slot.clear();
+    }
+    state.mWake.notify_all();
+    if (state.mThreadID != std::this_thread::get_id()) {
+      state.mIdle.wait(lock, [&state]() { return !state.mIsRunningCallbacks; });
+    }
+  }
+}
+
+void TimerWheel::Run(const std::shared_ptr<State>& statePtr) {
+  // Callbacks make native calls, e.g. for volume ramps
+  InitializeNativeThread();
+
+  auto& state = *statePtr;
+  std::vector<std::function<void()>> ready;
+
+  std::unique_lock lock(state.mMutex);
+  state.mThreadID = std::this_thread::get_id();
+  while (!state.mIsStopping) {
+    const auto now = state.GetTick(Clock::now());
+    for (; state.mNextTick <= now; ++state.mNextTick) {
+      std::erase_if(state.mSlots[state.mNextTick % SlotCount], [&](TimerID id) {
+        const auto it = state.mTimers.find(id);
+        if (it == state.mTimers.end()) {
+          return true;
+        }
+        if (it->second.mRounds > 0) {
+          --it->second.mRounds;
+          return false;
+        }
+        ready.push_back(std::move(it->second.mCallback));
+        state.mTimers.erase(it);
+        return true;
+      });
+    }
+
+    if (!ready.empty()) {
+      state.mIsRunningCallbacks = true;
+      lock.unlock();
+      for (const auto& callback: ready) {
+        // Stopped by an earlier callback, or by another thread
+        if (state.mIsStopping) {
+          break;
+        }
+        callback();
+      }
+      ready.clear();
+      lock.lock();
+      state.mIsRunningCallbacks = false;
+      state.mIdle.notify_all();
+      continue;
+    }
+
+    if (state.mTimers.empty()) {
+      state.mWake.wait(lock);
+      continue;
+    }
+
+    // Sleep until the next slot with anything in it
+    std::optional<uint64_t> nextTick;
+    for (size_t i = 0; i < SlotCount; ++i) {
+      if (!state.mSlots[(state.mNextTick + i) % SlotCount].empty()) {
+        nextTick = state.mNextTick + i;
+        break;
+      }
+    }
+    if (nextTick) {
+      state.mWake.wait_until(lock, state.GetTime(*nextTick));
+    } else {
+      state.mWake.wait(lock);
+    }
+  }
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,101 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace FredEmmott::Audio {
+
+/* A hashed timer wheel, serviced by a single library-owned thread.
+ *
+ * Callbacks run on that thread, one at a time, so anything that is only ever
+ * done from timer callbacks is implicitly serialized. Callbacks must not
+ * block for long, as they delay every other timer. The thread calls
+ * `InitializeNativeThread()`, so callbacks may make native calls.
+ *
+ * The thread is started by the first `Schedule()`, and exits once the wheel
+ * has been stopped or destroyed.
+ */
+class TimerWheel final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using TimerID = uint64_t;
+
+  static constexpr auto Resolution = std::chrono::milliseconds(1);
+  static constexpr size_t SlotCount = 512;
+
+  TimerWheel() = default;
+  // Stops the wheel; see `Stop()`
+  ~TimerWheel();
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Callbacks that are already due run as soon as possible. Once the wheel
+  // has been stopped, the callback is discarded without running.
+  TimerID Schedule(Clock::time_point due, std::function<void()>);
+  // Has no effect if the timer has already started running
+  void Cancel(TimerID);
+
+  /* Discards every pending timer, and stops the thread.
+   *
+   * Waits for a callback that is already running, unless called from that
+   * callback, so that once this returns, nothing the callbacks reference is
+   * in use.
+   */
+  void Stop();
+
+ private:
+  struct Timer {
+    // Number of times the wheel must pass this slot before the timer is due
+    uint64_t mRounds {};
+    std::function<void()> mCallback;
+  };
+
+  // Shared with the thread, as it can outlive the wheel if it's destroyed
+  // from a callback
+  struct State {
+    const Clock::time_point mStart {Clock::now()};
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    // Notified when a batch of callbacks has finished running
+    std::condition_variable mIdle;
+    std::atomic<bool> mIsStopping {false};
+    bool mIsRunningCallbacks {false};
+    std::thread::id mThreadID;
+    // Every tick before this has been processed
+    uint64_t mNextTick {};
+    TimerID mNextID {1};
+    std::unordered_map<TimerID, Timer> mTimers;
+    // Cancelled timers are left in their slot, and skipped when it's
+    // processed
+    std::array<std::vector<TimerID>, SlotCount> mSlots;
+
+    uint64_t GetTick(Clock::time_point) const;
+    Clock::time_point GetTime(uint64_t tick) const;
+  };
+
+  const std::shared_ptr<State> mState {std::make_shared<State>()};
+  std::once_flag mStarted;
+
+  static void Run(const std::shared_ptr<State>&);
+};
+
+// The default `AudioContext`'s instance
+TimerWheel* GetTimerWheel();
+
+}// namespace FredEmmott::Audio
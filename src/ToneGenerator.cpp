@@ -0,0 +1,116 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "ToneGenerator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+static_assert(std::has_single_bit(ToneGenerator::WavetableSize));
+constexpr auto IndexBits = std::bit_width(ToneGenerator::WavetableSize) - 1;
+constexpr auto FractionBits = 32 - IndexBits;
+constexpr uint32_t FractionMask = (1u << FractionBits) - 1;
+
+uint32_t GetFrames(std::chrono::milliseconds duration, uint32_t sampleRate) {
+  return static_cast<uint32_t>(
+    (static_cast<uint64_t>(std::max<int64_t>(0, duration.count()))
+     * sampleRate)
+    / 1000);
+}
+
+}// namespace
+
+const ToneGenerator::Wavetable& ToneGenerator::GetWavetable() {
+  static const auto table = []() {
+    Wavetable ret {};
+    for (size_t i = 0; i < ret.size(); ++i) {
+      ret[i] = static_cast<float>(
+        std::sin((2 * std::numbers::pi * i) / WavetableSize));
+    }
+    return ret;
+  }();
+  return table;
+}
+
+void ToneGenerator::Reset(
+  const IdentificationTonePattern& pattern,
+  uint32_t sampleRate) {
+  // Initialize now, rather than on the render thread
+  GetWavetable();
+
+  sampleRate = std::max<uint32_t>(1, sampleRate);
+  const auto frequency
+    = std::clamp<double>(pattern.frequencyHz, 0, sampleRate / 2.0);
+
+  mGain = std::clamp(pattern.gain, 0.0f, 1.0f);
+  mPhase = 0;
+  mPhaseIncrement = static_cast<uint32_t>(
+    std::min((frequency / sampleRate) * 4294967296.0, 4294967295.0));
+
+  mBeepFrames = GetFrames(pattern.beepDuration, sampleRate);
+  mPeriodFrames
+    = std::max<uint32_t>(1, mBeepFrames + GetFrames(pattern.gap, sampleRate));
+  mTotalFrames = pattern.beepCount == 0
+    ? 0
+    : ((pattern.beepCount - 1) * mPeriodFrames) + mBeepFrames;
+  mFadeFrames = std::clamp<uint32_t>(
+    GetFrames(FadeDuration, sampleRate), 1, std::max(1u, mBeepFrames / 2));
+  mPosition = 0;
+}
+
+float ToneGenerator::NextSample() {
+  if (mPosition >= mTotalFrames) {
+    return 0;
+  }
+  const auto offset = mPosition++ % mPeriodFrames;
+  if (offset >= mBeepFrames) {
+    mPhase = 0;
+    return 0;
+  }
+
+  const auto envelope = std::min(
+    {1.0f,
+     static_cast<float>(offset) / mFadeFrames,
+     static_cast<float>(mBeepFrames - offset) / mFadeFrames});
+
+  const auto& table = GetWavetable();
+  const auto index = mPhase >> FractionBits;
+  const auto fraction
+    = static_cast<float>(mPhase & FractionMask) / (FractionMask + 1.0f);
+  const auto sample
+    = table[index] + ((table[index + 1] - table[index]) * fraction);
+  mPhase += mPhaseIncrement;
+
+  return sample * envelope * mGain;
+}
+
+void ToneGenerator::Render(const AudioRenderBufferView& buffer) {
+  const auto channels = buffer.mChannels;
+  for (uint32_t frame = 0; frame < buffer.mFrames; ++frame) {
+    const auto sample = NextSample();
+    const auto first = static_cast<size_t>(frame) * channels;
+    switch (buffer.mFormat) {
+      case AudioSampleFormat::FLOAT32:
+        std::fill_n(
+          static_cast<float*>(buffer.mData) + first, channels, sample);
+        break;
+      case AudioSampleFormat::INT16:
+        std::fill_n(
+          static_cast<int16_t*>(buffer.mData) + first,
+          channels,
+          static_cast<int16_t>(std::lrint(sample * 32767)));
+        break;
+    }
+  }
+}
+
+}// namespace FredEmmott::Audio
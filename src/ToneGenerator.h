@@ -0,0 +1,60 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "NativeAudioStreams.h"
+
+namespace FredEmmott::Audio {
+
+/* Renders an `IdentificationTonePattern` from a precomputed sine wavetable.
+ *
+ * Each beep fades in and out, to avoid clicks. Once the pattern is finished,
+ * only silence is rendered.
+ *
+ * `Render()` neither blocks nor allocates.
+ */
+class ToneGenerator final {
+ public:
+  // Must be a power of two
+  static constexpr size_t WavetableSize = 2048;
+  static constexpr auto FadeDuration = std::chrono::milliseconds(5);
+
+  void Reset(const IdentificationTonePattern&, uint32_t sampleRate);
+  void Render(const AudioRenderBufferView&);
+
+  bool IsFinished() const {
+    return mPosition >= mTotalFrames;
+  }
+
+ private:
+  // With a guard entry, so interpolation never needs to wrap
+  using Wavetable = std::array<float, WavetableSize + 1>;
+  static const Wavetable& GetWavetable();
+
+  float mGain {};
+  // Fixed-point phase; the top bits index the wavetable, and the rest are the
+  // fraction between entries
+  uint32_t mPhase {};
+  uint32_t mPhaseIncrement {};
+
+  uint32_t mBeepFrames {};
+  // Beep and gap
+  uint32_t mPeriodFrames {1};
+  uint32_t mTotalFrames {};
+  uint32_t mFadeFrames {1};
+  uint32_t mPosition {};
+
+  float NextSample();
+};
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,152 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "VoiceActivityDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+uint32_t ToBlocks(std::chrono::milliseconds duration) {
+  return static_cast<uint32_t>(std::max<int64_t>(
+    1, duration / VoiceActivityDetector::BlockDuration));
+}
+
+float ToFloat(float sample) {
+  return sample;
+}
+
+float ToFloat(int16_t sample) {
+  return sample / 32768.0f;
+}
+
+}// namespace
+
+VoiceActivityDetector::VoiceActivityDetector(
+  const SpeechWhileMutedOptions& options)
+  : mOptions(options),
+    mMinimumSpeechBlocks(ToBlocks(options.minimumSpeech)),
+    mHangoverBlocks(ToBlocks(options.hangover)) {
+}
+
+void VoiceActivityDetector::Reset() {
+  mSampleRate = 0;
+  mNoiseFloorDecibels = std::nullopt;
+  mSpeechBlocks = 0;
+  mSilentBlocks = 0;
+  mInSpeech = false;
+}
+
+void VoiceActivityDetector::Configure(uint32_t sampleRate) {
+  mSampleRate = sampleRate;
+  mStride = std::max<uint32_t>(
+    1,
+    (sampleRate + mOptions.maxAnalysisSampleRate - 1)
+      / std::max<uint32_t>(mOptions.maxAnalysisSampleRate, 1));
+  const auto analysisRate = sampleRate / mStride;
+  mBlockFrames = std::max<uint32_t>(
+    1,
+    static_cast<uint32_t>(
+      (static_cast<uint64_t>(analysisRate) * BlockDuration.count()) / 1000));
+
+  mFrameIndex = 0;
+  mBlockSamples = 0;
+  mBlockSumSquares = 0;
+  mBlockZeroCrossings = 0;
+}
+
+bool VoiceActivityDetector::Process(const AudioBufferView& buffer) {
+  if (buffer.mChannels == 0 || buffer.mSampleRate == 0) {
+    return false;
+  }
+  if (buffer.mSampleRate != mSampleRate) {
+    Configure(buffer.mSampleRate);
+  }
+
+  const auto data = buffer.mIsSilent ? nullptr : buffer.mData;
+  switch (buffer.mFormat) {
+    case AudioSampleFormat::FLOAT32:
+      return ProcessSamples(
+        static_cast<const float*>(data), buffer.mFrames, buffer.mChannels);
+    case AudioSampleFormat::INT16:
+      return ProcessSamples(
+        static_cast<const int16_t*>(data), buffer.mFrames, buffer.mChannels);
+  }
+  return false;
+}
+
+template <class T>
+bool VoiceActivityDetector::ProcessSamples(
+  const T* samples,
+  uint32_t frames,
+  uint16_t channels) {
+  bool started = false;
+  for (uint32_t frame = 0; frame < frames; ++frame) {
+    if (++mFrameIndex < mStride) {
+      continue;
+    }
+    mFrameIndex = 0;
+
+    const auto sample
+      = samples ? ToFloat(samples[static_cast<size_t>(frame) * channels]) : 0;
+    const auto isNegative = sample < 0;
+    if (mBlockSamples > 0 && isNegative != mLastSampleWasNegative) {
+      ++mBlockZeroCrossings;
+    }
+    mLastSampleWasNegative = isNegative;
+    mBlockSumSquares += sample * sample;
+
+    if (++mBlockSamples >= mBlockFrames) {
+      started = EndBlock() || started;
+    }
+  }
+  return started;
+}
+
+bool VoiceActivityDetector::EndBlock() {
+  const auto samples = static_cast<float>(mBlockSamples);
+  const auto decibels
+    = 10 * std::log10((mBlockSumSquares / samples) + 1e-12f);
+  const auto zeroCrossingsPerSecond = (mBlockZeroCrossings * mSampleRate)
+    / (samples * static_cast<float>(mStride));
+
+  mBlockSamples = 0;
+  mBlockSumSquares = 0;
+  mBlockZeroCrossings = 0;
+
+  if (!mNoiseFloorDecibels) {
+    mNoiseFloorDecibels = decibels;
+  }
+  auto& noiseFloor = *mNoiseFloorDecibels;
+
+  const auto isSpeech = decibels >= mOptions.minimumDecibels
+    && decibels >= noiseFloor + mOptions.thresholdDecibels
+    && zeroCrossingsPerSecond <= MaxSpeechZeroCrossingsPerSecond;
+
+  // Follow falling levels immediately, but rising levels slowly, so that
+  // speech doesn't raise the floor, but a noise that continues does
+  noiseFloor = std::min(decibels, noiseFloor + NoiseFloorRiseDecibelsPerBlock);
+
+  if (!isSpeech) {
+    mSpeechBlocks = 0;
+    if (mInSpeech && ++mSilentBlocks >= mHangoverBlocks) {
+      mInSpeech = false;
+    }
+    return false;
+  }
+
+  mSilentBlocks = 0;
+  if (mInSpeech || ++mSpeechBlocks < mMinimumSpeechBlocks) {
+    return false;
+  }
+  mInSpeech = true;
+  return true;
+}
+
+}// namespace FredEmmott::Audio
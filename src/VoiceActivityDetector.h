@@ -0,0 +1,72 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "NativeAudioStreams.h"
+
+namespace FredEmmott::Audio {
+
+/* A streaming energy and zero-crossing voice activity detector.
+ *
+ * Audio is analysed in 10ms blocks of the first channel, decimated to at most
+ * `maxAnalysisSampleRate`. A block is speech-like if it is loud enough, far
+ * enough above an adaptive noise floor, and has a zero-crossing rate below
+ * that of broadband noise.
+ *
+ * `Process()` neither blocks nor allocates.
+ */
+class VoiceActivityDetector final {
+ public:
+  static constexpr auto BlockDuration = std::chrono::milliseconds(10);
+  // Voiced speech crosses zero far less often than hiss or fan noise
+  static constexpr float MaxSpeechZeroCrossingsPerSecond = 3500.0f;
+  // How quickly the noise floor follows rising levels
+  static constexpr float NoiseFloorRiseDecibelsPerBlock = 0.05f;
+
+  explicit VoiceActivityDetector(const SpeechWhileMutedOptions&);
+
+  // Returns true if speech started in this buffer
+  bool Process(const AudioBufferView&);
+  void Reset();
+
+ private:
+  const SpeechWhileMutedOptions mOptions;
+  const uint32_t mMinimumSpeechBlocks;
+  const uint32_t mHangoverBlocks;
+
+  // Derived from the sample rate of the most recent buffer
+  uint32_t mSampleRate {};
+  uint32_t mStride {1};
+  uint32_t mBlockFrames {};
+
+  // The block being accumulated
+  uint32_t mFrameIndex {};
+  uint32_t mBlockSamples {};
+  float mBlockSumSquares {};
+  uint32_t mBlockZeroCrossings {};
+  bool mLastSampleWasNegative {false};
+
+  std::optional<float> mNoiseFloorDecibels;
+  uint32_t mSpeechBlocks {};
+  uint32_t mSilentBlocks {};
+  bool mInSpeech {false};
+
+  void Configure(uint32_t sampleRate);
+  // `samples` is null for silence
+  template <class T>
+  bool ProcessSamples(const T* samples, uint32_t frames, uint16_t channels);
+  // Returns true if speech started with this block
+  bool EndBlock();
+};
+
+}// namespace FredEmmott::Audio
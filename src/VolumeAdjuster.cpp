@@ -0,0 +1,197 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "VolumeAdjuster.h"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace FredEmmott::Audio {
+
+VolumeAdjuster::VolumeAdjuster(TimerWheel* timers) : mTimers(timers) {
+}
+
+float VolumeAdjuster::GetAccelerationFactor(
+  VolumeAcceleration acceleration,
+  Clock::duration sinceLastAdjustment) {
+  if (
+    acceleration == VolumeAcceleration::NONE
+    || sinceLastAdjustment >= AccelerationWindow) {
+    return 1.0f;
+  }
+
+  constexpr auto MaxSpeed = 4.0f;
+  const auto speed = sinceLastAdjustment.count() <= 0
+    ? MaxSpeed
+    : std::min(
+      MaxSpeed,
+      std::chrono::duration<float>(AccelerationWindow)
+        / std::chrono::duration<float>(sinceLastAdjustment));
+
+  switch (acceleration) {
+    case VolumeAcceleration::NONE:
+      return 1.0f;
+    case VolumeAcceleration::LINEAR:
+      return speed;
+    case VolumeAcceleration::QUADRATIC:
+      return speed * speed;
+  }
+  return 1.0f;
+}
+
+bool VolumeAdjuster::NeedsResync(
+  const std::string& deviceID,
+  Clock::time_point now) const {
+  const auto it = mDevices.find(deviceID);
+  if (it == mDevices.end()) {
+    return true;
+  }
+  const auto& state = it->second;
+  return !state.mDirty && now - state.mLastAdjustment > ResyncInterval;
+}
+
+result<void> VolumeAdjuster::Adjust(
+  const std::string& deviceID,
+  float delta,
+  VolumeAcceleration acceleration,
+  WriteFailedCallback onWriteFailed) {
+  const auto now = Clock::now();
+
+  std::unique_lock lock(mMutex);
+  if (NeedsResync(deviceID, now)) {
+    // Not holding the lock, so a slow device doesn't block adjustments for
+    // other devices, or writes
+    lock.unlock();
+    const auto volume = GetDeviceVolume(deviceID);
+    if (!volume) {
+      return {unexpect, volume.error()};
+    }
+    lock.lock();
+    // Another adjustment may have started the burst while we were reading;
+    // if so, its target already includes its delta
+    if (NeedsResync(deviceID, now)) {
+      mDevices[deviceID].mTarget = volume->volumeScalar;
+    }
+  }
+
+  auto& state = mDevices.find(deviceID)->second;
+  const auto factor
+    = GetAccelerationFactor(acceleration, now - state.mLastAdjustment);
+  state.mTarget = std::clamp(state.mTarget + (delta * factor), 0.0f, 1.0f);
+  state.mLastAdjustment = std::max(now, state.mLastAdjustment);
+  if (onWriteFailed) {
+    state.mOnWriteFailed = std::move(onWriteFailed);
+  }
+  if (!state.mDirty) {
+    state.mDirty = true;
+    ScheduleFlush(std::max(now, state.mLastWrite + MinWriteInterval));
+  }
+  return {};
+}
+
+void VolumeAdjuster::ScheduleFlush(Clock::time_point when) {
+  if (mFlushScheduled) {
+    return;
+  }
+  mFlushScheduled = true;
+  mTimers->Schedule(when, [this]() { Flush(); });
+}
+
+void VolumeAdjuster::Flush() {
+  struct Write {
+    std::string mDeviceID;
+    float mTarget {};
+    std::optional<Error> mError {};
+  };
+  std::vector<Write> writes;
+  {
+    std::unique_lock lock(mMutex);
+    mFlushScheduled = false;
+    const auto now = Clock::now();
+    for (auto& [id, state]: mDevices) {
+      if (!state.mDirty || state.mLastWrite + MinWriteInterval > now) {
+        continue;
+      }
+      writes.push_back({.mDeviceID = id, .mTarget = state.mTarget});
+      state.mDirty = false;
+      state.mLastWrite = now;
+    }
+  }
+
+  // Don't block `Adjust()` on native calls; anything it accumulates in the
+  // meantime marks the device dirty again, and is written next time
+  for (auto& write: writes) {
+    auto written = SetDeviceVolumeScalar(write.mDeviceID, write.mTarget);
+    if (!written) {
+      write.mError = written.error();
+    }
+  }
+
+  // Invoked once the lock is released, as they may adjust the volume again
+  std::vector<std::pair<WriteFailedCallback, Error>> failures;
+  std::unique_lock lock(mMutex);
+  for (const auto& write: writes) {
+    const auto it = mDevices.find(write.mDeviceID);
+    if (it == mDevices.end()) {
+      continue;
+    }
+    auto& state = it->second;
+    if (!write.mError) {
+      state.mFailedWrites = 0;
+      continue;
+    }
+    // Retried with the latest target, so no deltas are lost
+    if (
+      *write.mError != Error::DEVICE_NOT_AVAILABLE
+      && ++state.mFailedWrites < MaxWriteAttempts) {
+      state.mDirty = true;
+      continue;
+    }
+    // The next adjustment starts over from whatever the device reports
+    if (state.mOnWriteFailed) {
+      failures.emplace_back(std::move(state.mOnWriteFailed), *write.mError);
+    }
+    mDevices.erase(it);
+  }
+
+  std::optional<Clock::time_point> nextDue;
+  for (const auto& [id, state]: mDevices) {
+    if (!state.mDirty) {
+      continue;
+    }
+    const auto due = state.mLastWrite + MinWriteInterval;
+    if (!(nextDue && *nextDue < due)) {
+      nextDue = due;
+    }
+  }
+  if (nextDue) {
+    ScheduleFlush(*nextDue);
+  }
+  lock.unlock();
+
+  for (const auto& [callback, error]: failures) {
+    callback(error);
+  }
+}
+
+VolumeAdjuster* GetVolumeAdjuster() {
+  // Intentionally leaked, like the timer wheel it runs on
+  static auto instance = new VolumeAdjuster(GetTimerWheel());
+  return instance;
+}
+
+result<void> AdjustDeviceVolumeBy(
+  const std::string& deviceID,
+  float delta,
+  VolumeAcceleration acceleration,
+  std::function<void(Error)> onWriteFailed) {
+  return GetVolumeAdjuster()->Adjust(
+    deviceID, delta, acceleration, std::move(onWriteFailed));
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,85 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "TimerWheel.h"
+
+namespace FredEmmott::Audio {
+
+/* Accumulates relative volume adjustments, and writes them to the device at
+ * a bounded rate from timer callbacks.
+ *
+ * Timer callbacks run one at a time, so writes for a device are never
+ * reordered; the last write is always the latest accumulated target.
+ */
+class VolumeAdjuster final {
+ public:
+  using Clock = TimerWheel::Clock;
+
+  static constexpr auto MinWriteInterval = std::chrono::milliseconds(16);
+  // Adjustments closer together than this are accelerated
+  static constexpr auto AccelerationWindow = std::chrono::milliseconds(50);
+  // If a device has been idle for this long, the next adjustment starts from
+  // the device's current volume instead of our last target, in case something
+  // else has changed it
+  static constexpr auto ResyncInterval = std::chrono::milliseconds(500);
+  // Consecutive failed writes before the pending target is dropped; writes
+  // that fail with `DEVICE_NOT_AVAILABLE` aren't retried
+  static constexpr uint32_t MaxWriteAttempts = 3;
+
+  explicit VolumeAdjuster(TimerWheel*);
+  VolumeAdjuster(const VolumeAdjuster&) = delete;
+  VolumeAdjuster& operator=(const VolumeAdjuster&) = delete;
+
+  using WriteFailedCallback = std::function<void(Error)>;
+
+  result<void> Adjust(
+    const std::string& deviceID,
+    float delta,
+    VolumeAcceleration,
+    WriteFailedCallback = {});
+
+  static float GetAccelerationFactor(
+    VolumeAcceleration,
+    Clock::duration sinceLastAdjustment);
+
+ private:
+  struct DeviceState {
+    float mTarget {};
+    bool mDirty {false};
+    Clock::time_point mLastAdjustment {};
+    Clock::time_point mLastWrite {};
+    uint32_t mFailedWrites {};
+    // From the latest adjustment that provided one
+    WriteFailedCallback mOnWriteFailed;
+  };
+
+  TimerWheel* mTimers {nullptr};
+
+  std::mutex mMutex;
+  bool mFlushScheduled {false};
+  std::map<std::string, DeviceState, std::less<>> mDevices;
+
+  // Require `mMutex`
+  bool NeedsResync(const std::string& deviceID, Clock::time_point now) const;
+  void ScheduleFlush(Clock::time_point);
+  void Flush();
+};
+
+// Process-wide instance, using `GetTimerWheel()`
+VolumeAdjuster* GetVolumeAdjuster();
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,79 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "VolumeBalance.h"
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace FredEmmott::Audio {
+
+std::optional<float> GetVolumeBalance(std::span<const float> channelVolumes) {
+  if (channelVolumes.size() < 2) {
+    return std::nullopt;
+  }
+  const auto left = channelVolumes[0];
+  const auto right = channelVolumes[1];
+  if (left <= 0 && right <= 0) {
+    return 0.0f;
+  }
+  const auto angle = std::atan2(right, left);
+  return std::clamp((angle * 4 / std::numbers::pi_v<float>) - 1, -1.0f, 1.0f);
+}
+
+void ApplyVolumeBalance(std::span<float> channelVolumes, float balance) {
+  if (channelVolumes.size() < 2) {
+    return;
+  }
+  auto& left = channelVolumes[0];
+  auto& right = channelVolumes[1];
+
+  const auto magnitude = std::hypot(left, right);
+  const auto angle
+    = (std::clamp(balance, -1.0f, 1.0f) + 1) * std::numbers::pi_v<float> / 4;
+  left = magnitude * std::cos(angle);
+  right = magnitude * std::sin(angle);
+
+  const auto peak = std::max(left, right);
+  if (peak > 1) {
+    left /= peak;
+    right /= peak;
+  }
+  left = std::clamp(left, 0.0f, 1.0f);
+  right = std::clamp(right, 0.0f, 1.0f);
+}
+
+result<float> GetDeviceVolumeBalance(const std::string& deviceID) {
+  const auto volumes = GetDeviceChannelVolumes(deviceID);
+  if (!volumes) {
+    return {unexpect, volumes.error()};
+  }
+  const auto balance = GetVolumeBalance(*volumes);
+  if (!balance) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  return *balance;
+}
+
+result<void> SetDeviceVolumeBalance(const std::string& deviceID, float value) {
+  if (value < -1 || value > 1) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  auto volumes = GetDeviceChannelVolumes(deviceID);
+  if (!volumes) {
+    return {unexpect, volumes.error()};
+  }
+  if (volumes->size() < 2) {
+    return {unexpect, Error::OPERATION_UNSUPPORTED};
+  }
+  ApplyVolumeBalance(*volumes, value);
+  return SetDeviceChannelVolumes(deviceID, *volumes);
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,29 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <optional>
+#include <span>
+
+namespace FredEmmott::Audio {
+
+/* Balance between channel 0 (left) and channel 1 (right), using a
+ * constant-power pan law: the angle of (left, right) from the left axis,
+ * mapped from [0, pi/2] to [-1, 1].
+ *
+ * Returns `std::nullopt` if there are fewer than two channels.
+ */
+std::optional<float> GetVolumeBalance(std::span<const float> channelVolumes);
+
+/* Moves channels 0 and 1 to `balance` along the constant-power arc through
+ * their current levels; other channels are unchanged.
+ *
+ * If a channel would exceed full scale, both are scaled down together.
+ */
+void ApplyVolumeBalance(std::span<float> channelVolumes, float balance);
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,80 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "VolumeChangeFilter.h"
+
+#include <algorithm>
+
+namespace FredEmmott::Audio {
+
+VolumeChangeFilter::VolumeChangeFilter(
+  CallbackDelivery delivery,
+  VolumeChangedFields interestingFields,
+  const std::optional<Volume>& initial)
+  : mDelivery(delivery),
+    mInterestingFields(interestingFields),
+    mLast(initial) {
+}
+
+VolumeChangedFields VolumeChangeFilter::GetChangedFields(
+  const Volume& before,
+  const Volume& after) {
+  auto changed = VolumeChangedFields::NONE;
+  if (before.isMuted != after.isMuted) {
+    changed |= VolumeChangedFields::MUTE;
+  }
+  // Exact comparisons are intended: our own writes echo back with identical
+  // values, and they're what we most want to drop
+  if (before.volumeScalar != after.volumeScalar) {
+    changed |= VolumeChangedFields::SCALAR;
+  }
+  if (before.volumeDecibels != after.volumeDecibels) {
+    changed |= VolumeChangedFields::DECIBELS;
+  }
+  if (before.volumeStep != after.volumeStep) {
+    changed |= VolumeChangedFields::STEP;
+  }
+  return changed;
+}
+
+std::optional<VolumeChangeEvent> VolumeChangeFilter::Update(
+  const Volume& volume,
+  std::span<const float> channelVolumes) {
+  std::unique_lock lock(mMutex);
+  const auto sequenceNumber = ++mSequenceNumber;
+
+  // With no previous value, everything has changed
+  constexpr auto allVolumeFields = VolumeChangedFields::MUTE
+    | VolumeChangedFields::SCALAR | VolumeChangedFields::DECIBELS
+    | VolumeChangedFields::STEP;
+  auto changed = mLast ? GetChangedFields(*mLast, volume) : allVolumeFields;
+  mLast = volume;
+
+  // Likewise, `mLastChannels` is empty until the first notification with
+  // channel volumes
+  if (!channelVolumes.empty()) {
+    if (!std::ranges::equal(mLastChannels, channelVolumes)) {
+      changed |= VolumeChangedFields::CHANNELS;
+    }
+    mLastChannels.assign(channelVolumes.begin(), channelVolumes.end());
+  }
+  changed = changed & mInterestingFields;
+
+  if (
+    mDelivery == CallbackDelivery::CHANGES_ONLY
+    && changed == VolumeChangedFields::NONE) {
+    return std::nullopt;
+  }
+
+  return VolumeChangeEvent {
+    .volume = volume,
+    .channelVolumes = channelVolumes,
+    .changedFields = changed,
+    .sequenceNumber = sequenceNumber,
+  };
+}
+
+}// namespace FredEmmott::Audio
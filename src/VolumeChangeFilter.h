@@ -0,0 +1,59 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace FredEmmott::Audio {
+
+/* Tracks the last reported `Volume` for a single callback registration.
+ *
+ * Native notifications are fed in as they arrive; the filter works out which
+ * fields changed, and whether the notification should be delivered at all.
+ */
+class VolumeChangeFilter final {
+ public:
+  /* `interestingFields` are the fields the callback reports; with
+   * `CHANGES_ONLY`, notifications that don't change any of them are dropped.
+   *
+   * `initial` is the value at registration time, if it could be retrieved.
+   */
+  VolumeChangeFilter(
+    CallbackDelivery,
+    VolumeChangedFields interestingFields,
+    const std::optional<Volume>& initial);
+
+  /* Returns `std::nullopt` if this notification should not be delivered.
+   *
+   * `channelVolumes` is empty if the notification doesn't include them; if
+   * present, the returned event refers to it, rather than a copy.
+   */
+  std::optional<VolumeChangeEvent> Update(
+    const Volume&,
+    std::span<const float> channelVolumes = {});
+
+  static VolumeChangedFields GetChangedFields(
+    const Volume& before,
+    const Volume& after);
+
+ private:
+  const CallbackDelivery mDelivery;
+  const VolumeChangedFields mInterestingFields;
+
+  std::mutex mMutex;
+  std::optional<Volume> mLast;
+  // Only reallocated if the channel count grows
+  std::vector<float> mLastChannels;
+  uint64_t mSequenceNumber {};
+};
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,50 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "VolumeCurve.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace FredEmmott::Audio {
+
+VolumeCurve::VolumeCurve(const VolumeRange& range) : mRange(range) {
+}
+
+float VolumeCurve::ScalarToDecibels(float scalar) const {
+  scalar = std::clamp(scalar, 0.0f, 1.0f);
+  return mRange.minDecibels
+    + (scalar * (mRange.maxDecibels - mRange.minDecibels));
+}
+
+float VolumeCurve::DecibelsToScalar(float decibels) const {
+  const auto span = mRange.maxDecibels - mRange.minDecibels;
+  if (span <= 0) {
+    return 1.0f;
+  }
+  decibels = std::clamp(decibels, mRange.minDecibels, mRange.maxDecibels);
+  return (decibels - mRange.minDecibels) / span;
+}
+
+uint32_t VolumeCurve::ScalarToStep(float scalar) const {
+  if (mRange.volumeSteps < 2) {
+    return 0;
+  }
+  scalar = std::clamp(scalar, 0.0f, 1.0f);
+  return static_cast<uint32_t>(
+    std::lround(scalar * static_cast<float>(mRange.volumeSteps - 1)));
+}
+
+float VolumeCurve::StepToScalar(uint32_t step) const {
+  if (mRange.volumeSteps < 2) {
+    return 1.0f;
+  }
+  step = std::min(step, mRange.volumeSteps - 1);
+  return static_cast<float>(step)
+    / static_cast<float>(mRange.volumeSteps - 1);
+}
+
+}// namespace FredEmmott::Audio
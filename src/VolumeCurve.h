@@ -0,0 +1,40 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <cstdint>
+
+namespace FredEmmott::Audio {
+
+/* Converts between volume scalars, decibels, and step indices, for backends
+ * where the OS doesn't do this for us.
+ *
+ * Scalars are in [0, 1], and map linearly to [minDecibels, maxDecibels] of
+ * the `VolumeRange`, as an audio taper; steps are evenly spaced scalars, from
+ * 0 to `volumeSteps - 1`.
+ */
+class VolumeCurve final {
+ public:
+  explicit VolumeCurve(const VolumeRange&);
+
+  float ScalarToDecibels(float scalar) const;
+  float DecibelsToScalar(float decibels) const;
+
+  uint32_t ScalarToStep(float scalar) const;
+  float StepToScalar(uint32_t step) const;
+
+  const VolumeRange& GetRange() const {
+    return mRange;
+  }
+
+ private:
+  VolumeRange mRange;
+};
+
+}// namespace FredEmmott::Audio
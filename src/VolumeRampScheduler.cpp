@@ -0,0 +1,346 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "VolumeRampScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace FredEmmott::Audio {
+
+namespace {
+
+constexpr uint32_t DefaultFrameRate = 60;
+
+std::chrono::steady_clock::duration GetFrameInterval(
+  uint32_t framesPerSecond) {
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(1.0 / std::max(framesPerSecond, 1u)));
+}
+
+}// namespace
+
+VolumeRampScheduler::VolumeRampScheduler(TimerWheel* timers)
+  : mTimers(timers), mFrameInterval(GetFrameInterval(DefaultFrameRate)) {
+}
+
+float VolumeRampScheduler::ApplyCurve(VolumeRampCurve curve, float progress) {
+  const auto t = std::clamp(progress, 0.0f, 1.0f);
+  switch (curve) {
+    case VolumeRampCurve::LINEAR:
+      return t;
+    case VolumeRampCurve::EASE_IN:
+      return t * t;
+    case VolumeRampCurve::EASE_OUT:
+      return 1 - ((1 - t) * (1 - t));
+    case VolumeRampCurve::EASE_IN_OUT:
+      return t * t * (3 - (2 * t));
+  }
+  return t;
+}
+
+result<void> VolumeRampScheduler::Start(
+  const std::string& deviceID,
+  float target,
+  Clock::duration duration,
+  VolumeRampCurve curve,
+  CompletionCallback onComplete) {
+  if (target < 0 || target > 1) {
+    return {unexpect, Error::OUT_OF_RANGE};
+  }
+  const auto volume = GetDeviceVolume(deviceID);
+  if (!volume) {
+    return {unexpect, volume.error()};
+  }
+
+  // Only destroyed after the lock is released; unused if another thread
+  // subscribes first
+  std::optional<VolumeCallbackHandle> subscription;
+  bool isPolled = false;
+  CompletionCallback cancelled;
+  while (true) {
+    {
+      std::unique_lock lock(mMutex);
+      // Every device state has either a subscription or `mIsPolled`
+      const auto it = mDevices.find(deviceID);
+      if (subscription || isPolled || it != mDevices.end()) {
+        auto& device = mDevices[deviceID];
+        if (device.mRamp) {
+          cancelled = std::move(device.mRamp->mOnComplete);
+        }
+        if (!(device.mSubscription || device.mIsPolled)) {
+          device.mSubscription = std::move(subscription);
+          device.mIsPolled = isPolled;
+        }
+        // If the replaced ramp is writing, its value stays in
+        // `mPendingValue`, so the echo isn't an interruption
+        device.mPreviousValue = volume->volumeScalar;
+        device.mLastValue = volume->volumeScalar;
+        device.mRamp = Ramp {
+          .mID = mNextID++,
+          .mFrom = volume->volumeScalar,
+          .mTo = target,
+          .mStart = Clock::now(),
+          .mDuration = duration,
+          .mCurve = curve,
+          .mOnComplete = std::move(onComplete),
+        };
+        ScheduleFrame(device.mRamp->mStart);
+        break;
+      }
+    }
+
+    // Without the lock, as registering makes native calls
+    auto handle = AddAudioDeviceVolumeChangeCallback(
+      deviceID, [this, deviceID](const VolumeChangeEvent& event) {
+        OnVolumeChanged(deviceID, event.volume.volumeScalar);
+      });
+    if (handle) {
+      subscription.emplace(*handle);
+    } else {
+      // For example, `OPERATION_UNSUPPORTED`; each frame reads the volume
+      // back instead. If the device has gone, the first write fails.
+      isPolled = true;
+    }
+  }
+
+  if (cancelled) {
+    cancelled(VolumeRampResult::CANCELLED);
+  }
+  return {};
+}
+
+void VolumeRampScheduler::Cancel(const std::string& deviceID) {
+  CompletionCallback cancelled;
+  std::vector<VolumeCallbackHandle> released;
+  {
+    std::unique_lock lock(mMutex);
+    const auto it = mDevices.find(deviceID);
+    if (it == mDevices.end() || !it->second.mRamp) {
+      return;
+    }
+    cancelled = std::move(it->second.mRamp->mOnComplete);
+    it->second.mRamp.reset();
+    ReleaseIfIdle(it, &released);
+  }
+
+  if (cancelled) {
+    cancelled(VolumeRampResult::CANCELLED);
+  }
+}
+
+void VolumeRampScheduler::SetFrameRate(uint32_t framesPerSecond) {
+  std::unique_lock lock(mMutex);
+  mFrameInterval = GetFrameInterval(framesPerSecond);
+}
+
+void VolumeRampScheduler::ScheduleFrame(Clock::time_point when) {
+  if (mFrameScheduled) {
+    return;
+  }
+  mFrameScheduled = true;
+  mTimers->Schedule(when, [this]() { RunFrame(); });
+}
+
+void VolumeRampScheduler::ReleaseIfIdle(
+  decltype(mDevices)::iterator it,
+  std::vector<VolumeCallbackHandle>* released) {
+  auto& device = it->second;
+  if (device.mRamp || device.mPendingValue) {
+    return;
+  }
+  if (device.mSubscription) {
+    released->push_back(*device.mSubscription);
+  }
+  mDevices.erase(it);
+}
+
+void VolumeRampScheduler::OnVolumeChanged(
+  const std::string& deviceID,
+  float scalar) {
+  std::unique_lock lock(mMutex);
+  const auto it = mDevices.find(deviceID);
+  if (it == mDevices.end() || !it->second.mRamp) {
+    return;
+  }
+  auto& device = it->second;
+  if (IsInterruption(GetExpectedRange(device), scalar)) {
+    device.mRamp->mIsInterrupted = true;
+  }
+}
+
+std::pair<float, float> VolumeRampScheduler::GetExpectedRange(
+  const DeviceState& device) {
+  auto low = std::min(device.mPreviousValue, device.mLastValue);
+  auto high = std::max(device.mPreviousValue, device.mLastValue);
+  if (device.mPendingValue) {
+    low = std::min(low, *device.mPendingValue);
+    high = std::max(high, *device.mPendingValue);
+  }
+  return {low, high};
+}
+
+bool VolumeRampScheduler::IsInterruption(
+  const std::pair<float, float>& expected,
+  float scalar) {
+  return scalar < expected.first - InterruptionThreshold
+    || scalar > expected.second + InterruptionThreshold;
+}
+
+void VolumeRampScheduler::RunFrame() {
+  struct Step {
+    std::string mDeviceID;
+    uint64_t mRampID {};
+    float mValue {};
+    bool mIsWrite {false};
+    bool mIsLast {false};
+    // Set if the volume must be read back to detect interruptions
+    std::optional<std::pair<float, float>> mExpectedRange {};
+    std::optional<VolumeRampResult> mResult {};
+  };
+  std::vector<Step> steps;
+
+  const auto now = Clock::now();
+  {
+    std::unique_lock lock(mMutex);
+    mFrameScheduled = false;
+    steps.reserve(mDevices.size());
+    for (auto& [id, device]: mDevices) {
+      if (!device.mRamp) {
+        continue;
+      }
+      const auto& ramp = *device.mRamp;
+      if (ramp.mIsInterrupted) {
+        steps.push_back({
+          .mDeviceID = id,
+          .mRampID = ramp.mID,
+          .mResult = VolumeRampResult::INTERRUPTED,
+        });
+        continue;
+      }
+      const auto progress = ramp.mDuration <= Clock::duration::zero()
+        ? 1.0f
+        : std::chrono::duration<float>(now - ramp.mStart)
+          / std::chrono::duration<float>(ramp.mDuration);
+      const auto value = ramp.mFrom
+        + ((ramp.mTo - ramp.mFrom) * ApplyCurve(ramp.mCurve, progress));
+      std::optional<std::pair<float, float>> expected;
+      if (device.mIsPolled) {
+        expected = GetExpectedRange(device);
+      }
+      device.mPendingValue = value;
+      steps.push_back({
+        .mDeviceID = id,
+        .mRampID = ramp.mID,
+        .mValue = value,
+        .mIsWrite = true,
+        .mIsLast = progress >= 1.0f,
+        .mExpectedRange = expected,
+      });
+    }
+  }
+
+  // Native calls without the lock, so that starting or cancelling a ramp
+  // never waits for a device
+  for (auto& step: steps) {
+    if (!step.mIsWrite) {
+      continue;
+    }
+    if (step.mExpectedRange) {
+      const auto volume = GetDeviceVolume(step.mDeviceID);
+      if (!volume) {
+        step.mIsWrite = false;
+        step.mResult = VolumeRampResult::FAILED;
+        continue;
+      }
+      if (IsInterruption(*step.mExpectedRange, volume->volumeScalar)) {
+        step.mIsWrite = false;
+        step.mResult = VolumeRampResult::INTERRUPTED;
+        continue;
+      }
+    }
+    if (!SetDeviceVolumeScalar(step.mDeviceID, step.mValue)) {
+      step.mIsWrite = false;
+      step.mResult = VolumeRampResult::FAILED;
+      continue;
+    }
+    if (step.mIsLast) {
+      step.mResult = VolumeRampResult::COMPLETED;
+    }
+  }
+
+  std::vector<std::pair<CompletionCallback, VolumeRampResult>> completed;
+  std::vector<VolumeCallbackHandle> released;
+  {
+    std::unique_lock lock(mMutex);
+    for (const auto& step: steps) {
+      const auto it = mDevices.find(step.mDeviceID);
+      if (it == mDevices.end()) {
+        continue;
+      }
+      auto& device = it->second;
+      if (step.mIsWrite) {
+        device.mPreviousValue = device.mLastValue;
+        device.mLastValue = step.mValue;
+      }
+      device.mPendingValue.reset();
+
+      // Cancelled or replaced while we weren't holding the lock
+      if (!device.mRamp || device.mRamp->mID != step.mRampID) {
+        ReleaseIfIdle(it, &released);
+        continue;
+      }
+      if (!step.mResult) {
+        continue;
+      }
+      completed.emplace_back(
+        std::move(device.mRamp->mOnComplete), *step.mResult);
+      device.mRamp.reset();
+      ReleaseIfIdle(it, &released);
+    }
+    const auto isRamping = std::ranges::any_of(mDevices, [](const auto& it) {
+      return it.second.mRamp.has_value();
+    });
+    if (isRamping) {
+      ScheduleFrame(now + mFrameInterval);
+    }
+  }
+
+  for (const auto& [callback, result]: completed) {
+    if (callback) {
+      callback(result);
+    }
+  }
+}
+
+VolumeRampScheduler* GetVolumeRampScheduler() {
+  // Intentionally leaked, like the timer wheel it runs on
+  static auto instance = new VolumeRampScheduler(GetTimerWheel());
+  return instance;
+}
+
+result<void> RampDeviceVolume(
+  const std::string& deviceID,
+  float target,
+  std::chrono::milliseconds duration,
+  VolumeRampCurve curve,
+  std::function<void(VolumeRampResult)> onComplete) {
+  return GetVolumeRampScheduler()->Start(
+    deviceID, target, duration, curve, std::move(onComplete));
+}
+
+void CancelDeviceVolumeRamp(const std::string& deviceID) {
+  GetVolumeRampScheduler()->Cancel(deviceID);
+}
+
+void SetVolumeRampFrameRate(uint32_t framesPerSecond) {
+  GetVolumeRampScheduler()->SetFrameRate(framesPerSecond);
+}
+
+}// namespace FredEmmott::Audio
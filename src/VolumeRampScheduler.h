@@ -0,0 +1,113 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TimerWheel.h"
+
+namespace FredEmmott::Audio {
+
+/* Services every active volume ramp from a single repeating frame timer.
+ *
+ * Interruptions are detected from volume change notifications, rather than
+ * by reading the volume every frame: a notification is an echo of our own
+ * writes if it's between the previous value written to the device and the
+ * value being written now. Anything else stops the ramp with `INTERRUPTED`
+ * on the next frame.
+ *
+ * If the platform can't notify volume changes for a device, each frame reads
+ * the volume back before writing, and compares it in the same way; a change
+ * made between the read and the write is overwritten.
+ */
+class VolumeRampScheduler final {
+ public:
+  using Clock = TimerWheel::Clock;
+  using CompletionCallback = std::function<void(VolumeRampResult)>;
+
+  // Allows for the OS rounding our own writes
+  static constexpr float InterruptionThreshold = 0.005f;
+
+  explicit VolumeRampScheduler(TimerWheel*);
+  VolumeRampScheduler(const VolumeRampScheduler&) = delete;
+  VolumeRampScheduler& operator=(const VolumeRampScheduler&) = delete;
+
+  result<void> Start(
+    const std::string& deviceID,
+    float target,
+    Clock::duration,
+    VolumeRampCurve,
+    CompletionCallback);
+  void Cancel(const std::string& deviceID);
+  void SetFrameRate(uint32_t framesPerSecond);
+
+  // Maps linear progress in [0, 1] to ramp progress in [0, 1]
+  static float ApplyCurve(VolumeRampCurve, float progress);
+
+ private:
+  struct Ramp {
+    uint64_t mID {};
+    float mFrom {};
+    float mTo {};
+    Clock::time_point mStart {};
+    Clock::duration mDuration {};
+    VolumeRampCurve mCurve {};
+    CompletionCallback mOnComplete;
+    bool mIsInterrupted {false};
+  };
+
+  // Outlives ramps that are replaced or cancelled while a frame is writing
+  // to the device, so that the write isn't mistaken for an interruption
+  struct DeviceState {
+    std::optional<Ramp> mRamp;
+    std::optional<VolumeCallbackHandle> mSubscription;
+    // Set instead of `mSubscription` if notifications are unavailable
+    bool mIsPolled {false};
+    float mPreviousValue {};
+    float mLastValue {};
+    // Set while a frame is writing to the device without the lock
+    std::optional<float> mPendingValue;
+  };
+
+  TimerWheel* mTimers {nullptr};
+
+  std::mutex mMutex;
+  Clock::duration mFrameInterval;
+  uint64_t mNextID {1};
+  bool mFrameScheduled {false};
+  std::map<std::string, DeviceState, std::less<>> mDevices;
+
+  // Requires `mMutex`
+  void ScheduleFrame(Clock::time_point);
+  // Requires `mMutex`; moves the subscription into `released` if the device
+  // state is no longer needed, so that it can be destroyed without the lock
+  void ReleaseIfIdle(
+    decltype(mDevices)::iterator,
+    std::vector<VolumeCallbackHandle>* released);
+  void RunFrame();
+  void OnVolumeChanged(const std::string& deviceID, float scalar);
+
+  // Requires `mMutex`; the range of values our own writes may have left the
+  // device at
+  static std::pair<float, float> GetExpectedRange(const DeviceState&);
+  static bool IsInterruption(
+    const std::pair<float, float>& expected,
+    float scalar);
+};
+
+// Process-wide instance, using `GetTimerWheel()`
+VolumeRampScheduler* GetVolumeRampScheduler();
+
+}// namespace FredEmmott::Audio
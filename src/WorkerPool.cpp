@@ -0,0 +1,61 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "WorkerPool.h"
+
+#include <thread>
+
+#include "NativeDevices.h"
+
+namespace FredEmmott::Audio {
+
+WorkerPool::WorkerPool(size_t threadCount) : mThreadCount(threadCount) {
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::unique_lock lock(mState->mMutex);
+    mState->mIsStopping = true;
+  }
+  mState->mWake.notify_all();
+}
+
+void WorkerPool::Enqueue(std::function<void()> task) {
+  std::call_once(mStarted, [this]() {
+    for (size_t i = 0; i < mThreadCount; ++i) {
+      std::thread([state = mState]() { Run(state); }).detach();
+    }
+  });
+  {
+    std::unique_lock lock(mState->mMutex);
+    mState->mTasks.push_back(std::move(task));
+  }
+  mState->mWake.notify_one();
+}
+
+void WorkerPool::Run(const std::shared_ptr<State>& state) {
+  InitializeNativeThread();
+
+  std::unique_lock lock(state->mMutex);
+  while (true) {
+    state->mWake.wait(lock, [&state]() {
+      return state->mIsStopping || !state->mTasks.empty();
+    });
+    if (state->mTasks.empty()) {
+      return;
+    }
+    auto task = std::move(state->mTasks.front());
+    state->mTasks.pop_front();
+
+    lock.unlock();
+    task();
+    // Released before relocking, as it may own the pool
+    task = {};
+    lock.lock();
+  }
+}
+
+}// namespace FredEmmott::Audio
@@ -0,0 +1,58 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace FredEmmott::Audio {
+
+/* A fixed set of library-owned threads, for native calls that are slow but
+ * independent of each other, such as resolving devices.
+ *
+ * Tasks are started in the order they were enqueued, but may run
+ * concurrently, and finish in any order.
+ *
+ * The threads are started by the first `Enqueue()`. Destroying the pool
+ * doesn't wait for them: they finish the tasks that are already queued, then
+ * exit. This means a task may destroy the pool that it's running on.
+ */
+class WorkerPool final {
+ public:
+  static constexpr size_t DefaultThreadCount = 4;
+
+  explicit WorkerPool(size_t threadCount);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  void Enqueue(std::function<void()>);
+
+ private:
+  // Shared with the threads, as they can outlive the pool
+  struct State {
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<std::function<void()>> mTasks;
+    bool mIsStopping {false};
+  };
+
+  const size_t mThreadCount;
+  const std::shared_ptr<State> mState {std::make_shared<State>()};
+  std::once_flag mStarted;
+
+  static void Run(const std::shared_ptr<State>&);
+};
+
+// The default `AudioContext`'s instance
+WorkerPool* GetWorkerPool();
+
+}// namespace FredEmmott::Audio
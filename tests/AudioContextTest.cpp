@@ -0,0 +1,190 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+// A device quarantined by one context can still be used by another
+void TestQuarantineIsPerContext() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("shared");
+  const auto gate = std::make_shared<Gate>();
+  backend.SetNativeCallHook([gate](std::string_view function) {
+    if (function == "IsNativeDeviceMuted") {
+      gate->Wait();
+    }
+  });
+
+  auto hung = CreateAudioContext();
+  hung.SetNativeCallTimeout(std::chrono::milliseconds(20));
+  auto muted = hung.IsAudioDeviceMuted("shared");
+  CHECK(muted.error() == Error::TIMEOUT);
+  auto volume = hung.GetDeviceVolume("shared");
+  CHECK(volume.error() == Error::TIMEOUT);
+
+  auto other = CreateAudioContext();
+  other.SetNativeCallTimeout(std::chrono::seconds(10));
+  CHECK(other.GetDeviceVolume("shared").has_value());
+
+  gate->Release();
+  backend.SetNativeCallHook({});
+}
+
+// Each context has its own threading mode and backend thread
+void TestThreadingIsPerContext() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("threads");
+
+  std::mutex mutex;
+  std::thread::id callingThread;
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function == "GetNativeDeviceVolume") {
+      std::unique_lock lock(mutex);
+      callingThread = std::this_thread::get_id();
+    }
+  });
+  const auto getCallingThread = [&]() {
+    std::unique_lock lock(mutex);
+    return callingThread;
+  };
+
+  auto backendContext = CreateAudioContext();
+  backendContext.SetNativeCallThreading(NativeCallThreading::BACKEND_THREAD);
+  std::atomic<std::thread::id> backendThread;
+  backendContext.PostToAudioBackendThread(
+    [&]() { backendThread = std::this_thread::get_id(); });
+  CHECK(backendContext.GetDeviceVolume("threads").has_value());
+  CHECK(getCallingThread() == backendThread.load());
+
+  auto otherBackendContext = CreateAudioContext();
+  otherBackendContext.SetNativeCallThreading(
+    NativeCallThreading::BACKEND_THREAD);
+  CHECK(otherBackendContext.GetDeviceVolume("threads").has_value());
+  CHECK(getCallingThread() != backendThread.load());
+  CHECK(getCallingThread() != std::this_thread::get_id());
+
+  auto callingContext = CreateAudioContext();
+  CHECK(callingContext.GetDeviceVolume("threads").has_value());
+  CHECK(getCallingThread() == std::this_thread::get_id());
+
+  backend.SetNativeCallHook({});
+}
+
+// Destroying a context doesn't wait for a hung call
+void TestDestroyWhileHung() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("destroyed");
+  const auto gate = std::make_shared<Gate>();
+  const auto returned = std::make_shared<std::atomic<bool>>(false);
+  backend.SetNativeCallHook([gate, returned](std::string_view function) {
+    if (function == "IsNativeDeviceMuted") {
+      gate->Wait();
+      *returned = true;
+    }
+  });
+
+  {
+    auto context = CreateAudioContext();
+    context.SetNativeCallTimeout(std::chrono::milliseconds(20));
+    auto muted = context.IsAudioDeviceMuted("destroyed");
+    CHECK(muted.error() == Error::TIMEOUT);
+  }
+  CHECK(!*returned);
+  gate->Release();
+  CHECK(WaitUntil([&]() { return returned->load(); }));
+  backend.SetNativeCallHook({});
+}
+
+void TestCachesArePerContext() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  constexpr auto Output = AudioDeviceDirection::OUTPUT;
+  constexpr auto Default = AudioDeviceRole::DEFAULT;
+  backend.SetNativeDefault(Output, Default, "speakers");
+  AddFakeDevice("speakers");
+
+  auto first = CreateAudioContext();
+  auto second = CreateAudioContext();
+  CHECK(first.GetDefaultAudioDeviceID(Output, Default) == "speakers");
+  CHECK(first.GetDefaultAudioDeviceID(Output, Default) == "speakers");
+  CHECK(backend.GetCallCount("GetNativeDefaultAudioDeviceID") == 1);
+  CHECK(second.GetDefaultAudioDeviceID(Output, Default) == "speakers");
+  CHECK(backend.GetCallCount("GetNativeDefaultAudioDeviceID") == 2);
+
+  CHECK(first.GetDeviceStreamProperties("speakers").has_value());
+  CHECK(first.GetDeviceStreamProperties("speakers").has_value());
+  CHECK(backend.GetCallCount("QueryNativeStreamProperties") == 1);
+
+  first.ResetCaches();
+  CHECK(first.GetDefaultAudioDeviceID(Output, Default) == "speakers");
+  CHECK(backend.GetCallCount("GetNativeDefaultAudioDeviceID") == 3);
+  CHECK(first.GetDeviceStreamProperties("speakers").has_value());
+  CHECK(backend.GetCallCount("QueryNativeStreamProperties") == 2);
+  // Only the context that was reset
+  CHECK(second.GetDefaultAudioDeviceID(Output, Default) == "speakers");
+  CHECK(backend.GetCallCount("GetNativeDefaultAudioDeviceID") == 3);
+}
+
+// After `Shutdown()`, calls still work, but nothing is cached or watched
+void TestShutdown() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("shutdown");
+
+  auto context = CreateAudioContext();
+  std::atomic<size_t> notified {0};
+  auto handle = context.AddDeviceStreamPropertiesCallback(
+    "shutdown", [&](const AudioDeviceStreamProperties&) { ++notified; });
+  CHECK(handle.has_value());
+
+  context.Shutdown();
+  // Idempotent
+  context.Shutdown();
+
+  FakeBackend::Get().UpdateDevice("shutdown", [](FakeDevice& device) {
+    device.streamProperties.format.sampleRate = 44100;
+  });
+  backend.NotifyStreamPropertiesChanged("shutdown");
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  CHECK(notified == 0);
+
+  const auto added = context.AddDeviceStreamPropertiesCallback(
+    "shutdown", [](const AudioDeviceStreamProperties&) {});
+  CHECK(added.error() == Error::OPERATION_UNSUPPORTED);
+
+  const auto before = backend.GetCallCount("QueryNativeStreamProperties");
+  const auto properties = context.GetDeviceStreamProperties("shutdown");
+  CHECK(properties.has_value());
+  CHECK(properties->format.sampleRate == 44100);
+  CHECK(context.GetDeviceStreamProperties("shutdown").has_value());
+  CHECK(backend.GetCallCount("QueryNativeStreamProperties") == before + 2);
+}
+
+}// namespace
+
+int main() {
+  TestQuarantineIsPerContext();
+  TestThreadingIsPerContext();
+  TestDestroyWhileHung();
+  TestCachesArePerContext();
+  TestShutdown();
+  return 0;
+}
@@ -0,0 +1,184 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using WatchKind = FakeBackend::WatchKind;
+
+// Records the events that a callback receives
+class Recorder final {
+ public:
+  void operator()(const AudioDeviceChangeEvent& event) {
+    std::unique_lock lock(mMutex);
+    mEvents.push_back(event);
+  }
+
+  std::vector<AudioDeviceChangeEvent> Get() const {
+    std::unique_lock lock(mMutex);
+    return mEvents;
+  }
+
+  size_t GetCount() const {
+    std::unique_lock lock(mMutex);
+    return mEvents.size();
+  }
+
+  // Waits for the next event after the first `count`
+  std::optional<AudioDeviceChangeEvent> WaitForEvent(size_t count) const {
+    if (!WaitUntil([&]() { return GetCount() > count; })) {
+      return std::nullopt;
+    }
+    std::unique_lock lock(mMutex);
+    return mEvents[count];
+  }
+
+ private:
+  mutable std::mutex mMutex;
+  std::vector<AudioDeviceChangeEvent> mEvents;
+};
+
+void Update(
+  const std::string& id,
+  const std::function<void(AudioDeviceInfo&)>& update) {
+  auto& backend = FakeBackend::Get();
+  CHECK(backend.UpdateDevice(
+    id, [&update](FakeDevice& device) { update(device.info); }));
+  backend.NotifyDeviceInfoChanged(id);
+}
+
+void Test() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("speakers", AudioDeviceDirection::OUTPUT);
+  AddFakeDevice("microphone", AudioDeviceDirection::INPUT);
+
+  // Known devices first
+  Recorder first;
+  std::optional<AudioDeviceChangeCallbackHandle> firstHandle
+    = AddAudioDeviceChangeCallback([&first](const auto& e) { first(e); });
+  CHECK(WaitUntil([&]() { return first.GetCount() == 2; }));
+  for (const auto& event: first.Get()) {
+    CHECK(event.kind == AudioDeviceChangeKind::ADDED);
+    CHECK(event.changedFields == AudioDeviceInfoFields::ALL);
+    CHECK(event.info == backend.GetDevice(event.info.id)->info);
+  }
+  // One native registration per device
+  CHECK(backend.GetWatchCount(WatchKind::DEVICE_INFO, "speakers") == 1);
+  CHECK(backend.GetWatchCount(WatchKind::DEVICE_INFO, "microphone") == 1);
+
+  Update("speakers", [](auto& info) { info.displayName = "Renamed"; });
+  auto event = first.WaitForEvent(2);
+  CHECK(event);
+  CHECK(event->kind == AudioDeviceChangeKind::CHANGED);
+  CHECK(event->changedFields == AudioDeviceInfoFields::DISPLAY_NAME);
+  CHECK(event->info.id == "speakers");
+  CHECK(event->info.displayName == "Renamed");
+
+  // Disabled devices are changed, not removed
+  Update("speakers", [](auto& info) {
+    info.state = AudioDeviceState::DEVICE_DISABLED;
+  });
+  event = first.WaitForEvent(3);
+  CHECK(event);
+  CHECK(event->kind == AudioDeviceChangeKind::CHANGED);
+  CHECK(event->changedFields == AudioDeviceInfoFields::STATE);
+  CHECK(event->info.state == AudioDeviceState::DEVICE_DISABLED);
+
+  // Notifications that don't change anything aren't delivered
+  backend.NotifyDeviceInfoChanged("microphone");
+  Update("microphone", [](auto& info) {
+    info.interfaceName = "Renamed";
+    info.endpointName = "Renamed";
+  });
+  event = first.WaitForEvent(4);
+  CHECK(event);
+  CHECK(event->info.id == "microphone");
+  CHECK(
+    event->changedFields
+    == (AudioDeviceInfoFields::INTERFACE_NAME
+        | AudioDeviceInfoFields::ENDPOINT_NAME));
+
+  AddFakeDevice("headset", AudioDeviceDirection::OUTPUT);
+  backend.DispatchAdded(AudioDeviceDirection::OUTPUT, "headset");
+  event = first.WaitForEvent(5);
+  CHECK(event);
+  CHECK(event->kind == AudioDeviceChangeKind::ADDED);
+  CHECK(event->info.id == "headset");
+  CHECK(WaitUntil([&]() {
+    return backend.GetWatchCount(WatchKind::DEVICE_INFO, "headset") == 1;
+  }));
+
+  // The native registration is removed with the device
+  const auto headset = backend.GetDevice("headset")->info;
+  backend.RemoveDevice("headset");
+  backend.DispatchRemoved(AudioDeviceDirection::OUTPUT, "headset");
+  event = first.WaitForEvent(6);
+  CHECK(event);
+  CHECK(event->kind == AudioDeviceChangeKind::REMOVED);
+  CHECK(event->changedFields == AudioDeviceInfoFields::NONE);
+  CHECK(event->info == headset);
+  CHECK(backend.GetWatchCount(WatchKind::DEVICE_INFO, "headset") == 0);
+
+  // Later subscribers get the current state
+  Recorder second;
+  const auto secondHandle
+    = AddAudioDeviceChangeCallback([&second](const auto& e) { second(e); });
+  CHECK(WaitUntil([&]() { return second.GetCount() == 2; }));
+  for (const auto& added: second.Get()) {
+    CHECK(added.kind == AudioDeviceChangeKind::ADDED);
+    CHECK(added.info == backend.GetDevice(added.info.id)->info);
+  }
+
+  // Nothing after the handle is destroyed
+  firstHandle.reset();
+  const auto firstCount = first.GetCount();
+  Update("speakers", [](auto& info) { info.displayName = "Again"; });
+  event = second.WaitForEvent(2);
+  CHECK(event);
+  CHECK(event->info.displayName == "Again");
+  CHECK(first.GetCount() == firstCount);
+
+  // A device that is slow to query doesn't delay the others
+  const auto gate = std::make_shared<Gate>();
+  std::atomic<bool> isBlocking {true};
+  backend.SetNativeCallHook([gate, &isBlocking](std::string_view function) {
+    if (function == "GetNativeDeviceInfo" && isBlocking.exchange(false)) {
+      gate->Wait();
+    }
+  });
+  Update("speakers", [](auto& info) { info.displayName = "Slow"; });
+  CHECK(WaitUntil([&]() { return !isBlocking; }));
+  Update("microphone", [](auto& info) { info.displayName = "Fast"; });
+  event = second.WaitForEvent(3);
+  CHECK(event);
+  CHECK(event->info.id == "microphone");
+  gate->Release();
+  event = second.WaitForEvent(4);
+  CHECK(event);
+  CHECK(event->info.displayName == "Slow");
+  backend.SetNativeCallHook({});
+}
+
+}// namespace
+
+int main() {
+  Test();
+  return 0;
+}
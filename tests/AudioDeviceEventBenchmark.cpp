@@ -0,0 +1,63 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "Benchmark.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t Iterations = 10000;
+
+// From the native notification to the callback
+void BenchmarkDeliveryLatency(bool useViews) {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  std::atomic<Clock::time_point> delivered {};
+  const auto callback = useViews
+    ? AddAudioDeviceEventViewCallback(
+        {},
+        [&delivered](const AudioDeviceEventView&) {
+          delivered.store(Clock::now());
+        })
+    : AddAudioDeviceEventCallback({}, [&delivered](const AudioDeviceEvent&) {
+        delivered.store(Clock::now());
+      });
+
+  const std::string deviceID("a-typical-length-device-id-{0.0.0.00000000}");
+  const auto isDelivered = [&delivered]() {
+    return delivered.load() != Clock::time_point {};
+  };
+  Samples samples;
+  for (size_t i = 0; i < Iterations; ++i) {
+    delivered.store({});
+    const auto start = Clock::now();
+    backend.DispatchAdded(AudioDeviceDirection::OUTPUT, deviceID);
+    CHECK(WaitUntil(isDelivered));
+    samples.Add(delivered.load() - start);
+  }
+  samples.Print(
+    useViews ? "AddAudioDeviceEventViewCallback()"
+             : "AddAudioDeviceEventCallback()");
+}
+
+}// namespace
+
+int main() {
+  BenchmarkDeliveryLatency(true);
+  BenchmarkDeliveryLatency(false);
+  return 0;
+}
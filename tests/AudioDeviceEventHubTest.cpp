@@ -0,0 +1,174 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "AudioDeviceEventHub.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+constexpr auto Output = AudioDeviceDirection::OUTPUT;
+constexpr auto Input = AudioDeviceDirection::INPUT;
+
+AudioDeviceEventView Plug(
+  AudioDeviceEventKind kind,
+  AudioDeviceDirection direction,
+  std::string_view id) {
+  return {.kind = kind, .direction = direction, .deviceID = id};
+}
+
+void TestMatcher() {
+  const AudioDeviceEventMatcher any({});
+  CHECK(any.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "a")));
+
+  const AudioDeviceEventMatcher kinds(
+    {.kinds = {AudioDeviceEventKind::REMOVED}});
+  CHECK(!kinds.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "a")));
+  CHECK(kinds.Matches(Plug(AudioDeviceEventKind::REMOVED, Output, "a")));
+
+  const AudioDeviceEventMatcher changes({
+    .kinds = {
+      AudioDeviceEventKind::STATE_CHANGED,
+      AudioDeviceEventKind::PROPERTY_CHANGED,
+    },
+  });
+  CHECK(!changes.Matches(Plug(AudioDeviceEventKind::REMOVED, Output, "a")));
+  CHECK(
+    changes.Matches(Plug(AudioDeviceEventKind::STATE_CHANGED, Output, "a")));
+  CHECK(
+    changes.Matches(Plug(AudioDeviceEventKind::PROPERTY_CHANGED, Output, "a")));
+
+  const AudioDeviceEventMatcher directions({.directions = {Input}});
+  CHECK(!directions.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "a")));
+  CHECK(directions.Matches(Plug(AudioDeviceEventKind::ADDED, Input, "a")));
+
+  // Roles are only checked for events that have one
+  const AudioDeviceEventMatcher roles(
+    {.roles = {AudioDeviceRole::COMMUNICATION}});
+  CHECK(roles.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "a")));
+  CHECK(!roles.Matches({
+    .kind = AudioDeviceEventKind::DEFAULT_CHANGED,
+    .direction = Output,
+    .role = AudioDeviceRole::DEFAULT,
+    .deviceID = "a",
+  }));
+  CHECK(roles.Matches({
+    .kind = AudioDeviceEventKind::DEFAULT_CHANGED,
+    .direction = Output,
+    .role = AudioDeviceRole::COMMUNICATION,
+    .deviceID = "a",
+  }));
+
+  const AudioDeviceEventMatcher prefix({.deviceIDPrefix = "{0.0.1."});
+  CHECK(prefix.Matches(Plug(AudioDeviceEventKind::ADDED, Input, "{0.0.1.x}")));
+  CHECK(
+    !prefix.Matches(Plug(AudioDeviceEventKind::ADDED, Input, "{0.0.0.x}")));
+
+  // Duplicates are harmless
+  const AudioDeviceEventMatcher ids({.deviceIDs = {"c", "a", "c"}});
+  CHECK(ids.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "a")));
+  CHECK(!ids.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "b")));
+  CHECK(ids.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "c")));
+
+  // Every non-empty field must match
+  const AudioDeviceEventMatcher all({
+    .kinds = {AudioDeviceEventKind::ADDED},
+    .directions = {Input},
+    .deviceIDs = {"a"},
+  });
+  CHECK(all.Matches(Plug(AudioDeviceEventKind::ADDED, Input, "a")));
+  CHECK(!all.Matches(Plug(AudioDeviceEventKind::ADDED, Output, "a")));
+  CHECK(!all.Matches(Plug(AudioDeviceEventKind::REMOVED, Input, "a")));
+}
+
+void TestFilteredDelivery() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+
+  std::vector<std::string> added;
+  std::vector<std::string> inputs;
+  {
+    const auto addedHandle = AddAudioDeviceEventCallback(
+      {.kinds = {AudioDeviceEventKind::ADDED}},
+      [&added](const AudioDeviceEvent& event) {
+        added.push_back(event.deviceID);
+      });
+    const auto inputHandle = AddAudioDeviceEventViewCallback(
+      {.directions = {Input}}, [&inputs](const AudioDeviceEventView& event) {
+        inputs.emplace_back(event.deviceID);
+      });
+
+    backend.DispatchAdded(Output, "speakers");
+    backend.DispatchAdded(Input, "microphone");
+    backend.DispatchRemoved(Input, "microphone");
+  }
+  // Destroying the handles unsubscribes
+  backend.DispatchAdded(Output, "headphones");
+
+  CHECK((added == std::vector<std::string> {"speakers", "microphone"}));
+  CHECK((inputs == std::vector<std::string> {"microphone", "microphone"}));
+}
+
+// Owning events are only built once per dispatch, however many subscribers
+// want one
+void TestOwningEventIsShared() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+
+  std::vector<const AudioDeviceEvent*> events;
+  const auto record
+    = [&events](const AudioDeviceEvent& event) { events.push_back(&event); };
+  const auto first = AddAudioDeviceEventCallback({}, record);
+  const auto second = AddAudioDeviceEventCallback({}, record);
+  backend.DispatchAdded(Output, "speakers");
+
+  CHECK(events.size() == 2);
+  CHECK(events[0] == events[1]);
+}
+
+void TestLegacyCallbacks() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+
+  std::vector<std::pair<AudioDevicePlugEvent, std::string>> plugs;
+  const auto plugHandle = AddAudioDevicePlugEventCallback(
+    [&plugs](AudioDevicePlugEvent event, const std::string& id) {
+      plugs.emplace_back(event, id);
+    });
+  std::optional<std::string> newDefault;
+  const auto defaultHandle = AddDefaultAudioDeviceChangeCallback(
+    [&newDefault](
+      AudioDeviceDirection, AudioDeviceRole, const std::string& id) {
+      newDefault = id;
+    });
+
+  backend.DispatchAdded(Output, "speakers");
+  backend.DispatchDefaultChanged(Output, AudioDeviceRole::DEFAULT, "speakers");
+  backend.DispatchRemoved(Output, "speakers");
+
+  CHECK(plugs.size() == 2);
+  CHECK(plugs[0].first == AudioDevicePlugEvent::ADDED);
+  CHECK(plugs[1].first == AudioDevicePlugEvent::REMOVED);
+  CHECK(plugs[1].second == "speakers");
+  CHECK(newDefault == "speakers");
+}
+
+}// namespace
+
+int main() {
+  TestMatcher();
+  TestFilteredDelivery();
+  TestOwningEventIsShared();
+  TestLegacyCallbacks();
+  return 0;
+}
@@ -0,0 +1,157 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AudioDeviceEventHub.h"
+#include "AudioDeviceEventPool.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+// Only allocations on a thread that is counting are counted
+thread_local bool gCountAllocations {false};
+thread_local size_t gAllocationCount {0};
+}// namespace
+
+void* operator new(std::size_t size) {
+  if (gCountAllocations) {
+    ++gAllocationCount;
+  }
+  if (const auto p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+void TestLeasesAreExclusive() {
+  AudioDeviceEventPool pool;
+  std::atomic<size_t> conflicts {0};
+
+  // More threads than slots, so some of them have to wait
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < AudioDeviceEventPool::SlotCount * 4; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int iteration = 0; iteration < 1000; ++iteration) {
+        const auto lease = pool.Acquire();
+        const auto buffer = lease.GetDeviceIDBuffer();
+        std::memcpy(buffer.data(), &i, sizeof(i));
+        std::this_thread::yield();
+        size_t stored;
+        std::memcpy(&stored, buffer.data(), sizeof(stored));
+        if (stored != i) {
+          ++conflicts;
+        }
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  CHECK(conflicts == 0);
+}
+
+// Leases can't be moved, so they're held on the stack while `f` runs
+template <class F>
+void WithLeases(AudioDeviceEventPool& pool, size_t count, F&& f) {
+  if (count == 0) {
+    f();
+    return;
+  }
+  const auto lease = pool.Acquire();
+  WithLeases(pool, count - 1, std::forward<F>(f));
+}
+
+void TestExhaustedPoolWaitsForRelease() {
+  AudioDeviceEventPool pool;
+  std::atomic<bool> holding {false};
+  std::atomic<bool> release {false};
+  std::thread holder([&]() {
+    const auto lease = pool.Acquire();
+    holding = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  CHECK(WaitUntil([&]() { return holding.load(); }));
+
+  WithLeases(pool, AudioDeviceEventPool::SlotCount - 1, [&]() {
+    std::atomic<bool> acquired {false};
+    std::thread waiter([&]() {
+      const auto lease = pool.Acquire();
+      acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!acquired);
+
+    release = true;
+    waiter.join();
+    CHECK(acquired);
+  });
+  holder.join();
+}
+
+// The native notification path must not allocate for view subscribers
+void TestViewDispatchDoesNotAllocate() {
+  AudioDeviceEventHub hub;
+  size_t delivered = 0;
+  hub.Subscribe(
+    {.kinds = {AudioDeviceEventKind::ADDED}},
+    AudioDeviceEventHub::ViewCallback(
+      [&delivered](const AudioDeviceEventView& event) {
+        if (event.deviceID == "{0.0.0.00000000}.{speakers}") {
+          ++delivered;
+        }
+      }));
+  hub.Subscribe(
+    {.kinds = {AudioDeviceEventKind::REMOVED}},
+    AudioDeviceEventHub::Callback([](const AudioDeviceEvent&) {}));
+
+  constexpr std::string_view nativeID = "{0.0.0.00000000}.{speakers}";
+  gCountAllocations = true;
+  for (int i = 0; i < 100; ++i) {
+    const auto lease = hub.GetEventPool().Acquire();
+    const auto buffer = lease.GetDeviceIDBuffer();
+    std::ranges::copy(nativeID, buffer.begin());
+    hub.Dispatch({
+      .kind = AudioDeviceEventKind::ADDED,
+      .direction = AudioDeviceDirection::OUTPUT,
+      .deviceID = {buffer.data(), nativeID.size()},
+    });
+  }
+  gCountAllocations = false;
+
+  CHECK(delivered == 100);
+  CHECK(gAllocationCount == 0);
+}
+
+}// namespace
+
+int main() {
+  TestLeasesAreExclusive();
+  TestExhaustedPoolWaitsForRelease();
+  TestViewDispatchDoesNotAllocate();
+  return 0;
+}
@@ -0,0 +1,289 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+// Records the sequence numbers that a callback receives
+class Recorder final {
+ public:
+  void operator()(const AudioDeviceJournalEntry& entry) {
+    std::unique_lock lock(mMutex);
+    mSequenceNumbers.push_back(entry.sequenceNumber);
+  }
+
+  std::vector<uint64_t> Get() const {
+    std::unique_lock lock(mMutex);
+    return mSequenceNumbers;
+  }
+
+  size_t GetCount() const {
+    std::unique_lock lock(mMutex);
+    return mSequenceNumbers.size();
+  }
+
+ private:
+  mutable std::mutex mMutex;
+  std::vector<uint64_t> mSequenceNumbers;
+};
+
+// Each entry is a default change, as they don't start volume watches
+void Append(const std::string& deviceID) {
+  FakeBackend::Get().DispatchDefaultChanged(
+    AudioDeviceDirection::OUTPUT, AudioDeviceRole::DEFAULT, deviceID);
+}
+
+std::vector<uint64_t> GetRange(uint64_t first, uint64_t last) {
+  std::vector<uint64_t> ret;
+  for (auto i = first; i <= last; ++i) {
+    ret.push_back(i);
+  }
+  return ret;
+}
+
+void TestReplay() {
+  StartAudioDeviceJournal(4);
+  const auto start = GetAudioDeviceJournalSequenceNumber();
+  for (int i = 0; i < 3; ++i) {
+    Append("replayed");
+  }
+  CHECK(GetAudioDeviceJournalSequenceNumber() == start + 3);
+
+  std::vector<AudioDeviceJournalEntry> entries;
+  {
+    auto handle = AddAudioDeviceJournalCallback(
+      start + 1,
+      [&entries](const AudioDeviceJournalEntry& entry) {
+        entries.push_back(entry);
+      });
+    CHECK(handle.has_value());
+    CHECK(entries.size() == 2);
+    Append("new");
+  }
+  Append("unsubscribed");
+
+  CHECK(entries.size() == 3);
+  CHECK(entries[0].sequenceNumber == start + 2);
+  CHECK(entries[0].kind == AudioDeviceJournalEntryKind::DEFAULT_CHANGED);
+  CHECK(entries[0].role == AudioDeviceRole::DEFAULT);
+  CHECK(entries[0].deviceID == "replayed");
+  CHECK(entries[2].sequenceNumber == start + 4);
+  CHECK(entries[2].deviceID == "new");
+
+  // Evicted, and not yet recorded
+  auto evicted = AddAudioDeviceJournalCallback(start, [](const auto&) {});
+  CHECK(evicted.error() == Error::OUT_OF_RANGE);
+  auto future = AddAudioDeviceJournalCallback(
+    GetAudioDeviceJournalSequenceNumber() + 1, [](const auto&) {});
+  CHECK(future.error() == Error::OUT_OF_RANGE);
+}
+
+// Callbacks can add callbacks, which get each entry exactly once
+void TestNestedSubscribe() {
+  StartAudioDeviceJournal(64);
+  const auto start = GetAudioDeviceJournalSequenceNumber();
+  const auto nested = std::make_shared<Recorder>();
+  std::optional<AudioDeviceJournalCallbackHandle> nestedHandle;
+  auto outer = AddAudioDeviceJournalCallback(
+    start,
+    [&nestedHandle, nested, start](const AudioDeviceJournalEntry& entry) {
+      if (entry.sequenceNumber != start + 2) {
+        return;
+      }
+      // Replays the current entry, and the one before it
+      auto handle = AddAudioDeviceJournalCallback(
+        start, [nested](const auto& entry) { (*nested)(entry); });
+      CHECK(handle.has_value());
+      CHECK(nested->GetCount() == 2);
+      nestedHandle = std::move(*handle);
+    });
+  CHECK(outer.has_value());
+  for (int i = 0; i < 4; ++i) {
+    Append("nested");
+  }
+  CHECK(nested->Get() == GetRange(start + 1, start + 4));
+  nestedHandle.reset();
+}
+
+// Appending doesn't wait for a slow callback on another thread
+void TestCallbacksDontBlockAppends() {
+  StartAudioDeviceJournal(64);
+  const auto start = GetAudioDeviceJournalSequenceNumber();
+  const auto gate = std::make_shared<Gate>();
+  const auto recorder = std::make_shared<Recorder>();
+  std::atomic<bool> isBlocked {false};
+  auto handle = AddAudioDeviceJournalCallback(
+    start,
+    [gate, recorder, &isBlocked, start](const AudioDeviceJournalEntry& entry) {
+      if (entry.sequenceNumber == start + 1) {
+        isBlocked = true;
+        gate->Wait();
+      }
+      (*recorder)(entry);
+    });
+  CHECK(handle.has_value());
+
+  std::thread blocked([]() { Append("blocked"); });
+  CHECK(WaitUntil([&]() { return isBlocked.load(); }));
+  Append("queued");
+  Append("queued");
+  CHECK(GetAudioDeviceJournalSequenceNumber() == start + 3);
+  CHECK(recorder->GetCount() == 0);
+
+  // Another callback waits its turn, rather than seeing a later entry first
+  const auto late = std::make_shared<Recorder>();
+  std::optional<AudioDeviceJournalCallbackHandle> lateHandle;
+  std::thread subscriber([&]() {
+    auto added = AddAudioDeviceJournalCallback(
+      start, [late](const auto& entry) { (*late)(entry); });
+    CHECK(added.has_value());
+    lateHandle = std::move(*added);
+  });
+
+  gate->Release();
+  blocked.join();
+  subscriber.join();
+  CHECK(recorder->Get() == GetRange(start + 1, start + 3));
+  Append("after");
+  CHECK(recorder->Get() == GetRange(start + 1, start + 4));
+  CHECK(late->Get() == GetRange(start + 1, start + 4));
+}
+
+// Every subscriber gets every entry in order, without gaps
+void TestConcurrentAppends() {
+  constexpr int ThreadCount = 4;
+  constexpr int PerThread = 500;
+
+  StartAudioDeviceJournal(ThreadCount * PerThread);
+  const auto start = GetAudioDeviceJournalSequenceNumber();
+  const auto early = std::make_shared<Recorder>();
+  auto earlyHandle = AddAudioDeviceJournalCallback(
+    start, [early](const auto& entry) { (*early)(entry); });
+  CHECK(earlyHandle.has_value());
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < ThreadCount; ++i) {
+    threads.emplace_back([]() {
+      for (int j = 0; j < PerThread; ++j) {
+        Append("concurrent");
+      }
+    });
+  }
+  // Joins part way through
+  CHECK(WaitUntil([&]() { return early->GetCount() >= 100; }));
+  const auto late = std::make_shared<Recorder>();
+  auto lateHandle = AddAudioDeviceJournalCallback(
+    start, [late](const auto& entry) { (*late)(entry); });
+  CHECK(lateHandle.has_value());
+  for (auto& thread: threads) {
+    thread.join();
+  }
+
+  const auto expected = GetRange(start + 1, start + ThreadCount * PerThread);
+  CHECK(early->Get() == expected);
+  CHECK(late->Get() == expected);
+}
+
+// Keeps the entries for one device
+class EntryRecorder final {
+ public:
+  explicit EntryRecorder(std::string deviceID)
+    : mDeviceID(std::move(deviceID)) {
+  }
+
+  void operator()(const AudioDeviceJournalEntry& entry) {
+    if (entry.deviceID != mDeviceID) {
+      return;
+    }
+    std::unique_lock lock(mMutex);
+    mEntries.push_back(entry);
+  }
+
+  std::vector<AudioDeviceJournalEntry> Get() const {
+    std::unique_lock lock(mMutex);
+    return mEntries;
+  }
+
+ private:
+  const std::string mDeviceID;
+  mutable std::mutex mMutex;
+  std::vector<AudioDeviceJournalEntry> mEntries;
+};
+
+void TestStateChanged() {
+  const auto recorder = std::make_shared<EntryRecorder>("state");
+  auto handle = AddAudioDeviceJournalCallback(
+    GetAudioDeviceJournalSequenceNumber(),
+    [recorder](const auto& entry) { (*recorder)(entry); });
+  CHECK(handle.has_value());
+
+  FakeBackend::Get().DispatchStateChanged(
+    AudioDeviceDirection::INPUT,
+    "state",
+    AudioDeviceState::DEVICE_DISABLED);
+  const auto entries = recorder->Get();
+  CHECK(entries.size() == 1);
+  CHECK(entries.front().kind == AudioDeviceJournalEntryKind::STATE_CHANGED);
+  CHECK(entries.front().direction == AudioDeviceDirection::INPUT);
+  CHECK(entries.front().state == AudioDeviceState::DEVICE_DISABLED);
+  CHECK(!entries.front().volume);
+}
+
+// Devices without a volume control still have their mute changes recorded
+void TestMuteOnlyDevice() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  backend.SetFailure(
+    "AddAudioDeviceVolumeChangeCallback", Error::OPERATION_UNSUPPORTED);
+  AddFakeDevice("mute-only");
+
+  const auto recorder = std::make_shared<EntryRecorder>("mute-only");
+  auto handle = AddAudioDeviceJournalCallback(
+    GetAudioDeviceJournalSequenceNumber(),
+    [recorder](const auto& entry) { (*recorder)(entry); });
+  CHECK(handle.has_value());
+  backend.DispatchAdded(AudioDeviceDirection::OUTPUT, "mute-only");
+  CHECK(WaitUntil([&]() {
+    return backend.GetCallCount("AddAudioDeviceMuteUnmuteCallback") == 1;
+  }));
+
+  backend.UpdateDevice(
+    "mute-only", [](FakeDevice& device) { device.volume.isMuted = true; });
+  backend.NotifyVolumeChanged("mute-only");
+  const auto entries = recorder->Get();
+  CHECK(entries.size() == 2);
+  CHECK(entries.back().kind == AudioDeviceJournalEntryKind::MUTE_CHANGED);
+  CHECK(entries.back().isMuted == true);
+  CHECK(!entries.back().volume);
+  backend.SetFailure("AddAudioDeviceVolumeChangeCallback", std::nullopt);
+}
+
+}// namespace
+
+int main() {
+  FakeBackend::Get().Reset();
+  TestReplay();
+  TestNestedSubscribe();
+  TestCallbacksDontBlockAppends();
+  TestConcurrentAppends();
+  TestStateChanged();
+  TestMuteOnlyDevice();
+  return 0;
+}
@@ -0,0 +1,175 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "AudioDeviceListCache.h"
+#include "FakeBackend.h"
+#include "MappedFile.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+AudioDeviceListSnapshot MakeSnapshot() {
+  AudioDeviceListSnapshot ret {
+    .defaultOutputID = "speakers",
+    .defaultCommunicationOutputID = "headset",
+    .defaultInputID = "microphone",
+  };
+  for (const auto& info: {
+         MakeFakeDevice("speakers", AudioDeviceDirection::OUTPUT).info,
+         MakeFakeDevice("headset", AudioDeviceDirection::OUTPUT).info,
+         MakeFakeDevice("microphone", AudioDeviceDirection::INPUT).info,
+       }) {
+    ret.devices.emplace(info.id, info);
+  }
+  ret.devices.at("headset").state = AudioDeviceState::DEVICE_NOT_PRESENT;
+  return ret;
+}
+
+void CheckEqual(
+  const AudioDeviceListSnapshot& a,
+  const AudioDeviceListSnapshot& b) {
+  CHECK(a.devices == b.devices);
+  CHECK(a.defaultOutputID == b.defaultOutputID);
+  CHECK(a.defaultCommunicationOutputID == b.defaultCommunicationOutputID);
+  CHECK(a.defaultInputID == b.defaultInputID);
+  CHECK(a.defaultCommunicationInputID == b.defaultCommunicationInputID);
+}
+
+void TestRoundTrip() {
+  const auto snapshot = MakeSnapshot();
+  const auto decoded
+    = AudioDeviceListCache::Decode(AudioDeviceListCache::Encode(snapshot));
+  CHECK(decoded);
+  CheckEqual(*decoded, snapshot);
+  CHECK(decoded->isPossiblyStale);
+
+  const auto empty = AudioDeviceListCache::Decode(
+    AudioDeviceListCache::Encode(AudioDeviceListSnapshot {}));
+  CHECK(empty);
+  CHECK(empty->devices.empty());
+}
+
+// Any single corrupted byte, and any truncation, is rejected
+void TestCorruption() {
+  const auto data = AudioDeviceListCache::Encode(MakeSnapshot());
+  for (size_t i = 0; i < data.size(); ++i) {
+    auto corrupted = data;
+    corrupted[i] ^= std::byte {0x10};
+    CHECK(!AudioDeviceListCache::Decode(corrupted));
+    CHECK(!AudioDeviceListCache::Decode(std::span(data).first(i)));
+  }
+  auto extended = data;
+  extended.push_back({});
+  CHECK(!AudioDeviceListCache::Decode(extended));
+}
+
+std::filesystem::path GetTemporaryPath(const std::string& name) {
+  const auto ret = std::filesystem::temp_directory_path()
+    / "AudioDeviceListCacheTest" / name;
+  std::filesystem::remove(ret);
+  return ret;
+}
+
+void TestMappedFile() {
+  const auto path = GetTemporaryPath("mapped");
+  CHECK(!MappedFile::Open(path));
+
+  std::filesystem::create_directories(path.parent_path());
+  { std::ofstream file(path, std::ios::binary); }
+  CHECK(!MappedFile::Open(path));
+
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "hello";
+  }
+  const auto mapped = MappedFile::Open(path);
+  CHECK(mapped);
+  const auto data = mapped->GetData();
+  CHECK(data.size() == 5);
+  CHECK(std::string(reinterpret_cast<const char*>(data.data()), 5) == "hello");
+}
+
+void TestCachedList() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("speakers", AudioDeviceDirection::OUTPUT);
+  AddFakeDevice("microphone", AudioDeviceDirection::INPUT);
+  backend.SetNativeDefault(
+    AudioDeviceDirection::OUTPUT, AudioDeviceRole::DEFAULT, "speakers");
+  const auto path = GetTemporaryPath("list");
+
+  // No cache yet, so the platform is queried
+  const auto first = GetCachedAudioDeviceList(path);
+  CHECK(!first.isPossiblyStale);
+  CHECK(first.devices.size() == 2);
+  CHECK(first.defaultOutputID == "speakers");
+  CHECK(std::filesystem::exists(path));
+
+  backend.RemoveDevice("microphone");
+  AddFakeDevice("headset", AudioDeviceDirection::OUTPUT);
+  backend.SetNativeDefault(
+    AudioDeviceDirection::OUTPUT, AudioDeviceRole::DEFAULT, "headset");
+  backend.DispatchDefaultChanged(
+    AudioDeviceDirection::OUTPUT, AudioDeviceRole::DEFAULT, "headset");
+
+  std::mutex mutex;
+  std::vector<AudioDeviceEvent> events;
+  const auto cached
+    = GetCachedAudioDeviceList(path, [&](const AudioDeviceEvent& event) {
+        std::unique_lock lock(mutex);
+        events.push_back(event);
+      });
+  CHECK(cached.isPossiblyStale);
+  CheckEqual(cached, first);
+
+  // The refresh finds every difference
+  CHECK(WaitUntil([&]() {
+    std::unique_lock lock(mutex);
+    return events.size() == 3;
+  }));
+  {
+    std::unique_lock lock(mutex);
+    CHECK(events[0].kind == AudioDeviceEventKind::REMOVED);
+    CHECK(events[0].deviceID == "microphone");
+    CHECK(events[0].direction == AudioDeviceDirection::INPUT);
+    CHECK(events[1].kind == AudioDeviceEventKind::ADDED);
+    CHECK(events[1].deviceID == "headset");
+    CHECK(events[2].kind == AudioDeviceEventKind::DEFAULT_CHANGED);
+    CHECK(events[2].deviceID == "headset");
+    CHECK(events[2].role == AudioDeviceRole::DEFAULT);
+  }
+
+  // ... and rewrites the cache
+  CHECK(WaitUntil([&]() {
+    const auto file = MappedFile::Open(path);
+    const auto refreshed
+      = file ? AudioDeviceListCache::Decode(file->GetData()) : std::nullopt;
+    return refreshed && refreshed->devices.contains("headset")
+      && refreshed->defaultOutputID == "headset";
+  }));
+  std::filesystem::remove(path);
+}
+
+}// namespace
+
+int main() {
+  TestRoundTrip();
+  TestCorruption();
+  TestMappedFile();
+  TestCachedList();
+  return 0;
+}
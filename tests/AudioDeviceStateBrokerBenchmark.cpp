@@ -0,0 +1,93 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The most that the shared state holds
+constexpr size_t DeviceCount = 32;
+constexpr size_t Iterations = 100000;
+constexpr auto WriteInterval = std::chrono::microseconds(100);
+
+// Clients read while the broker is publishing volume changes
+void BenchmarkReads() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  std::vector<std::string> ids;
+  for (size_t i = 0; i < DeviceCount; ++i) {
+    ids.push_back("device" + std::to_string(i));
+    AddFakeDevice(ids.back());
+  }
+
+  // Unique, in case several copies are running
+  const auto name = "benchmark-"
+    + std::to_string(Clock::now().time_since_epoch().count());
+  auto broker = StartAudioDeviceStateBroker(name);
+  CHECK(broker.has_value());
+  auto client = ConnectToAudioDeviceStateBroker(name);
+  CHECK(client.has_value());
+
+  std::atomic<bool> isStopping {false};
+  std::thread writer([&]() {
+    for (size_t i = 0; !isStopping; ++i) {
+      const auto& id = ids[i % ids.size()];
+      backend.UpdateDevice(id, [i](FakeDevice& device) {
+        device.volume.volumeScalar = static_cast<float>(i % 100) / 100;
+      });
+      backend.NotifyVolumeChanged(id);
+      // Far more often than a user could change anything
+      std::this_thread::sleep_for(WriteInterval);
+    }
+  });
+
+  Samples states;
+  Samples generations;
+  size_t failures {};
+  const auto firstGeneration = client->GetGeneration();
+  for (size_t i = 0; i < Iterations; ++i) {
+    auto start = Clock::now();
+    const auto state = client->GetState();
+    states.Add(Clock::now() - start);
+    failures += state.has_value() ? 0 : 1;
+
+    start = Clock::now();
+    client->GetGeneration();
+    generations.Add(Clock::now() - start);
+  }
+  isStopping = true;
+  writer.join();
+
+  std::printf(
+    "%zu devices; %llu changes published while reading\n",
+    DeviceCount,
+    static_cast<unsigned long long>(
+      client->GetGeneration() - firstGeneration));
+  states.Print("GetState()");
+  generations.Print("GetGeneration()");
+  std::printf("failed reads: %zu\n", failures);
+}
+
+}// namespace
+
+int main() {
+  BenchmarkReads();
+  return 0;
+}
@@ -0,0 +1,130 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <optional>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "BrokerIPC.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+// Unique to this process, as tests may run concurrently
+std::string GetName(const std::string& suffix) {
+#ifdef _WIN32
+  return "test-" + std::to_string(GetCurrentProcessId()) + "-" + suffix;
+#else
+  return "test-" + std::to_string(getpid()) + "-" + suffix;
+#endif
+}
+
+#ifndef _WIN32
+// Before any other test, as forking is only safe with a single thread
+void TestAbandonedSegmentIsReplaced() {
+  const auto name = GetName("abandoned");
+  const auto child = fork();
+  CHECK(child != -1);
+  if (child == 0) {
+    // Exits without destroying it, like a broker that crashed
+    auto segment = SharedMemorySegment::Create(name, 64);
+    _exit(segment ? 0 : 1);
+  }
+  int status {};
+  CHECK(waitpid(child, &status, 0) == child);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  const auto abandoned = SharedMemorySegment::Open(name, 64);
+  CHECK(abandoned);
+  CHECK(!abandoned->IsOwnerRunning());
+  auto segment = SharedMemorySegment::Create(name, 64);
+  CHECK(segment.has_value());
+}
+#endif
+
+// A segment in use is kept, even though it was created by this process
+void TestSegmentInUseIsKept() {
+  const auto name = GetName("in-use");
+  auto segment = SharedMemorySegment::Create(name, 64);
+  CHECK(segment.has_value());
+  static_cast<char*>((*segment)->GetData())[0] = 42;
+
+  auto second = SharedMemorySegment::Create(name, 64);
+  CHECK(second.error() == Error::BROKER_NOT_AVAILABLE);
+  const auto reader = SharedMemorySegment::Open(name, 64);
+  CHECK(reader);
+  CHECK(static_cast<const char*>(reader->GetData())[0] == 42);
+  CHECK(reader->IsOwnerRunning());
+}
+
+void TestBroker() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("speakers", AudioDeviceDirection::OUTPUT, [](auto& device) {
+    device.volume = {.isMuted = true, .volumeScalar = 0.25f};
+  });
+
+  // Longer than some platforms allow for shared memory names
+  const auto name = GetName(std::string(40, 'x'));
+  auto broker = StartAudioDeviceStateBroker(name);
+  CHECK(broker.has_value());
+  auto second = StartAudioDeviceStateBroker(name);
+  CHECK(second.error() == Error::BROKER_NOT_AVAILABLE);
+
+  auto client = ConnectToAudioDeviceStateBroker(name);
+  CHECK(client.has_value());
+  CHECK(client->IsBrokerRunning());
+  const auto state = client->GetState();
+  CHECK(state.has_value());
+  CHECK(state->list.devices.contains("speakers"));
+  CHECK(state->volumes.contains("speakers"));
+  CHECK(state->volumes.at("speakers").isMuted);
+  CHECK(state->volumes.at("speakers").volumeScalar == 0.25f);
+
+  auto missing = ConnectToAudioDeviceStateBroker(GetName("missing"));
+  CHECK(missing.error() == Error::BROKER_NOT_AVAILABLE);
+}
+
+// Clients that are still connected find out that the broker has gone
+void TestBrokerStopped() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("stopped");
+
+  const auto name = GetName("stopped");
+  std::optional<AudioDeviceStateClient> client;
+  {
+    auto broker = StartAudioDeviceStateBroker(name);
+    CHECK(broker.has_value());
+    auto connected = ConnectToAudioDeviceStateBroker(name);
+    CHECK(connected.has_value());
+    client = *connected;
+    CHECK(client->GetState().has_value());
+  }
+  CHECK(!client->IsBrokerRunning());
+  auto state = client->GetState();
+  CHECK(state.error() == Error::BROKER_NOT_AVAILABLE);
+}
+
+}// namespace
+
+int main() {
+#ifndef _WIN32
+  TestAbandonedSegmentIsReplaced();
+#endif
+  TestSegmentInUseIsKept();
+  TestBroker();
+  TestBrokerStopped();
+  return 0;
+}
@@ -0,0 +1,185 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "AudioRingBuffer.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+
+namespace {
+
+constexpr AudioStreamFormat StereoFloat {
+  .sampleFormat = AudioSampleFormat::FLOAT32,
+  .sampleRate = 48000,
+  .channels = 2,
+};
+
+AudioBufferView MakeView(const std::vector<float>& samples, uint16_t channels) {
+  return {
+    .mData = samples.data(),
+    .mFrames = static_cast<uint32_t>(samples.size() / channels),
+    .mChannels = channels,
+    .mSampleRate = 48000,
+  };
+}
+
+// Copies everything available out of the ring buffer, and releases it
+template <class T>
+std::vector<T> ReadAll(AudioRingBuffer& ring) {
+  const auto spans = ring.BeginRead();
+  std::vector<T> ret((spans.first.size() + spans.second.size()) / sizeof(T));
+  std::memcpy(ret.data(), spans.first.data(), spans.first.size());
+  std::memcpy(
+    reinterpret_cast<std::byte*>(ret.data()) + spans.first.size(),
+    spans.second.data(),
+    spans.second.size());
+  ring.EndRead(spans.frames);
+  return ret;
+}
+
+void TestWrapAround() {
+  AudioRingBuffer ring(StereoFloat, 8);
+  std::vector<float> samples(12);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = static_cast<float>(i);
+  }
+  ring.Write(MakeView(samples, 2));
+  CHECK(ReadAll<float>(ring) == samples);
+
+  // Starts at frame 6 of 8, so it wraps
+  samples.resize(10);
+  ring.Write(MakeView(samples, 2));
+  const auto spans = ring.BeginRead();
+  CHECK(spans.frames == 5);
+  CHECK(spans.first.size() == 2 * ring.GetFrameBytes());
+  CHECK(spans.second.size() == 3 * ring.GetFrameBytes());
+  CHECK(ReadAll<float>(ring) == samples);
+  CHECK(ring.BeginRead().frames == 0);
+  CHECK(ring.GetOverrunFrames() == 0);
+}
+
+// Unread frames are never overwritten
+void TestOverrun() {
+  AudioRingBuffer ring(StereoFloat, 4);
+  const std::vector<float> samples {1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6};
+  ring.Write(MakeView(samples, 2));
+  CHECK(ring.GetOverrunFrames() == 2);
+  CHECK((ReadAll<float>(ring) == std::vector<float> {1, 1, 2, 2, 3, 3, 4, 4}));
+
+  // Releasing more than is available only releases what is
+  ring.EndRead(100);
+  ring.Write(MakeView({7, 7}, 2));
+  CHECK((ReadAll<float>(ring) == std::vector<float> {7, 7}));
+}
+
+void TestConversion() {
+  // Float to mono int16; the extra channel is dropped, and values are clamped
+  AudioRingBuffer mono(
+    {.sampleFormat = AudioSampleFormat::INT16, .channels = 1}, 16);
+  mono.Write(MakeView({0.5f, 0.9f, -1.5f, 0.9f, 1.0f, 0.9f}, 2));
+  CHECK(
+    (ReadAll<int16_t>(mono) == std::vector<int16_t> {16384, -32767, 32767}));
+
+  // Int16 to 3-channel float; the missing channel is silent
+  AudioRingBuffer surround(
+    {.sampleFormat = AudioSampleFormat::FLOAT32, .channels = 3}, 16);
+  const std::vector<int16_t> int16s {-32768, 16384};
+  surround.Write({
+    .mData = int16s.data(),
+    .mFrames = 1,
+    .mChannels = 2,
+    .mSampleRate = 48000,
+    .mFormat = AudioSampleFormat::INT16,
+  });
+  CHECK((ReadAll<float>(surround) == std::vector<float> {-1.0f, 0.5f, 0}));
+
+  // Silent buffers are written as zeroes
+  AudioRingBuffer silent(StereoFloat, 16);
+  silent.Write({
+    .mFrames = 2,
+    .mChannels = 2,
+    .mSampleRate = 48000,
+    .mIsSilent = true,
+  });
+  CHECK((ReadAll<float>(silent) == std::vector<float>(4, 0)));
+}
+
+void TestWaitTimesOut() {
+  AudioRingBuffer ring(StereoFloat, 16);
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(!ring.WaitForFrames(1, std::chrono::milliseconds(20)));
+  CHECK(
+    std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+  ring.Write(MakeView({1, 1}, 2));
+  CHECK(ring.WaitForFrames(1, std::chrono::milliseconds(0)));
+  CHECK(!ring.WaitForFrames(2, std::chrono::milliseconds(0)));
+}
+
+// Every frame is either delivered in order or counted as an overrun
+void TestProducerAndConsumer() {
+  AudioRingBuffer ring(StereoFloat, 256);
+  constexpr uint32_t BufferFrames = 64;
+  constexpr uint32_t BufferCount = 20000;
+
+  std::atomic<bool> finished {false};
+  std::thread producer([&]() {
+    std::vector<float> samples(BufferFrames * 2);
+    float next = 0;
+    for (uint32_t buffer = 0; buffer < BufferCount; ++buffer) {
+      for (uint32_t i = 0; i < BufferFrames; ++i) {
+        samples[2 * i] = next;
+        samples[(2 * i) + 1] = -next;
+        ++next;
+      }
+      ring.Write(MakeView(samples, 2));
+      if (buffer % 16 == 0) {
+        std::this_thread::yield();
+      }
+    }
+    finished = true;
+  });
+
+  uint64_t received = 0;
+  size_t errors = 0;
+  float last = -1;
+  while (true) {
+    const auto isFinished = finished.load();
+    ring.WaitForFrames(BufferFrames, std::chrono::milliseconds(10));
+    const auto samples = ReadAll<float>(ring);
+    for (size_t i = 0; i < samples.size(); i += 2) {
+      // Dropped frames leave gaps, but never reorder or tear frames
+      if (samples[i] <= last || samples[i + 1] != -samples[i]) {
+        ++errors;
+      }
+      last = samples[i];
+    }
+    received += samples.size() / 2;
+    if (isFinished && samples.empty()) {
+      break;
+    }
+  }
+  producer.join();
+
+  CHECK(errors == 0);
+  CHECK(received + ring.GetOverrunFrames() == BufferFrames * BufferCount);
+}
+
+}// namespace
+
+int main() {
+  TestWrapAround();
+  TestOverrun();
+  TestConversion();
+  TestWaitTimesOut();
+  TestProducerAndConsumer();
+  return 0;
+}
@@ -0,0 +1,152 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AudioSessionTable.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using Event = std::pair<AudioSessionEventKind, AudioSessionInfo>;
+
+AudioSessionInfo MakeSession(const std::string& id) {
+  return {
+    .id = id,
+    .processID = 123,
+    .displayName = "Test",
+    .volumeScalar = 1,
+  };
+}
+
+// Only actual changes are notified
+void TestNotifications() {
+  AudioSessionTable table;
+  std::vector<Event> events;
+  const auto id = table.Subscribe(
+    [&](AudioSessionEventKind kind, const AudioSessionInfo& info) {
+      events.emplace_back(kind, info);
+      // Would deadlock if called with the lock held
+      table.GetSessions();
+    });
+
+  auto session = MakeSession("a");
+  table.Set(session);
+  table.Set(session);
+  CHECK(events.size() == 1);
+  CHECK(events.back() == Event(AudioSessionEventKind::ADDED, session));
+
+  session.isActive = true;
+  table.Set(session);
+  CHECK(events.size() == 2);
+  CHECK(events.back() == Event(AudioSessionEventKind::CHANGED, session));
+
+  table.Update("a", [](AudioSessionInfo& info) { info.isActive = true; });
+  table.Update("missing", [](AudioSessionInfo& info) { info.isMuted = true; });
+  CHECK(events.size() == 2);
+  table.Update("a", [](AudioSessionInfo& info) { info.volumeScalar = 0.5f; });
+  CHECK(events.size() == 3);
+  CHECK(events.back().second.volumeScalar == 0.5f);
+  CHECK(table.GetSessions().front().volumeScalar == 0.5f);
+
+  table.Remove("missing");
+  CHECK(events.size() == 3);
+  table.Remove("a");
+  CHECK(events.size() == 4);
+  CHECK(events.back().first == AudioSessionEventKind::REMOVED);
+  CHECK(events.back().second.id == "a");
+  CHECK(table.GetSessions().empty());
+
+  table.Unsubscribe(id);
+  table.Set(session);
+  CHECK(events.size() == 4);
+}
+
+// A change made on another thread while the first is still being delivered
+// must not be delivered before it
+void TestDeliveryOrder() {
+  AudioSessionTable table;
+  Gate delivering;
+  Gate release;
+  std::mutex mutex;
+  std::vector<AudioSessionEventKind> kinds;
+  const auto id = table.Subscribe(
+    [&](AudioSessionEventKind kind, const AudioSessionInfo&) {
+      if (kind == AudioSessionEventKind::ADDED) {
+        delivering.Release();
+        release.Wait();
+      }
+      std::unique_lock lock(mutex);
+      kinds.push_back(kind);
+    });
+
+  std::thread adder([&]() { table.Set(MakeSession("a")); });
+  delivering.Wait();
+  // Queued for the delivering thread, rather than delivered here
+  table.Update("a", [](AudioSessionInfo& info) { info.isActive = true; });
+  table.Remove("a");
+  release.Release();
+  adder.join();
+
+  const std::vector expected {
+    AudioSessionEventKind::ADDED,
+    AudioSessionEventKind::CHANGED,
+    AudioSessionEventKind::REMOVED,
+  };
+  CHECK(kinds == expected);
+  table.Unsubscribe(id);
+}
+
+void TestPublicAPI() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("sessions");
+  auto table = GetAudioSessionTable("sessions");
+  CHECK(table.has_value());
+  (*table)->Set(MakeSession("b"));
+
+  const auto sessions = GetAudioSessions("sessions");
+  CHECK(sessions.has_value());
+  CHECK(sessions->size() == 1);
+
+  std::vector<Event> events;
+  {
+    const auto handle = AddAudioSessionCallback(
+      "sessions",
+      [&](AudioSessionEventKind kind, const AudioSessionInfo& info) {
+        events.emplace_back(kind, info);
+      });
+    CHECK(handle.has_value());
+    CHECK(SetAudioSessionMute("sessions", "b", true).has_value());
+    CHECK(SetAudioSessionVolume("sessions", "b", 0.25f).has_value());
+    CHECK(events.size() == 2);
+    CHECK(events.back().second.isMuted);
+    CHECK(events.back().second.volumeScalar == 0.25f);
+  }
+  // Unsubscribed by destroying the handle
+  CHECK(SetAudioSessionMute("sessions", "b", false).has_value());
+  CHECK(events.size() == 2);
+
+  auto missing = GetAudioSessions("missing");
+  CHECK(missing.error() == Error::DEVICE_NOT_AVAILABLE);
+}
+
+}// namespace
+
+int main() {
+  TestNotifications();
+  TestDeliveryOrder();
+  TestPublicAPI();
+  return 0;
+}
@@ -0,0 +1,124 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "BackendThread.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+// Tasks run in order, on one initialized thread
+void TestOrder() {
+  BackendThread thread;
+  CHECK(!thread.IsCurrentThread());
+
+  std::vector<int> order;
+  std::optional<std::thread::id> threadID;
+  std::atomic<bool> isSameThread {true};
+  std::atomic<bool> isInitialized {true};
+  std::atomic<bool> done {false};
+  for (int i = 0; i < 100; ++i) {
+    thread.Post([&, i]() {
+      if (!thread.IsCurrentThread()) {
+        isSameThread = false;
+      }
+      if (!FakeBackend::IsNativeThreadInitialized()) {
+        isInitialized = false;
+      }
+      if (!threadID) {
+        threadID = std::this_thread::get_id();
+      } else if (*threadID != std::this_thread::get_id()) {
+        isSameThread = false;
+      }
+      order.push_back(i);
+      if (i == 99) {
+        done = true;
+      }
+    });
+  }
+  CHECK(WaitUntil([&]() { return done.load(); }));
+  CHECK(isSameThread);
+  CHECK(isInitialized);
+  for (int i = 0; i < 100; ++i) {
+    CHECK(order[i] == i);
+  }
+}
+
+// Including tasks posted by tasks, and while the thread is asleep
+void TestConcurrentPosts() {
+  constexpr int ProducerCount = 4;
+  constexpr int PerProducer = 20000;
+
+  BackendThread thread;
+  std::vector<int> next(ProducerCount);
+  std::atomic<int> ran {0};
+  std::atomic<bool> isOrdered {true};
+  std::vector<std::thread> producers;
+  for (int producer = 0; producer < ProducerCount; ++producer) {
+    producers.emplace_back([&, producer]() {
+      for (int i = 0; i < PerProducer; ++i) {
+        thread.Post([&, producer, i]() {
+          if (next[producer]++ != i) {
+            isOrdered = false;
+          }
+          ++ran;
+        });
+        if (i % 1000 == 0) {
+          // Let the thread catch up, and go back to sleep
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+    });
+  }
+  for (auto& producer: producers) {
+    producer.join();
+  }
+
+  std::atomic<bool> nestedRan {false};
+  thread.Post([&]() { thread.Post([&]() { nestedRan = true; }); });
+  CHECK(WaitUntil([&]() { return nestedRan.load(); }));
+  CHECK(ran == ProducerCount * PerProducer);
+  CHECK(isOrdered);
+}
+
+// Destroying it doesn't wait, but the tasks already posted still run
+void TestDestroyWithPendingTasks() {
+  const auto ran = std::make_shared<std::atomic<int>>(0);
+  const auto release = std::make_shared<std::atomic<bool>>(false);
+  {
+    BackendThread thread;
+    thread.Post([release]() {
+      while (!*release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+    for (int i = 0; i < 10; ++i) {
+      thread.Post([ran]() { ++*ran; });
+    }
+  }
+  CHECK(*ran == 0);
+  *release = true;
+  CHECK(WaitUntil([&]() { return *ran == 10; }));
+}
+
+}// namespace
+
+int main() {
+  TestOrder();
+  TestConcurrentPosts();
+  TestDestroyWithPendingTasks();
+  return 0;
+}
@@ -0,0 +1,54 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace FredEmmott::Audio::Testing {
+
+/* Benchmarks are plain executables that print their results; they're only
+ * built with `AUDIODEVICELIB_BUILD_BENCHMARKS`, and aren't run by CTest, as
+ * timings on shared CI machines are too noisy to check.
+ */
+class Samples final {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  void Add(Duration sample) {
+    mSamples.push_back(sample);
+  }
+
+  // Prints the median, 99th percentile, and maximum, in microseconds
+  void Print(const char* name) {
+    if (mSamples.empty()) {
+      std::printf("%s: no samples\n", name);
+      return;
+    }
+    std::ranges::sort(mSamples);
+    const auto at = [this](double percentile) {
+      const auto index = static_cast<size_t>(
+        percentile * static_cast<double>(mSamples.size() - 1));
+      return std::chrono::duration<double, std::micro>(mSamples[index])
+        .count();
+    };
+    std::printf(
+      "%s: n=%zu p50=%.1fus p99=%.1fus max=%.1fus\n",
+      name,
+      mSamples.size(),
+      at(0.5),
+      at(0.99),
+      at(1.0));
+  }
+
+ private:
+  std::vector<Duration> mSamples;
+};
+
+}// namespace FredEmmott::Audio::Testing
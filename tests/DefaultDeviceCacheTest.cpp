@@ -0,0 +1,149 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+constexpr auto Output = AudioDeviceDirection::OUTPUT;
+constexpr auto Input = AudioDeviceDirection::INPUT;
+constexpr auto Default = AudioDeviceRole::DEFAULT;
+constexpr auto Communication = AudioDeviceRole::COMMUNICATION;
+
+void TestQueriesOnlyOnce() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  backend.SetNativeDefault(Output, Default, "speakers");
+
+  CHECK(GetDefaultAudioDeviceID(Output, Default) == "speakers");
+  CHECK(GetDefaultAudioDeviceID(Output, Default) == "speakers");
+  CHECK(backend.GetCallCount("GetNativeDefaultAudioDeviceID") == 1);
+}
+
+void TestNotificationsUpdateWithoutQuerying() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  backend.SetNativeDefault(Input, Default, "microphone");
+  CHECK(GetDefaultAudioDeviceID(Input, Default) == "microphone");
+
+  backend.SetNativeDefault(Input, Default, "headset");
+  backend.DispatchDefaultChanged(Input, Default, "headset");
+  CHECK(GetDefaultAudioDeviceID(Input, Default) == "headset");
+  // No default is reported as an empty ID
+  backend.DispatchDefaultChanged(Input, Default, "");
+  CHECK(GetDefaultAudioDeviceID(Input, Default).empty());
+  CHECK(backend.GetCallCount("GetNativeDefaultAudioDeviceID") == 1);
+}
+
+void TestSetIsVisibleImmediately() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  SetDefaultAudioDeviceID(Output, Communication, "headset");
+  // The notification hasn't been delivered yet
+  CHECK(GetDefaultAudioDeviceID(Output, Communication) == "headset");
+  CHECK(backend.GetCallCount("GetNativeDefaultAudioDeviceID") == 0);
+}
+
+// A notification that arrives while the native query is in progress is at
+// least as new as the query result, so the result must not replace it
+void TestStaleQueryDoesNotOverwriteNotification() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  backend.SetNativeDefault(Input, Communication, "stale");
+  backend.SetNativeCallHook([&backend](std::string_view function) {
+    if (function == "GetNativeDefaultAudioDeviceID") {
+      backend.DispatchDefaultChanged(Input, Communication, "fresh");
+    }
+  });
+
+  // This caller sees the value it queried...
+  CHECK(GetDefaultAudioDeviceID(Input, Communication) == "stale");
+  backend.SetNativeCallHook({});
+  // ... but the cache keeps the notification
+  CHECK(GetDefaultAudioDeviceID(Input, Communication) == "fresh");
+}
+
+void TestConcurrentNotificationsAndReads() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+
+  constexpr int Iterations = 20000;
+  const std::vector<std::string> ids {"a", "b", "c", "d"};
+  std::atomic<bool> done {false};
+  std::atomic<size_t> badReads {0};
+
+  // Every pair has a value from this test before the readers start
+  for (const auto direction: {Output, Input}) {
+    for (const auto role: {Default, Communication}) {
+      backend.DispatchDefaultChanged(direction, role, ids.front());
+    }
+  }
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      while (!done.load()) {
+        for (const auto direction: {Output, Input}) {
+          for (const auto role: {Default, Communication}) {
+            const auto id = GetDefaultAudioDeviceID(direction, role);
+            if (std::ranges::find(ids, id) == ids.end()) {
+              ++badReads;
+            }
+          }
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> notifiers;
+  for (const auto direction: {Output, Input}) {
+    for (const auto role: {Default, Communication}) {
+      notifiers.emplace_back([&, direction, role]() {
+        for (int i = 0; i < Iterations; ++i) {
+          backend.DispatchDefaultChanged(
+            direction, role, ids[i % ids.size()]);
+        }
+        backend.DispatchDefaultChanged(direction, role, ids.back());
+      });
+    }
+  }
+
+  for (auto& thread: notifiers) {
+    thread.join();
+  }
+  done = true;
+  for (auto& thread: readers) {
+    thread.join();
+  }
+
+  CHECK(badReads == 0);
+  for (const auto direction: {Output, Input}) {
+    for (const auto role: {Default, Communication}) {
+      CHECK(GetDefaultAudioDeviceID(direction, role) == ids.back());
+    }
+  }
+}
+
+}// namespace
+
+int main() {
+  TestQueriesOnlyOnce();
+  TestNotificationsUpdateWithoutQuerying();
+  TestSetIsVisibleImmediately();
+  TestStaleQueryDoesNotOverwriteNotification();
+  TestConcurrentNotificationsAndReads();
+  return 0;
+}
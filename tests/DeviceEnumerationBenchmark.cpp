@@ -0,0 +1,82 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "Benchmark.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t DeviceCount = 32;
+constexpr size_t Iterations = 20;
+constexpr auto FastLatency = std::chrono::milliseconds(1);
+// Every `SlowInterval`th property query, like a Bluetooth device
+constexpr auto SlowLatency = std::chrono::milliseconds(50);
+constexpr size_t SlowInterval = 8;
+
+void Benchmark(const char* name, std::chrono::milliseconds timeout) {
+  auto context = CreateAudioContext();
+  context.SetDeviceEnumerationTimeout(timeout);
+  Samples samples;
+  size_t found {};
+  for (size_t i = 0; i < Iterations; ++i) {
+    // Each enumeration queries the platform
+    context.ResetCaches();
+    const auto start = Clock::now();
+    found += context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT).size();
+    samples.Add(Clock::now() - start);
+  }
+  samples.Print(name);
+  std::printf(
+    "  devices per enumeration: %.1f of %zu\n",
+    static_cast<double>(found) / Iterations,
+    DeviceCount);
+}
+
+// Slow devices shouldn't delay the others' queries
+void BenchmarkHeterogeneousLatency() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  for (size_t i = 0; i < DeviceCount; ++i) {
+    AddFakeDevice("device" + std::to_string(i), AudioDeviceDirection::OUTPUT);
+  }
+  std::atomic<size_t> calls {0};
+  backend.SetNativeCallHook([&calls](std::string_view function) {
+    if (function != "GetNativeDeviceInfo") {
+      return;
+    }
+    std::this_thread::sleep_for(
+      (calls++ % SlowInterval) == 0 ? SlowLatency : FastLatency);
+  });
+
+  std::printf(
+    "%zu devices; 1 in %zu takes %lldms, the others %lldms\n",
+    DeviceCount,
+    SlowInterval,
+    static_cast<long long>(SlowLatency.count()),
+    static_cast<long long>(FastLatency.count()));
+  Benchmark("waiting for every device", std::chrono::milliseconds(0));
+  Benchmark("20ms enumeration timeout", std::chrono::milliseconds(20));
+  backend.SetNativeCallHook({});
+}
+
+}// namespace
+
+int main() {
+  BenchmarkHeterogeneousLatency();
+  return 0;
+}
@@ -0,0 +1,179 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+void TestDirections() {
+  FakeBackend::Get().Reset();
+  AddFakeDevice("speakers", AudioDeviceDirection::OUTPUT);
+  AddFakeDevice("headphones", AudioDeviceDirection::OUTPUT);
+  AddFakeDevice("microphone", AudioDeviceDirection::INPUT);
+
+  auto context = CreateAudioContext();
+  const auto outputs = context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT);
+  CHECK(outputs.size() == 2);
+  CHECK(outputs.at("speakers").displayName == "Display speakers");
+  CHECK(outputs.contains("headphones"));
+
+  const auto inputs = context.GetAudioDeviceList(AudioDeviceDirection::INPUT);
+  CHECK(inputs.size() == 1);
+  CHECK(inputs.at("microphone").direction == AudioDeviceDirection::INPUT);
+}
+
+// Properties are fetched concurrently, on initialized threads
+void TestParallel() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  for (const auto id: {"a", "b", "c"}) {
+    AddFakeDevice(id, AudioDeviceDirection::OUTPUT);
+  }
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  size_t inFlight {};
+  size_t maxInFlight {};
+  bool isInitialized {true};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function != "GetNativeDeviceInfo") {
+      return;
+    }
+    std::unique_lock lock(mutex);
+    isInitialized = isInitialized && FakeBackend::IsNativeThreadInitialized();
+    maxInFlight = std::max(maxInFlight, ++inFlight);
+    changed.notify_all();
+    // Only returns early if all three are running at once
+    changed.wait_for(
+      lock, std::chrono::seconds(1), [&]() { return maxInFlight == 3; });
+    --inFlight;
+  });
+
+  auto context = CreateAudioContext();
+  context.SetDeviceEnumerationTimeout(std::chrono::seconds(10));
+  const auto start = std::chrono::steady_clock::now();
+  const auto devices = context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT);
+  backend.SetNativeCallHook({});
+
+  CHECK(devices.size() == 3);
+  CHECK(maxInFlight == 3);
+  CHECK(isInitialized);
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+}
+
+// By default, slow devices are waited for rather than left out
+void TestSlowDevice() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  for (const auto id: {"a", "b", "c"}) {
+    AddFakeDevice(id, AudioDeviceDirection::OUTPUT);
+  }
+
+  std::atomic<bool> isFirst {true};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function == "GetNativeDeviceInfo" && isFirst.exchange(false)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    }
+  });
+
+  auto context = CreateAudioContext();
+  CHECK(context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT).size() == 3);
+  backend.SetNativeCallHook({});
+}
+
+// A device that doesn't respond in time is left out, and isn't queried
+// again until the hung call returns
+void TestTimeout() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  for (const auto id: {"a", "b", "c"}) {
+    AddFakeDevice(id, AudioDeviceDirection::OUTPUT);
+  }
+
+  std::mutex mutex;
+  std::condition_variable released;
+  bool isReleased {false};
+  std::atomic<bool> isFirst {true};
+  std::atomic<bool> isFinished {false};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function != "GetNativeDeviceInfo" || !isFirst.exchange(false)) {
+      return;
+    }
+    std::unique_lock lock(mutex);
+    released.wait(lock, [&]() { return isReleased; });
+    isFinished = true;
+  });
+
+  auto context = CreateAudioContext();
+  context.SetDeviceEnumerationTimeout(std::chrono::milliseconds(100));
+  const auto start = std::chrono::steady_clock::now();
+  const auto devices = context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  CHECK(devices.size() == 2);
+  CHECK(elapsed >= std::chrono::milliseconds(100));
+  CHECK(elapsed < std::chrono::seconds(5));
+
+  // Quarantined, rather than queued behind the hung call
+  const auto calls = backend.GetCallCount("GetNativeDeviceInfo");
+  CHECK(context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT).size() == 2);
+  CHECK(backend.GetCallCount("GetNativeDeviceInfo") == calls + 2);
+
+  // The hung task finishes after the list has been returned
+  {
+    std::unique_lock lock(mutex);
+    isReleased = true;
+  }
+  released.notify_all();
+  CHECK(WaitUntil([&]() { return isFinished.load(); }));
+  CHECK(WaitUntil([&]() {
+    return context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT).size()
+      == 3;
+  }));
+  backend.SetNativeCallHook({});
+}
+
+void TestBackendThread() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("a", AudioDeviceDirection::OUTPUT);
+  AddFakeDevice("b", AudioDeviceDirection::OUTPUT);
+
+  std::atomic<bool> isInitialized {true};
+  backend.SetNativeCallHook([&](std::string_view) {
+    if (!FakeBackend::IsNativeThreadInitialized()) {
+      isInitialized = false;
+    }
+  });
+
+  auto context = CreateAudioContext();
+  context.SetNativeCallThreading(NativeCallThreading::BACKEND_THREAD);
+  CHECK(context.GetAudioDeviceList(AudioDeviceDirection::OUTPUT).size() == 2);
+  CHECK(isInitialized);
+  backend.SetNativeCallHook({});
+}
+
+}// namespace
+
+int main() {
+  TestDirections();
+  TestParallel();
+  TestSlowDevice();
+  TestTimeout();
+  TestBackendThread();
+  return 0;
+}
@@ -0,0 +1,278 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+constexpr auto Timeout = std::chrono::seconds(10);
+
+void Plug(const std::string& id) {
+  AddFakeDevice(id);
+  FakeBackend::Get().DispatchAdded(AudioDeviceDirection::OUTPUT, id);
+}
+
+void Unplug(const std::string& id) {
+  auto& backend = FakeBackend::Get();
+  backend.RemoveDevice(id);
+  backend.DispatchRemoved(AudioDeviceDirection::OUTPUT, id);
+}
+
+// Results of asynchronous waits
+class Results final {
+ public:
+  std::function<void(result<void>)> Add() {
+    return [this](result<void> waited) {
+      std::unique_lock lock(mMutex);
+      mErrors.push_back(
+        waited ? std::nullopt : std::optional<Error> {waited.error()});
+    };
+  }
+
+  std::vector<std::optional<Error>> Get() const {
+    std::unique_lock lock(mMutex);
+    return mErrors;
+  }
+
+  size_t GetCount() const {
+    std::unique_lock lock(mMutex);
+    return mErrors.size();
+  }
+
+ private:
+  mutable std::mutex mMutex;
+  std::vector<std::optional<Error>> mErrors;
+};
+
+void TestAlreadyInState() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("present");
+
+  CHECK(WaitForDeviceState("present", AudioDeviceState::CONNECTED, Timeout)
+          .has_value());
+  auto missing = WaitForDeviceState(
+    "missing", AudioDeviceState::CONNECTED, std::chrono::milliseconds(50));
+  CHECK(missing.error() == Error::TIMEOUT);
+
+  // Asynchronous waits still complete on a library thread
+  Results results;
+  const auto caller = std::this_thread::get_id();
+  std::atomic<bool> isOtherThread {false};
+  WaitForDeviceState(
+    "present",
+    AudioDeviceState::CONNECTED,
+    Timeout,
+    [&, onComplete = results.Add()](result<void> waited) {
+      isOtherThread = std::this_thread::get_id() != caller;
+      onComplete(waited);
+    });
+  CHECK(WaitUntil([&]() { return results.GetCount() == 1; }));
+  CHECK(isOtherThread);
+  CHECK(!results.Get()[0]);
+}
+
+void TestPlugNotifications() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+
+  std::optional<result<void>> plugged;
+  std::thread waiter([&plugged]() {
+    plugged
+      = WaitForDeviceState("plugged", AudioDeviceState::CONNECTED, Timeout);
+  });
+  // Once it's waiting
+  CHECK(
+    WaitUntil([&]() { return backend.GetCallCount("GetAudioDeviceState"); }));
+  Plug("plugged");
+  waiter.join();
+  CHECK(plugged->has_value());
+
+  Results results;
+  WaitForDeviceState(
+    "plugged", AudioDeviceState::DEVICE_NOT_PRESENT, Timeout, results.Add());
+  Unplug("plugged");
+  CHECK(WaitUntil([&]() { return results.GetCount() == 1; }));
+  CHECK(!results.Get()[0]);
+}
+
+// Waiters for the same device share queries
+void TestQueriesAreShared() {
+  constexpr size_t WaiterCount = 8;
+
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  const auto gate = std::make_shared<Gate>();
+  backend.SetNativeCallHook([gate](std::string_view function) {
+    if (function == "GetAudioDeviceState") {
+      gate->Wait();
+    }
+  });
+
+  Results results;
+  WaitForDeviceState(
+    "shared", AudioDeviceState::CONNECTED, Timeout, results.Add());
+  // The rest start while the first query is running
+  CHECK(
+    WaitUntil([&]() { return backend.GetCallCount("GetAudioDeviceState"); }));
+  for (size_t i = 1; i < WaiterCount; ++i) {
+    WaitForDeviceState(
+      "shared", AudioDeviceState::CONNECTED, Timeout, results.Add());
+  }
+  gate->Release();
+  Plug("shared");
+
+  CHECK(WaitUntil([&]() { return results.GetCount() == WaiterCount; }));
+  for (const auto& error: results.Get()) {
+    CHECK(!error);
+  }
+  // The first query, one for the waiters that started during it, and one
+  // for the notification
+  CHECK(backend.GetCallCount("GetAudioDeviceState") <= 3);
+  backend.SetNativeCallHook({});
+}
+
+void TestAsyncTimeout() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  Results results;
+  const auto start = std::chrono::steady_clock::now();
+  WaitForDeviceState(
+    "late",
+    AudioDeviceState::CONNECTED,
+    std::chrono::milliseconds(50),
+    results.Add());
+  CHECK(WaitUntil([&]() { return results.GetCount() == 1; }));
+  CHECK(
+    std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+  CHECK(results.Get()[0] == Error::TIMEOUT);
+
+  // Not completed a second time
+  Plug("late");
+  CHECK(WaitForDeviceState("late", AudioDeviceState::CONNECTED, Timeout)
+          .has_value());
+  CHECK(results.GetCount() == 1);
+}
+
+void SetState(const std::string& id, AudioDeviceState state) {
+  FakeBackend::Get().UpdateDevice(
+    id, [state](FakeDevice& device) { device.info.state = state; });
+}
+
+// Changes that aren't plug events, such as jacks on macOS, are picked up by
+// watching the device
+void TestWatchedChanges() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("jack");
+  SetState("jack", AudioDeviceState::DEVICE_PRESENT_NO_CONNECTION);
+  constexpr auto Kind = FakeBackend::WatchKind::DEVICE_INFO;
+
+  Results results;
+  WaitForDeviceState(
+    "jack", AudioDeviceState::CONNECTED, Timeout, results.Add());
+  CHECK(WaitUntil([&]() { return backend.GetWatchCount(Kind, "jack"); }));
+
+  SetState("jack", AudioDeviceState::CONNECTED);
+  backend.NotifyDeviceInfoChanged("jack");
+  CHECK(WaitUntil([&]() { return results.GetCount() == 1; }));
+  CHECK(!results.Get()[0]);
+  // Only watched while waited for
+  CHECK(backend.GetWatchCount(Kind, "jack") == 0);
+}
+
+void TestUnwatchableDevicesArePolled() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  backend.SetFailure("WatchNativeDeviceInfo", Error::OPERATION_UNSUPPORTED);
+  AddFakeDevice("polled");
+  SetState("polled", AudioDeviceState::DEVICE_PRESENT_NO_CONNECTION);
+
+  Results results;
+  WaitForDeviceState(
+    "polled", AudioDeviceState::CONNECTED, Timeout, results.Add());
+  CHECK(WaitUntil(
+    [&]() { return backend.GetCallCount("WatchNativeDeviceInfo"); }));
+
+  // Without any notification
+  SetState("polled", AudioDeviceState::CONNECTED);
+  CHECK(WaitUntil([&]() { return results.GetCount() == 1; }));
+  CHECK(!results.Get()[0]);
+  backend.SetFailure("WatchNativeDeviceInfo", std::nullopt);
+}
+
+// Starts immediately, and isn't resumed by anything else
+struct Task {
+  struct promise_type {
+    Task get_return_object() {
+      return {};
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() {
+    }
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+};
+
+Task Await(
+  std::string id,
+  std::chrono::milliseconds timeout,
+  std::shared_ptr<Results> results) {
+  const auto onComplete = results->Add();
+  onComplete(
+    co_await AwaitDeviceState(id, AudioDeviceState::CONNECTED, timeout));
+}
+
+void TestAwaitable() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  const auto results = std::make_shared<Results>();
+  Await("awaited", Timeout, results);
+  Await("timed-out", std::chrono::milliseconds(50), results);
+  Plug("awaited");
+  CHECK(WaitUntil([&]() { return results->GetCount() == 2; }));
+  auto errors = results->Get();
+  std::ranges::sort(errors);
+  CHECK(!errors[0]);
+  CHECK(errors[1] == Error::TIMEOUT);
+}
+
+}// namespace
+
+int main() {
+  TestAlreadyInState();
+  TestPlugNotifications();
+  TestQueriesAreShared();
+  TestAsyncTimeout();
+  TestAwaitable();
+  TestWatchedChanges();
+  TestUnwatchableDevicesArePolled();
+  return 0;
+}
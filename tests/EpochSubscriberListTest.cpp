@@ -0,0 +1,167 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "EpochSubscriberList.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using List = EpochSubscriberList<std::function<void()>>;
+
+void TestAddAndRemove() {
+  List list;
+  CHECK(list.IsEmpty());
+  int first = 0;
+  int second = 0;
+  const auto firstID = list.Add([&first]() { ++first; });
+  list.Add([&second]() { ++second; });
+  CHECK(!list.IsEmpty());
+
+  list.ForEach([](const auto& f) { f(); });
+  list.Remove(firstID);
+  list.ForEach([](const auto& f) { f(); });
+  // Unknown IDs are ignored
+  list.Remove(firstID);
+
+  CHECK(first == 1);
+  CHECK(second == 2);
+}
+
+/* Once `Remove()` returns, a subscriber must not be running or start
+ * running on any thread, so that it can refer to state that is destroyed
+ * straight after its handle.
+ *
+ * Built with `AUDIODEVICELIB_SANITIZE_THREAD`, this also checks that the
+ * snapshot reclamation doesn't race with readers.
+ */
+void TestRemoveWaitsForReaders() {
+  List list;
+  std::atomic<bool> stop {false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      while (!stop) {
+        list.ForEach([](const auto& f) { f(); });
+      }
+    });
+  }
+
+  std::atomic<size_t> violations {0};
+  std::atomic<size_t> calls {0};
+  for (int i = 0; i < 20000; ++i) {
+    // Written non-atomically after `Remove()`, so the sanitizer reports any
+    // invocation that overlaps it
+    struct State {
+      bool mIsRemoved {false};
+    } state;
+    const auto id = list.Add([&state, &violations, &calls]() {
+      ++calls;
+      if (state.mIsRemoved) {
+        ++violations;
+      }
+      std::this_thread::yield();
+      if (state.mIsRemoved) {
+        ++violations;
+      }
+    });
+    if (i % 100 == 0) {
+      // Give the readers a chance to start an invocation
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    list.Remove(id);
+    state.mIsRemoved = true;
+  }
+
+  stop = true;
+  for (auto& thread: readers) {
+    thread.join();
+  }
+  CHECK(calls > 0);
+  CHECK(violations == 0);
+  CHECK(list.IsEmpty());
+}
+
+void TestRemoveWaitsForSlowSubscriber() {
+  List list;
+  std::atomic<bool> started {false};
+  std::atomic<bool> finished {false};
+  const auto id = list.Add([&]() {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    finished = true;
+  });
+
+  std::thread reader([&]() { list.ForEach([](const auto& f) { f(); }); });
+  CHECK(WaitUntil([&]() { return started.load(); }));
+  list.Remove(id);
+  CHECK(finished);
+  reader.join();
+}
+
+void TestSubscriberCanRemoveItself() {
+  List list;
+  int calls = 0;
+  List::SubscriptionID id {};
+  id = list.Add([&]() {
+    ++calls;
+    // Must not wait for this invocation
+    list.Remove(id);
+  });
+  list.ForEach([](const auto& f) { f(); });
+  list.ForEach([](const auto& f) { f(); });
+  CHECK(calls == 1);
+  CHECK(list.IsEmpty());
+}
+
+void TestSubscriberCanAdd() {
+  List list;
+  int added = 0;
+  list.Add([&]() {
+    if (added == 0) {
+      list.Add([&added]() { ++added; });
+    }
+  });
+  // The new subscriber isn't in the snapshot being iterated
+  list.ForEach([](const auto& f) { f(); });
+  CHECK(added == 0);
+  list.ForEach([](const auto& f) { f(); });
+  CHECK(added == 1);
+}
+
+// Another thread's invocation may remove itself while this thread is waiting
+// for it in `Remove()`
+void TestConcurrentSelfRemoval() {
+  for (int i = 0; i < 1000; ++i) {
+    List list;
+    List::SubscriptionID id {};
+    id = list.Add([&]() { list.Remove(id); });
+    std::thread reader([&]() { list.ForEach([](const auto& f) { f(); }); });
+    list.Remove(id);
+    reader.join();
+    CHECK(list.IsEmpty());
+  }
+}
+
+}// namespace
+
+int main() {
+  TestAddAndRemove();
+  TestRemoveWaitsForReaders();
+  TestRemoveWaitsForSlowSubscriber();
+  TestSubscriberCanRemoveItself();
+  TestSubscriberCanAdd();
+  TestConcurrentSelfRemoval();
+  return 0;
+}
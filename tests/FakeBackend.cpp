@@ -0,0 +1,843 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include "FakeBackend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include "AudioDeviceEventHub.h"
+#include "AudioSessionTable.h"
+#include "NativeAudioStreams.h"
+#include "NativeDevices.h"
+#include "VolumeChangeFilter.h"
+
+namespace {
+// Set by `InitializeNativeThread()`
+thread_local bool gIsNativeThreadInitialized {false};
+}// namespace
+
+namespace FredEmmott::Audio::Testing {
+
+class FakeRenderStream final : public NativeRenderStream {
+ public:
+  FakeRenderStream(AudioStreamFormat format, Callback callback)
+    : mFormat(format), mCallback(std::move(callback)) {
+  }
+
+  ~FakeRenderStream() override {
+    FakeBackend::Get().RemoveRenderStream(this);
+  }
+
+  AudioStreamFormat GetFormat() const override {
+    return mFormat;
+  }
+
+  result<void> Start() override {
+    if (const auto error
+        = FakeBackend::Get().BeginNativeCall("NativeRenderStream::Start")) {
+      return {unexpect, *error};
+    }
+    std::unique_lock lock(mMutex);
+    mIsStarted = true;
+    return {};
+  }
+
+  void Stop() override {
+    std::unique_lock lock(mMutex);
+    mIsStarted = false;
+  }
+
+  // Returns `false` if the stream isn't started
+  bool Render(std::vector<float>& interleaved, uint32_t frames) {
+    std::unique_lock lock(mMutex);
+    if (!mIsStarted) {
+      return false;
+    }
+    interleaved.resize(frames * mFormat.channels);
+    mCallback({
+      .mData = interleaved.data(),
+      .mFrames = frames,
+      .mChannels = mFormat.channels,
+      .mSampleRate = mFormat.sampleRate,
+      .mFormat = mFormat.sampleFormat,
+    });
+    return true;
+  }
+
+ private:
+  const AudioStreamFormat mFormat;
+  const Callback mCallback;
+
+  // Held while rendering, so that `Stop()` waits for the callback
+  std::mutex mMutex;
+  bool mIsStarted {false};
+};
+
+FakeBackend& FakeBackend::Get() {
+  // Intentionally leaked: library threads may still make native calls during
+  // static destruction
+  static auto instance = new FakeBackend();
+  return *instance;
+}
+
+void FakeBackend::AddDevice(const FakeDevice& device) {
+  std::unique_lock lock(mMutex);
+  mDevices.insert_or_assign(device.info.id, device);
+}
+
+void FakeBackend::RemoveDevice(const std::string& deviceID) {
+  std::unique_lock lock(mMutex);
+  mDevices.erase(deviceID);
+}
+
+bool FakeBackend::UpdateDevice(
+  const std::string& deviceID,
+  const std::function<void(FakeDevice&)>& update) {
+  std::unique_lock lock(mMutex);
+  const auto it = mDevices.find(deviceID);
+  if (it == mDevices.end()) {
+    return false;
+  }
+  update(it->second);
+  return true;
+}
+
+std::vector<std::string> FakeBackend::GetDeviceIDs(
+  AudioDeviceDirection direction) const {
+  std::unique_lock lock(mMutex);
+  std::vector<std::string> ids;
+  for (const auto& [id, device]: mDevices) {
+    if (device.info.direction == direction) {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+std::optional<FakeDevice> FakeBackend::GetDevice(
+  const std::string& deviceID) const {
+  std::unique_lock lock(mMutex);
+  const auto it = mDevices.find(deviceID);
+  if (it == mDevices.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void FakeBackend::SetNativeDefault(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role,
+  const std::string& deviceID) {
+  std::unique_lock lock(mMutex);
+  mDefaults.insert_or_assign({direction, role}, deviceID);
+}
+
+std::string FakeBackend::GetNativeDefault(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role) const {
+  std::unique_lock lock(mMutex);
+  const auto it = mDefaults.find({direction, role});
+  if (it == mDefaults.end()) {
+    return {};
+  }
+  return it->second;
+}
+
+void FakeBackend::SetFailure(
+  std::string_view function,
+  std::optional<Error> error) {
+  std::unique_lock lock(mMutex);
+  if (error) {
+    mFailures.insert_or_assign(std::string(function), *error);
+    return;
+  }
+  const auto it = mFailures.find(function);
+  if (it != mFailures.end()) {
+    mFailures.erase(it);
+  }
+}
+
+void FakeBackend::SetNativeCallHook(NativeCallHook hook) {
+  std::unique_lock lock(mMutex);
+  mHook = std::move(hook);
+}
+
+size_t FakeBackend::GetCallCount(std::string_view function) const {
+  std::unique_lock lock(mMutex);
+  const auto it = mCallCounts.find(function);
+  if (it == mCallCounts.end()) {
+    return 0;
+  }
+  return it->second;
+}
+
+void FakeBackend::Reset() {
+  std::unique_lock lock(mMutex);
+  mDevices.clear();
+  mDefaults.clear();
+  mFailures.clear();
+  mCallCounts.clear();
+  mHook = {};
+}
+
+std::optional<Error> FakeBackend::BeginNativeCall(std::string_view function) {
+  NativeCallHook hook;
+  {
+    std::unique_lock lock(mMutex);
+    auto count = mCallCounts.find(function);
+    if (count == mCallCounts.end()) {
+      count = mCallCounts.emplace(std::string(function), 0).first;
+    }
+    ++count->second;
+    hook = mHook;
+  }
+  if (hook) {
+    hook(function);
+  }
+
+  std::unique_lock lock(mMutex);
+  const auto failure = mFailures.find(function);
+  if (failure == mFailures.end()) {
+    return std::nullopt;
+  }
+  return failure->second;
+}
+
+void FakeBackend::DispatchAdded(
+  AudioDeviceDirection direction,
+  const std::string& deviceID) {
+  GetAudioDeviceEventHub()->Dispatch({
+    .kind = AudioDeviceEventKind::ADDED,
+    .direction = direction,
+    .deviceID = deviceID,
+  });
+}
+
+void FakeBackend::DispatchRemoved(
+  AudioDeviceDirection direction,
+  const std::string& deviceID) {
+  GetAudioDeviceEventHub()->Dispatch({
+    .kind = AudioDeviceEventKind::REMOVED,
+    .direction = direction,
+    .deviceID = deviceID,
+  });
+}
+
+void FakeBackend::DispatchDefaultChanged(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role,
+  const std::string& deviceID) {
+  GetAudioDeviceEventHub()->Dispatch({
+    .kind = AudioDeviceEventKind::DEFAULT_CHANGED,
+    .direction = direction,
+    .role = role,
+    .deviceID = deviceID,
+  });
+}
+
+void FakeBackend::DispatchStateChanged(
+  AudioDeviceDirection direction,
+  const std::string& deviceID,
+  AudioDeviceState state) {
+  GetAudioDeviceEventHub()->Dispatch({
+    .kind = AudioDeviceEventKind::STATE_CHANGED,
+    .direction = direction,
+    .deviceID = deviceID,
+    .state = state,
+  });
+}
+
+uint64_t FakeBackend::AddVolumeCallback(
+  const std::string& deviceID,
+  VolumeCallback callback) {
+  std::unique_lock lock(mMutex);
+  const auto id = mNextCallbackID++;
+  mVolumeCallbacks.emplace(id, std::make_pair(deviceID, std::move(callback)));
+  return id;
+}
+
+void FakeBackend::RemoveVolumeCallback(uint64_t id) {
+  std::unique_lock lock(mMutex);
+  mVolumeCallbacks.erase(id);
+}
+
+void FakeBackend::NotifyVolumeChanged(const std::string& deviceID) {
+  std::vector<VolumeCallback> callbacks;
+  FakeDevice device;
+  {
+    std::unique_lock lock(mMutex);
+    const auto it = mDevices.find(deviceID);
+    if (it == mDevices.end()) {
+      return;
+    }
+    device = it->second;
+    for (const auto& [id, entry]: mVolumeCallbacks) {
+      if (entry.first == deviceID) {
+        callbacks.push_back(entry.second);
+      }
+    }
+  }
+  for (const auto& callback: callbacks) {
+    callback(device);
+  }
+}
+
+uint64_t FakeBackend::AddWatch(
+  WatchKind kind,
+  const std::string& deviceID,
+  WatchCallback callback) {
+  std::unique_lock lock(mMutex);
+  const auto id = mNextCallbackID++;
+  mWatches.emplace(id, std::make_tuple(kind, deviceID, std::move(callback)));
+  return id;
+}
+
+void FakeBackend::RemoveWatch(uint64_t id) {
+  std::unique_lock lock(mMutex);
+  mWatches.erase(id);
+}
+
+size_t FakeBackend::GetWatchCount(
+  WatchKind kind,
+  const std::string& deviceID) const {
+  std::unique_lock lock(mMutex);
+  return std::ranges::count_if(mWatches, [&](const auto& it) {
+    const auto& [watchKind, watchDeviceID, callback] = it.second;
+    return watchKind == kind && watchDeviceID == deviceID;
+  });
+}
+
+void FakeBackend::Notify(WatchKind kind, const std::string& deviceID) {
+  std::vector<WatchCallback> callbacks;
+  {
+    std::unique_lock lock(mMutex);
+    for (const auto& [id, watch]: mWatches) {
+      const auto& [watchKind, watchDeviceID, callback] = watch;
+      if (watchKind == kind && watchDeviceID == deviceID) {
+        callbacks.push_back(callback);
+      }
+    }
+  }
+  for (const auto& callback: callbacks) {
+    callback();
+  }
+}
+
+void FakeBackend::NotifyDeviceInfoChanged(const std::string& deviceID) {
+  Notify(WatchKind::DEVICE_INFO, deviceID);
+}
+
+void FakeBackend::NotifyStreamPropertiesChanged(const std::string& deviceID) {
+  Notify(WatchKind::STREAM_PROPERTIES, deviceID);
+}
+
+void FakeBackend::AddRenderStream(
+  const std::string& deviceID,
+  FakeRenderStream* stream) {
+  std::unique_lock lock(mMutex);
+  mRenderStreams.emplace(deviceID, stream);
+}
+
+void FakeBackend::RemoveRenderStream(FakeRenderStream* stream) {
+  std::unique_lock lock(mMutex);
+  std::erase_if(
+    mRenderStreams, [stream](const auto& it) { return it.second == stream; });
+}
+
+std::optional<std::vector<float>> FakeBackend::Render(
+  const std::string& deviceID,
+  uint32_t frames) {
+  // Held while rendering, so that streams can't be destroyed meanwhile
+  std::unique_lock lock(mMutex);
+  const auto [begin, end] = mRenderStreams.equal_range(deviceID);
+  std::vector<float> interleaved;
+  for (auto it = begin; it != end; ++it) {
+    if (!it->second->Render(interleaved, frames)) {
+      continue;
+    }
+    const auto channels = it->second->GetFormat().channels;
+    std::vector<float> ret(frames);
+    for (uint32_t i = 0; i < frames; ++i) {
+      ret[i] = interleaved[i * channels];
+    }
+    return ret;
+  }
+  return std::nullopt;
+}
+
+size_t FakeBackend::GetRenderStreamCount(const std::string& deviceID) const {
+  std::unique_lock lock(mMutex);
+  return mRenderStreams.count(deviceID);
+}
+
+bool FakeBackend::IsNativeThreadInitialized() {
+  return gIsNativeThreadInitialized;
+}
+
+FakeDevice MakeFakeDevice(
+  const std::string& id,
+  AudioDeviceDirection direction) {
+  return {
+    .info = {
+      .id = id,
+      .interfaceName = "Interface " + id,
+      .endpointName = "Endpoint " + id,
+      .displayName = "Display " + id,
+      .direction = direction,
+      .state = AudioDeviceState::CONNECTED,
+    },
+  };
+}
+
+void AddFakeDevice(
+  const std::string& id,
+  AudioDeviceDirection direction,
+  const std::function<void(FakeDevice&)>& configure) {
+  auto device = MakeFakeDevice(id, direction);
+  if (configure) {
+    configure(device);
+  }
+  FakeBackend::Get().AddDevice(device);
+}
+
+}// namespace FredEmmott::Audio::Testing
+
+namespace FredEmmott::Audio {
+
+using Testing::FakeBackend;
+using Testing::FakeDevice;
+using Testing::FakeRenderStream;
+
+namespace {
+
+/* Runs `f` with the device, under the backend's lock.
+ *
+ * Fails with the injected error, or with `DEVICE_NOT_AVAILABLE` if the
+ * device doesn't exist.
+ */
+template <class T, class F>
+result<T> CallWithDevice(
+  std::string_view function,
+  const std::string& deviceID,
+  F&& f) {
+  auto& backend = FakeBackend::Get();
+  if (const auto error = backend.BeginNativeCall(function)) {
+    return {unexpect, *error};
+  }
+  // `result<T>` isn't movable, so the value and error are kept separately
+  std::optional<Error> error;
+  [[maybe_unused]] std::conditional_t<std::is_void_v<T>, bool, std::optional<T>>
+    value {};
+  const auto found = backend.UpdateDevice(
+    deviceID, [&error, &value, &f](FakeDevice& device) {
+      result<T> ret = f(device);
+      if (!ret.has_value()) {
+        error = ret.error();
+      } else if constexpr (!std::is_void_v<T>) {
+        value = std::move(*ret);
+      }
+    });
+  if (!found) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
+  if (error) {
+    return {unexpect, *error};
+  }
+  if constexpr (std::is_void_v<T>) {
+    return {};
+  } else {
+    return std::move(*value);
+  }
+}
+
+// Linear in decibels, like an endpoint with a dB-linear taper
+void SetScalar(FakeDevice& device, float scalar) {
+  const auto& range = device.range;
+  device.volume.volumeScalar = scalar;
+  device.volume.volumeDecibels
+    = range.minDecibels + (scalar * (range.maxDecibels - range.minDecibels));
+  device.volume.volumeStep
+    = static_cast<uint32_t>(std::lround(scalar * range.volumeSteps));
+}
+
+}// namespace
+
+void InitializeNativeThread() {
+  gIsNativeThreadInitialized = true;
+}
+
+std::vector<std::string> GetNativeDeviceIDs(AudioDeviceDirection direction) {
+  auto& backend = FakeBackend::Get();
+  if (backend.BeginNativeCall(__func__)) {
+    return {};
+  }
+  return backend.GetDeviceIDs(direction);
+}
+
+result<AudioDeviceInfo> GetNativeDeviceInfo(
+  AudioDeviceDirection direction,
+  const std::string& deviceID) {
+  return CallWithDevice<AudioDeviceInfo>(
+    __func__,
+    deviceID,
+    [direction](FakeDevice& device) -> result<AudioDeviceInfo> {
+      if (device.info.direction != direction) {
+        return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+      }
+      return device.info;
+    });
+}
+
+AudioDeviceState GetAudioDeviceState(const std::string& deviceID) {
+  return CallWithDevice<AudioDeviceState>(
+           __func__,
+           deviceID,
+           [](FakeDevice& device) { return device.info.state; })
+    .value_or(AudioDeviceState::DEVICE_NOT_PRESENT);
+}
+
+result<void> PrewarmNativeDevice(const std::string& deviceID) {
+  return CallWithDevice<void>(
+    __func__, deviceID, [](FakeDevice&) -> result<void> { return {}; });
+}
+
+result<NativeWatchHandle> WatchNativeDeviceInfo(
+  const std::string& deviceID,
+  std::function<void()> callback) {
+  if (const auto error = FakeBackend::Get().BeginNativeCall(__func__)) {
+    return {unexpect, *error};
+  }
+  const auto id = FakeBackend::Get().AddWatch(
+    FakeBackend::WatchKind::DEVICE_INFO, deviceID, std::move(callback));
+  return NativeWatchHandle([id]() { FakeBackend::Get().RemoveWatch(id); });
+}
+
+std::string GetNativeDefaultAudioDeviceID(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role) {
+  auto& backend = FakeBackend::Get();
+  backend.BeginNativeCall(__func__);
+  return backend.GetNativeDefault(direction, role);
+}
+
+bool SetNativeDefaultAudioDeviceID(
+  AudioDeviceDirection direction,
+  AudioDeviceRole role,
+  const std::string& deviceID) {
+  auto& backend = FakeBackend::Get();
+  if (backend.BeginNativeCall(__func__)) {
+    return false;
+  }
+  backend.SetNativeDefault(direction, role, deviceID);
+  return true;
+}
+
+AudioDeviceEventHub* GetAudioDeviceEventHub() {
+  // Intentionally leaked, like the platform hubs
+  static auto hub = new AudioDeviceEventHub();
+  return hub;
+}
+
+result<bool> IsNativeDeviceMuted(const std::string& deviceID) {
+  return CallWithDevice<bool>(
+    __func__, deviceID, [](FakeDevice& device) {
+      return device.volume.isMuted;
+    });
+}
+
+result<void> MuteNativeDevice(const std::string& deviceID) {
+  return CallWithDevice<void>(
+    __func__, deviceID, [](FakeDevice& device) -> result<void> {
+      device.volume.isMuted = true;
+      return {};
+    });
+}
+
+result<void> UnmuteNativeDevice(const std::string& deviceID) {
+  return CallWithDevice<void>(
+    __func__, deviceID, [](FakeDevice& device) -> result<void> {
+      device.volume.isMuted = false;
+      return {};
+    });
+}
+
+result<VolumeRange> GetNativeDeviceVolumeRange(const std::string& deviceID) {
+  return CallWithDevice<VolumeRange>(
+    __func__, deviceID, [](FakeDevice& device) { return device.range; });
+}
+
+result<Volume> GetNativeDeviceVolume(const std::string& deviceID) {
+  return CallWithDevice<Volume>(
+    __func__, deviceID, [](FakeDevice& device) { return device.volume; });
+}
+
+result<void> SetNativeDeviceVolumeScalar(
+  const std::string& deviceID,
+  float scalar) {
+  return CallWithDevice<void>(
+    __func__, deviceID, [scalar](FakeDevice& device) -> result<void> {
+      if (scalar < 0.0f || scalar > 1.0f) {
+        return {unexpect, Error::OUT_OF_RANGE};
+      }
+      SetScalar(device, scalar);
+      return {};
+    });
+}
+
+result<void> SetNativeDeviceVolumeDecibels(
+  const std::string& deviceID,
+  float decibels) {
+  return CallWithDevice<void>(
+    __func__, deviceID, [decibels](FakeDevice& device) -> result<void> {
+      const auto& range = device.range;
+      if (decibels < range.minDecibels || decibels > range.maxDecibels) {
+        return {unexpect, Error::OUT_OF_RANGE};
+      }
+      SetScalar(
+        device,
+        (decibels - range.minDecibels)
+          / (range.maxDecibels - range.minDecibels));
+      return {};
+    });
+}
+
+namespace {
+
+result<void> StepVolume(
+  std::string_view function,
+  const std::string& deviceID,
+  int32_t delta) {
+  return CallWithDevice<void>(
+    function, deviceID, [delta](FakeDevice& device) -> result<void> {
+      const auto steps = static_cast<float>(device.range.volumeSteps);
+      const auto step = std::lround(device.volume.volumeScalar * steps) + delta;
+      SetScalar(device, std::clamp(step / steps, 0.0f, 1.0f));
+      return {};
+    });
+}
+
+}// namespace
+
+result<void> IncreaseNativeDeviceVolume(const std::string& deviceID) {
+  return StepVolume(__func__, deviceID, 1);
+}
+
+result<void> DecreaseNativeDeviceVolume(const std::string& deviceID) {
+  return StepVolume(__func__, deviceID, -1);
+}
+
+result<std::vector<float>> GetNativeDeviceChannelVolumes(
+  const std::string& deviceID) {
+  return CallWithDevice<std::vector<float>>(
+    __func__, deviceID, [](FakeDevice& device) {
+      return device.channelVolumes;
+    });
+}
+
+result<void> SetNativeDeviceChannelVolumes(
+  const std::string& deviceID,
+  std::span<const float> volumes) {
+  return CallWithDevice<void>(
+    __func__, deviceID, [volumes](FakeDevice& device) -> result<void> {
+      if (volumes.size() != device.channelVolumes.size()) {
+        return {unexpect, Error::OUT_OF_RANGE};
+      }
+      std::ranges::copy(volumes, device.channelVolumes.begin());
+      return {};
+    });
+}
+
+class MuteCallbackHandle::Impl {
+ public:
+  explicit Impl(uint64_t id) : mID(id) {
+  }
+
+  ~Impl() {
+    FakeBackend::Get().RemoveVolumeCallback(mID);
+  }
+
+ private:
+  uint64_t mID;
+};
+
+MuteCallbackHandle::MuteCallbackHandle(const std::shared_ptr<Impl>& p) : p(p) {
+}
+
+MuteCallbackHandle::~MuteCallbackHandle() = default;
+
+result<MuteCallbackHandle> AddAudioDeviceMuteUnmuteCallback(
+  const std::string& deviceID,
+  std::function<void(bool isMuted)> cb,
+  CallbackDelivery delivery) {
+  if (const auto error = FakeBackend::Get().BeginNativeCall(__func__)) {
+    return {unexpect, *error};
+  }
+  const auto initial = GetNativeDeviceVolume(deviceID);
+  if (!initial) {
+    return {unexpect, initial.error()};
+  }
+  auto filter = std::make_shared<VolumeChangeFilter>(
+    delivery, VolumeChangedFields::MUTE, *initial);
+  const auto id = FakeBackend::Get().AddVolumeCallback(
+    deviceID, [cb, filter](const FakeDevice& device) {
+      const auto event = filter->Update(device.volume);
+      if (event) {
+        cb(event->volume.isMuted);
+      }
+    });
+  return {{std::make_shared<MuteCallbackHandle::Impl>(id)}};
+}
+
+class VolumeCallbackHandle::Impl {
+ public:
+  explicit Impl(uint64_t id) : mID(id) {
+  }
+
+  ~Impl() {
+    FakeBackend::Get().RemoveVolumeCallback(mID);
+  }
+
+ private:
+  uint64_t mID;
+};
+
+VolumeCallbackHandle::VolumeCallbackHandle(const std::shared_ptr<Impl>& p)
+  : p(p) {
+}
+
+VolumeCallbackHandle::~VolumeCallbackHandle() = default;
+
+result<VolumeCallbackHandle> AddAudioDeviceVolumeChangeCallback(
+  const std::string& deviceID,
+  std::function<void(const VolumeChangeEvent&)> cb,
+  CallbackDelivery delivery) {
+  if (const auto error = FakeBackend::Get().BeginNativeCall(__func__)) {
+    return {unexpect, *error};
+  }
+  const auto initial = GetNativeDeviceVolume(deviceID);
+  if (!initial) {
+    return {unexpect, initial.error()};
+  }
+  auto filter = std::make_shared<VolumeChangeFilter>(
+    delivery,
+    VolumeChangedFields::MUTE | VolumeChangedFields::SCALAR
+      | VolumeChangedFields::DECIBELS | VolumeChangedFields::STEP
+      | VolumeChangedFields::CHANNELS,
+    *initial);
+  const auto id = FakeBackend::Get().AddVolumeCallback(
+    deviceID, [cb, filter](const FakeDevice& device) {
+      const auto event = filter->Update(device.volume, device.channelVolumes);
+      if (event) {
+        cb(*event);
+      }
+    });
+  return {{std::make_shared<VolumeCallbackHandle::Impl>(id)}};
+}
+
+result<VolumeCallbackHandle> AddAudioDeviceVolumeCallback(
+  const std::string& deviceID,
+  std::function<void(const Volume&)> cb,
+  CallbackDelivery delivery) {
+  return AddAudioDeviceVolumeChangeCallback(
+    deviceID,
+    [cb](const VolumeChangeEvent& event) { cb(event.volume); },
+    delivery);
+}
+
+result<bool> IsNativeMuteAfterCapture(const std::string& deviceID) {
+  return CallWithDevice<bool>(__func__, deviceID, [](FakeDevice& device) {
+    return device.isMuteAfterCapture;
+  });
+}
+
+result<std::unique_ptr<NativeCaptureStream>> OpenNativeCaptureStream(
+  const std::string&,
+  NativeCaptureStream::Callback) {
+  return {unexpect, Error::OPERATION_UNSUPPORTED};
+}
+
+result<std::unique_ptr<NativeRenderStream>> OpenNativeRenderStream(
+  const std::string& deviceID,
+  NativeRenderStream::Callback callback) {
+  auto format = CallWithDevice<AudioStreamFormat>(
+    __func__, deviceID, [](FakeDevice& device) -> result<AudioStreamFormat> {
+      if (device.info.direction != AudioDeviceDirection::OUTPUT) {
+        return {unexpect, Error::OPERATION_UNSUPPORTED};
+      }
+      return device.streamProperties.format;
+    });
+  if (!format) {
+    return {unexpect, format.error()};
+  }
+  auto stream
+    = std::make_unique<FakeRenderStream>(*format, std::move(callback));
+  FakeBackend::Get().AddRenderStream(deviceID, stream.get());
+  return std::unique_ptr<NativeRenderStream>(std::move(stream));
+}
+
+result<AudioDeviceStreamProperties> QueryNativeStreamProperties(
+  const std::string& deviceID) {
+  return CallWithDevice<AudioDeviceStreamProperties>(
+    __func__, deviceID, [](FakeDevice& device) {
+      return device.streamProperties;
+    });
+}
+
+result<NativeWatchHandle> WatchNativeStreamProperties(
+  const std::string& deviceID,
+  std::function<void()> callback) {
+  const auto id = FakeBackend::Get().AddWatch(
+    FakeBackend::WatchKind::STREAM_PROPERTIES, deviceID, std::move(callback));
+  return NativeWatchHandle([id]() { FakeBackend::Get().RemoveWatch(id); });
+}
+
+result<AudioSessionTable*> GetAudioSessionTable(const std::string& deviceID) {
+  static std::mutex mutex;
+  static std::map<std::string, AudioSessionTable*> tables;
+
+  if (!FakeBackend::Get().GetDevice(deviceID)) {
+    return {unexpect, Error::DEVICE_NOT_AVAILABLE};
+  }
+  std::unique_lock lock(mutex);
+  auto& table = tables[deviceID];
+  if (!table) {
+    // Intentionally leaked, like the platform tables
+    table = new AudioSessionTable();
+  }
+  return table;
+}
+
+result<void> SetAudioSessionVolume(
+  const std::string& deviceID,
+  const std::string& sessionID,
+  float volume) {
+  const auto table = GetAudioSessionTable(deviceID);
+  if (!table) {
+    return {unexpect, table.error()};
+  }
+  (*table)->Update(sessionID, [volume](AudioSessionInfo& info) {
+    info.volumeScalar = volume;
+  });
+  return {};
+}
+
+result<void> SetAudioSessionMute(
+  const std::string& deviceID,
+  const std::string& sessionID,
+  bool muted) {
+  const auto table = GetAudioSessionTable(deviceID);
+  if (!table) {
+    return {unexpect, table.error()};
+  }
+  (*table)->Update(
+    sessionID, [muted](AudioSessionInfo& info) { info.isMuted = muted; });
+  return {};
+}
+
+}// namespace FredEmmott::Audio
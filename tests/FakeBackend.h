@@ -0,0 +1,165 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <AudioDevices/AudioDevices.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace FredEmmott::Audio::Testing {
+
+class FakeRenderStream;
+
+// Devices are only added by the test; see `AddFakeDevice()`
+struct FakeDevice {
+  AudioDeviceInfo info;
+  Volume volume {.volumeScalar = 0.5f};
+  VolumeRange range {
+    .minDecibels = -96.0f,
+    .maxDecibels = 0.0f,
+    .incrementDecibels = 1.0f,
+    .volumeSteps = 96,
+  };
+  std::vector<float> channelVolumes {0.5f, 0.5f};
+  AudioDeviceStreamProperties streamProperties {
+    .format = {.sampleRate = 48000, .channels = 2},
+    .period = std::chrono::microseconds(10000),
+    .bufferFrames = 480,
+    .latency = std::chrono::microseconds(20000),
+  };
+  // Like the real backends, muting silences capture streams by default
+  bool isMuteAfterCapture {false};
+};
+
+/* Implements the platform backend functions in memory, so that the portable
+ * parts of the library can be tested on any platform.
+ *
+ * State is only changed by the test; changes are not reported to the library
+ * unless the test also calls one of the `Dispatch...()` or `Notify...()`
+ * functions, in the same way that native notifications are separate from
+ * native state.
+ */
+class FakeBackend final {
+ public:
+  // Invoked on the calling thread before every native call, without any lock
+  // held; e.g. to block, to simulate a hung device
+  using NativeCallHook = std::function<void(std::string_view function)>;
+
+  static FakeBackend& Get();
+
+  FakeBackend(const FakeBackend&) = delete;
+  FakeBackend& operator=(const FakeBackend&) = delete;
+
+  void AddDevice(const FakeDevice&);
+  void RemoveDevice(const std::string& deviceID);
+  // Returns `false` if the device doesn't exist
+  bool UpdateDevice(
+    const std::string& deviceID,
+    const std::function<void(FakeDevice&)>&);
+  std::optional<FakeDevice> GetDevice(const std::string& deviceID) const;
+  std::vector<std::string> GetDeviceIDs(AudioDeviceDirection) const;
+
+  void SetNativeDefault(
+    AudioDeviceDirection,
+    AudioDeviceRole,
+    const std::string& deviceID);
+  std::string GetNativeDefault(AudioDeviceDirection, AudioDeviceRole) const;
+
+  // Makes every later call to `function` fail, until cleared with
+  // `std::nullopt`
+  void SetFailure(std::string_view function, std::optional<Error>);
+  void SetNativeCallHook(NativeCallHook);
+  // Number of native calls made to `function` since the last `Reset()`
+  size_t GetCallCount(std::string_view function) const;
+
+  void Reset();
+
+  // Native notifications
+  void DispatchAdded(AudioDeviceDirection, const std::string& deviceID);
+  void DispatchRemoved(AudioDeviceDirection, const std::string& deviceID);
+  void DispatchDefaultChanged(
+    AudioDeviceDirection,
+    AudioDeviceRole,
+    const std::string& deviceID);
+  void DispatchStateChanged(
+    AudioDeviceDirection,
+    const std::string& deviceID,
+    AudioDeviceState);
+  void NotifyDeviceInfoChanged(const std::string& deviceID);
+  void NotifyStreamPropertiesChanged(const std::string& deviceID);
+  void NotifyVolumeChanged(const std::string& deviceID);
+
+  // Render streams are only rendered when the test asks; returns the first
+  // channel, or `std::nullopt` if the device has no started render stream
+  std::optional<std::vector<float>> Render(
+    const std::string& deviceID,
+    uint32_t frames);
+  // Number of render streams currently open for the device
+  size_t GetRenderStreamCount(const std::string& deviceID) const;
+
+  // Whether `InitializeNativeThread()` has been called on this thread
+  static bool IsNativeThreadInitialized();
+
+  // Called by the backend functions; returns the injected failure, if any
+  std::optional<Error> BeginNativeCall(std::string_view function);
+
+  using VolumeCallback = std::function<void(const FakeDevice&)>;
+  uint64_t AddVolumeCallback(const std::string& deviceID, VolumeCallback);
+  void RemoveVolumeCallback(uint64_t id);
+
+  using WatchCallback = std::function<void()>;
+  enum class WatchKind { DEVICE_INFO, STREAM_PROPERTIES };
+  uint64_t AddWatch(WatchKind, const std::string& deviceID, WatchCallback);
+  void RemoveWatch(uint64_t id);
+  // Number of watches currently registered for the device
+  size_t GetWatchCount(WatchKind, const std::string& deviceID) const;
+
+  void AddRenderStream(const std::string& deviceID, FakeRenderStream*);
+  // Waits for any in-progress `Render()` of the stream
+  void RemoveRenderStream(FakeRenderStream*);
+
+ private:
+  FakeBackend() = default;
+
+  mutable std::mutex mMutex;
+  std::map<std::string, FakeDevice> mDevices;
+  std::map<std::pair<AudioDeviceDirection, AudioDeviceRole>, std::string>
+    mDefaults;
+  std::map<std::string, Error, std::less<>> mFailures;
+  std::map<std::string, size_t, std::less<>> mCallCounts;
+  NativeCallHook mHook;
+
+  uint64_t mNextCallbackID {1};
+  std::map<uint64_t, std::pair<std::string, VolumeCallback>> mVolumeCallbacks;
+  std::map<uint64_t, std::tuple<WatchKind, std::string, WatchCallback>>
+    mWatches;
+  std::multimap<std::string, FakeRenderStream*> mRenderStreams;
+
+  void Notify(WatchKind, const std::string& deviceID);
+};
+
+// A connected device, with distinct names based on its ID
+FakeDevice MakeFakeDevice(
+  const std::string& id,
+  AudioDeviceDirection = AudioDeviceDirection::OUTPUT);
+
+// Adds `MakeFakeDevice(id, direction)` to the backend, after `configure` (if
+// provided) has changed anything else
+void AddFakeDevice(
+  const std::string& id,
+  AudioDeviceDirection = AudioDeviceDirection::OUTPUT,
+  const std::function<void(FakeDevice&)>& configure = {});
+
+}// namespace FredEmmott::Audio::Testing
@@ -0,0 +1,103 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+bool IsAudible(const std::vector<float>& samples) {
+  return std::ranges::any_of(samples, [](float s) { return s != 0; });
+}
+
+// The stream is stopped once the tone has finished, but kept open
+void TestPlaysThenStops() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("plays", AudioDeviceDirection::OUTPUT);
+
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(PlayIdentificationTone("plays").has_value());
+  const auto samples = backend.Render("plays", 4800);
+  CHECK(samples);
+  CHECK(IsAudible(*samples));
+
+  CHECK(WaitUntil([&]() { return !backend.Render("plays", 1); }));
+  // The default pattern is 320ms, followed by a 250ms delay
+  CHECK(
+    std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(570));
+  CHECK(backend.GetRenderStreamCount("plays") == 1);
+}
+
+void TestStreamIsReused() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("reused", AudioDeviceDirection::OUTPUT);
+
+  CHECK(PlayIdentificationTone("reused").has_value());
+  const auto first = backend.Render("reused", 2000);
+  CHECK(first);
+
+  // Replaces the tone that is already playing, from the start
+  CHECK(PlayIdentificationTone("reused").has_value());
+  CHECK(backend.Render("reused", 2000) == first);
+
+  CHECK(backend.GetCallCount("OpenNativeRenderStream") == 1);
+  CHECK(backend.GetRenderStreamCount("reused") == 1);
+}
+
+// A pooled stream that fails to start is replaced
+void TestFailedStartReopens() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("reopens", AudioDeviceDirection::OUTPUT);
+  CHECK(PlayIdentificationTone("reopens").has_value());
+
+  backend.SetFailure("NativeRenderStream::Start", Error::DEVICE_NOT_AVAILABLE);
+  auto played = PlayIdentificationTone("reopens");
+  CHECK(!played);
+  CHECK(played.error() == Error::DEVICE_NOT_AVAILABLE);
+  // Both the pooled stream, and the new one
+  CHECK(backend.GetCallCount("NativeRenderStream::Start") == 3);
+  CHECK(backend.GetRenderStreamCount("reopens") == 0);
+
+  backend.SetFailure("NativeRenderStream::Start", std::nullopt);
+  CHECK(PlayIdentificationTone("reopens").has_value());
+  CHECK(backend.GetCallCount("OpenNativeRenderStream") == 3);
+  CHECK(backend.GetRenderStreamCount("reopens") == 1);
+  CHECK(backend.Render("reopens", 1));
+}
+
+void TestUnsupportedDevices() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("input", AudioDeviceDirection::INPUT);
+
+  auto played = PlayIdentificationTone("input");
+  CHECK(!played);
+  CHECK(played.error() == Error::OPERATION_UNSUPPORTED);
+
+  played = PlayIdentificationTone("missing");
+  CHECK(!played);
+  CHECK(played.error() == Error::DEVICE_NOT_AVAILABLE);
+}
+
+}// namespace
+
+int main() {
+  TestPlaysThenStops();
+  TestStreamIsReused();
+  TestFailedStartReopens();
+  TestUnsupportedDevices();
+  return 0;
+}
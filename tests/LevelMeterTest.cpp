@@ -0,0 +1,222 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "LevelKernels.h"
+#include "LevelMeter.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+struct Levels {
+  std::vector<float> mPeaks;
+  std::vector<float> mSumSquares;
+};
+
+template <class T>
+Levels Reference(const std::vector<T>& samples, uint16_t channels) {
+  Levels ret {
+    .mPeaks = std::vector<float>(channels),
+    .mSumSquares = std::vector<float>(channels),
+  };
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const auto channel = i % channels;
+    const auto value = std::is_same_v<T, int16_t>
+      ? static_cast<float>(samples[i]) / 32768
+      : static_cast<float>(samples[i]);
+    ret.mPeaks[channel] = std::max(ret.mPeaks[channel], std::abs(value));
+    ret.mSumSquares[channel] += value * value;
+  }
+  return ret;
+}
+
+template <class T>
+void CheckMatchesReference(const std::vector<T>& samples, uint16_t channels) {
+  // Accumulates onto existing values
+  Levels actual {
+    .mPeaks = std::vector<float>(channels),
+    .mSumSquares = std::vector<float>(channels),
+  };
+  const auto half = (samples.size() / channels / 2) * channels;
+  const std::span<const T> all(samples);
+  AccumulateLevels(
+    all.first(half), channels, actual.mPeaks, actual.mSumSquares);
+  AccumulateLevels(
+    all.subspan(half), channels, actual.mPeaks, actual.mSumSquares);
+
+  const auto expected = Reference(samples, channels);
+  for (size_t i = 0; i < channels; ++i) {
+    CHECK(actual.mPeaks[i] == expected.mPeaks[i]);
+    // The vector paths sum in a different order
+    CHECK(
+      std::abs(actual.mSumSquares[i] - expected.mSumSquares[i])
+      <= expected.mSumSquares[i] * 1e-4f);
+  }
+}
+
+// Covers the vector paths, the scalar path for other channel counts, and
+// trailing samples that don't fill a vector
+void TestKernelsMatchReference() {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> distribution(-1, 1);
+  for (const uint16_t channels: {1, 2, 3, 4, 6}) {
+    std::vector<float> floats(1003 * channels);
+    std::vector<int16_t> int16s(floats.size());
+    for (size_t i = 0; i < floats.size(); ++i) {
+      // Different levels in each channel, so that mixing them up fails
+      floats[i] = distribution(random) * static_cast<float>(1 + (i % channels))
+        / 8;
+      int16s[i] = static_cast<int16_t>(floats[i] * 32767);
+    }
+    CheckMatchesReference(floats, channels);
+    CheckMatchesReference(int16s, channels);
+  }
+}
+
+void TestInt16Scale() {
+  const std::vector<int16_t> samples {-32768, 16384};
+  std::vector<float> peaks(1);
+  std::vector<float> sumSquares(1);
+  AccumulateLevels(std::span<const int16_t>(samples), 1, peaks, sumSquares);
+  CHECK(peaks[0] == 1.0f);
+  CHECK(sumSquares[0] == 1.25f);
+}
+
+std::vector<float> MakeSine(uint32_t frames, float leftAmplitude) {
+  std::vector<float> ret(frames * 2);
+  for (uint32_t i = 0; i < frames; ++i) {
+    // An integer number of cycles per buffer
+    const auto phase = 2 * std::numbers::pi_v<float> * static_cast<float>(i)
+      / 48;
+    ret[2 * i] = leftAmplitude * std::sin(phase);
+    ret[(2 * i) + 1] = leftAmplitude * 0.5f * std::sin(phase);
+  }
+  return ret;
+}
+
+void TestMeterPublishes() {
+  LevelMeter meter({
+    .publishInterval = std::chrono::milliseconds(10),
+    .decayTime = std::chrono::milliseconds(600),
+  });
+  CHECK(meter.GetLevels().sequenceNumber == 0);
+
+  // 5ms; not enough to publish
+  const auto loud = MakeSine(240, 0.5f);
+  const AudioBufferView buffer {
+    .mData = loud.data(),
+    .mFrames = 240,
+    .mChannels = 2,
+    .mSampleRate = 48000,
+  };
+  meter.Process(buffer);
+  CHECK(meter.GetLevels().sequenceNumber == 0);
+  meter.Process(buffer);
+
+  auto levels = meter.GetLevels();
+  CHECK(levels.sequenceNumber == 1);
+  CHECK(levels.channelCount == 2);
+  CHECK(std::abs(levels.channels[0].peak - 0.5f) < 0.001f);
+  CHECK(std::abs(levels.channels[0].rms - (0.5f / std::sqrt(2.0f))) < 0.001f);
+  CHECK(std::abs(levels.channels[0].smoothedDecibels - -6.02f) < 0.01f);
+  CHECK(std::abs(levels.channels[1].peak - 0.25f) < 0.001f);
+
+  // Silence decays at 60dB per `decayTime`, i.e. 1dB per 10ms
+  meter.Process({
+    .mFrames = 480,
+    .mChannels = 2,
+    .mSampleRate = 48000,
+    .mIsSilent = true,
+  });
+  levels = meter.GetLevels();
+  CHECK(levels.sequenceNumber == 2);
+  CHECK(levels.channels[0].peak == 0);
+  CHECK(levels.channels[0].rms == 0);
+  CHECK(std::abs(levels.channels[0].smoothedDecibels - -7.02f) < 0.01f);
+}
+
+void TestMeterLimitsChannels() {
+  LevelMeter meter({.publishInterval = std::chrono::milliseconds(1)});
+  constexpr uint16_t channels = AudioLevels::MaxChannels + 2;
+  std::vector<float> samples(48 * channels, 0.25f);
+  meter.Process({
+    .mData = samples.data(),
+    .mFrames = 48,
+    .mChannels = channels,
+    .mSampleRate = 48000,
+  });
+  const auto levels = meter.GetLevels();
+  CHECK(levels.channelCount == AudioLevels::MaxChannels);
+  CHECK(levels.channels.back().peak == 0.25f);
+
+  // Ignored
+  meter.Process({
+    .mData = samples.data(),
+    .mFrames = 1,
+    .mChannels = LevelMeter::MaxInputChannels + 1,
+    .mSampleRate = 48000,
+  });
+  CHECK(meter.GetLevels().sequenceNumber == levels.sequenceNumber);
+}
+
+// Readers on other threads see every publication whole, and in order
+void TestConcurrentReaders() {
+  LevelMeter meter({.publishInterval = std::chrono::milliseconds(1)});
+  std::atomic<bool> stop {false};
+  std::atomic<bool> failed {false};
+  std::thread reader([&]() {
+    uint64_t last = 0;
+    while (!stop) {
+      const auto levels = meter.GetLevels();
+      if (levels.sequenceNumber < last) {
+        failed = true;
+      }
+      last = levels.sequenceNumber;
+      // Every buffer has both channels at the same level
+      if (levels.channels[0].peak != levels.channels[1].peak) {
+        failed = true;
+      }
+    }
+  });
+
+  std::vector<float> samples(96);
+  for (int i = 0; i < 10000; ++i) {
+    std::ranges::fill(samples, static_cast<float>(i % 100) / 100);
+    meter.Process({
+      .mData = samples.data(),
+      .mFrames = 48,
+      .mChannels = 2,
+      .mSampleRate = 48000,
+    });
+  }
+  stop = true;
+  reader.join();
+  CHECK(!failed);
+  CHECK(meter.GetLevels().sequenceNumber == 10000);
+}
+
+}// namespace
+
+int main() {
+  TestKernelsMatchReference();
+  TestInt16Scale();
+  TestMeterPublishes();
+  TestMeterLimitsChannels();
+  TestConcurrentReaders();
+  return 0;
+}
@@ -0,0 +1,102 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MPSCQueue.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+
+namespace {
+
+void TestOrder() {
+  MPSCQueue<int> queue;
+  CHECK(!queue.Pop());
+
+  // Emptied and refilled, so the stub node is relinked each time
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 5; ++i) {
+      queue.Push(i);
+    }
+    for (int i = 0; i < 5; ++i) {
+      CHECK(queue.Pop() == i);
+    }
+    CHECK(!queue.Pop());
+  }
+
+  // Interleaved
+  queue.Push(1);
+  queue.Push(2);
+  CHECK(queue.Pop() == 1);
+  queue.Push(3);
+  CHECK(queue.Pop() == 2);
+  CHECK(queue.Pop() == 3);
+  CHECK(!queue.Pop());
+}
+
+void TestDestructorFreesValues() {
+  const auto value = std::make_shared<int>(0);
+  {
+    MPSCQueue<std::shared_ptr<int>> queue;
+    for (int i = 0; i < 3; ++i) {
+      queue.Push(value);
+    }
+    CHECK(value.use_count() == 4);
+  }
+  CHECK(value.use_count() == 1);
+}
+
+// Every value is received once, and each producer's values stay in order
+void TestConcurrentProducers() {
+  constexpr int ProducerCount = 4;
+  constexpr int PerProducer = 100000;
+
+  MPSCQueue<std::pair<int, int>> queue;
+  std::atomic<int> pushed {0};
+  std::vector<std::thread> producers;
+  for (int producer = 0; producer < ProducerCount; ++producer) {
+    producers.emplace_back([&queue, &pushed, producer]() {
+      for (int i = 0; i < PerProducer; ++i) {
+        queue.Push({producer, i});
+        pushed.fetch_add(1, std::memory_order_release);
+      }
+    });
+  }
+
+  std::vector<int> next(ProducerCount);
+  int received = 0;
+  while (received < ProducerCount * PerProducer) {
+    const auto value = queue.Pop();
+    if (!value) {
+      // Empty, or a `Push()` is in progress
+      std::this_thread::yield();
+      continue;
+    }
+    CHECK(value->second == next[value->first]);
+    ++next[value->first];
+    ++received;
+  }
+  for (auto& producer: producers) {
+    producer.join();
+  }
+  CHECK(!queue.Pop());
+  CHECK(pushed == ProducerCount * PerProducer);
+}
+
+}// namespace
+
+int main() {
+  TestOrder();
+  TestDestructorFreesValues();
+  TestConcurrentProducers();
+  return 0;
+}
@@ -0,0 +1,163 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "FakeBackend.h"
+#include "NativeCallGuard.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+void TestWithoutTimeout() {
+  NativeCallGuard guard;
+  const auto caller = std::this_thread::get_id();
+  const auto ret = guard.Call<int>("a", [caller]() -> result<int> {
+    CHECK(std::this_thread::get_id() == caller);
+    return 42;
+  });
+  CHECK(*ret == 42);
+}
+
+void TestResults() {
+  NativeCallGuard guard;
+  guard.SetTimeout(std::chrono::seconds(10));
+  const auto caller = std::this_thread::get_id();
+
+  auto value = guard.Call<std::string>("a", [caller]() -> result<std::string> {
+    // On an initialized library thread
+    CHECK(std::this_thread::get_id() != caller);
+    CHECK(FakeBackend::IsNativeThreadInitialized());
+    return std::string("value");
+  });
+  CHECK(*value == "value");
+
+  auto error = guard.Call<void>(
+    "a", []() -> result<void> { return {unexpect, Error::OUT_OF_RANGE}; });
+  CHECK(error.error() == Error::OUT_OF_RANGE);
+
+  // Nested calls run directly on the same thread
+  auto nested = guard.Call<bool>("a", [&guard]() -> result<bool> {
+    const auto outer = std::this_thread::get_id();
+    return guard.Call<bool>("b", [outer]() -> result<bool> {
+      return std::this_thread::get_id() == outer;
+    });
+  });
+  CHECK(nested.value());
+}
+
+// A hung call quarantines its device, but not others, until it returns
+void TestQuarantine() {
+  NativeCallGuard guard;
+  guard.SetTimeout(std::chrono::milliseconds(50));
+  const auto gate = std::make_shared<Gate>();
+  const auto returned = std::make_shared<std::atomic<bool>>(false);
+
+  const auto start = std::chrono::steady_clock::now();
+  auto hung = guard.Call<void>("hung", [gate, returned]() -> result<void> {
+    gate->Wait();
+    *returned = true;
+    return {};
+  });
+  CHECK(hung.error() == Error::TIMEOUT);
+  CHECK(
+    std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+
+  std::atomic<bool> ran {false};
+  auto quarantined = guard.Call<void>("hung", [&ran]() -> result<void> {
+    ran = true;
+    return {};
+  });
+  CHECK(quarantined.error() == Error::TIMEOUT);
+  CHECK(!ran);
+
+  // Other devices get their own threads
+  auto other = guard.Call<int>("other", []() -> result<int> { return 1; });
+  CHECK(*other == 1);
+
+  gate->Release();
+  CHECK(WaitUntil([&]() {
+    return guard.Call<void>("hung", []() -> result<void> { return {}; })
+      .has_value();
+  }));
+  CHECK(*returned);
+}
+
+// Calls still running when the guard is destroyed are allowed to finish
+void TestDestroyedWhileHung() {
+  const auto gate = std::make_shared<Gate>();
+  const auto returned = std::make_shared<std::atomic<bool>>(false);
+  {
+    NativeCallGuard guard;
+    guard.SetTimeout(std::chrono::milliseconds(10));
+    auto hung = guard.Call<void>("hung", [gate, returned]() -> result<void> {
+      gate->Wait();
+      *returned = true;
+      return {};
+    });
+    CHECK(hung.error() == Error::TIMEOUT);
+  }
+  gate->Release();
+  CHECK(WaitUntil([&]() { return returned->load(); }));
+}
+
+void TestBackendThread() {
+  NativeCallGuard guard;
+  guard.SetUseBackendThread(true);
+  const auto backendThread = guard.GetBackendThread();
+  auto ret = guard.Call<bool>("a", [backendThread]() -> result<bool> {
+    return backendThread->IsCurrentThread()
+      && FakeBackend::IsNativeThreadInitialized();
+  });
+  CHECK(ret.value());
+}
+
+// Via the public API, with the fake backend
+void TestPublicTimeout() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("slow");
+  const auto gate = std::make_shared<Gate>();
+  backend.SetNativeCallHook([gate](std::string_view function) {
+    if (function == "IsNativeDeviceMuted") {
+      gate->Wait();
+    }
+  });
+
+  auto context = CreateAudioContext();
+  context.SetNativeCallTimeout(std::chrono::milliseconds(20));
+  auto muted = context.IsAudioDeviceMuted("slow");
+  CHECK(muted.error() == Error::TIMEOUT);
+  // Without waiting
+  auto muting = context.MuteAudioDevice("slow");
+  CHECK(muting.error() == Error::TIMEOUT);
+  CHECK(backend.GetCallCount("MuteNativeDevice") == 0);
+
+  gate->Release();
+  backend.SetNativeCallHook({});
+  CHECK(
+    WaitUntil([&]() { return context.MuteAudioDevice("slow").has_value(); }));
+  CHECK(backend.GetDevice("slow")->volume.isMuted);
+}
+
+}// namespace
+
+int main() {
+  TestWithoutTimeout();
+  TestResults();
+  TestQuarantine();
+  TestDestroyedWhileHung();
+  TestBackendThread();
+  TestPublicTimeout();
+  return 0;
+}
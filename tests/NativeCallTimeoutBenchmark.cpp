@@ -0,0 +1,72 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+#include "Benchmark.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto Timeout = std::chrono::milliseconds(20);
+constexpr size_t Iterations = 1000;
+
+// How long callers wait on a hung device, and whether others are delayed
+void BenchmarkHungDevice() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("hung");
+  AddFakeDevice("healthy");
+  const auto gate = std::make_shared<Gate>();
+  backend.SetNativeCallHook([gate](std::string_view function) {
+    if (function == "IsNativeDeviceMuted") {
+      gate->Wait();
+    }
+  });
+
+  auto context = CreateAudioContext();
+  context.SetNativeCallTimeout(Timeout);
+  std::printf(
+    "native call timeout: %lldms\n", static_cast<long long>(Timeout.count()));
+
+  Samples first;
+  auto start = Clock::now();
+  CHECK(context.IsAudioDeviceMuted("hung").error() == Error::TIMEOUT);
+  first.Add(Clock::now() - start);
+  first.Print("first call to the hung device");
+
+  Samples quarantined;
+  Samples healthy;
+  for (size_t i = 0; i < Iterations; ++i) {
+    start = Clock::now();
+    CHECK(context.GetDeviceVolume("hung").error() == Error::TIMEOUT);
+    quarantined.Add(Clock::now() - start);
+
+    start = Clock::now();
+    CHECK(context.GetDeviceVolume("healthy").has_value());
+    healthy.Add(Clock::now() - start);
+  }
+  quarantined.Print("later calls to the hung device");
+  healthy.Print("calls to another device meanwhile");
+
+  gate->Release();
+  backend.SetNativeCallHook({});
+}
+
+}// namespace
+
+int main() {
+  BenchmarkHungDevice();
+  return 0;
+}
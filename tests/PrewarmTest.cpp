@@ -0,0 +1,185 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+void AddDevice(const std::string& id, AudioDeviceState state) {
+  AddFakeDevice(id, AudioDeviceDirection::OUTPUT, [state](auto& device) {
+    device.info.state = state;
+  });
+}
+
+// Records how devices were prewarmed, and when prewarming completed
+class Recorder final {
+ public:
+  Recorder() {
+    FakeBackend::Get().SetNativeCallHook([this](std::string_view function) {
+      if (function != "PrewarmNativeDevice") {
+        return;
+      }
+      std::unique_lock lock(mMutex);
+      if (!FakeBackend::IsNativeThreadInitialized()) {
+        mIsInitialized = false;
+      }
+      ++mInFlight;
+      mMaxInFlight = std::max(mMaxInFlight, mInFlight);
+      // Held until enough calls are running in parallel
+      if (mInFlight >= mParallelism) {
+        mIsReleased = true;
+        mChanged.notify_all();
+      }
+      mChanged.wait_for(
+        lock, std::chrono::seconds(10), [this]() { return mIsReleased; });
+      --mInFlight;
+    });
+  }
+
+  ~Recorder() {
+    FakeBackend::Get().SetNativeCallHook({});
+  }
+
+  void SetParallelism(size_t value) {
+    std::unique_lock lock(mMutex);
+    mParallelism = value;
+  }
+
+  void Release() {
+    std::unique_lock lock(mMutex);
+    mIsReleased = true;
+    mChanged.notify_all();
+  }
+
+  void Complete() {
+    std::unique_lock lock(mMutex);
+    ++mCompletions;
+    mChanged.notify_all();
+  }
+
+  bool WaitForCompletion() {
+    std::unique_lock lock(mMutex);
+    return mChanged.wait_for(lock, std::chrono::seconds(10), [this]() {
+      return mCompletions > 0;
+    });
+  }
+
+  size_t GetCompletions() {
+    std::unique_lock lock(mMutex);
+    return mCompletions;
+  }
+
+  size_t GetMaxInFlight() {
+    std::unique_lock lock(mMutex);
+    return mMaxInFlight;
+  }
+
+  bool IsInitialized() {
+    std::unique_lock lock(mMutex);
+    return mIsInitialized;
+  }
+
+ private:
+  std::mutex mMutex;
+  std::condition_variable mChanged;
+  size_t mParallelism {1};
+  bool mIsReleased {false};
+  size_t mInFlight {};
+  size_t mMaxInFlight {};
+  size_t mCompletions {};
+  bool mIsInitialized {true};
+};
+
+// Devices are prewarmed in parallel, on initialized threads
+void TestParallel() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  for (const auto id: {"a", "b", "c"}) {
+    AddDevice(id, AudioDeviceState::CONNECTED);
+  }
+
+  Recorder recorder;
+  recorder.SetParallelism(3);
+  PrewarmAudioDevices(
+    {.deviceIDs = {"a", "b", "c"}}, [&]() { recorder.Complete(); });
+  CHECK(recorder.WaitForCompletion());
+
+  CHECK(recorder.GetMaxInFlight() == 3);
+  CHECK(recorder.IsInitialized());
+  CHECK(backend.GetCallCount("PrewarmNativeDevice") == 3);
+}
+
+void TestDoesNotWait() {
+  FakeBackend::Get().Reset();
+  AddDevice("slow", AudioDeviceState::CONNECTED);
+
+  Recorder recorder;
+  // Never reached, so blocks until released
+  recorder.SetParallelism(2);
+  PrewarmAudioDevices({.deviceIDs = {"slow"}}, [&]() { recorder.Complete(); });
+  CHECK(recorder.GetCompletions() == 0);
+  recorder.Release();
+  CHECK(recorder.WaitForCompletion());
+}
+
+// By default, every connected device
+void TestConnectedDevices() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("connected", AudioDeviceState::CONNECTED);
+  AddDevice("unplugged", AudioDeviceState::DEVICE_NOT_PRESENT);
+
+  Recorder recorder;
+  recorder.Release();
+  PrewarmAudioDevices({}, [&]() { recorder.Complete(); });
+  CHECK(recorder.WaitForCompletion());
+  CHECK(backend.GetCallCount("PrewarmNativeDevice") == 1);
+}
+
+// Devices that fail are skipped
+void TestFailures() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("failing", AudioDeviceState::CONNECTED);
+  backend.SetFailure("PrewarmNativeDevice", Error::DEVICE_NOT_AVAILABLE);
+
+  Recorder recorder;
+  recorder.Release();
+  PrewarmAudioDevices(
+    {.deviceIDs = {"failing", "missing"}}, [&]() { recorder.Complete(); });
+  CHECK(recorder.WaitForCompletion());
+  CHECK(recorder.GetCompletions() == 1);
+  CHECK(backend.GetCallCount("PrewarmNativeDevice") == 2);
+  backend.SetFailure("PrewarmNativeDevice", std::nullopt);
+}
+
+// There's nothing to do, but it still completes
+void TestNoDevices() {
+  FakeBackend::Get().Reset();
+  Recorder recorder;
+  PrewarmAudioDevices({}, [&]() { recorder.Complete(); });
+  CHECK(recorder.WaitForCompletion());
+}
+
+}// namespace
+
+int main() {
+  TestParallel();
+  TestDoesNotWait();
+  TestConnectedDevices();
+  TestFailures();
+  TestNoDevices();
+  return 0;
+}
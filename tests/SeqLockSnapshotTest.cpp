@@ -0,0 +1,105 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "SeqLockSnapshot.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+
+namespace {
+
+// Several words, plus a size that isn't a multiple of a word
+struct Value {
+  std::array<uint64_t, 6> mWords {};
+  uint16_t mTail {};
+};
+
+void TestDefaultValue() {
+  const SeqLockSnapshot<Value> snapshot;
+  const auto value = snapshot.Load();
+  CHECK(value.mWords[0] == 0);
+  CHECK(value.mTail == 0);
+}
+
+// Every field is written with the same number, so a torn read shows up as a
+// mismatch
+void TestReadsAreNeverTorn() {
+  SeqLockSnapshot<Value> snapshot;
+  std::atomic<bool> stop {false};
+  std::atomic<size_t> torn {0};
+  std::atomic<size_t> reordered {0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      uint64_t last = 0;
+      while (!stop) {
+        const auto value = snapshot.Load();
+        const auto first = value.mWords.front();
+        for (const auto word: value.mWords) {
+          if (word != first) {
+            ++torn;
+          }
+        }
+        if (value.mTail != static_cast<uint16_t>(first)) {
+          ++torn;
+        }
+        if (first < last) {
+          ++reordered;
+        }
+        last = first;
+      }
+    });
+  }
+
+  for (uint64_t i = 1; i <= 200000; ++i) {
+    Value value;
+    value.mWords.fill(i);
+    value.mTail = static_cast<uint16_t>(i);
+    snapshot.Store(value);
+  }
+  stop = true;
+  for (auto& reader: readers) {
+    reader.join();
+  }
+
+  CHECK(torn == 0);
+  CHECK(reordered == 0);
+  CHECK(snapshot.Load().mWords.back() == 200000);
+}
+
+// A writer in another process can die during a `Store()`
+void TestTryLoadGivesUp() {
+  SeqLockSnapshot<Value> snapshot;
+  CHECK(snapshot.TryLoad(std::chrono::milliseconds(10)).has_value());
+
+  // The sequence number is the first member; leave it odd, as a writer that
+  // died during `Store()` would
+  static_assert(std::is_standard_layout_v<SeqLockSnapshot<Value>>);
+  reinterpret_cast<std::atomic<uint64_t>*>(&snapshot)->fetch_add(1);
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(!snapshot.TryLoad(std::chrono::milliseconds(10)).has_value());
+  CHECK(
+    std::chrono::steady_clock::now() - start
+    >= std::chrono::milliseconds(10));
+}
+
+}// namespace
+
+int main() {
+  TestDefaultValue();
+  TestReadsAreNeverTorn();
+  TestTryLoadGivesUp();
+  return 0;
+}
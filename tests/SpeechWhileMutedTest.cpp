@@ -0,0 +1,58 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <AudioDevices/AudioDevices.h>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+void AddDevice(const std::string& id, bool isMuteAfterCapture) {
+  AddFakeDevice(
+    id, AudioDeviceDirection::INPUT, [isMuteAfterCapture](auto& device) {
+      device.volume.isMuted = true;
+      device.isMuteAfterCapture = isMuteAfterCapture;
+    });
+}
+
+// Captured audio would always be silent
+void TestMuteBeforeCapture() {
+  FakeBackend::Get().Reset();
+  AddDevice("silenced", false);
+
+  auto handle = AddSpeechWhileMutedCallback("silenced", []() {});
+  CHECK(!handle);
+  CHECK(handle.error() == Error::OPERATION_UNSUPPORTED);
+}
+
+void TestMuteAfterCapture() {
+  FakeBackend::Get().Reset();
+  AddDevice("captured", true);
+
+  const auto handle = AddSpeechWhileMutedCallback("captured", []() {});
+  CHECK(handle);
+}
+
+void TestMissingDevice() {
+  FakeBackend::Get().Reset();
+
+  auto handle = AddSpeechWhileMutedCallback("missing", []() {});
+  CHECK(!handle);
+  CHECK(handle.error() == Error::DEVICE_NOT_AVAILABLE);
+}
+
+}// namespace
+
+int main() {
+  TestMuteBeforeCapture();
+  TestMuteAfterCapture();
+  TestMissingDevice();
+  return 0;
+}
@@ -0,0 +1,150 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "StreamPropertiesCache.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+void SetSampleRate(const std::string& id, uint32_t sampleRate) {
+  FakeBackend::Get().UpdateDevice(id, [sampleRate](FakeDevice& device) {
+    device.streamProperties.format.sampleRate = sampleRate;
+  });
+}
+
+uint32_t GetSampleRate(const std::string& id) {
+  const auto properties = GetDeviceStreamProperties(id);
+  CHECK(properties.has_value());
+  return properties->format.sampleRate;
+}
+
+// Long enough for a refresh to have happened, if one was going to
+void WaitForRefresh() {
+  std::this_thread::sleep_for(StreamPropertiesCache::RefreshDelay * 5);
+}
+
+void TestCachedUntilNotified() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("cached");
+
+  CHECK(GetSampleRate("cached") == 48000);
+  CHECK(GetSampleRate("cached") == 48000);
+  CHECK(backend.GetCallCount("QueryNativeStreamProperties") == 1);
+
+  // Not reported to the library, so not seen
+  SetSampleRate("cached", 44100);
+  CHECK(GetSampleRate("cached") == 48000);
+
+  backend.NotifyStreamPropertiesChanged("cached");
+  CHECK(GetSampleRate("cached") == 44100);
+  CHECK(GetSampleRate("cached") == 44100);
+  CHECK(backend.GetCallCount("QueryNativeStreamProperties") == 2);
+}
+
+// A result is not cached if it may have been stale by the time it returned
+void TestNotificationDuringQuery() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("racing");
+
+  std::atomic<bool> notified {false};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function == "QueryNativeStreamProperties" && !notified.exchange(true)) {
+      backend.NotifyStreamPropertiesChanged("racing");
+    }
+  });
+  CHECK(GetSampleRate("racing") == 48000);
+  CHECK(notified);
+  CHECK(GetSampleRate("racing") == 48000);
+  CHECK(GetSampleRate("racing") == 48000);
+  CHECK(backend.GetCallCount("QueryNativeStreamProperties") == 2);
+  backend.SetNativeCallHook({});
+}
+
+void TestSubscribers() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddFakeDevice("subscribed");
+
+  std::mutex mutex;
+  std::vector<uint32_t> notified;
+  {
+    const auto handle = AddDeviceStreamPropertiesCallback(
+      "subscribed", [&](const AudioDeviceStreamProperties& properties) {
+        std::unique_lock lock(mutex);
+        notified.push_back(properties.format.sampleRate);
+      });
+    CHECK(handle.has_value());
+
+    // A burst of notifications is one refresh
+    SetSampleRate("subscribed", 44100);
+    for (int i = 0; i < 5; ++i) {
+      backend.NotifyStreamPropertiesChanged("subscribed");
+    }
+    CHECK(WaitUntil([&]() {
+      std::unique_lock lock(mutex);
+      return !notified.empty();
+    }));
+    WaitForRefresh();
+
+    // Notifications without a change aren't passed on
+    backend.NotifyStreamPropertiesChanged("subscribed");
+    WaitForRefresh();
+    {
+      std::unique_lock lock(mutex);
+      CHECK(notified == std::vector<uint32_t> {44100});
+    }
+
+    SetSampleRate("subscribed", 96000);
+    backend.NotifyStreamPropertiesChanged("subscribed");
+    CHECK(WaitUntil([&]() {
+      std::unique_lock lock(mutex);
+      return notified.size() == 2;
+    }));
+    std::unique_lock lock(mutex);
+    CHECK(notified.back() == 96000);
+  }
+
+  // Unsubscribed by destroying the handle
+  SetSampleRate("subscribed", 48000);
+  backend.NotifyStreamPropertiesChanged("subscribed");
+  WaitForRefresh();
+  std::unique_lock lock(mutex);
+  CHECK(notified.size() == 2);
+}
+
+void TestMissingDevice() {
+  FakeBackend::Get().Reset();
+  auto properties = GetDeviceStreamProperties("missing");
+  CHECK(!properties);
+  CHECK(properties.error() == Error::DEVICE_NOT_AVAILABLE);
+
+  // Failures aren't cached
+  AddFakeDevice("missing");
+  CHECK(GetSampleRate("missing") == 48000);
+}
+
+}// namespace
+
+int main() {
+  TestCachedUntilNotified();
+  TestNotificationDuringQuery();
+  TestSubscribers();
+  TestMissingDevice();
+  return 0;
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+// Tests are plain executables; a failed check aborts, so that CTest reports
+// it, and a debugger stops at it
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::fprintf( \
+        stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      std::abort(); \
+    } \
+  } while (false)
+
+namespace FredEmmott::Audio::Testing {
+
+// For results delivered on library threads; returns `false` on timeout
+template <class F>
+bool WaitUntil(
+  F&& predicate,
+  std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Blocks calls until released; usually shared, as it can outlive the test
+class Gate final {
+ public:
+  void Wait() {
+    std::unique_lock lock(mMutex);
+    mReleased.wait(lock, [this]() { return mIsReleased; });
+  }
+
+  void Release() {
+    {
+      std::unique_lock lock(mMutex);
+      mIsReleased = true;
+    }
+    mReleased.notify_all();
+  }
+
+ private:
+  std::mutex mMutex;
+  std::condition_variable mReleased;
+  bool mIsReleased {false};
+};
+
+}// namespace FredEmmott::Audio::Testing
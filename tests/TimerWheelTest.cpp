@@ -0,0 +1,139 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+#include "TimerWheel.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using Clock = TimerWheel::Clock;
+
+void TestTimersRunInOrder() {
+  auto& timers = *GetTimerWheel();
+  std::mutex mutex;
+  std::vector<int> order;
+  const auto record = [&](int value) {
+    return [&, value]() {
+      std::unique_lock lock(mutex);
+      order.push_back(value);
+    };
+  };
+
+  const auto now = Clock::now();
+  // Further away than a full turn of the wheel, so it needs several rounds
+  timers.Schedule(now + (TimerWheel::Resolution * 600), record(3));
+  timers.Schedule(now + std::chrono::milliseconds(20), record(2));
+  // Already due
+  timers.Schedule(now - std::chrono::seconds(1), record(1));
+
+  CHECK(WaitUntil([&]() {
+    std::unique_lock lock(mutex);
+    return order.size() == 3;
+  }));
+  CHECK((order == std::vector {1, 2, 3}));
+  // Never early
+  CHECK(Clock::now() >= now + (TimerWheel::Resolution * 600));
+}
+
+void TestCancel() {
+  auto& timers = *GetTimerWheel();
+  std::atomic<bool> cancelledRan {false};
+  std::atomic<bool> otherRan {false};
+  const auto now = Clock::now();
+  const auto id = timers.Schedule(
+    now + std::chrono::milliseconds(20), [&]() { cancelledRan = true; });
+  timers.Schedule(
+    now + std::chrono::milliseconds(40), [&]() { otherRan = true; });
+  timers.Cancel(id);
+
+  CHECK(WaitUntil([&]() { return otherRan.load(); }));
+  CHECK(!cancelledRan);
+}
+
+// Timer callbacks make native calls, e.g. for volume ramps
+void TestThreadIsInitializedForNativeCalls() {
+  std::atomic<bool> ran {false};
+  std::atomic<bool> initialized {false};
+  GetTimerWheel()->Schedule(Clock::now(), [&]() {
+    initialized = FakeBackend::IsNativeThreadInitialized();
+    ran = true;
+  });
+  CHECK(WaitUntil([&]() { return ran.load(); }));
+  CHECK(initialized);
+}
+
+// Pending timers are discarded, and nothing runs afterwards
+void TestStop() {
+  TimerWheel timers;
+  const auto destroyed = std::make_shared<std::atomic<bool>>(false);
+  const auto ran = std::make_shared<std::atomic<bool>>(false);
+  // Destroyed along with the callback that captures it
+  std::shared_ptr<void> guard(
+    nullptr, [destroyed](void*) { *destroyed = true; });
+  timers.Schedule(
+    Clock::now() + std::chrono::seconds(10),
+    [guard = std::move(guard), ran]() { *ran = true; });
+
+  timers.Stop();
+  CHECK(*destroyed);
+  timers.Schedule(Clock::now(), [ran]() { *ran = true; });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  CHECK(!*ran);
+}
+
+// Stopping from a callback doesn't deadlock waiting for itself, and later
+// timers don't run
+void TestStopFromCallback() {
+  auto timers = std::make_unique<TimerWheel>();
+  std::atomic<bool> stopped {false};
+  std::atomic<bool> laterRan {false};
+  const auto now = Clock::now();
+  timers->Schedule(now, [&]() {
+    timers->Stop();
+    stopped = true;
+  });
+  timers->Schedule(
+    now + std::chrono::milliseconds(20), [&]() { laterRan = true; });
+
+  CHECK(WaitUntil([&]() { return stopped.load(); }));
+  timers.reset();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  CHECK(!laterRan);
+}
+
+// The wheel can be destroyed from its own callback
+void TestDestroyFromCallback() {
+  auto timers = new TimerWheel();
+  std::atomic<bool> destroyed {false};
+  timers->Schedule(Clock::now(), [&]() {
+    delete timers;
+    destroyed = true;
+  });
+  CHECK(WaitUntil([&]() { return destroyed.load(); }));
+}
+
+}// namespace
+
+int main() {
+  TestTimersRunInOrder();
+  TestCancel();
+  TestThreadIsInitializedForNativeCalls();
+  TestStop();
+  TestStopFromCallback();
+  TestDestroyFromCallback();
+  return 0;
+}
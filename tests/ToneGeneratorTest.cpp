@@ -0,0 +1,140 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#include "Testing.h"
+#include "ToneGenerator.h"
+
+using namespace FredEmmott::Audio;
+
+namespace {
+
+constexpr uint32_t SampleRate = 48000;
+// The default pattern: two 120ms beeps, 80ms apart
+constexpr uint32_t BeepFrames = 5760;
+constexpr uint32_t PeriodFrames = 9600;
+constexpr uint32_t TotalFrames = PeriodFrames + BeepFrames;
+constexpr uint32_t FadeFrames = 240;
+
+// Renders the first channel of stereo output, in `chunkFrames` pieces
+std::vector<float> Render(
+  ToneGenerator& generator,
+  uint32_t frames,
+  uint32_t chunkFrames) {
+  std::vector<float> ret;
+  std::vector<float> buffer(chunkFrames * 2);
+  while (ret.size() < frames) {
+    generator.Render({
+      .mData = buffer.data(),
+      .mFrames = chunkFrames,
+      .mChannels = 2,
+      .mSampleRate = SampleRate,
+    });
+    for (uint32_t i = 0; i < chunkFrames; ++i) {
+      // Every channel gets the same sample
+      CHECK(buffer[2 * i] == buffer[(2 * i) + 1]);
+      ret.push_back(buffer[2 * i]);
+    }
+  }
+  ret.resize(frames);
+  return ret;
+}
+
+void TestPattern() {
+  const IdentificationTonePattern pattern;
+  ToneGenerator generator;
+  generator.Reset(pattern, SampleRate);
+  const auto samples = Render(generator, TotalFrames + 1000, 1000);
+  CHECK(generator.IsFinished());
+
+  for (uint32_t i = 0; i < samples.size(); ++i) {
+    const auto offset = i % PeriodFrames;
+    if (i >= TotalFrames || offset >= BeepFrames) {
+      CHECK(samples[i] == 0);
+      continue;
+    }
+    if (offset < FadeFrames || offset >= BeepFrames - FadeFrames) {
+      CHECK(std::abs(samples[i]) <= pattern.gain);
+      continue;
+    }
+    // Each beep starts at phase 0
+    const auto expected = pattern.gain
+      * std::sin(
+        2 * std::numbers::pi * pattern.frequencyHz * offset / SampleRate);
+    CHECK(std::abs(samples[i] - expected) < 0.0001);
+  }
+}
+
+// Fades mean that no step between samples is larger than the sine's own
+void TestNoClicks() {
+  const IdentificationTonePattern pattern;
+  ToneGenerator generator;
+  generator.Reset(pattern, SampleRate);
+  const auto samples = Render(generator, TotalFrames + 100, 480);
+
+  const auto maxStep = pattern.gain * 2 * std::numbers::pi_v<float>
+    * pattern.frequencyHz / SampleRate;
+  for (size_t i = 1; i < samples.size(); ++i) {
+    CHECK(std::abs(samples[i] - samples[i - 1]) <= maxStep * 1.01f);
+  }
+}
+
+void TestChunkingDoesNotMatter() {
+  ToneGenerator whole;
+  whole.Reset({}, SampleRate);
+  ToneGenerator chunked;
+  chunked.Reset({}, SampleRate);
+  CHECK(
+    Render(whole, TotalFrames, TotalFrames)
+    == Render(chunked, TotalFrames, 7));
+}
+
+void TestInt16() {
+  ToneGenerator floatGenerator;
+  floatGenerator.Reset({}, SampleRate);
+  const auto floats = Render(floatGenerator, 2000, 2000);
+
+  ToneGenerator int16Generator;
+  int16Generator.Reset({}, SampleRate);
+  std::vector<int16_t> int16s(2000);
+  int16Generator.Render({
+    .mData = int16s.data(),
+    .mFrames = 2000,
+    .mChannels = 1,
+    .mSampleRate = SampleRate,
+    .mFormat = AudioSampleFormat::INT16,
+  });
+  for (size_t i = 0; i < int16s.size(); ++i) {
+    CHECK(int16s[i] == std::lrint(floats[i] * 32767));
+  }
+}
+
+void TestReset() {
+  ToneGenerator generator;
+  generator.Reset({.beepCount = 0}, SampleRate);
+  CHECK(generator.IsFinished());
+
+  generator.Reset({.beepCount = 1}, SampleRate);
+  CHECK(!generator.IsFinished());
+  const auto samples = Render(generator, BeepFrames + 10, BeepFrames + 10);
+  CHECK(generator.IsFinished());
+  CHECK(std::ranges::any_of(samples, [](float s) { return s != 0; }));
+}
+
+}// namespace
+
+int main() {
+  TestPattern();
+  TestNoClicks();
+  TestChunkingDoesNotMatter();
+  TestInt16();
+  TestReset();
+  return 0;
+}
@@ -0,0 +1,182 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include "Testing.h"
+#include "VoiceActivityDetector.h"
+
+using namespace FredEmmott::Audio;
+
+namespace {
+
+constexpr uint32_t SampleRate = 48000;
+constexpr uint32_t BufferFrames = 480;
+
+// Returns the end times of the buffers in which speech was detected, in
+// milliseconds
+std::vector<uint32_t> Detect(
+  const std::function<float(float seconds)>& generate,
+  float seconds,
+  AudioSampleFormat format = AudioSampleFormat::FLOAT32) {
+  VoiceActivityDetector detector({});
+  std::vector<float> floats(BufferFrames * 2);
+  std::vector<int16_t> int16s(floats.size());
+  std::vector<uint32_t> ret;
+
+  const auto buffers = static_cast<uint32_t>(seconds * 100);
+  for (uint32_t buffer = 0; buffer < buffers; ++buffer) {
+    for (uint32_t i = 0; i < BufferFrames; ++i) {
+      const auto time
+        = static_cast<float>((buffer * BufferFrames) + i) / SampleRate;
+      const auto value = generate(time);
+      floats[2 * i] = value;
+      // Only the first channel is analysed
+      floats[(2 * i) + 1] = 0;
+      int16s[2 * i] = static_cast<int16_t>(value * 32767);
+      int16s[(2 * i) + 1] = 0;
+    }
+    const auto isFloat = format == AudioSampleFormat::FLOAT32;
+    const AudioBufferView view {
+      .mData = isFloat ? static_cast<const void*>(floats.data())
+                       : static_cast<const void*>(int16s.data()),
+      .mFrames = BufferFrames,
+      .mChannels = 2,
+      .mSampleRate = SampleRate,
+      .mFormat = format,
+    };
+    if (detector.Process(view)) {
+      ret.push_back((buffer + 1) * 10);
+    }
+  }
+  return ret;
+}
+
+// A harmonic-rich tone with a 140Hz fundamental, like a voiced vowel
+float Voiced(float t) {
+  float ret = 0;
+  for (int harmonic = 1; harmonic < 8; ++harmonic) {
+    ret += std::sin(2 * std::numbers::pi_v<float> * 140 * harmonic * t)
+      / static_cast<float>(harmonic);
+  }
+  return 0.1f * ret;
+}
+
+class Noise final {
+ public:
+  explicit Noise(float amplitude) : mAmplitude(amplitude) {
+  }
+
+  float operator()() {
+    return mAmplitude * mDistribution(mRandom);
+  }
+
+ private:
+  float mAmplitude;
+  std::mt19937 mRandom {42};
+  std::normal_distribution<float> mDistribution {0, 1};
+};
+
+bool Between(float t, float start, float end) {
+  return t >= start && t < end;
+}
+
+void TestNoiseIsNotSpeech() {
+  Noise quiet(0.003f);
+  CHECK(Detect([&](float) { return quiet(); }, 4).empty());
+
+  // Loud, but crosses zero far too often to be voiced
+  Noise hiss(0.2f);
+  CHECK(Detect([&](float) { return hiss(); }, 4).empty());
+
+  Noise burst(1);
+  CHECK(Detect(
+          [&](float t) {
+            return burst() * (Between(t, 1, 1.5f) ? 0.2f : 0.003f);
+          },
+          4)
+          .empty());
+}
+
+void TestSpeechIsDetected() {
+  Noise noise(0.003f);
+  const auto detected = Detect(
+    [&](float t) { return noise() + (Between(t, 1, 1.6f) ? Voiced(t) : 0); },
+    3);
+  CHECK(detected.size() == 1);
+  // Only after `minimumSpeech`
+  CHECK(detected[0] >= 1150);
+  CHECK(detected[0] <= 1300);
+}
+
+void TestInt16() {
+  Noise noise(0.003f);
+  const auto detected = Detect(
+    [&](float t) { return noise() + (Between(t, 1, 1.6f) ? Voiced(t) : 0); },
+    3,
+    AudioSampleFormat::INT16);
+  CHECK(detected.size() == 1);
+}
+
+void TestShortSoundsAreIgnored() {
+  Noise noise(0.003f);
+  CHECK(Detect(
+          [&](float t) {
+            return noise() + (Between(t, 1, 1.1f) ? Voiced(t) : 0);
+          },
+          3)
+          .empty());
+}
+
+void TestHangover() {
+  Noise noise(0.003f);
+  // The second burst starts within the 2s hangover
+  auto detected = Detect(
+    [&](float t) {
+      const auto on = Between(t, 1, 1.5f) || Between(t, 1.8f, 2.3f);
+      return noise() + (on ? Voiced(t) : 0);
+    },
+    4);
+  CHECK(detected.size() == 1);
+
+  // ... and this one doesn't
+  detected = Detect(
+    [&](float t) {
+      const auto on = Between(t, 1, 1.5f) || Between(t, 4, 4.5f);
+      return noise() + (on ? Voiced(t) : 0);
+    },
+    5);
+  CHECK(detected.size() == 2);
+}
+
+void TestSilentBuffers() {
+  VoiceActivityDetector detector({});
+  for (int i = 0; i < 300; ++i) {
+    CHECK(!detector.Process({
+      .mFrames = BufferFrames,
+      .mChannels = 2,
+      .mSampleRate = SampleRate,
+      .mIsSilent = true,
+    }));
+  }
+}
+
+}// namespace
+
+int main() {
+  TestNoiseIsNotSpeech();
+  TestSpeechIsDetected();
+  TestInt16();
+  TestShortSoundsAreIgnored();
+  TestHangover();
+  TestSilentBuffers();
+  return 0;
+}
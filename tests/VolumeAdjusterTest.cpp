@@ -0,0 +1,187 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+#include "VolumeAdjuster.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+void AddDevice(const std::string& id, float scalar) {
+  AddFakeDevice(id, AudioDeviceDirection::OUTPUT, [scalar](auto& device) {
+    device.volume.volumeScalar = scalar;
+  });
+}
+
+float GetScalar(const std::string& id) {
+  return FakeBackend::Get().GetDevice(id)->volume.volumeScalar;
+}
+
+bool WaitForScalar(const std::string& id, float expected) {
+  return WaitUntil(
+    [&]() { return std::abs(GetScalar(id) - expected) < 0.0001f; });
+}
+
+void TestAccelerationFactor() {
+  using Clock = VolumeAdjuster::Clock;
+  const auto fast = std::chrono::duration_cast<Clock::duration>(
+    VolumeAdjuster::AccelerationWindow / 2);
+  CHECK(
+    VolumeAdjuster::GetAccelerationFactor(VolumeAcceleration::NONE, fast)
+    == 1.0f);
+  CHECK(
+    VolumeAdjuster::GetAccelerationFactor(VolumeAcceleration::LINEAR, fast)
+    == 2.0f);
+  CHECK(
+    VolumeAdjuster::GetAccelerationFactor(VolumeAcceleration::QUADRATIC, fast)
+    == 4.0f);
+  CHECK(
+    VolumeAdjuster::GetAccelerationFactor(
+      VolumeAcceleration::QUADRATIC, Clock::duration::zero())
+    == 16.0f);
+  CHECK(
+    VolumeAdjuster::GetAccelerationFactor(
+      VolumeAcceleration::LINEAR, VolumeAdjuster::AccelerationWindow)
+    == 1.0f);
+}
+
+void TestAdjustmentsAreCoalesced() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("coalesced", 0.5f);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 200; ++i) {
+    CHECK(AdjustDeviceVolumeBy("coalesced", 0.001f).has_value());
+  }
+  CHECK(WaitForScalar("coalesced", 0.7f));
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // Only the first adjustment reads the volume
+  CHECK(backend.GetCallCount("GetNativeDeviceVolume") == 1);
+  const auto maxWrites
+    = 2 + static_cast<size_t>(elapsed / VolumeAdjuster::MinWriteInterval);
+  CHECK(backend.GetCallCount("SetNativeDeviceVolumeScalar") <= maxWrites);
+}
+
+// A device that is slow to report its volume must not delay adjustments for
+// other devices
+void TestSlowReadDoesNotBlockOtherDevices() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("slow", 0.5f);
+  AddDevice("fast", 0.5f);
+
+  std::atomic<bool> reading {false};
+  std::atomic<bool> release {false};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function == "GetNativeDeviceVolume" && !reading.exchange(true)) {
+      while (!release) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::thread slow([]() {
+    CHECK(AdjustDeviceVolumeBy("slow", 0.25f).has_value());
+  });
+  CHECK(WaitUntil([&]() { return reading.load(); }));
+
+  std::atomic<bool> adjusted {false};
+  std::thread fast([&]() {
+    CHECK(AdjustDeviceVolumeBy("fast", 0.25f).has_value());
+    adjusted = true;
+  });
+  const auto fastCompleted = WaitUntil([&]() { return adjusted.load(); });
+  release = true;
+  slow.join();
+  fast.join();
+  backend.SetNativeCallHook({});
+
+  CHECK(fastCompleted);
+  CHECK(WaitForScalar("slow", 0.75f));
+  CHECK(WaitForScalar("fast", 0.75f));
+}
+
+void TestFailedWritesAreRetried() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("flaky", 0.5f);
+
+  // Fails every other write
+  std::atomic<int> writes {0};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function == "SetNativeDeviceVolumeScalar") {
+      backend.SetFailure(
+        function,
+        (writes++ % 2 == 0) ? std::optional {Error::UNKNOWN} : std::nullopt);
+    }
+  });
+
+  CHECK(AdjustDeviceVolumeBy("flaky", 0.1f).has_value());
+  CHECK(WaitForScalar("flaky", 0.6f));
+  CHECK(AdjustDeviceVolumeBy("flaky", 0.1f).has_value());
+  CHECK(WaitForScalar("flaky", 0.7f));
+  backend.SetNativeCallHook({});
+  backend.SetFailure("SetNativeDeviceVolumeScalar", std::nullopt);
+}
+
+void TestPersistentFailuresAreReported() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("broken", 0.5f);
+  backend.SetFailure("SetNativeDeviceVolumeScalar", Error::UNKNOWN);
+
+  std::mutex mutex;
+  std::vector<Error> errors;
+  const auto onWriteFailed = [&](Error error) {
+    std::unique_lock lock(mutex);
+    errors.push_back(error);
+  };
+  const auto getErrors = [&]() {
+    std::unique_lock lock(mutex);
+    return errors;
+  };
+
+  CHECK(AdjustDeviceVolumeBy(
+          "broken", 0.1f, VolumeAcceleration::NONE, onWriteFailed)
+          .has_value());
+  CHECK(WaitUntil([&]() { return !getErrors().empty(); }));
+  CHECK(getErrors() == std::vector {Error::UNKNOWN});
+  CHECK(
+    backend.GetCallCount("SetNativeDeviceVolumeScalar")
+    == VolumeAdjuster::MaxWriteAttempts);
+
+  // Reported once; the next adjustment isn't affected by the old failure,
+  // and starts over from the device
+  backend.SetFailure("SetNativeDeviceVolumeScalar", std::nullopt);
+  CHECK(AdjustDeviceVolumeBy(
+          "broken", 0.2f, VolumeAcceleration::NONE, onWriteFailed)
+          .has_value());
+  CHECK(WaitForScalar("broken", 0.7f));
+  std::this_thread::sleep_for(VolumeAdjuster::MinWriteInterval * 2);
+  CHECK(getErrors().size() == 1);
+}
+
+}// namespace
+
+int main() {
+  TestAccelerationFactor();
+  TestAdjustmentsAreCoalesced();
+  TestSlowReadDoesNotBlockOtherDevices();
+  TestFailedWritesAreRetried();
+  TestPersistentFailuresAreReported();
+  return 0;
+}
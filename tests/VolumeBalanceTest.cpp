@@ -0,0 +1,99 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+#include "VolumeBalance.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+bool Near(float a, float b) {
+  return std::abs(a - b) < 0.0001f;
+}
+
+void TestGetBalance() {
+  CHECK(!GetVolumeBalance(std::vector<float> {0.5f}));
+  CHECK(*GetVolumeBalance(std::vector<float> {0.5f, 0.5f}) == 0);
+  CHECK(Near(*GetVolumeBalance(std::vector<float> {1, 0}), -1));
+  CHECK(Near(*GetVolumeBalance(std::vector<float> {0, 1}), 1));
+  // Silence is centered
+  CHECK(*GetVolumeBalance(std::vector<float> {0, 0}) == 0);
+  // Only the first two channels count
+  CHECK(*GetVolumeBalance(std::vector<float> {0.3f, 0.3f, 1, 0}) == 0);
+}
+
+// Balance doesn't change the total power, and round-trips
+void TestConstantPower() {
+  for (const auto balance: {-1.0f, -0.5f, 0.0f, 0.25f, 1.0f}) {
+    std::vector<float> volumes {0.5f, 0.5f, 0.75f};
+    const auto power = std::hypot(volumes[0], volumes[1]);
+    ApplyVolumeBalance(volumes, balance);
+    CHECK(Near(std::hypot(volumes[0], volumes[1]), power));
+    CHECK(Near(*GetVolumeBalance(volumes), balance));
+    CHECK(volumes[2] == 0.75f);
+  }
+}
+
+// Both channels are scaled down together, so the balance is kept
+void TestFullScale() {
+  std::vector<float> volumes {1, 1};
+  ApplyVolumeBalance(volumes, 1);
+  CHECK(Near(volumes[0], 0));
+  CHECK(Near(volumes[1], 1));
+
+  volumes = {1, 1};
+  ApplyVolumeBalance(volumes, 0.5f);
+  CHECK(Near(volumes[1], 1));
+  CHECK(volumes[0] < 1);
+  CHECK(Near(*GetVolumeBalance(volumes), 0.5f));
+}
+
+void AddDevice(const std::string& id, std::vector<float> channelVolumes) {
+  AddFakeDevice(id, AudioDeviceDirection::OUTPUT, [&](auto& device) {
+    device.channelVolumes = std::move(channelVolumes);
+  });
+}
+
+void TestDevices() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("stereo", {0.5f, 0.5f});
+  AddDevice("mono", {0.5f});
+
+  auto balance = GetDeviceVolumeBalance("stereo");
+  CHECK(*balance == 0);
+  CHECK(SetDeviceVolumeBalance("stereo", -0.5f).has_value());
+  balance = GetDeviceVolumeBalance("stereo");
+  CHECK(Near(*balance, -0.5f));
+  const auto volumes = backend.GetDevice("stereo")->channelVolumes;
+  CHECK(volumes[0] > volumes[1]);
+
+  auto set = SetDeviceVolumeBalance("stereo", 1.5f);
+  CHECK(set.error() == Error::OUT_OF_RANGE);
+  set = SetDeviceVolumeBalance("mono", 0);
+  CHECK(set.error() == Error::OPERATION_UNSUPPORTED);
+  balance = GetDeviceVolumeBalance("mono");
+  CHECK(balance.error() == Error::OPERATION_UNSUPPORTED);
+  set = SetDeviceVolumeBalance("missing", 0);
+  CHECK(set.error() == Error::DEVICE_NOT_AVAILABLE);
+}
+
+}// namespace
+
+int main() {
+  TestGetBalance();
+  TestConstantPower();
+  TestFullScale();
+  TestDevices();
+  return 0;
+}
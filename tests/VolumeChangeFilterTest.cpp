@@ -0,0 +1,119 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <array>
+
+#include "Testing.h"
+#include "VolumeChangeFilter.h"
+
+using namespace FredEmmott::Audio;
+
+namespace {
+
+constexpr auto AllFields = VolumeChangedFields::MUTE
+  | VolumeChangedFields::SCALAR | VolumeChangedFields::DECIBELS
+  | VolumeChangedFields::STEP | VolumeChangedFields::CHANNELS;
+
+const Volume Initial {
+  .isMuted = false,
+  .volumeScalar = 0.5f,
+  .volumeDecibels = -10.0f,
+  .volumeStep = 50,
+};
+
+void TestChangesOnlyDropsEchoes() {
+  VolumeChangeFilter filter(CallbackDelivery::CHANGES_ONLY, AllFields, Initial);
+  CHECK(!filter.Update(Initial));
+
+  auto louder = Initial;
+  louder.volumeScalar = 0.6f;
+  louder.volumeDecibels = -8.0f;
+  const auto event = filter.Update(louder);
+  CHECK(event);
+  CHECK(
+    event->changedFields
+    == (VolumeChangedFields::SCALAR | VolumeChangedFields::DECIBELS));
+  CHECK(event->volume.volumeScalar == 0.6f);
+
+  // The echo of our own write
+  CHECK(!filter.Update(louder));
+}
+
+void TestAllNotificationsDeliversEverything() {
+  VolumeChangeFilter filter(
+    CallbackDelivery::ALL_NOTIFICATIONS, AllFields, Initial);
+  const auto event = filter.Update(Initial);
+  CHECK(event);
+  CHECK(event->changedFields == VolumeChangedFields::NONE);
+}
+
+void TestUninterestingFieldsAreIgnored() {
+  VolumeChangeFilter filter(
+    CallbackDelivery::CHANGES_ONLY, VolumeChangedFields::MUTE, Initial);
+  auto louder = Initial;
+  louder.volumeScalar = 0.9f;
+  CHECK(!filter.Update(louder));
+
+  auto muted = louder;
+  muted.isMuted = true;
+  const auto event = filter.Update(muted);
+  CHECK(event);
+  CHECK(event->changedFields == VolumeChangedFields::MUTE);
+}
+
+void TestNoInitialValue() {
+  VolumeChangeFilter filter(
+    CallbackDelivery::CHANGES_ONLY, AllFields, std::nullopt);
+  const auto event = filter.Update(Initial);
+  CHECK(event);
+  CHECK(
+    event->changedFields
+    == (VolumeChangedFields::MUTE | VolumeChangedFields::SCALAR
+        | VolumeChangedFields::DECIBELS | VolumeChangedFields::STEP));
+}
+
+void TestChannelVolumes() {
+  VolumeChangeFilter filter(CallbackDelivery::CHANGES_ONLY, AllFields, Initial);
+  std::array<float, 2> channels {0.5f, 0.5f};
+  // The first channel volumes are a change, as there were none before
+  auto event = filter.Update(Initial, channels);
+  CHECK(event);
+  CHECK(event->changedFields == VolumeChangedFields::CHANNELS);
+  // Refers to the caller's buffer, rather than a copy
+  CHECK(event->channelVolumes.data() == channels.data());
+
+  CHECK(!filter.Update(Initial, channels));
+  // Notifications without channel volumes don't clear them
+  CHECK(!filter.Update(Initial));
+
+  channels[1] = 0.25f;
+  event = filter.Update(Initial, channels);
+  CHECK(event);
+  CHECK(event->changedFields == VolumeChangedFields::CHANNELS);
+}
+
+void TestSequenceNumbersCountSuppressedNotifications() {
+  VolumeChangeFilter filter(CallbackDelivery::CHANGES_ONLY, AllFields, Initial);
+  auto volume = Initial;
+  volume.volumeStep = 51;
+  CHECK(filter.Update(volume)->sequenceNumber == 1);
+  CHECK(!filter.Update(volume));
+  CHECK(!filter.Update(volume));
+  volume.volumeStep = 52;
+  CHECK(filter.Update(volume)->sequenceNumber == 4);
+}
+
+}// namespace
+
+int main() {
+  TestChangesOnlyDropsEchoes();
+  TestAllNotificationsDeliversEverything();
+  TestUninterestingFieldsAreIgnored();
+  TestNoInitialValue();
+  TestChannelVolumes();
+  TestSequenceNumbersCountSuppressedNotifications();
+  return 0;
+}
@@ -0,0 +1,85 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <array>
+#include <cmath>
+
+#include "Testing.h"
+#include "VolumeCurve.h"
+
+using namespace FredEmmott::Audio;
+
+namespace {
+
+const std::array Ranges {
+  VolumeRange {
+    .minDecibels = -96,
+    .maxDecibels = 0,
+    .incrementDecibels = 1,
+    .volumeSteps = 97,
+  },
+  VolumeRange {
+    .minDecibels = -63.5f,
+    .maxDecibels = 12,
+    .incrementDecibels = 0.5f,
+    .volumeSteps = 152,
+  },
+};
+
+bool Near(float a, float b) {
+  return std::abs(a - b) < 0.0001f;
+}
+
+void TestDecibels() {
+  for (const auto& range: Ranges) {
+    const VolumeCurve curve(range);
+    CHECK(Near(curve.ScalarToDecibels(0), range.minDecibels));
+    CHECK(Near(curve.ScalarToDecibels(1), range.maxDecibels));
+    CHECK(Near(
+      curve.ScalarToDecibels(0.5f),
+      (range.minDecibels + range.maxDecibels) / 2));
+    // Out of range values are clamped
+    CHECK(Near(curve.ScalarToDecibels(-0.5f), range.minDecibels));
+    CHECK(Near(curve.ScalarToDecibels(1.5f), range.maxDecibels));
+
+    for (int i = 0; i <= 1000; ++i) {
+      const auto scalar = static_cast<float>(i) / 1000;
+      const auto decibels = curve.ScalarToDecibels(scalar);
+      CHECK(Near(curve.DecibelsToScalar(decibels), scalar));
+    }
+    CHECK(curve.DecibelsToScalar(range.maxDecibels + 10) == 1.0f);
+    CHECK(curve.DecibelsToScalar(range.minDecibels - 10) == 0.0f);
+  }
+
+  // A fixed-gain device is always at full volume
+  const VolumeCurve fixed({.volumeSteps = 1});
+  CHECK(fixed.DecibelsToScalar(0) == 1.0f);
+}
+
+void TestSteps() {
+  const VolumeCurve curve(Ranges[0]);
+  CHECK(curve.ScalarToStep(0) == 0);
+  CHECK(curve.ScalarToStep(1) == 96);
+  CHECK(curve.ScalarToStep(0.5f) == 48);
+  CHECK(curve.ScalarToStep(2) == 96);
+  CHECK(curve.StepToScalar(48) == 0.5f);
+  CHECK(curve.StepToScalar(1000) == 1.0f);
+  for (uint32_t step = 0; step < 97; ++step) {
+    CHECK(curve.ScalarToStep(curve.StepToScalar(step)) == step);
+  }
+
+  const VolumeCurve single({.volumeSteps = 1});
+  CHECK(single.ScalarToStep(0.5f) == 0);
+  CHECK(single.StepToScalar(0) == 1.0f);
+}
+
+}// namespace
+
+int main() {
+  TestDecibels();
+  TestSteps();
+  return 0;
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FakeBackend.h"
+#include "Testing.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t DeviceCount = 500;
+constexpr auto Duration = std::chrono::milliseconds(500);
+
+// Many concurrent ramps share the one timer thread
+void BenchmarkConcurrentRamps() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  std::vector<std::string> ids;
+  for (size_t i = 0; i < DeviceCount; ++i) {
+    ids.push_back("ramp" + std::to_string(i));
+    AddFakeDevice(ids.back(), AudioDeviceDirection::OUTPUT, [](auto& device) {
+      device.volume.volumeScalar = 0.2f;
+    });
+  }
+
+  std::mutex mutex;
+  Samples starts;
+  Samples lateness;
+  std::atomic<size_t> completed {0};
+  for (const auto& id: ids) {
+    const auto start = Clock::now();
+    const auto due = start + Duration;
+    CHECK(RampDeviceVolume(
+      id,
+      0.8f,
+      Duration,
+      VolumeRampCurve::LINEAR,
+      [&, due](VolumeRampResult result) {
+        CHECK(result == VolumeRampResult::COMPLETED);
+        {
+          std::unique_lock lock(mutex);
+          lateness.Add(Clock::now() - due);
+        }
+        ++completed;
+      }));
+    starts.Add(Clock::now() - start);
+  }
+  CHECK(WaitUntil([&]() { return completed == DeviceCount; }));
+
+  std::printf(
+    "%zu concurrent ramps over %lldms\n",
+    DeviceCount,
+    static_cast<long long>(Duration.count()));
+  starts.Print("RampDeviceVolume()");
+  lateness.Print("completion after due");
+  std::printf(
+    "writes per ramp: %.1f\n",
+    static_cast<double>(backend.GetCallCount("SetNativeDeviceVolumeScalar"))
+      / DeviceCount);
+}
+
+}// namespace
+
+int main() {
+  BenchmarkConcurrentRamps();
+  return 0;
+}
@@ -0,0 +1,257 @@
+/* Copyright (c) 2019-present, Fred Emmott
+ *
+ * This source code is licensed under the MIT-style license found in the
+ * LICENSE file.
+ */
+
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include "FakeBackend.h"
+#include "Testing.h"
+#include "VolumeRampScheduler.h"
+
+using namespace FredEmmott::Audio;
+using namespace FredEmmott::Audio::Testing;
+
+namespace {
+
+using namespace std::chrono_literals;
+
+void AddDevice(const std::string& id, float scalar) {
+  AddFakeDevice(id, AudioDeviceDirection::OUTPUT, [scalar](auto& device) {
+    device.volume.volumeScalar = scalar;
+  });
+}
+
+float GetScalar(const std::string& id) {
+  return FakeBackend::Get().GetDevice(id)->volume.volumeScalar;
+}
+
+class Completion final {
+ public:
+  std::function<void(VolumeRampResult)> GetCallback() {
+    return [this](VolumeRampResult result) {
+      mResult = result;
+      mIsDone = true;
+    };
+  }
+
+  bool Wait() {
+    return WaitUntil([this]() { return mIsDone.load(); });
+  }
+
+  VolumeRampResult GetResult() const {
+    return mResult;
+  }
+
+ private:
+  std::atomic<bool> mIsDone {false};
+  std::atomic<VolumeRampResult> mResult {};
+};
+
+bool StartRamp(
+  const std::string& deviceID,
+  float target,
+  std::chrono::milliseconds duration,
+  Completion& completion) {
+  return RampDeviceVolume(
+           deviceID,
+           target,
+           duration,
+           VolumeRampCurve::LINEAR,
+           completion.GetCallback())
+    .has_value();
+}
+
+// Echoes our own writes back as notifications, like the OS does
+class Notifier final {
+ public:
+  explicit Notifier(const std::string& deviceID)
+    : mThread([this, deviceID]() {
+        while (!mStop) {
+          FakeBackend::Get().NotifyVolumeChanged(deviceID);
+          std::this_thread::sleep_for(1ms);
+        }
+      }) {
+  }
+
+  ~Notifier() {
+    mStop = true;
+    mThread.join();
+  }
+
+ private:
+  std::atomic<bool> mStop {false};
+  std::thread mThread;
+};
+
+void TestCurves() {
+  for (const auto curve:
+       {VolumeRampCurve::LINEAR,
+        VolumeRampCurve::EASE_IN,
+        VolumeRampCurve::EASE_OUT,
+        VolumeRampCurve::EASE_IN_OUT}) {
+    CHECK(VolumeRampScheduler::ApplyCurve(curve, 0) == 0);
+    CHECK(VolumeRampScheduler::ApplyCurve(curve, 1) == 1);
+    CHECK(VolumeRampScheduler::ApplyCurve(curve, 2) == 1);
+  }
+  CHECK(VolumeRampScheduler::ApplyCurve(VolumeRampCurve::EASE_IN, 0.5f) < 0.5f);
+  CHECK(
+    VolumeRampScheduler::ApplyCurve(VolumeRampCurve::EASE_OUT, 0.5f) > 0.5f);
+}
+
+// Interruptions come from notifications, so frames only write
+void TestRampDoesNotPollVolume() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("ramp", 0.2f);
+  const Notifier notifier("ramp");
+
+  Completion completion;
+  CHECK(StartRamp("ramp", 0.8f, 200ms, completion));
+  CHECK(completion.Wait());
+  CHECK(completion.GetResult() == VolumeRampResult::COMPLETED);
+  CHECK(std::abs(GetScalar("ramp") - 0.8f) < 0.0001f);
+
+  // One read to start the ramp, and one to start the change filter
+  CHECK(backend.GetCallCount("GetNativeDeviceVolume") <= 2);
+  CHECK(backend.GetCallCount("SetNativeDeviceVolumeScalar") >= 3);
+}
+
+void TestExternalChangeInterrupts() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("interrupted", 0.2f);
+
+  Completion completion;
+  CHECK(StartRamp("interrupted", 0.8f, 10s, completion));
+  CHECK(WaitUntil([&]() {
+    return backend.GetCallCount("SetNativeDeviceVolumeScalar") >= 2;
+  }));
+
+  backend.UpdateDevice(
+    "interrupted", [](FakeDevice& device) { device.volume.volumeScalar = 1; });
+  backend.NotifyVolumeChanged("interrupted");
+  CHECK(completion.Wait());
+  CHECK(completion.GetResult() == VolumeRampResult::INTERRUPTED);
+  std::this_thread::sleep_for(50ms);
+  CHECK(GetScalar("interrupted") == 1);
+}
+
+// A frame may still be writing the replaced ramp's value when the new ramp
+// starts; that write must not look like an interruption
+// Without notifications, frames read the volume back instead
+void TestUnsupportedNotifications() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("unnotified", 0.2f);
+  backend.SetFailure(
+    "AddAudioDeviceVolumeChangeCallback", Error::OPERATION_UNSUPPORTED);
+
+  Completion completed;
+  CHECK(StartRamp("unnotified", 0.8f, 100ms, completed));
+  CHECK(completed.Wait());
+  CHECK(completed.GetResult() == VolumeRampResult::COMPLETED);
+  CHECK(std::abs(GetScalar("unnotified") - 0.8f) < 0.0001f);
+
+  const auto writes = backend.GetCallCount("SetNativeDeviceVolumeScalar");
+  Completion interrupted;
+  CHECK(StartRamp("unnotified", 0.2f, 10s, interrupted));
+  CHECK(WaitUntil([&]() {
+    return backend.GetCallCount("SetNativeDeviceVolumeScalar") >= writes + 2;
+  }));
+  // No notification; changed just before a frame reads the volume back
+  std::atomic<bool> change {true};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function == "GetNativeDeviceVolume" && change.exchange(false)) {
+      backend.UpdateDevice("unnotified", [](FakeDevice& device) {
+        device.volume.volumeScalar = 1;
+      });
+    }
+  });
+  CHECK(interrupted.Wait());
+  CHECK(interrupted.GetResult() == VolumeRampResult::INTERRUPTED);
+  std::this_thread::sleep_for(50ms);
+  CHECK(GetScalar("unnotified") == 1);
+
+  backend.SetNativeCallHook({});
+  backend.SetFailure("AddAudioDeviceVolumeChangeCallback", std::nullopt);
+}
+
+void TestReplacedMidFrame() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("replaced", 0.2f);
+  const Notifier notifier("replaced");
+
+  std::atomic<bool> writing {false};
+  std::atomic<bool> release {false};
+  backend.SetNativeCallHook([&](std::string_view function) {
+    if (function == "SetNativeDeviceVolumeScalar" && !writing.exchange(true)) {
+      while (!release) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // Reaches its target in the first frame, so that its write is a jump
+  Completion first;
+  CHECK(StartRamp("replaced", 0.8f, 0ms, first));
+  CHECK(WaitUntil([&]() { return writing.load(); }));
+
+  Completion second;
+  CHECK(StartRamp("replaced", 0.3f, 100ms, second));
+  CHECK(first.Wait());
+  CHECK(first.GetResult() == VolumeRampResult::CANCELLED);
+
+  release = true;
+  CHECK(second.Wait());
+  CHECK(second.GetResult() == VolumeRampResult::COMPLETED);
+  CHECK(std::abs(GetScalar("replaced") - 0.3f) < 0.0001f);
+  backend.SetNativeCallHook({});
+}
+
+void TestCancel() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("cancelled", 0.2f);
+
+  Completion completion;
+  CHECK(StartRamp("cancelled", 0.8f, 10s, completion));
+  CancelDeviceVolumeRamp("cancelled");
+  // Invoked on this thread
+  CHECK(completion.GetResult() == VolumeRampResult::CANCELLED);
+
+  const auto writes = backend.GetCallCount("SetNativeDeviceVolumeScalar");
+  std::this_thread::sleep_for(50ms);
+  CHECK(backend.GetCallCount("SetNativeDeviceVolumeScalar") <= writes + 1);
+}
+
+void TestFailedWrite() {
+  auto& backend = FakeBackend::Get();
+  backend.Reset();
+  AddDevice("failing", 0.2f);
+  backend.SetFailure("SetNativeDeviceVolumeScalar", Error::UNKNOWN);
+
+  Completion completion;
+  CHECK(StartRamp("failing", 0.8f, 1s, completion));
+  CHECK(completion.Wait());
+  CHECK(completion.GetResult() == VolumeRampResult::FAILED);
+  backend.SetFailure("SetNativeDeviceVolumeScalar", std::nullopt);
+}
+
+}// namespace
+
+int main() {
+  TestCurves();
+  TestRampDoesNotPollVolume();
+  TestExternalChangeInterrupts();
+  TestUnsupportedNotifications();
+  TestReplacedMidFrame();
+  TestCancel();
+  TestFailedWrite();
+  return 0;
+}